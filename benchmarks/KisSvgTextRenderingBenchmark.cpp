@@ -0,0 +1,182 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisSvgTextRenderingBenchmark.h"
+
+#include <QTest>
+#include <QImage>
+#include <QPainter>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <KoShapeManager.h>
+#include <KoShapePaintingContext.h>
+#include <KoSvgTextShape.h>
+#include <KoSvgTextShapeMarkupConverter.h>
+#include <MockShapes.h>
+
+#define NUM_TEXT_SHAPES 400
+#define NUM_COLUMNS 8
+
+namespace {
+
+void renderPage(const QList<KoShape*> &shapes, const QSize &pageSize)
+{
+    QImage page(pageSize, QImage::Format_ARGB32_Premultiplied);
+    page.fill(Qt::white);
+
+    QPainter painter(&page);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    KoShapePaintingContext paintContext;
+
+    Q_FOREACH (KoShape *shape, shapes) {
+        KoShapeManager::renderSingleShape(shape, painter, paintContext);
+    }
+}
+
+struct RenderPageJob : public QRunnable
+{
+    RenderPageJob(const QList<KoShape*> &shapes, const QSize &pageSize)
+        : m_shapes(shapes),
+          m_pageSize(pageSize)
+    {
+    }
+
+    void run() override {
+        renderPage(m_shapes, m_pageSize);
+    }
+
+    QList<KoShape*> m_shapes;
+    QSize m_pageSize;
+};
+
+void renderPageInWorkerThread(const QList<KoShape*> &shapes, const QSize &pageSize)
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(1);
+    pool.start(new RenderPageJob(shapes, pageSize));
+    pool.waitForDone();
+}
+
+struct RenderPaintJobsJob : public QRunnable
+{
+    RenderPaintJobsJob(KoShapeManager *shapeManager,
+                       const KoShapeManager::PaintJobsOrder &jobsOrder)
+        : m_shapeManager(shapeManager),
+          m_jobsOrder(jobsOrder)
+    {
+    }
+
+    void run() override {
+        Q_FOREACH (const KoShapeManager::PaintJob &job, m_jobsOrder.jobs) {
+            QImage image(job.viewUpdateRect.size(), QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::white);
+
+            QPainter painter(&image);
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.setClipRect(QRect(QPoint(), job.viewUpdateRect.size()));
+            painter.setTransform(QTransform::fromTranslate(-job.viewUpdateRect.x(), -job.viewUpdateRect.y()));
+
+            m_shapeManager->paintJob(painter, job, false);
+        }
+    }
+
+    KoShapeManager *m_shapeManager;
+    KoShapeManager::PaintJobsOrder m_jobsOrder;
+};
+
+/**
+ * Renders the page the way KisShapeLayerCanvas does it: the shapes are
+ * cloned by preparePaintJobs() in the GUI thread and the clones are
+ * painted in a worker thread.
+ */
+void renderPaintJobsInWorkerThread(KoShapeManager *shapeManager, const QSize &pageSize)
+{
+    KoShapeManager::PaintJobsOrder jobsOrder;
+    jobsOrder.jobs << KoShapeManager::PaintJob(QRectF(QPointF(), pageSize), QRect(QPoint(), pageSize));
+    jobsOrder.uncroppedViewUpdateRect = QRect(QPoint(), pageSize);
+
+    shapeManager->preparePaintJobs(jobsOrder, 0);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(1);
+    pool.start(new RenderPaintJobsJob(shapeManager, jobsOrder));
+    pool.waitForDone();
+}
+
+}
+
+void KisSvgTextRenderingBenchmark::initTestCase()
+{
+    const QSizeF balloonSize(240, 120);
+
+    for (int i = 0; i < NUM_TEXT_SHAPES; i++) {
+        KoSvgTextShape *shape = new KoSvgTextShape();
+
+        KoSvgTextShapeMarkupConverter converter(shape);
+        converter.convertFromSvg(
+            QString("<text fill=\"#000000\" stroke=\"#ffffff\" stroke-width=\"0.5\">"
+                    "<tspan x=\"0\" dy=\"1.2em\">Balloon %1: what was that noise?</tspan>"
+                    "<tspan x=\"0\" dy=\"1.2em\">I don't know, but it came</tspan>"
+                    "<tspan x=\"0\" dy=\"1.2em\">from the <tspan font-weight=\"bold\">basement</tspan>!</tspan>"
+                    "</text>").arg(i),
+            "<defs/>",
+            QRectF(QPointF(), balloonSize), 72.0);
+
+        shape->setPosition(QPointF((i % NUM_COLUMNS) * balloonSize.width(),
+                                   (i / NUM_COLUMNS) * balloonSize.height()));
+
+        m_shapes.append(shape);
+    }
+
+    const int numRows = (NUM_TEXT_SHAPES + NUM_COLUMNS - 1) / NUM_COLUMNS;
+    m_pageSize = QSizeF(NUM_COLUMNS * balloonSize.width(), numRows * balloonSize.height()).toSize();
+}
+
+void KisSvgTextRenderingBenchmark::cleanupTestCase()
+{
+    qDeleteAll(m_shapes);
+    m_shapes.clear();
+}
+
+void KisSvgTextRenderingBenchmark::benchmarkRenderGuiThread()
+{
+    QBENCHMARK {
+        renderPage(m_shapes, m_pageSize);
+    }
+}
+
+void KisSvgTextRenderingBenchmark::benchmarkRenderWorkerThread()
+{
+    QBENCHMARK {
+        renderPageInWorkerThread(m_shapes, m_pageSize);
+    }
+}
+
+void KisSvgTextRenderingBenchmark::benchmarkRenderClonedShapesWorkerThread()
+{
+    MockCanvas canvas;
+    KoShapeManager shapeManager(&canvas, m_shapes);
+
+    QBENCHMARK {
+        renderPaintJobsInWorkerThread(&shapeManager, m_pageSize);
+    }
+}
+
+QTEST_MAIN(KisSvgTextRenderingBenchmark)
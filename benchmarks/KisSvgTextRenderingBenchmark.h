@@ -0,0 +1,50 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSVGTEXTRENDERINGBENCHMARK_H
+#define KISSVGTEXTRENDERINGBENCHMARK_H
+
+#include <QtTest>
+
+class KoShape;
+
+/**
+ * Renders a comic-like page with hundreds of text shapes, the same
+ * way as a vector layer does it, from the GUI thread and from a
+ * worker thread. The last case clones the shapes via
+ * KoShapeManager::preparePaintJobs() before every render, like
+ * KisShapeLayerCanvas does.
+ */
+class KisSvgTextRenderingBenchmark : public QObject
+{
+    Q_OBJECT
+
+private:
+    QList<KoShape*> m_shapes;
+    QSize m_pageSize;
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkRenderGuiThread();
+    void benchmarkRenderWorkerThread();
+    void benchmarkRenderClonedShapesWorkerThread();
+};
+
+#endif // KISSVGTEXTRENDERINGBENCHMARK_H
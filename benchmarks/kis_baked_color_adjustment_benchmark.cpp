@@ -0,0 +1,197 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <QTest>
+
+#include "kis_baked_color_adjustment_benchmark.h"
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorSpaceConstants.h>
+#include <KoColorModelStandardIds.h>
+#include <KoCompositeColorTransformation.h>
+#include <KoLut3DColorTransformation.h>
+
+#include "filter/kis_filter_registry.h"
+#include "filter/kis_filter_configuration.h"
+#include "filter/kis_color_transformation_filter.h"
+#include <KisGlobalResourcesInterface.h>
+
+const int NUM_PIXELS = 1024 * 1024;
+
+KoColorTransformation* KisBakedColorAdjustmentBenchmark::createAdjustmentChain(const KoColorSpace *cs)
+{
+    QVector<KoColorTransformation*> transforms;
+
+    auto createTransform = [cs] (const QString &id, const QVariantMap &properties) -> KoColorTransformation* {
+        KisColorTransformationFilter *filter =
+            dynamic_cast<KisColorTransformationFilter*>(KisFilterRegistry::instance()->value(id).data());
+        if (!filter) return 0;
+
+        KisFilterConfigurationSP config = filter->defaultConfiguration(KisGlobalResourcesInterface::instance());
+        for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+            config->setProperty(it.key(), it.value());
+        }
+
+        return filter->createTransformation(cs, config);
+    };
+
+    QVariantMap hsv;
+    hsv["h"] = 20;
+    hsv["s"] = 15;
+    hsv["v"] = -5;
+    transforms << createTransform("hsvadjustment", hsv);
+
+    QVariantMap colorBalance;
+    colorBalance["cyan_red_midtones"] = 20;
+    colorBalance["yellow_blue_highlights"] = -15;
+    transforms << createTransform("colorbalance", colorBalance);
+
+    transforms << createTransform("desaturate", QVariantMap());
+
+    return KoCompositeColorTransformation::createOptimizedCompositeTransform(transforms);
+}
+
+QByteArray KisBakedColorAdjustmentBenchmark::randomPixels(const KoColorSpace *cs)
+{
+    QByteArray pixels(NUM_PIXELS * cs->pixelSize(), 0);
+
+    srand(31524744);
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = rand() % 256;
+    }
+
+    // keep the pixels opaque, the adjustments are not interesting for transparent ones
+    for (int i = 0; i < NUM_PIXELS; i++) {
+        cs->setOpacity(reinterpret_cast<quint8*>(pixels.data()) + i * cs->pixelSize(), OPACITY_OPAQUE_U8, 1);
+    }
+
+    return pixels;
+}
+
+void KisBakedColorAdjustmentBenchmark::benchmarkDirect_data()
+{
+    QTest::addColumn<QString>("depth");
+
+    QTest::newRow("rgb8") << Integer8BitsColorDepthID.id();
+    QTest::newRow("rgb16") << Integer16BitsColorDepthID.id();
+}
+
+void KisBakedColorAdjustmentBenchmark::benchmarkDirect()
+{
+    QFETCH(QString, depth);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depth, 0);
+
+    QScopedPointer<KoColorTransformation> transform(createAdjustmentChain(cs));
+    QVERIFY(transform);
+
+    QByteArray src = randomPixels(cs);
+    QByteArray dst(src.size(), 0);
+
+    QBENCHMARK {
+        transform->transform(reinterpret_cast<const quint8*>(src.constData()),
+                             reinterpret_cast<quint8*>(dst.data()), NUM_PIXELS);
+    }
+}
+
+void KisBakedColorAdjustmentBenchmark::benchmarkBaked_data()
+{
+    benchmarkDirect_data();
+}
+
+void KisBakedColorAdjustmentBenchmark::benchmarkBaked()
+{
+    QFETCH(QString, depth);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depth, 0);
+
+    QScopedPointer<KoColorTransformation> transform(createAdjustmentChain(cs));
+    QVERIFY(transform);
+
+    QScopedPointer<KoColorTransformation> lut(KoLut3DColorTransformation::bake(transform.data(), cs));
+    QVERIFY(lut);
+
+    QByteArray src = randomPixels(cs);
+    QByteArray dst(src.size(), 0);
+
+    QBENCHMARK {
+        lut->transform(reinterpret_cast<const quint8*>(src.constData()),
+                       reinterpret_cast<quint8*>(dst.data()), NUM_PIXELS);
+    }
+}
+
+void KisBakedColorAdjustmentBenchmark::benchmarkBake_data()
+{
+    benchmarkDirect_data();
+}
+
+void KisBakedColorAdjustmentBenchmark::benchmarkBake()
+{
+    QFETCH(QString, depth);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depth, 0);
+
+    QScopedPointer<KoColorTransformation> transform(createAdjustmentChain(cs));
+    QVERIFY(transform);
+
+    QBENCHMARK {
+        QScopedPointer<KoColorTransformation> lut(KoLut3DColorTransformation::bake(transform.data(), cs));
+    }
+}
+
+void KisBakedColorAdjustmentBenchmark::testMaxError_data()
+{
+    benchmarkDirect_data();
+}
+
+void KisBakedColorAdjustmentBenchmark::testMaxError()
+{
+    QFETCH(QString, depth);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depth, 0);
+
+    QScopedPointer<KoColorTransformation> transform(createAdjustmentChain(cs));
+    QVERIFY(transform);
+
+    QScopedPointer<KoColorTransformation> lut(KoLut3DColorTransformation::bake(transform.data(), cs));
+    QVERIFY(lut);
+
+    QByteArray src = randomPixels(cs);
+    QByteArray refDst(src.size(), 0);
+    QByteArray lutDst(src.size(), 0);
+
+    transform->transform(reinterpret_cast<const quint8*>(src.constData()),
+                         reinterpret_cast<quint8*>(refDst.data()), NUM_PIXELS);
+    lut->transform(reinterpret_cast<const quint8*>(src.constData()),
+                   reinterpret_cast<quint8*>(lutDst.data()), NUM_PIXELS);
+
+    QVector<float> refChannels(cs->channelCount());
+    QVector<float> lutChannels(cs->channelCount());
+    float maxError = 0.0;
+
+    for (int i = 0; i < NUM_PIXELS; i++) {
+        cs->normalisedChannelsValue(reinterpret_cast<const quint8*>(refDst.constData()) + i * cs->pixelSize(), refChannels);
+        cs->normalisedChannelsValue(reinterpret_cast<const quint8*>(lutDst.constData()) + i * cs->pixelSize(), lutChannels);
+
+        for (int ch = 0; ch < refChannels.size(); ch++) {
+            maxError = qMax(maxError, qAbs(refChannels[ch] - lutChannels[ch]));
+        }
+    }
+
+    qDebug() << "Max error of the baked transformation:" << depth
+             << maxError << "(" << qRound(maxError * 255) << "of 255 )";
+}
+
+QTEST_MAIN(KisBakedColorAdjustmentBenchmark)
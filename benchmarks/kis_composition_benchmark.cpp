@@ -48,6 +48,8 @@
 #include <KoColorSpaceTraits.h>
 #include <KoCompositeOpAlphaDarken.h>
 #include <KoCompositeOpOver.h>
+#include <KoCompositeOpGeneric.h>
+#include <KoCompositeOpRegistry.h>
 #include <KoOptimizedCompositeOpFactory.h>
 #include <KoAlphaDarkenParamsWrapper.h>
 
@@ -290,8 +292,36 @@ inline bool comparePixels(channel_type *p1, channel_type *p2, channel_type prec)
          fuzzyCompare(p1[3], p2[3], prec));
 }
 
+/**
+ * Compares the pixels with the colors multiplied by alpha. The colors of
+ * the (almost) transparent pixels are not significant, and the integer
+ * generic ops lose their precision there.
+ */
+template <typename channel_type>
+inline bool comparePixelsPremultiplied(channel_type *p1, channel_type *p2, qreal prec) {
+    const qreal unit = KoColorSpaceMathsTraits<channel_type>::unitValue;
+
+    if (qAbs(qreal(p1[3]) - qreal(p2[3])) > prec) {
+        return false;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        const qreal c1 = qreal(p1[i]) * p1[3] / unit;
+        const qreal c2 = qreal(p2[i]) * p2[3] / unit;
+
+        // floating point channels may go above the unit value
+        const qreal scale = qMax(qreal(1.0), qMax(qAbs(qreal(p1[i])), qAbs(qreal(p2[i]))) / unit);
+
+        if (qAbs(c1 - c2) > prec * scale) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 template <typename channel_type>
-bool compareTwoOpsPixels(QVector<Tile> &tiles, channel_type prec) {
+bool compareTwoOpsPixels(QVector<Tile> &tiles, channel_type prec, bool premultiplied = false) {
     channel_type *dst1 = reinterpret_cast<channel_type*>(tiles[0].dst);
     channel_type *dst2 = reinterpret_cast<channel_type*>(tiles[1].dst);
 
@@ -299,7 +329,11 @@ bool compareTwoOpsPixels(QVector<Tile> &tiles, channel_type prec) {
     channel_type *src2 = reinterpret_cast<channel_type*>(tiles[1].src);
 
     for (int i = 0; i < numPixels; i++) {
-        if (!comparePixels<channel_type>(dst1, dst2, prec)) {
+        const bool isEqual = premultiplied ?
+            comparePixelsPremultiplied<channel_type>(dst1, dst2, prec) :
+            comparePixels<channel_type>(dst1, dst2, prec);
+
+        if (!isEqual) {
             qDebug() << "Wrong result:" << i;
             qDebug() << "Act: " << dst1[0] << dst1[1] << dst1[2] << dst1[3];
             qDebug() << "Exp: " << dst2[0] << dst2[1] << dst2[2] << dst2[3];
@@ -322,7 +356,7 @@ bool compareTwoOpsPixels(QVector<Tile> &tiles, channel_type prec) {
     return true;
 }
 
-bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp *op2)
+bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp *op2, bool premultiplied = false)
 {
     Q_ASSERT(op1->colorSpace()->pixelSize() == op2->colorSpace()->pixelSize());
     const quint32 pixelSize = op1->colorSpace()->pixelSize();
@@ -352,10 +386,14 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
 
     bool compareResult = true;
     if (pixelSize == 4) {
-        compareResult = compareTwoOpsPixels<quint8>(tiles, 10);
+        compareResult = premultiplied ?
+            compareTwoOpsPixels<quint8>(tiles, 2, true) :
+            compareTwoOpsPixels<quint8>(tiles, 10);
     }
     else if (pixelSize == 16) {
-        compareResult = compareTwoOpsPixels<float>(tiles, 2e-7);
+        compareResult = premultiplied ?
+            compareTwoOpsPixels<float>(tiles, 1e-6, true) :
+            compareTwoOpsPixels<float>(tiles, 2e-7);
     }
     else {
         qFatal("Pixel size %i is not implemented", pixelSize);
@@ -366,6 +404,61 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
     return compareResult;
 }
 
+template <class Traits>
+QVector<KoCompositeOp*> createGenericSCOps(const KoColorSpace *cs)
+{
+    typedef typename Traits::channels_type T;
+
+    QVector<KoCompositeOp*> ops;
+    ops << new KoCompositeOpGenericSC<Traits, &cfMultiply<T> >(cs, COMPOSITE_MULT, "Multiply", KoCompositeOp::categoryArithmetic());
+    ops << new KoCompositeOpGenericSC<Traits, &cfScreen<T> >(cs, COMPOSITE_SCREEN, "Screen", KoCompositeOp::categoryLight());
+    ops << new KoCompositeOpGenericSC<Traits, &cfOverlay<T> >(cs, COMPOSITE_OVERLAY, "Overlay", KoCompositeOp::categoryMix());
+    ops << new KoCompositeOpGenericSC<Traits, &cfHardLight<T> >(cs, COMPOSITE_HARD_LIGHT, "Hard Light", KoCompositeOp::categoryLight());
+    ops << new KoCompositeOpGenericSC<Traits, &cfColorDodge<T> >(cs, COMPOSITE_DODGE, "Color Dodge", KoCompositeOp::categoryLight());
+    ops << new KoCompositeOpGenericSC<Traits, &cfSoftLight<T> >(cs, COMPOSITE_SOFT_LIGHT_PHOTOSHOP, "Soft Light (Photoshop)", KoCompositeOp::categoryLight());
+    ops << new KoCompositeOpGenericSC<Traits, &cfDarkenOnly<T> >(cs, COMPOSITE_DARKEN, "Darken", KoCompositeOp::categoryDark());
+    ops << new KoCompositeOpGenericSC<Traits, &cfLightenOnly<T> >(cs, COMPOSITE_LIGHTEN, "Lighten", KoCompositeOp::categoryLight());
+    ops << new KoCompositeOpGenericSC<Traits, &cfAddition<T> >(cs, COMPOSITE_ADD, "Addition", KoCompositeOp::categoryArithmetic());
+    ops << new KoCompositeOpGenericSC<Traits, &cfAddition<T> >(cs, COMPOSITE_LINEAR_DODGE, "Linear Dodge", KoCompositeOp::categoryLight());
+    ops << new KoCompositeOpGenericSC<Traits, &cfSubtract<T> >(cs, COMPOSITE_SUBTRACT, "Subtract", KoCompositeOp::categoryArithmetic());
+    ops << new KoCompositeOpGenericSC<Traits, &cfDifference<T> >(cs, COMPOSITE_DIFF, "Difference", KoCompositeOp::categoryNegative());
+    return ops;
+}
+
+template <class Traits>
+bool compareGenericSCOps(const KoColorSpace *cs, bool haveMask)
+{
+    bool result = true;
+    QVector<KoCompositeOp*> ops = createGenericSCOps<Traits>(cs);
+
+    Q_FOREACH (KoCompositeOp *opExp, ops) {
+        KoCompositeOp *opAct = Traits::pixelSize == 4 ?
+            KoOptimizedCompositeOpFactory::createGenericSCOp32(cs, opExp->id(), opExp->description(), opExp->category()) :
+            KoOptimizedCompositeOpFactory::createGenericSCOp128(cs, opExp->id(), opExp->description(), opExp->category());
+
+#ifdef HAVE_VC
+        if (!opAct) {
+            qDebug() << "No optimized version of" << opExp->id();
+            result = false;
+            continue;
+        }
+#else
+        // there are no optimized ops without vector instructions
+        if (!opAct) continue;
+#endif
+
+        if (!compareTwoOps(haveMask, opAct, opExp, true)) {
+            qDebug() << "Wrong result of" << opExp->id();
+            result = false;
+        }
+
+        delete opAct;
+    }
+
+    qDeleteAll(ops);
+    return result;
+}
+
 QString getTestName(bool haveMask,
                     const int srcAlignmentShift,
                     const int dstAlignmentShift,
@@ -710,6 +803,24 @@ void KisCompositionBenchmark::compareRgbF32OverOps()
     delete opAct;
 }
 
+void KisCompositionBenchmark::compareGenericSCOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    QVERIFY(::compareGenericSCOps<KoBgrU8Traits>(cs, true));
+}
+
+void KisCompositionBenchmark::compareGenericSCOpsNoMask()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    QVERIFY(::compareGenericSCOps<KoBgrU8Traits>(cs, false));
+}
+
+void KisCompositionBenchmark::compareRgbF32GenericSCOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F32", "");
+    QVERIFY(::compareGenericSCOps<KoRgbF32Traits>(cs, true));
+}
+
 void KisCompositionBenchmark::testRgb8CompositeAlphaDarkenLegacy()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
@@ -45,6 +45,9 @@ private Q_SLOTS:
     void compareOverOps();
     void compareOverOpsNoMask();
     void compareRgbF32OverOps();
+    void compareGenericSCOps();
+    void compareGenericSCOpsNoMask();
+    void compareRgbF32GenericSCOps();
 
     void testRgb8CompositeAlphaDarkenLegacy();
     void testRgb8CompositeAlphaDarkenOptimized();
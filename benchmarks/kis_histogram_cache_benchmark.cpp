@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <QTest>
+
+#include "kis_histogram_cache_benchmark.h"
+#include "kis_benchmark_values.h"
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColor.h>
+
+#include "kis_paint_device.h"
+#include <kis_iterator_ng.h>
+#include <KisTileHistogramCache.h>
+
+const int NUM_DABS = 10;
+const int DAB_SIZE = 30;
+
+void KisHistogramCacheBenchmark::initTestCase()
+{
+    m_colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    m_device = new KisPaintDevice(m_colorSpace);
+    m_bounds = QRect(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+    KoColor color(m_colorSpace);
+    srand(31524744);
+
+    KisSequentialIterator it(m_device, m_bounds);
+    while (it.nextPixel()) {
+        color.fromQColor(QColor(rand() % 255, rand() % 255, rand() % 255));
+        memcpy(it.rawData(), color.data(), m_colorSpace->pixelSize());
+    }
+}
+
+void KisHistogramCacheBenchmark::benchmarkCloneAndSubsample()
+{
+    // the way the histogram docker used to compute the histogram
+    QBENCHMARK {
+        KisPaintDeviceSP clone = new KisPaintDevice(m_colorSpace);
+        clone->makeCloneFrom(m_device, m_bounds);
+
+        const quint32 channelCount = clone->channelCount();
+        const quint32 pixelSize = clone->pixelSize();
+        const quint32 nSkip = 1 + ((m_bounds.width() * m_bounds.height()) >> 20);
+        quint32 toSkip = nSkip;
+
+        QVector<QVector<quint32>> bins(channelCount, QVector<quint32>(256, 0));
+
+        KisSequentialConstIterator it(clone, clone->exactBounds());
+
+        int numConseqPixels = it.nConseqPixels();
+        while (it.nextPixels(numConseqPixels)) {
+            numConseqPixels = it.nConseqPixels();
+            const quint8* pixel = it.rawDataConst();
+            for (int k = 0; k < numConseqPixels; ++k) {
+                if (--toSkip == 0) {
+                    for (quint32 chan = 0; chan < channelCount; ++chan) {
+                        bins[chan][m_colorSpace->scaleToU8(pixel, chan)]++;
+                    }
+                    toSkip = nSkip;
+                }
+                pixel += pixelSize;
+            }
+        }
+    }
+}
+
+void KisHistogramCacheBenchmark::benchmarkFullCount()
+{
+    KisTileHistogramCache cache;
+
+    QBENCHMARK {
+        cache.reset();
+        cache.update(m_device, m_bounds);
+    }
+}
+
+void KisHistogramCacheBenchmark::benchmarkDabsIncremental()
+{
+    KisTileHistogramCache cache;
+    cache.update(m_device, m_bounds);
+
+    KisPaintDeviceSP device = new KisPaintDevice(*m_device);
+    KoColor color(m_colorSpace);
+    srand(31524744);
+
+    QBENCHMARK {
+        for (int i = 0; i < NUM_DABS; i++) {
+            const QRect dabRect(rand() % (m_bounds.width() - DAB_SIZE),
+                                rand() % (m_bounds.height() - DAB_SIZE),
+                                DAB_SIZE, DAB_SIZE);
+
+            color.fromQColor(QColor(rand() % 255, rand() % 255, rand() % 255));
+            device->fill(dabRect, color);
+            cache.setDirty(dabRect);
+        }
+
+        cache.update(device, m_bounds);
+
+        for (int chan = 0; chan < cache.channelCount(); chan++) {
+            cache.channelBins(chan);
+        }
+    }
+}
+
+QTEST_MAIN(KisHistogramCacheBenchmark)
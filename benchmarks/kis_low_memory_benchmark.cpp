@@ -19,6 +19,7 @@
 #include "kis_low_memory_benchmark.h"
 
 #include <QTest>
+#include <QElapsedTimer>
 
 #include "kis_benchmark_values.h"
 
@@ -39,8 +40,16 @@
 #include "KisGlobalResourcesInterface.h"
 
 #include "tiles3/kis_tile_data_store.h"
+#include "kis_transaction.h"
 #include "kis_surrogate_undo_adapter.h"
 #include "kis_image_config.h"
+#include "kis_sequential_iterator.h"
+#include "kis_processing_information.h"
+#include "filter/kis_filter_configuration.h"
+#include "generator/kis_generator.h"
+#include "generator/kis_generator_layer.h"
+#include "generator/kis_generator_registry.h"
+
 #define LOAD_PRESET_OR_RETURN(preset, fileName)                         \
     if(!preset->load(KisGlobalResourcesInterface::instance())) { dbgKrita << "Preset" << fileName << "was NOT loaded properly. Done."; return; } \
     else dbgKrita << "Loaded preset:" << fileName
@@ -230,4 +239,199 @@ void KisLowMemoryBenchmark::memory2000History100Pool500HugeBrush()
                       2000, 600, 500, 0);
 }
 
+/**
+ * This benchmark runs a series of transactions that change only a
+ * few rows in every tile of a huge device and logs how much memory
+ * the undo history takes depending on the number of undo steps. The
+ * columns of the log are: undo depth, total memory, history memory,
+ * compressed part of the history and the size of the swap (in bytes).
+ */
+void KisLowMemoryBenchmark::benchmarkHistoryMemory(bool compressHistory, int swapDepth)
+{
+    const int deviceSize = 4096;
+    const int numSteps = 30;
+
+    const KoColorSpace *colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(colorSpace);
+    dev->fill(QRect(0, 0, deviceSize, deviceSize), KoColor(Qt::white, colorSpace));
+
+    /**
+     * A simple adapter that will store all the transactions for us
+     */
+    KisSurrogateUndoAdapter undoAdapter;
+
+    KisImageConfig config(false);
+    const bool oldCompressHistory = config.compressUndoHistory();
+    const int oldSwapDepth = config.undoHistorySwapDepth();
+
+    config.setCompressUndoHistory(compressHistory);
+    config.setUndoHistorySwapDepth(swapDepth);
+
+    KisTileDataStore::instance()->testingRereadConfig();
+
+    QString fileName;
+    fileName = QString("log_history_%1_%2.txt")
+        .arg(compressHistory)
+        .arg(swapDepth);
+
+    QFile logFile(fileName);
+    logFile.open(QFile::WriteOnly | QFile::Truncate);
+    QTextStream logStream(&logFile);
+    logStream.setFieldWidth(12);
+    logStream.setFieldAlignment(QTextStream::AlignRight);
+
+    for (int i = 0; i < numSteps; i++) {
+        KisTransaction transaction(dev);
+
+        const KoColor color(QColor::fromHsv(i * 10 % 360, 255, 255), colorSpace);
+
+        for (int y = 0; y < deviceSize; y += 64) {
+            dev->fill(QRect(0, y + i % 64, deviceSize, 1), color);
+        }
+
+        transaction.commit(&undoAdapter);
+
+        // let the swapper process the history
+        QTest::qSleep(2000);
+
+        KisTileDataStore::MemoryStatistics stats =
+            KisTileDataStore::instance()->memoryStatistics();
+
+        logStream << i + 1
+                  << stats.totalMemorySize
+                  << stats.historicalMemorySize
+                  << stats.compressedHistorySize
+                  << stats.swapSize << endl;
+    }
+
+    config.setCompressUndoHistory(oldCompressHistory);
+    config.setUndoHistorySwapDepth(oldSwapDepth);
+
+    KisTileDataStore::instance()->testingRereadConfig();
+}
+
+void KisLowMemoryBenchmark::historyMemoryNoCompression()
+{
+    benchmarkHistoryMemory(false, 0);
+}
+
+void KisLowMemoryBenchmark::historyMemoryCompressed()
+{
+    benchmarkHistoryMemory(true, 0);
+}
+
+void KisLowMemoryBenchmark::historyMemoryCompressedSwapDepth10()
+{
+    benchmarkHistoryMemory(true, 10);
+}
+
+/**
+ * A generator producing a noisy pattern, so that no tile can be
+ * shared with the default one
+ */
+class NoiseTestGenerator : public KisGenerator
+{
+public:
+    NoiseTestGenerator()
+        : KisGenerator(KoID("noisetestgenerator", "Noise Test Generator"), KoID("test"), "")
+    {
+    }
+
+    void generate(KisProcessingInformation dst,
+                  const QSize& size,
+                  const KisFilterConfigurationSP config,
+                  KoUpdater* progressUpdater) const override
+    {
+        Q_UNUSED(config);
+        Q_UNUSED(progressUpdater);
+
+        KisSequentialIterator it(dst.paintDevice(), QRect(dst.topLeft(), size));
+        while (it.nextPixel()) {
+            const quint32 hash = quint32(it.x()) * 2654435761U ^ quint32(it.y()) * 40503U;
+            quint8 *pixel = it.rawData();
+            pixel[0] = hash & 0xFF;
+            pixel[1] = (hash >> 8) & 0xFF;
+            pixel[2] = (hash >> 16) & 0xFF;
+            pixel[3] = 255;
+        }
+    }
+};
+
+/**
+ * This benchmark creates a stack of generator layers on a big image,
+ * renders the image and logs how much memory the tiles take. The
+ * columns of the log are: number of layers, total memory, memory
+ * taken by the tiles of the layers and the time it took to render
+ * the image (in ms).
+ */
+void KisLowMemoryBenchmark::benchmarkGeneratorLayers(bool useVirtualLayers)
+{
+    const int imageSize = 4096;
+    const int numLayers = 8;
+
+    if (!KisGeneratorRegistry::instance()->contains("noisetestgenerator")) {
+        KisGeneratorRegistry::instance()->add(new NoiseTestGenerator());
+    }
+    KisGeneratorSP generator = KisGeneratorRegistry::instance()->value("noisetestgenerator");
+
+    KisImageConfig config(false);
+    const bool oldUseVirtualLayers = config.useVirtualGeneratorLayers();
+    config.setUseVirtualGeneratorLayers(useVirtualLayers);
+
+    const KoColorSpace *colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageSize, imageSize, colorSpace, "generator layers");
+
+    QString fileName;
+    fileName = QString("log_generator_layers_%1.txt").arg(useVirtualLayers);
+
+    QFile logFile(fileName);
+    logFile.open(QFile::WriteOnly | QFile::Truncate);
+    QTextStream logStream(&logFile);
+    logStream.setFieldWidth(12);
+    logStream.setFieldAlignment(QTextStream::AlignRight);
+
+    const qint64 baseMemory = KisTileDataStore::instance()->memoryStatistics().totalMemorySize;
+
+    for (int i = 0; i < numLayers; i++) {
+        KisFilterConfigurationSP filterConfig =
+            generator->defaultConfiguration(KisGlobalResourcesInterface::instance());
+
+        KisGeneratorLayerSP layer =
+            new KisGeneratorLayer(image, QString("layer %1").arg(i), filterConfig, KisSelectionSP());
+        layer->setOpacity(128);
+        image->addNode(layer, image->rootLayer());
+
+        QElapsedTimer timer;
+        timer.start();
+
+        layer->update();
+        image->waitForDone();
+
+        image->refreshGraphAsync();
+        image->waitForDone();
+
+        const qint64 renderTime = timer.elapsed();
+
+        KisTileDataStore::MemoryStatistics stats =
+            KisTileDataStore::instance()->memoryStatistics();
+
+        logStream << i + 1
+                  << stats.totalMemorySize
+                  << stats.totalMemorySize - baseMemory
+                  << renderTime << endl;
+    }
+
+    config.setUseVirtualGeneratorLayers(oldUseVirtualLayers);
+}
+
+void KisLowMemoryBenchmark::generatorLayersStored()
+{
+    benchmarkGeneratorLayers(false);
+}
+
+void KisLowMemoryBenchmark::generatorLayersVirtual()
+{
+    benchmarkGeneratorLayers(true);
+}
+
 QTEST_MAIN(KisLowMemoryBenchmark)
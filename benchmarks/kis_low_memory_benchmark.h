@@ -31,6 +31,13 @@ private Q_SLOTS:
 
     void memory2000History100Pool500HugeBrush();
 
+    void historyMemoryNoCompression();
+    void historyMemoryCompressed();
+    void historyMemoryCompressedSwapDepth10();
+
+    void generatorLayersStored();
+    void generatorLayersVirtual();
+
 private:
     void benchmarkWideArea(const QString presetFileName,
                            const QRectF &rect, qreal vstep,
@@ -40,6 +47,10 @@ private:
                            int softLimitMiB,
                            int poolLimitMiB,
                            int index);
+
+    void benchmarkHistoryMemory(bool compressHistory, int swapDepth);
+
+    void benchmarkGeneratorLayers(bool useVirtualLayers);
 };
 
 #endif /* __KIS_LOW_MEMORY_BENCHMARK_H */
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <QTest>
+
+#include "kis_oilpaint_filter_benchmark.h"
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColor.h>
+
+#include "filter/kis_filter_registry.h"
+#include "filter/kis_filter_configuration.h"
+#include "filter/kis_filter.h"
+
+#include "kis_paint_device.h"
+#include <kis_iterator_ng.h>
+#include <KisGlobalResourcesInterface.h>
+
+const int IMAGE_SIZE = 1024;
+
+void KisOilPaintFilterBenchmark::initTestCase()
+{
+    m_colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    m_device = new KisPaintDevice(m_colorSpace);
+
+    KoColor color(m_colorSpace);
+    srand(31524744);
+
+    KisSequentialIterator it(m_device, QRect(0, 0, IMAGE_SIZE, IMAGE_SIZE));
+    while (it.nextPixel()) {
+        color.fromQColor(QColor(rand() % 255, rand() % 255, rand() % 255));
+        memcpy(it.rawData(), color.data(), m_colorSpace->pixelSize());
+    }
+}
+
+void KisOilPaintFilterBenchmark::benchmarkFilter_data()
+{
+    QTest::addColumn<int>("brushSize");
+
+    QTest::newRow("2") << 2;
+    QTest::newRow("5") << 5;
+    QTest::newRow("10") << 10;
+    QTest::newRow("20") << 20;
+    QTest::newRow("30") << 30;
+}
+
+void KisOilPaintFilterBenchmark::benchmarkFilter()
+{
+    QFETCH(int, brushSize);
+
+    KisFilterSP filter = KisFilterRegistry::instance()->value("oilpaint");
+    QVERIFY(filter);
+
+    KisFilterConfigurationSP config = filter->defaultConfiguration(KisGlobalResourcesInterface::instance());
+    config->setProperty("brushSize", brushSize);
+    config->setProperty("smooth", 30);
+
+    KisPaintDeviceSP device = new KisPaintDevice(*m_device);
+
+    QBENCHMARK_ONCE {
+        filter->process(device, QRect(0, 0, IMAGE_SIZE, IMAGE_SIZE), config);
+    }
+}
+
+QTEST_MAIN(KisOilPaintFilterBenchmark)
@@ -0,0 +1,59 @@
+"""Compares the round trip of the pixels of a layer through NumPy
+using Node.pixelData()/Node.setPixelData() and Node.lockPixelData().
+
+Run it with kritarunner:
+
+    kritarunner -s pixel_region_benchmark -f run [width] [height] [iterations]
+
+The directory of the script must be in PYTHONPATH.
+"""
+
+import time
+
+import numpy as np
+from krita import Krita
+
+
+def _create_document(width, height):
+    app = Krita.instance()
+    doc = app.createDocument(width, height, "benchmark", "RGBA", "U8", "", 300.0)
+    node = doc.activeNode()
+    return doc, node
+
+
+def _byte_array_round_trip(node, width, height):
+    data = node.pixelData(0, 0, width, height)
+    pixels = np.frombuffer(data, dtype=np.uint8).reshape(height, width, 4).copy()
+    pixels[:, :, 3] //= 2
+    node.setPixelData(pixels.tobytes(), 0, 0, width, height)
+
+
+def _pixel_region_round_trip(node, width, height):
+    region = node.lockPixelData(0, 0, width, height)
+    pixels = np.frombuffer(region, dtype=np.uint8).reshape(height, width, 4)
+    pixels[:, :, 3] //= 2
+    region.commit()
+    del pixels
+    region.unlock()
+
+
+def _measure(name, func, node, width, height, iterations):
+    start = time.perf_counter()
+    for _ in range(iterations):
+        func(node, width, height)
+    elapsed = (time.perf_counter() - start) / iterations
+    print("{0:>14}: {1:8.2f} ms per round trip".format(name, elapsed * 1000.0))
+
+
+def run(args):
+    width = int(args[0]) if len(args) > 0 else 8192
+    height = int(args[1]) if len(args) > 1 else 8192
+    iterations = int(args[2]) if len(args) > 2 else 5
+
+    doc, node = _create_document(width, height)
+
+    print("{0}x{1} RGBA U8, {2} iterations".format(width, height, iterations))
+    _measure("pixelData", _byte_array_round_trip, node, width, height, iterations)
+    _measure("lockPixelData", _pixel_region_round_trip, node, width, height, iterations)
+
+    doc.close()
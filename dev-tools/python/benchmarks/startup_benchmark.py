@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Compares the time of a command-line KRA to PNG conversion with the
+lean headless startup and with the full startup of Krita.
+
+Usage:
+
+    startup_benchmark.py <path to krita> <input.kra> [iterations]
+
+The full startup is requested by setting KRITA_NO_LEAN_STARTUP in
+the environment of the Krita process.
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def _convert(krita, source, target, lean):
+    env = dict(os.environ)
+    env.pop("KRITA_NO_LEAN_STARTUP", None)
+    if not lean:
+        env["KRITA_NO_LEAN_STARTUP"] = "1"
+
+    start = time.perf_counter()
+    subprocess.run([krita, source, "--export", "--export-filename", target],
+                   env=env, check=True,
+                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return time.perf_counter() - start
+
+
+def _measure(name, krita, source, target, lean, iterations):
+    timings = [_convert(krita, source, target, lean) for _ in range(iterations)]
+    timings.sort()
+    print("{0:>6}: best {1:7.2f} s, median {2:7.2f} s".format(
+        name, timings[0], timings[len(timings) // 2]))
+
+
+def main(argv):
+    if len(argv) < 3:
+        print(__doc__)
+        return 1
+
+    krita = argv[1]
+    source = argv[2]
+    iterations = int(argv[3]) if len(argv) > 3 else 5
+
+    with tempfile.TemporaryDirectory() as directory:
+        target = os.path.join(directory, "result.png")
+
+        # warm up the file system caches and the resource database
+        _convert(krita, source, target, lean=False)
+
+        _measure("full", krita, source, target, False, iterations)
+        _measure("lean", krita, source, target, True, iterations)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
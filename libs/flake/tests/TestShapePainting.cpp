@@ -24,10 +24,14 @@
 #include "KoShapeContainer.h"
 #include "KoShapeManager.h"
 #include "KoShapePaintingContext.h"
+#include "KoSvgTextShape.h"
+#include "KoSvgTextShapeMarkupConverter.h"
 #include <sdk/tests/testflake.h>
 #include <MockShapes.h>
 
 #include <QTest>
+#include <QRunnable>
+#include <QThreadPool>
 
 void TestShapePainting::testPaintShape()
 {
@@ -312,4 +316,100 @@ void TestShapePainting::testGroupUngroup()
     }
 }
 
+namespace {
+
+struct PaintShapesJob : public QRunnable
+{
+    PaintShapesJob(KoShapeManager *shapeManager, const KoShapeManager::PaintJob &job, QImage *image)
+        : m_shapeManager(shapeManager),
+          m_job(job),
+          m_image(image)
+    {
+    }
+
+    PaintShapesJob(KoShape *shape, QImage *image)
+        : m_shape(shape),
+          m_image(image)
+    {
+    }
+
+    void run() override {
+        QPainter painter(m_image);
+        painter.setClipRect(m_image->rect());
+
+        if (m_shapeManager) {
+            m_shapeManager->paintJob(painter, m_job, false);
+        } else {
+            KoShapePaintingContext paintContext;
+            KoShapeManager::renderSingleShape(m_shape, painter, paintContext);
+        }
+    }
+
+    KoShapeManager *m_shapeManager = 0;
+    KoShapeManager::PaintJob m_job;
+    KoShape *m_shape = 0;
+    QImage *m_image;
+};
+
+void paintInWorkerThread(PaintShapesJob *job)
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(1);
+    pool.start(job);
+    pool.waitForDone();
+}
+
+}
+
+void TestShapePainting::testPaintClonedTextShape()
+{
+    QScopedPointer<KoSvgTextShape> shape(new KoSvgTextShape());
+
+    KoSvgTextShapeMarkupConverter converter(shape.data());
+    converter.convertFromSvg(
+        "<text fill=\"#000000\">"
+        "<tspan x=\"0\" dy=\"1.2em\">Some text</tspan>"
+        "<tspan x=\"0\" dy=\"1.2em\">on <tspan font-weight=\"bold\">two</tspan> lines</tspan>"
+        "</text>",
+        "<defs/>",
+        QRectF(0, 0, 100, 100), 72.0);
+    shape->setPosition(QPointF(10, 10));
+
+    const QPainterPath originalOutline = shape->textOutline();
+    QVERIFY(!originalOutline.isEmpty());
+
+    MockCanvas canvas;
+    KoShapeManager manager(&canvas);
+    manager.addShape(shape.data());
+
+    const QRect pageRect(0, 0, 200, 100);
+
+    KoShapeManager::PaintJobsOrder jobsOrder;
+    jobsOrder.jobs << KoShapeManager::PaintJob(pageRect, pageRect);
+    jobsOrder.uncroppedViewUpdateRect = pageRect;
+    manager.preparePaintJobs(jobsOrder, 0);
+
+    QCOMPARE(jobsOrder.jobs.size(), 1);
+    QCOMPARE(jobsOrder.jobs.first().shapes.size(), 1);
+
+    KoSvgTextShape *clonedShape = dynamic_cast<KoSvgTextShape*>(jobsOrder.jobs.first().shapes.first());
+    QVERIFY(clonedShape);
+    QVERIFY(clonedShape != shape.data());
+
+    // the clone should inherit the glyphs of the original shape
+    QCOMPARE(clonedShape->textOutline(), originalOutline);
+
+    QImage emptyImage(pageRect.size(), QImage::Format_ARGB32_Premultiplied);
+    emptyImage.fill(0);
+
+    QImage originalImage = emptyImage.copy();
+    paintInWorkerThread(new PaintShapesJob(shape.data(), &originalImage));
+
+    QImage clonedImage = emptyImage.copy();
+    paintInWorkerThread(new PaintShapesJob(&manager, jobsOrder.jobs.first(), &clonedImage));
+
+    QVERIFY(originalImage != emptyImage);
+    QCOMPARE(clonedImage, originalImage);
+}
+
 KISTEST_MAIN(TestShapePainting)
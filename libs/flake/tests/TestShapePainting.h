@@ -31,6 +31,7 @@ private Q_SLOTS:
     void testPaintHiddenShape();
     void testPaintOrder();
     void testGroupUngroup();
+    void testPaintClonedTextShape();
 };
 
 #endif
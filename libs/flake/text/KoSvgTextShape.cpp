@@ -60,6 +60,21 @@ class KoSvgTextShape::Private
 {
 public:
 
+    /**
+     * The outlines of the glyphs of a single format range together with the
+     * brush and the pen they are painted with. Unlike QTextLayout and QRawFont,
+     * these outlines don't depend on any per-thread font engine data, so they
+     * can be painted from any thread.
+     */
+    struct CachedGlyphRun {
+        QPainterPath glyphs;
+        QPainterPath decorations;
+        QBrush brush;
+        QPen pen;
+    };
+
+    typedef std::vector<CachedGlyphRun> GlyphCache;
+
     // NOTE: the cache data is shared between all the instances of
     //       the shape, though it will be reset locally if the
     //       accessing thread changes
@@ -67,9 +82,18 @@ public:
     std::vector<QPointF> cachedLayoutsOffsets;
     QThread *cachedLayoutsWorkingThread = 0;
 
+    // NOTE: the glyph cache is rebuilt on every relayout() and is read
+    //       by the rendering threads, so it should be accessed with
+    //       std::atomic_load() and std::atomic_store() only
+    std::shared_ptr<const GlyphCache> cachedGlyphs;
+
 
     void clearAssociatedOutlines(const KoShape *rootShape);
 
+    static void addGlyphRunOutline(const QGlyphRun &run, const QTextLine &line,
+                                   const QPointF &layoutOffset,
+                                   CachedGlyphRun *cachedRun);
+
 };
 
 KoSvgTextShape::KoSvgTextShape()
@@ -84,8 +108,16 @@ KoSvgTextShape::KoSvgTextShape(const KoSvgTextShape &rhs)
     , d(new Private)
 {
     setShapeId(KoSvgTextShape_SHAPEID);
-    // QTextLayout has no copy-ctor, so just relayout everything!
-    relayout();
+
+    /**
+     * QTextLayout has no copy-ctor, but reshaping the text for every
+     * copy is too expensive: KoShapeManager clones all the shapes of a
+     * vector layer on every update. The glyph cache is immutable, so
+     * just share it. The layouts are recreated only when the copy is
+     * painted in the GUI thread. The associated outlines of the chunks
+     * are already shared by KoSvgTextChunkShape.
+     */
+    d->cachedGlyphs = std::atomic_load(&rhs.d->cachedGlyphs);
 }
 
 KoSvgTextShape::~KoSvgTextShape()
@@ -114,29 +146,38 @@ void KoSvgTextShape::paintComponent(QPainter &painter, KoShapePaintingContext &p
     /**
      * HACK ALERT:
      * QTextLayout should only be accessed from the thread it has been created in.
-     * If the cached layout has been created in a different thread, we should just
-     * recreate the layouts in the current thread to be able to render them.
+     * The GUI thread keeps its own layouts and just recreates them if they have
+     * been created in a different thread. All other threads (e.g. the ones that
+     * rasterize vector layers) paint the glyph outlines cached by relayout(),
+     * so the text is not reshaped on every render.
      */
 
-    if (QThread::currentThread() != d->cachedLayoutsWorkingThread) {
-        relayout();
-    }
+    if (QThread::currentThread() == qApp->thread()) {
+        if (QThread::currentThread() != d->cachedLayoutsWorkingThread) {
+            relayout();
+        }
 
-    for (int i = 0; i < (int)d->cachedLayouts.size(); i++) {
-        d->cachedLayouts[i]->draw(&painter, d->cachedLayoutsOffsets[i]);
-    }
+        for (int i = 0; i < (int)d->cachedLayouts.size(); i++) {
+            d->cachedLayouts[i]->draw(&painter, d->cachedLayoutsOffsets[i]);
+        }
+    } else {
+        std::shared_ptr<const Private::GlyphCache> glyphCache = std::atomic_load(&d->cachedGlyphs);
+        if (!glyphCache) {
+            relayout();
+            glyphCache = std::atomic_load(&d->cachedGlyphs);
+            KIS_SAFE_ASSERT_RECOVER_RETURN(glyphCache);
+        }
 
-    /**
-     * HACK ALERT:
-     * The layouts of non-gui threads must be destroyed in the same thread
-     * they have been created. Because the thread might be restarted in the
-     * meantime or just destroyed, meaning that the per-thread freetype data
-     * will not be available.
-     */
-    if (QThread::currentThread() != qApp->thread()) {
-        d->cachedLayouts.clear();
-        d->cachedLayoutsOffsets.clear();
-        d->cachedLayoutsWorkingThread = 0;
+        for (auto it = glyphCache->begin(); it != glyphCache->end(); ++it) {
+            if (it->brush.style() != Qt::NoBrush) {
+                painter.fillPath(it->glyphs, it->brush);
+                painter.fillPath(it->decorations, it->brush);
+            }
+
+            if (it->pen.style() != Qt::NoPen) {
+                painter.strokePath(it->glyphs, it->pen);
+            }
+        }
     }
 }
 
@@ -154,72 +195,66 @@ QPainterPath KoSvgTextShape::textOutline()
     QPainterPath result;
     result.setFillRule(Qt::WindingFill);
 
+    std::shared_ptr<const Private::GlyphCache> glyphCache = std::atomic_load(&d->cachedGlyphs);
+    if (!glyphCache) {
+        relayout();
+        glyphCache = std::atomic_load(&d->cachedGlyphs);
+        if (!glyphCache) return result;
+    }
 
-    for (int i = 0; i < (int)d->cachedLayouts.size(); i++) {
-        const QPointF layoutOffset = d->cachedLayoutsOffsets[i];
-        const QTextLayout *layout = d->cachedLayouts[i].get();
-
-        for (int j = 0; j < layout->lineCount(); j++) {
-            QTextLine line = layout->lineAt(j);
-
-            Q_FOREACH (const QGlyphRun &run, line.glyphRuns()) {
-                const QVector<quint32> indexes = run.glyphIndexes();
-                const QVector<QPointF> positions = run.positions();
-                const QRawFont font = run.rawFont();
-
-                KIS_SAFE_ASSERT_RECOVER(indexes.size() == positions.size()) { continue; }
-
-                for (int k = 0; k < indexes.size(); k++) {
-                    QPainterPath glyph = font.pathForGlyph(indexes[k]);
-                    glyph.translate(positions[k] + layoutOffset);
-                    result += glyph;
-                }
-
-                const qreal thickness = font.lineThickness();
-                const QRectF runBounds = run.boundingRect();
+    for (auto it = glyphCache->begin(); it != glyphCache->end(); ++it) {
+        // don't use direct addPath, because it doesn't care about Qt::WindingFill
+        result += it->glyphs;
+        result += it->decorations;
+    }
 
-                if (run.overline()) {
-                    // the offset is calculated to be consistent with the way how Qt renders the text
-                    const qreal y = line.y();
-                    QRectF overlineBlob(runBounds.x(), y, runBounds.width(), thickness);
-                    overlineBlob.translate(layoutOffset);
+    return result;
+}
 
-                    QPainterPath path;
-                    path.addRect(overlineBlob);
+void KoSvgTextShape::Private::addGlyphRunOutline(const QGlyphRun &run, const QTextLine &line,
+                                                 const QPointF &layoutOffset,
+                                                 CachedGlyphRun *cachedRun)
+{
+    const QVector<quint32> indexes = run.glyphIndexes();
+    const QVector<QPointF> positions = run.positions();
+    const QRawFont font = run.rawFont();
 
-                    // don't use direct addRect, because it doesn't care about Qt::WindingFill
-                    result += path;
-                }
+    KIS_SAFE_ASSERT_RECOVER_RETURN(indexes.size() == positions.size());
 
-                if (run.strikeOut()) {
-                    // the offset is calculated to be consistent with the way how Qt renders the text
-                    const qreal y = line.y() + 0.5 * line.height();
-                    QRectF strikeThroughBlob(runBounds.x(), y, runBounds.width(), thickness);
-                    strikeThroughBlob.translate(layoutOffset);
+    for (int k = 0; k < indexes.size(); k++) {
+        QPainterPath glyph = font.pathForGlyph(indexes[k]);
+        glyph.translate(positions[k] + layoutOffset);
+        cachedRun->glyphs.addPath(glyph);
+    }
 
-                    QPainterPath path;
-                    path.addRect(strikeThroughBlob);
+    const qreal thickness = font.lineThickness();
+    const QRectF runBounds = run.boundingRect();
 
-                    // don't use direct addRect, because it doesn't care about Qt::WindingFill
-                    result += path;
-                }
-
-                if (run.underline()) {
-                    const qreal y = line.y() + line.ascent() + font.underlinePosition();
-                    QRectF underlineBlob(runBounds.x(), y, runBounds.width(), thickness);
-                    underlineBlob.translate(layoutOffset);
+    /**
+     * The decorations are kept in a separate path, because their
+     * orientation may differ from the orientation of the glyphs,
+     * which would punch holes in the glyphs with Qt::WindingFill
+     */
 
-                    QPainterPath path;
-                    path.addRect(underlineBlob);
+    if (run.overline()) {
+        // the offset is calculated to be consistent with the way how Qt renders the text
+        const qreal y = line.y();
+        QRectF overlineBlob(runBounds.x(), y, runBounds.width(), thickness);
+        cachedRun->decorations.addRect(overlineBlob.translated(layoutOffset));
+    }
 
-                    // don't use direct addRect, because it doesn't care about Qt::WindingFill
-                    result += path;
-                }
-            }
-        }
+    if (run.strikeOut()) {
+        // the offset is calculated to be consistent with the way how Qt renders the text
+        const qreal y = line.y() + 0.5 * line.height();
+        QRectF strikeThroughBlob(runBounds.x(), y, runBounds.width(), thickness);
+        cachedRun->decorations.addRect(strikeThroughBlob.translated(layoutOffset));
     }
 
-    return result;
+    if (run.underline()) {
+        const qreal y = line.y() + line.ascent() + font.underlinePosition();
+        QRectF underlineBlob(runBounds.x(), y, runBounds.width(), thickness);
+        cachedRun->decorations.addRect(underlineBlob.translated(layoutOffset));
+    }
 }
 
 void KoSvgTextShape::resetTextShape()
@@ -492,6 +527,8 @@ void KoSvgTextShape::relayout() const
 
     d->clearAssociatedOutlines(this);
 
+    std::shared_ptr<Private::GlyphCache> glyphCache(new Private::GlyphCache());
+
     for (int i = 0; i < int(d->cachedLayouts.size()); i++) {
         const QTextLayout &layout = *d->cachedLayouts[i];
         const QPointF layoutOffset = d->cachedLayoutsOffsets[i];
@@ -510,6 +547,12 @@ void KoSvgTextShape::relayout() const
 
             const int rangeEnd = range.start + safeRangeLength - 1;
 
+            Private::CachedGlyphRun cachedRun;
+            cachedRun.glyphs.setFillRule(Qt::WindingFill);
+            cachedRun.decorations.setFillRule(Qt::WindingFill);
+            cachedRun.brush = format.foreground();
+            cachedRun.pen = format.textOutline();
+
             const int firstLineIndex = layout.lineForTextPosition(rangeStart).lineNumber();
             const int lastLineIndex = layout.lineForTextPosition(rangeEnd).lineNumber();
 
@@ -557,10 +600,31 @@ void KoSvgTextShape::relayout() const
                     rect.adjust(0, -0.5*rect.height(), 0, 0.5*rect.height()); // add some vertical margin too
 
                     wrapper.addCharacterRect(rect.translated(layoutOffset));
+
+                    Private::addGlyphRunOutline(run, line, layoutOffset, &cachedRun);
                 }
             }
+
+            if (!cachedRun.glyphs.isEmpty() || !cachedRun.decorations.isEmpty()) {
+                glyphCache->push_back(cachedRun);
+            }
         }
     }
+
+    std::atomic_store(&d->cachedGlyphs, std::shared_ptr<const Private::GlyphCache>(glyphCache));
+
+    /**
+     * HACK ALERT:
+     * The layouts of non-gui threads must be destroyed in the same thread
+     * they have been created. Because the thread might be restarted in the
+     * meantime or just destroyed, meaning that the per-thread freetype data
+     * will not be available. Such threads paint the glyph cache anyway.
+     */
+    if (QThread::currentThread() != qApp->thread()) {
+        d->cachedLayouts.clear();
+        d->cachedLayoutsOffsets.clear();
+        d->cachedLayoutsWorkingThread = 0;
+    }
 }
 
 void KoSvgTextShape::Private::clearAssociatedOutlines(const KoShape *rootShape)
@@ -19,9 +19,10 @@
 #ifndef __KIS_ACS_PIXEL_CACHE_RENDERER_H
 #define __KIS_ACS_PIXEL_CACHE_RENDERER_H
 
+#include <QVector>
+
 #include "KoColorSpace.h"
 #include "kis_paint_device.h"
-#include "kis_iterator_ng.h"
 #include "kis_display_color_converter.h"
 
 
@@ -31,7 +32,12 @@ namespace Acs {
     public:
         /**
          * \p Picker class must provide one method:
-         *     - KoColor Picker::colorAt(int x, int y);
+         *     - QColor Picker::renderedColorAt(int x, int y);
+         *
+         * The method should return the sRGB color the picker would pass
+         * to one of KisDisplayColorConverter::fromHsvF() family of
+         * methods. The colors are collected row by row and converted into
+         * the painting color space with a single call per row.
          */
         template <class Picker>
         static void render(Picker *picker,
@@ -48,13 +54,18 @@ namespace Acs {
                     realPixelCache = new KisPaintDevice(cacheColorSpace);
                 }
 
-                KoColor color;
+                const int rowWidth = pickRect.width();
+
+                QVector<QColor> colors(rowWidth);
+                QVector<quint8> pixels(rowWidth * pixelSize);
 
-                KisSequentialIterator it(realPixelCache, pickRect);
+                for (int y = pickRect.top(); y <= pickRect.bottom(); y++) {
+                    for (int i = 0; i < rowWidth; i++) {
+                        colors[i] = picker->renderedColorAt(pickRect.left() + i, y);
+                    }
 
-                while (it.nextPixel()) {
-                    color = picker->colorAt(it.x(), it.y());
-                    memcpy(it.rawData(), color.data(), pixelSize);
+                    converter->approximateFromRenderedQColors(colors.constData(), pixels.data(), rowWidth);
+                    realPixelCache->writeBytes(pixels.constData(), pickRect.left(), y, rowWidth, 1);
                 }
 
 
@@ -0,0 +1,581 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisLatencyTracer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGlobalStatic>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+
+#include "kis_debug.h"
+
+Q_GLOBAL_STATIC(KisLatencyTracer, s_instance)
+
+namespace {
+
+/**
+ * The hooks check the flag before touching the instance, so the
+ * environment variable should be read before the instance is created
+ */
+std::atomic<bool> s_enabled(!qgetenv("KRITA_LATENCY_TRACE").isEmpty());
+
+/**
+ * The number of events every thread keeps. When the buffer is full, the
+ * oldest events are overwritten.
+ */
+const quint64 bufferCapacity = 1 << 14;
+
+/**
+ * Events that happened later than this after the input event are not
+ * considered to be caused by it
+ */
+const qint64 maxLatencyNs = 1000000000;
+
+struct Record {
+    qint64 timestamp = 0;
+    KisLatencyTracer::EventType type = KisLatencyTracer::TabletEvent;
+    char phase = 'i';
+    QRect rect;
+    QPointF pos;
+};
+
+/**
+ * A ring buffer with a single writer, the thread that owns it. The
+ * readers take the events that have been completely written by the
+ * moment of the reading and were not overwritten while they were
+ * copied, in a seqlock manner: writeIndex is the sequence counter.
+ *
+ * When the owner thread exits, the buffer is passed to the next thread
+ * that starts recording. threadName and ownerTimestamp are changed on
+ * that handover, so they are protected by Private::buffersLock.
+ */
+struct ThreadBuffer {
+    ThreadBuffer(int _threadIndex, const QString &_threadName, qint64 _ownerTimestamp)
+        : records(bufferCapacity),
+          threadIndex(_threadIndex),
+          threadName(_threadName),
+          ownerTimestamp(_ownerTimestamp)
+    {
+    }
+
+    void push(const Record &record) {
+        const quint64 index = writeIndex.load(std::memory_order_relaxed);
+
+        // a reader that sees a part of this record sees the index as well
+        std::atomic_thread_fence(std::memory_order_release);
+
+        records[index % bufferCapacity] = record;
+        writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+    QVector<Record> takeSnapshot(qint64 minTimestamp) const {
+        const quint64 end = writeIndex.load(std::memory_order_acquire);
+        const quint64 start = end > bufferCapacity ? end - bufferCapacity : 0;
+
+        QVector<Record> copied;
+        copied.reserve(int(end - start));
+
+        for (quint64 i = start; i < end; i++) {
+            copied.append(records[i % bufferCapacity]);
+        }
+
+        /**
+         * The owner could have wrapped around while we were copying.
+         * While it writes the record with index newEnd, the index is not
+         * incremented yet, so the record newEnd - bufferCapacity can be
+         * torn and everything before it is overwritten. Such records are
+         * dropped.
+         */
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const quint64 newEnd = writeIndex.load(std::memory_order_relaxed);
+        const quint64 validStart = newEnd >= bufferCapacity ? newEnd - bufferCapacity + 1 : 0;
+
+        QVector<Record> result;
+        result.reserve(copied.size());
+
+        for (quint64 i = qMax(start, validStart); i < end; i++) {
+            const Record &record = copied[int(i - start)];
+            if (record.timestamp >= minTimestamp) {
+                result.append(record);
+            }
+        }
+
+        return result;
+    }
+
+    std::vector<Record> records;
+    std::atomic<quint64> writeIndex {0};
+    int threadIndex;
+    QString threadName;
+
+    /**
+     * The events recorded before this moment belong to the previous
+     * owner of the buffer
+     */
+    qint64 ownerTimestamp;
+};
+
+typedef QSharedPointer<ThreadBuffer> ThreadBufferSP;
+
+struct ThreadSnapshot {
+    int threadIndex;
+    QString threadName;
+    qint64 ownerTimestamp;
+    QVector<Record> records;
+};
+
+struct CanvasUpdate {
+    qint64 begin;
+    qint64 end;
+    QRect rect;
+};
+
+QString formatPercentiles(const QString &name, QVector<qint64> values)
+{
+    if (values.isEmpty()) {
+        return QString("%1: no data\n").arg(name, -24);
+    }
+
+    std::sort(values.begin(), values.end());
+
+    auto percentile = [&values] (qreal portion) {
+        const int index = qMin(values.size() - 1, int(portion * values.size()));
+        return QString::number(values[index] / 1000000.0, 'f', 2);
+    };
+
+    return QString("%1: count %2, p50 %3 ms, p90 %4 ms, p99 %5 ms, max %6 ms\n")
+            .arg(name, -24)
+            .arg(values.size())
+            .arg(percentile(0.5))
+            .arg(percentile(0.9))
+            .arg(percentile(0.99))
+            .arg(percentile(1.0));
+}
+
+}
+
+struct KisLatencyTracer::Private
+{
+    QElapsedTimer timer;
+    QString autoSaveFileName;
+
+    /**
+     * clear() doesn't touch the buffers, which are owned by the
+     * recording threads, it just hides all the older events
+     */
+    std::atomic<qint64> clearTimestamp {0};
+
+    /**
+     * Every buffer takes about 800 KiB and the thread pools start and
+     * stop their threads all the time, so the buffers of the finished
+     * threads are recycled. Their events are still saved into the trace
+     * until another thread takes the buffer over. That way the number
+     * of buffers never exceeds the number of threads recording at the
+     * same time.
+     */
+    mutable QMutex buffersLock;
+    QVector<ThreadBufferSP> buffers;
+    QVector<ThreadBufferSP> freeBuffers;
+
+    /**
+     * Returns the buffer into Private::freeBuffers when the owner
+     * thread exits and QThreadStorage deletes its data
+     */
+    struct ThreadBufferLease {
+        ThreadBufferLease(Private *_owner, ThreadBufferSP _buffer)
+            : owner(_owner),
+              buffer(_buffer)
+        {
+        }
+
+        ~ThreadBufferLease() {
+            owner->releaseBuffer(buffer);
+        }
+
+        Private *owner;
+        ThreadBufferSP buffer;
+    };
+
+    /**
+     * Should be declared after buffersLock: the lease of the thread
+     * that destroys the tracer is released in the destructor
+     */
+    QThreadStorage<ThreadBufferLease*> threadBuffer;
+
+    void record(EventType type, char phase, const QRect &rect, const QPointF &pos);
+    ThreadBuffer* currentThreadBuffer();
+    void releaseBuffer(ThreadBufferSP buffer);
+    QVector<ThreadSnapshot> takeSnapshot() const;
+};
+
+ThreadBuffer* KisLatencyTracer::Private::currentThreadBuffer()
+{
+    if (!threadBuffer.hasLocalData()) {
+        QMutexLocker l(&buffersLock);
+
+        QThread *thread = QThread::currentThread();
+        QString threadName = thread->objectName();
+
+        ThreadBufferSP buffer;
+        const int threadIndex = !freeBuffers.isEmpty() ? freeBuffers.last()->threadIndex : buffers.size();
+
+        if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+            threadName = "GUI thread";
+        } else if (threadName.isEmpty()) {
+            threadName = QString("Thread %1").arg(threadIndex);
+        }
+
+        if (!freeBuffers.isEmpty()) {
+            buffer = freeBuffers.takeLast();
+            buffer->threadName = threadName;
+            buffer->ownerTimestamp = timer.nsecsElapsed();
+        } else {
+            buffer.reset(new ThreadBuffer(threadIndex, threadName, 0));
+            buffers.append(buffer);
+        }
+
+        threadBuffer.setLocalData(new ThreadBufferLease(this, buffer));
+    }
+
+    return threadBuffer.localData()->buffer.data();
+}
+
+void KisLatencyTracer::Private::releaseBuffer(ThreadBufferSP buffer)
+{
+    QMutexLocker l(&buffersLock);
+    freeBuffers.append(buffer);
+}
+
+void KisLatencyTracer::Private::record(EventType type, char phase, const QRect &rect, const QPointF &pos)
+{
+    Record record;
+    record.timestamp = timer.nsecsElapsed();
+    record.type = type;
+    record.phase = phase;
+    record.rect = rect;
+    record.pos = pos;
+
+    currentThreadBuffer()->push(record);
+}
+
+QVector<ThreadSnapshot> KisLatencyTracer::Private::takeSnapshot() const
+{
+    QVector<ThreadBufferSP> buffersCopy;
+    QVector<ThreadSnapshot> result;
+
+    {
+        QMutexLocker l(&buffersLock);
+        buffersCopy = buffers;
+
+        Q_FOREACH (ThreadBufferSP buffer, buffersCopy) {
+            ThreadSnapshot snapshot;
+            snapshot.threadIndex = buffer->threadIndex;
+            snapshot.threadName = buffer->threadName;
+            snapshot.ownerTimestamp = buffer->ownerTimestamp;
+            result.append(snapshot);
+        }
+    }
+
+    const qint64 clearTimestampValue = clearTimestamp.load();
+
+    for (int i = 0; i < result.size(); i++) {
+        const qint64 minTimestamp = qMax(clearTimestampValue, result[i].ownerTimestamp);
+        result[i].records = buffersCopy[i]->takeSnapshot(minTimestamp);
+    }
+
+    return result;
+}
+
+KisLatencyTracer::Span::Span(EventType type, const QRect &rect)
+    : m_type(type),
+      m_isActive(KisLatencyTracer::isEnabled())
+{
+    if (m_isActive) {
+        KisLatencyTracer::instance()->recordBegin(m_type, rect);
+    }
+}
+
+KisLatencyTracer::Span::~Span()
+{
+    if (m_isActive) {
+        KisLatencyTracer::instance()->recordEnd(m_type);
+    }
+}
+
+KisLatencyTracer::KisLatencyTracer()
+    : m_d(new Private)
+{
+    m_d->timer.start();
+
+    m_d->autoSaveFileName = qgetenv("KRITA_LATENCY_TRACE");
+    if (!m_d->autoSaveFileName.isEmpty()) {
+        setEnabled(true);
+    }
+}
+
+KisLatencyTracer::~KisLatencyTracer()
+{
+    if (!m_d->autoSaveFileName.isEmpty()) {
+        setEnabled(false);
+        saveChromeTrace(m_d->autoSaveFileName);
+        qInfo().noquote() << summary();
+    }
+}
+
+KisLatencyTracer* KisLatencyTracer::instance()
+{
+    return s_instance;
+}
+
+bool KisLatencyTracer::isEnabled()
+{
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+void KisLatencyTracer::setEnabled(bool value)
+{
+    s_enabled.store(value);
+}
+
+void KisLatencyTracer::clear()
+{
+    m_d->clearTimestamp.store(m_d->timer.nsecsElapsed());
+}
+
+void KisLatencyTracer::recordInstant(EventType type, const QRect &rect)
+{
+    m_d->record(type, 'i', rect, QPointF());
+}
+
+void KisLatencyTracer::recordInstant(EventType type, const QPointF &pos)
+{
+    m_d->record(type, 'i', QRect(), pos);
+}
+
+void KisLatencyTracer::recordBegin(EventType type, const QRect &rect)
+{
+    m_d->record(type, 'B', rect, QPointF());
+}
+
+void KisLatencyTracer::recordEnd(EventType type)
+{
+    m_d->record(type, 'E', QRect(), QPointF());
+}
+
+QString KisLatencyTracer::eventName(EventType type)
+{
+    switch (type) {
+    case TabletEvent:
+        return "TabletEvent";
+    case PaintInfoCreated:
+        return "PaintInfoCreated";
+    case StrokeJobQueued:
+        return "StrokeJobQueued";
+    case StrokeJob:
+        return "StrokeJob";
+    case MergeJobQueued:
+        return "MergeJobQueued";
+    case ProjectionMerge:
+        return "ProjectionMerge";
+    case CanvasTextureUpdate:
+        return "CanvasTextureUpdate";
+    case NumEventTypes:
+        break;
+    }
+
+    return "Unknown";
+}
+
+bool KisLatencyTracer::saveChromeTrace(const QString &fileName) const
+{
+    QJsonArray events;
+
+    Q_FOREACH (const ThreadSnapshot &snapshot, m_d->takeSnapshot()) {
+        QJsonObject threadNameArgs;
+        threadNameArgs["name"] = snapshot.threadName;
+
+        QJsonObject threadNameEvent;
+        threadNameEvent["name"] = "thread_name";
+        threadNameEvent["ph"] = "M";
+        threadNameEvent["pid"] = 1;
+        threadNameEvent["tid"] = snapshot.threadIndex;
+        threadNameEvent["args"] = threadNameArgs;
+        events.append(threadNameEvent);
+
+        Q_FOREACH (const Record &record, snapshot.records) {
+            QJsonObject event;
+            event["name"] = eventName(record.type);
+            event["cat"] = "krita";
+            event["ph"] = QString(QLatin1Char(record.phase));
+            event["ts"] = record.timestamp / 1000.0;
+            event["pid"] = 1;
+            event["tid"] = snapshot.threadIndex;
+
+            if (record.phase == 'i') {
+                event["s"] = "t";
+            }
+
+            QJsonObject args;
+
+            if (!record.rect.isEmpty()) {
+                args["x"] = record.rect.x();
+                args["y"] = record.rect.y();
+                args["width"] = record.rect.width();
+                args["height"] = record.rect.height();
+            } else if (record.type == PaintInfoCreated) {
+                args["x"] = record.pos.x();
+                args["y"] = record.pos.y();
+            }
+
+            if (!args.isEmpty()) {
+                event["args"] = args;
+            }
+
+            events.append(event);
+        }
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        warnKrita << "Failed to save the latency trace to" << fileName;
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+QString KisLatencyTracer::summary() const
+{
+    QVector<qint64> durations[NumEventTypes];
+
+    QVector<qint64> tabletEvents;
+    QVector<QPair<qint64, QPointF>> paintInfos;
+    QVector<CanvasUpdate> canvasUpdates;
+
+    Q_FOREACH (const ThreadSnapshot &snapshot, m_d->takeSnapshot()) {
+        QVector<Record> openSpans;
+
+        Q_FOREACH (const Record &record, snapshot.records) {
+            if (record.phase == 'B') {
+                openSpans.append(record);
+            } else if (record.phase == 'E') {
+                // the begin events may have been overwritten in the ring buffer
+                if (openSpans.isEmpty() || openSpans.last().type != record.type) continue;
+
+                const Record begin = openSpans.takeLast();
+                durations[record.type].append(record.timestamp - begin.timestamp);
+
+                if (record.type == CanvasTextureUpdate) {
+                    canvasUpdates.append({begin.timestamp, record.timestamp, begin.rect});
+                }
+            } else if (record.type == TabletEvent) {
+                tabletEvents.append(record.timestamp);
+            } else if (record.type == PaintInfoCreated) {
+                paintInfos.append(qMakePair(record.timestamp, record.pos));
+            }
+        }
+    }
+
+    std::sort(tabletEvents.begin(), tabletEvents.end());
+    std::sort(paintInfos.begin(), paintInfos.end(),
+              [] (const QPair<qint64, QPointF> &lhs, const QPair<qint64, QPointF> &rhs) {
+                  return lhs.first < rhs.first;
+              });
+    std::sort(canvasUpdates.begin(), canvasUpdates.end(),
+              [] (const CanvasUpdate &lhs, const CanvasUpdate &rhs) {
+                  return lhs.begin < rhs.begin;
+              });
+
+    /**
+     * The pixels of a paint information are on the canvas after the
+     * first canvas update that has started after the paint information
+     * was created and covers its position
+     */
+    QVector<qint64> paintInfoToCanvas;
+    QVector<qint64> paintInfoLatencies(paintInfos.size(), -1);
+
+    for (int i = 0; i < paintInfos.size(); i++) {
+        const qint64 timestamp = paintInfos[i].first;
+        const QPoint pos = paintInfos[i].second.toPoint();
+
+        auto it = std::lower_bound(canvasUpdates.constBegin(), canvasUpdates.constEnd(), timestamp,
+                                   [] (const CanvasUpdate &update, qint64 value) {
+                                       return update.begin < value;
+                                   });
+
+        for (; it != canvasUpdates.constEnd() && it->begin - timestamp < maxLatencyNs; ++it) {
+            if (it->rect.contains(pos)) {
+                paintInfoLatencies[i] = it->end - timestamp;
+                paintInfoToCanvas.append(paintInfoLatencies[i]);
+                break;
+            }
+        }
+    }
+
+    QVector<qint64> tabletToPaintInfo;
+    QVector<qint64> tabletToCanvas;
+
+    Q_FOREACH (qint64 timestamp, tabletEvents) {
+        auto it = std::lower_bound(paintInfos.constBegin(), paintInfos.constEnd(), timestamp,
+                                   [] (const QPair<qint64, QPointF> &info, qint64 value) {
+                                       return info.first < value;
+                                   });
+
+        if (it == paintInfos.constEnd() || it->first - timestamp >= maxLatencyNs) continue;
+
+        const qint64 delay = it->first - timestamp;
+        tabletToPaintInfo.append(delay);
+
+        const qint64 paintInfoLatency = paintInfoLatencies[it - paintInfos.constBegin()];
+        if (paintInfoLatency >= 0) {
+            tabletToCanvas.append(delay + paintInfoLatency);
+        }
+    }
+
+    QString result;
+
+    result += formatPercentiles("TabletEvent->PaintInfo", tabletToPaintInfo);
+    result += formatPercentiles("PaintInfo->Canvas", paintInfoToCanvas);
+    result += formatPercentiles("TabletEvent->Canvas", tabletToCanvas);
+
+    for (int i = 0; i < NumEventTypes; i++) {
+        if (durations[i].isEmpty()) continue;
+        result += formatPercentiles(eventName(EventType(i)), durations[i]);
+    }
+
+    return result;
+}
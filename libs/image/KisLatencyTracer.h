@@ -0,0 +1,121 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISLATENCYTRACER_H
+#define KISLATENCYTRACER_H
+
+#include "kritaimage_export.h"
+
+#include <QPointF>
+#include <QRect>
+#include <QScopedPointer>
+#include <QString>
+
+/**
+ * A low-overhead recorder of the events on the way from a tablet event
+ * to the updated pixels on the canvas: the input event itself, creation
+ * of the paint information, stroke jobs, projection merges and canvas
+ * texture updates.
+ *
+ * Every thread writes its events into its own ring buffer, so recording
+ * never takes a lock. When the tracer is disabled, every hook costs a
+ * single atomic load. The collected events can be saved in the Chrome
+ * trace event format (readable by chrome://tracing and Perfetto) or
+ * summarized as latency percentiles.
+ *
+ * The tracer is enabled at startup if KRITA_LATENCY_TRACE environment
+ * variable is set. Its value is the name of the file the trace is saved
+ * into on exit. It can also be switched at runtime with setEnabled().
+ */
+class KRITAIMAGE_EXPORT KisLatencyTracer
+{
+public:
+    enum EventType {
+        TabletEvent = 0,
+        PaintInfoCreated,
+        StrokeJobQueued,
+        StrokeJob,
+        MergeJobQueued,
+        ProjectionMerge,
+        CanvasTextureUpdate,
+        NumEventTypes
+    };
+
+    /**
+     * Records a begin event in the constructor and the matching end
+     * event in the destructor, if the tracer is enabled
+     */
+    class KRITAIMAGE_EXPORT Span
+    {
+    public:
+        Span(EventType type, const QRect &rect = QRect());
+        ~Span();
+
+    private:
+        Q_DISABLE_COPY(Span)
+
+        EventType m_type;
+        bool m_isActive;
+    };
+
+public:
+    KisLatencyTracer();
+    ~KisLatencyTracer();
+
+    static KisLatencyTracer* instance();
+
+    /**
+     * @return true if the events are being recorded. This is the
+     * only call a hook does when the tracer is disabled.
+     */
+    static bool isEnabled();
+    void setEnabled(bool value);
+
+    /**
+     * Drops all the recorded events
+     */
+    void clear();
+
+    void recordInstant(EventType type, const QRect &rect = QRect());
+    void recordInstant(EventType type, const QPointF &pos);
+    void recordBegin(EventType type, const QRect &rect = QRect());
+    void recordEnd(EventType type);
+
+    /**
+     * Saves the recorded events in Chrome trace event JSON format.
+     *
+     * The threads keep recording while the trace is being saved, so
+     * the tracer should be disabled first to get a consistent trace.
+     */
+    bool saveChromeTrace(const QString &fileName) const;
+
+    /**
+     * @return a human-readable summary with the percentiles of the
+     * duration of every traced operation and of the latency from the
+     * input event to the updated pixels on the canvas
+     */
+    QString summary() const;
+
+    static QString eventName(EventType type);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISLATENCYTRACER_H
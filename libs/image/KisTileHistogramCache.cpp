@@ -0,0 +1,271 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTileHistogramCache.h"
+
+#include <QHash>
+#include <QSet>
+#include <QRegion>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtConcurrent>
+
+#include <KoColorSpace.h>
+
+#include "kis_paint_device.h"
+#include "kis_iterator_ng.h"
+#include "kis_assert.h"
+
+
+namespace {
+
+/**
+ * The same size as the tiles of the paint devices, so a dab usually
+ * dirties only one or two tiles of the cache
+ */
+const int tileSize = 64;
+
+inline int tileIndex(int coord)
+{
+    return coord >= 0 ? coord / tileSize : -((-coord - 1) / tileSize) - 1;
+}
+
+inline quint64 tileKey(int col, int row)
+{
+    return (quint64(quint32(col)) << 32) | quint32(row);
+}
+
+inline QRect tileRect(quint64 key)
+{
+    const int col = qint32(key >> 32);
+    const int row = qint32(key & 0xFFFFFFFF);
+
+    return QRect(col * tileSize, row * tileSize, tileSize, tileSize);
+}
+
+void addTileKeys(const QRect &rc, QSet<quint64> *keys)
+{
+    if (rc.isEmpty()) return;
+
+    const int firstCol = tileIndex(rc.left());
+    const int lastCol = tileIndex(rc.right());
+    const int firstRow = tileIndex(rc.top());
+    const int lastRow = tileIndex(rc.bottom());
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            keys->insert(tileKey(col, row));
+        }
+    }
+}
+
+struct TileJob
+{
+    quint64 key;
+    QRect rect;
+    QVector<quint32> bins;
+};
+
+struct CountTileBins
+{
+    CountTileBins(KisPaintDeviceSP device)
+        : m_device(device)
+    {
+    }
+
+    void operator()(TileJob &job)
+    {
+        if (job.rect.isEmpty()) return;
+
+        const KoColorSpace *cs = m_device->colorSpace();
+        const int channelCount = cs->channelCount();
+        const int pixelSize = cs->pixelSize();
+
+        job.bins.fill(0, channelCount * KisTileHistogramCache::numBins);
+        quint32 *bins = job.bins.data();
+
+        KisSequentialConstIterator it(m_device, job.rect);
+
+        int numConseqPixels = it.nConseqPixels();
+        while (it.nextPixels(numConseqPixels)) {
+            numConseqPixels = it.nConseqPixels();
+
+            const quint8 *pixel = it.rawDataConst();
+            for (int k = 0; k < numConseqPixels; k++) {
+                for (int chan = 0; chan < channelCount; chan++) {
+                    bins[chan * KisTileHistogramCache::numBins + cs->scaleToU8(pixel, chan)]++;
+                }
+                pixel += pixelSize;
+            }
+        }
+    }
+
+    KisPaintDeviceSP m_device;
+};
+
+}
+
+struct Q_DECL_HIDDEN KisTileHistogramCache::Private
+{
+    QMutex dirtyLock;
+    QSet<quint64> dirtyTiles;
+    bool allDirty = true;
+
+    // the data below is accessed under dataLock only
+    mutable QMutex dataLock;
+    KisPaintDeviceWSP device;
+    const KoColorSpace *colorSpace = 0;
+    QRect bounds;
+    QRect countRect;
+    int channelCount = 0;
+    int numRecountedTiles = 0;
+
+    QHash<quint64, QVector<quint32>> tiles;
+    QVector<quint32> bins;
+};
+
+
+KisTileHistogramCache::KisTileHistogramCache()
+    : m_d(new Private)
+{
+}
+
+KisTileHistogramCache::~KisTileHistogramCache()
+{
+}
+
+void KisTileHistogramCache::setDirty(const QRect &rc)
+{
+    QMutexLocker l(&m_d->dirtyLock);
+    if (m_d->allDirty) return;
+
+    addTileKeys(rc, &m_d->dirtyTiles);
+}
+
+void KisTileHistogramCache::reset()
+{
+    QMutexLocker l(&m_d->dirtyLock);
+    m_d->allDirty = true;
+    m_d->dirtyTiles.clear();
+}
+
+void KisTileHistogramCache::update(KisPaintDeviceSP device, const QRect &bounds)
+{
+    QMutexLocker dataLocker(&m_d->dataLock);
+
+    const bool needsReset =
+        !m_d->device.isValid() ||
+        m_d->device != device.data() ||
+        m_d->colorSpace != device->colorSpace() ||
+        m_d->bounds != bounds;
+
+    QSet<quint64> dirtyTiles;
+    bool allDirty = false;
+
+    {
+        QMutexLocker dirtyLocker(&m_d->dirtyLock);
+        dirtyTiles.swap(m_d->dirtyTiles);
+        allDirty = m_d->allDirty || needsReset;
+        m_d->allDirty = false;
+    }
+
+    if (allDirty) {
+        m_d->device = device;
+        m_d->colorSpace = device->colorSpace();
+        m_d->bounds = bounds;
+        m_d->channelCount = device->channelCount();
+
+        m_d->tiles.clear();
+        m_d->bins.fill(0, m_d->channelCount * numBins);
+
+        dirtyTiles.clear();
+        addTileKeys(bounds, &dirtyTiles);
+    }
+
+    const QRect countRect = bounds & device->extent();
+
+    /**
+     * The tiles that entered or left the extent since the previous
+     * update contain default pixels that were not counted (or should
+     * not be counted anymore), even though nobody has marked them dirty
+     */
+    if (!allDirty && countRect != m_d->countRect) {
+        const QRegion changedArea = QRegion(countRect).xored(QRegion(m_d->countRect));
+        Q_FOREACH (const QRect &rc, changedArea.rects()) {
+            addTileKeys(rc, &dirtyTiles);
+        }
+    }
+    m_d->countRect = countRect;
+
+    QVector<TileJob> jobs;
+    jobs.reserve(dirtyTiles.size());
+
+    Q_FOREACH (quint64 key, dirtyTiles) {
+        TileJob job;
+        job.key = key;
+        job.rect = tileRect(key) & countRect;
+        jobs.append(job);
+    }
+
+    QtConcurrent::blockingMap(jobs, CountTileBins(device));
+
+    quint32 *bins = m_d->bins.data();
+    const int totalBins = m_d->bins.size();
+
+    Q_FOREACH (const TileJob &job, jobs) {
+        auto it = m_d->tiles.find(job.key);
+
+        if (it != m_d->tiles.end()) {
+            const quint32 *oldBins = it->constData();
+            for (int i = 0; i < totalBins; i++) {
+                bins[i] -= oldBins[i];
+            }
+            m_d->tiles.erase(it);
+        }
+
+        if (!job.bins.isEmpty()) {
+            const quint32 *newBins = job.bins.constData();
+            for (int i = 0; i < totalBins; i++) {
+                bins[i] += newBins[i];
+            }
+            m_d->tiles.insert(job.key, job.bins);
+        }
+    }
+
+    m_d->numRecountedTiles = jobs.size();
+}
+
+int KisTileHistogramCache::channelCount() const
+{
+    QMutexLocker l(&m_d->dataLock);
+    return m_d->channelCount;
+}
+
+QVector<quint32> KisTileHistogramCache::channelBins(int channel) const
+{
+    QMutexLocker l(&m_d->dataLock);
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(channel >= 0 && channel < m_d->channelCount, QVector<quint32>());
+
+    return m_d->bins.mid(channel * numBins, numBins);
+}
+
+int KisTileHistogramCache::numRecountedTiles() const
+{
+    QMutexLocker l(&m_d->dataLock);
+    return m_d->numRecountedTiles;
+}
@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISTILEHISTOGRAMCACHE_H
+#define KISTILEHISTOGRAMCACHE_H
+
+#include <QScopedPointer>
+#include <QVector>
+#include <QRect>
+
+#include "kis_types.h"
+#include "kritaimage_export.h"
+
+/**
+ * Keeps an exact per-channel histogram (256 bins per channel, as
+ * returned by KoColorSpace::scaleToU8()) of a paint device up to date
+ * incrementally.
+ *
+ * The bins are counted per 64x64 tile and cached. When the device is
+ * changed, the user marks the changed area with setDirty(), and the
+ * next update() recounts only the dirty tiles, in parallel on the
+ * global thread pool. The device is read directly, no copy of it is
+ * made, so update() should be called when the image is idle. If the
+ * device is changed while update() runs, the affected tiles are simply
+ * recounted on the next call.
+ *
+ * The pixels outside the extent of the device are not counted. When
+ * the extent changes, the tiles that entered or left it are recounted
+ * automatically.
+ *
+ * setDirty() and reset() can be called from any thread, even while
+ * update() is running.
+ */
+class KRITAIMAGE_EXPORT KisTileHistogramCache
+{
+public:
+    static const int numBins = 256;
+
+public:
+    KisTileHistogramCache();
+    ~KisTileHistogramCache();
+
+    /**
+     * Marks the tiles intersecting \p rc for recounting
+     */
+    void setDirty(const QRect &rc);
+
+    /**
+     * Marks all the tiles for recounting
+     */
+    void reset();
+
+    /**
+     * Recounts the dirty tiles of \p device inside \p bounds. If the
+     * device, its color space or \p bounds are different from the
+     * ones of the previous call, all the tiles are counted anew.
+     */
+    void update(KisPaintDeviceSP device, const QRect &bounds);
+
+    /**
+     * The number of channels of the counted device
+     */
+    int channelCount() const;
+
+    /**
+     * The bins of \p channel counted by the last update()
+     */
+    QVector<quint32> channelBins(int channel) const;
+
+    /**
+     * The number of tiles recounted by the last update()
+     */
+    int numRecountedTiles() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISTILEHISTOGRAMCACHE_H
@@ -18,6 +18,7 @@
 
 #include <brushengine/kis_paint_information.h>
 
+#include <QDataStream>
 #include <QDomElement>
 #include <boost/optional.hpp>
 
@@ -344,6 +345,62 @@ KisPaintInformation KisPaintInformation::fromXML(const QDomElement& e)
                                rotation, tangentialPressure, perspective, time, speed);
 }
 
+void KisPaintInformation::toDataStream(QDataStream &stream) const
+{
+    // hovering mode infos are not supposed to be saved
+    KIS_ASSERT_RECOVER_NOOP(!d->isHoveringMode);
+
+    stream << d->pos
+           << double(d->pressure)
+           << double(d->xTilt)
+           << double(d->yTilt)
+           << double(d->rotation)
+           << double(d->tangentialPressure)
+           << double(d->perspective)
+           << double(d->time)
+           << double(d->speed)
+           << double(d->canvasRotation)
+           << d->canvasMirroredH
+           << d->canvasMirroredV;
+}
+
+KisPaintInformation KisPaintInformation::fromDataStream(QDataStream &stream)
+{
+    QPointF pos;
+    double pressure = 0.0;
+    double xTilt = 0.0;
+    double yTilt = 0.0;
+    double rotation = 0.0;
+    double tangentialPressure = 0.0;
+    double perspective = 0.0;
+    double time = 0.0;
+    double speed = 0.0;
+    double canvasRotation = 0.0;
+    bool canvasMirroredH = false;
+    bool canvasMirroredV = false;
+
+    stream >> pos
+           >> pressure
+           >> xTilt
+           >> yTilt
+           >> rotation
+           >> tangentialPressure
+           >> perspective
+           >> time
+           >> speed
+           >> canvasRotation
+           >> canvasMirroredH
+           >> canvasMirroredV;
+
+    KisPaintInformation pi(pos, pressure, xTilt, yTilt,
+                           rotation, tangentialPressure, perspective, time, speed);
+    pi.setCanvasRotation(canvasRotation);
+    pi.setCanvasMirroredH(canvasMirroredH);
+    pi.setCanvasMirroredV(canvasMirroredV);
+
+    return pi;
+}
+
 const QPointF& KisPaintInformation::pos() const
 {
     return d->pos;
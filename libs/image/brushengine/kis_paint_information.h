@@ -31,6 +31,7 @@
 #include "kis_timing_information.h"
 
 
+class QDataStream;
 class QDomDocument;
 class QDomElement;
 class KisDistanceInformation;
@@ -299,6 +300,14 @@ public:
 
     static KisPaintInformation fromXML(const QDomElement&);
 
+    /**
+     * Binary counterparts of toXML() and fromXML(). Apart from the
+     * values saved by toXML() they also keep the canvas rotation and
+     * mirroring, so that the recorded strokes could be replayed exactly.
+     */
+    void toDataStream(QDataStream &stream) const;
+    static KisPaintInformation fromDataStream(QDataStream &stream);
+
     // TODO: Refactor the static mix functions to non-static in-place mutation
     //       versions like mixOtherOnlyPosition and mixOtherWithoutTime.
     // Heap allocation on Windows is awfully slow and will fragment the memory
@@ -19,8 +19,10 @@
 #include "filter/kis_color_transformation_configuration.h"
 
 #include <QMutexLocker>
+#include <QScopedPointer>
 #include <QMap>
 #include <QThread>
+#include <KoLut3DColorTransformation.h>
 #include "filter/kis_color_transformation_filter.h"
 
 struct Q_DECL_HIDDEN KisColorTransformationConfiguration::Private {
@@ -30,10 +32,14 @@ struct Q_DECL_HIDDEN KisColorTransformationConfiguration::Private {
     ~Private()
     {
         qDeleteAll(colorTransformation);
+        qDeleteAll(bakedColorTransformation);
     }
 
     // XXX: Threadlocal storage!!!
     QMap<QThread*, KoColorTransformation*> colorTransformation;
+
+    // null values mark the color spaces the baking failed for
+    QMap<const KoColorSpace*, KoColorTransformation*> bakedColorTransformation;
     QMutex mutex;
 };
 
@@ -71,3 +77,18 @@ KoColorTransformation* KisColorTransformationConfiguration::colorTransformation(
     locker.unlock();
     return transformation;
 }
+
+KoColorTransformation* KisColorTransformationConfiguration::bakedColorTransformation(const KoColorSpace *cs, const KisColorTransformationFilter *filter) const
+{
+    if (!KoLut3DColorTransformation::supportsColorSpace(cs)) return 0;
+
+    QMutexLocker locker(&d->mutex);
+
+    if (!d->bakedColorTransformation.contains(cs)) {
+        KisFilterConfigurationSP config(const_cast<KisColorTransformationConfiguration*>(this));
+        QScopedPointer<KoColorTransformation> transformation(filter->createTransformation(cs, config));
+        d->bakedColorTransformation.insert(cs, KoLut3DColorTransformation::bake(transformation.data(), cs));
+    }
+
+    return d->bakedColorTransformation.value(cs, 0);
+}
@@ -39,6 +39,15 @@ public:
 
     KoColorTransformation *colorTransformation(const KoColorSpace *cs, const KisColorTransformationFilter *filter) const;
 
+    /**
+     * Returns the transformation of the filter baked into a 3D lookup
+     * table (see KoLut3DColorTransformation). The table is created once
+     * per color space and shared between all the threads.
+     *
+     * @return null if the transformation cannot be baked for \p cs
+     */
+    KoColorTransformation *bakedColorTransformation(const KoColorSpace *cs, const KisColorTransformationFilter *filter) const;
+
 private:
     struct Private;
     Private* const d;
@@ -31,6 +31,7 @@
 #endif
 #include <KisSequentialIteratorProgress.h>
 #include "kis_color_transformation_configuration.h"
+#include "kis_image_config.h"
 
 KisColorTransformationFilter::KisColorTransformationFilter(const KoID& id, const KoID & category, const QString & entry) : KisFilter(id, category, entry)
 {
@@ -54,7 +55,18 @@ void KisColorTransformationFilter::processImpl(KisPaintDeviceSP device,
     // Ew, casting
     KisColorTransformationConfigurationSP colorTransformationConfiguration(dynamic_cast<KisColorTransformationConfiguration*>(const_cast<KisFilterConfiguration*>(config.data())));
     if (colorTransformationConfiguration) {
-        colorTransformation = colorTransformationConfiguration->colorTransformation(cs, this);
+        /**
+         * The baked transformation is shared by all the threads and
+         * survives between the updates of the adjustment layer, so the
+         * expensive math of the filter is evaluated only once.
+         */
+        if (KisImageConfig(true).useBakedColorAdjustments()) {
+            colorTransformation = colorTransformationConfiguration->bakedColorTransformation(cs, this);
+        }
+
+        if (!colorTransformation) {
+            colorTransformation = colorTransformationConfiguration->colorTransformation(cs, this);
+        }
     }
     else {
         colorTransformation = createTransformation(cs, config);
@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisGeneratorDataSource.h"
+
+#include <QMutexLocker>
+
+#include "generator/kis_generator.h"
+#include "filter/kis_filter_configuration.h"
+#include "kis_paint_device.h"
+#include "kis_painter.h"
+#include "kis_processing_information.h"
+#include "kis_selection.h"
+
+
+KisGeneratorDataSource::KisGeneratorDataSource(KisGeneratorSP generator,
+                                               KisFilterConfigurationSP config,
+                                               const KoColorSpace *colorSpace,
+                                               KisDefaultBoundsBaseSP defaultBounds,
+                                               KisSelectionBasedLayer *layer)
+    : m_generator(generator),
+      m_config(config),
+      m_colorSpace(colorSpace),
+      m_defaultBounds(defaultBounds),
+      m_layer(layer)
+{
+}
+
+void KisGeneratorDataSource::readBytes(quint8 *data, const QRect &rect)
+{
+    QPoint offset;
+    {
+        QMutexLocker l(&m_mutex);
+        offset = m_offset;
+    }
+
+    const QRect deviceRect = rect.translated(offset);
+
+    KisPaintDeviceSP device = new KisPaintDevice(m_colorSpace);
+    device->setDefaultBounds(m_defaultBounds);
+
+    KisProcessingInformation dstCfg(device, deviceRect.topLeft(), KisSelectionSP());
+    m_generator->generate(dstCfg, deviceRect.size(), m_config, 0);
+
+    KisSharedPtr<KisSelectionBasedLayer> layer = m_layer.toStrongRef();
+    KisSelectionSP selection = layer ? layer->fetchComposedInternalSelection(deviceRect) : KisSelectionSP();
+
+    if (selection) {
+        KisPaintDeviceSP maskedDevice = new KisPaintDevice(m_colorSpace);
+        KisPainter::copyAreaOptimized(deviceRect.topLeft(), device, maskedDevice, deviceRect, selection);
+        device = maskedDevice;
+    }
+
+    device->readBytes(data, deviceRect);
+}
+
+QRect KisGeneratorDataSource::bounds() const
+{
+    QMutexLocker l(&m_mutex);
+    return m_bounds.translated(-m_offset);
+}
+
+void KisGeneratorDataSource::setBounds(const QRect &rc)
+{
+    QMutexLocker l(&m_mutex);
+    m_bounds = rc;
+}
+
+void KisGeneratorDataSource::setOffset(const QPoint &pt)
+{
+    QMutexLocker l(&m_mutex);
+    m_offset = pt;
+}
+
+KisFilterConfigurationSP KisGeneratorDataSource::config() const
+{
+    return m_config;
+}
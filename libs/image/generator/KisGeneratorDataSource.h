@@ -0,0 +1,83 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISGENERATORDATASOURCE_H
+#define KISGENERATORDATASOURCE_H
+
+#include <QMutex>
+#include <QPoint>
+#include <QRect>
+
+#include "tiles3/KisTiledDataSource.h"
+#include "kis_types.h"
+#include "kis_default_bounds_base.h"
+#include "kis_selection_based_layer.h"
+
+class KoColorSpace;
+
+/**
+ * A data source for the paint device of a generator layer, which
+ * runs the generator for every tile that is read from the device
+ * instead of storing the generated pixels. The internal selection of
+ * the layer is applied to the generated pixels, since the layer has no
+ * projection of its own then.
+ *
+ * The generator must allow splitting into patches.
+ *
+ * \see KisGeneratorLayer, KisPaintDevice::setDataSource()
+ */
+class KisGeneratorDataSource : public KisTiledDataSource
+{
+public:
+    KisGeneratorDataSource(KisGeneratorSP generator,
+                           KisFilterConfigurationSP config,
+                           const KoColorSpace *colorSpace,
+                           KisDefaultBoundsBaseSP defaultBounds,
+                           KisSelectionBasedLayer *layer);
+
+    void readBytes(quint8 *data, const QRect &rect) override;
+    QRect bounds() const override;
+
+    /**
+     * Sets the area the generator is run for, in the coordinates
+     * of the image
+     */
+    void setBounds(const QRect &rc);
+
+    /**
+     * Sets the offset of the paint device the source is attached to
+     */
+    void setOffset(const QPoint &pt);
+
+    KisFilterConfigurationSP config() const;
+
+private:
+    KisGeneratorSP m_generator;
+    KisFilterConfigurationSP m_config;
+    const KoColorSpace *m_colorSpace;
+    KisDefaultBoundsBaseSP m_defaultBounds;
+    KisWeakSharedPtr<KisSelectionBasedLayer> m_layer;
+
+    mutable QMutex m_mutex;
+    QRect m_bounds;
+    QPoint m_offset;
+};
+
+typedef QSharedPointer<KisGeneratorDataSource> KisGeneratorDataSourceSP;
+
+#endif // KISGENERATORDATASOURCE_H
@@ -19,6 +19,7 @@
 
 #include <QMutex>
 #include <QMutexLocker>
+#include <QAtomicInt>
 
 #include "kis_generator_layer.h"
 
@@ -37,6 +38,10 @@
 #include "kis_thread_safe_signal_compressor.h"
 #include <kis_generator_stroke_strategy.h>
 #include <KisRunnableStrokeJobData.h>
+#include "KisGeneratorDataSource.h"
+#include "kis_image_config.h"
+#include "kis_painter.h"
+#include "tiles3/kis_tile_data_interface.h"
 
 
 #define UPDATE_DELAY 100 /*ms */
@@ -54,6 +59,9 @@ struct Q_DECL_HIDDEN KisGeneratorLayer::Private
     KisFilterConfigurationSP preparedForFilter;
     QWeakPointer<bool> updateCookie;
     QMutex mutex;
+
+    KisGeneratorDataSourceSP dataSource;
+    QAtomicInt isVirtual;
 };
 
 
@@ -72,6 +80,20 @@ KisGeneratorLayer::KisGeneratorLayer(const KisGeneratorLayer& rhs)
       m_d(new Private)
 {
     connect(&m_d->updateSignalCompressor, SIGNAL(timeout()), SLOT(slotDelayedStaticUpdate()));
+
+    /**
+     * The copied paint device still reads from the source of \p rhs,
+     * which applies the selection of \p rhs, so we need our own one
+     */
+    if (rhs.isVirtual()) {
+        KisFilterConfigurationSP filterConfig = filter();
+        KisGeneratorSP f = KisGeneratorRegistry::instance()->value(filterConfig->name());
+        KIS_SAFE_ASSERT_RECOVER_RETURN(f);
+
+        attachDataSource(f, filterConfig, rhs.m_d->preparedImageBounds);
+        m_d->preparedForFilter = filterConfig;
+        m_d->preparedImageBounds = rhs.m_d->preparedImageBounds;
+    }
 }
 
 KisGeneratorLayer::~KisGeneratorLayer()
@@ -120,6 +142,47 @@ void KisGeneratorLayer::requestUpdateJobsWithStroke(KisStrokeId strokeId, KisFil
     KisImageSP image = this->image().toStrongRef();
     const QRect updateRect = extent() | image->bounds();
 
+    KisGeneratorSP f = KisGeneratorRegistry::instance()->value(filterConfig->name());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(f);
+
+    const bool useVirtualLayer =
+        KisImageConfig(true).useVirtualGeneratorLayers() &&
+        f->allowsSplittingIntoPatches();
+
+    if (useVirtualLayer) {
+        /**
+         * Nothing is rendered in advance, the tiles are generated
+         * when the layer is composed. We only need to drop the tiles
+         * generated with the old parameters.
+         */
+        if (filterConfig != m_d->preparedForFilter ||
+            !m_d->dataSource ||
+            original()->dataSource() != m_d->dataSource) {
+
+            attachDataSource(f, filterConfig, image->bounds());
+        } else {
+            KisPaintDeviceSP originalDevice = original();
+            m_d->dataSource->setBounds(image->bounds());
+            m_d->dataSource->setOffset(QPoint(originalDevice->x(), originalDevice->y()));
+            originalDevice->invalidateDataSourceCache(updateRect);
+        }
+
+        m_d->updateCookie.clear();
+        m_d->preparedRect = QRect();
+        m_d->preparedImageBounds = image->bounds();
+        m_d->preparedForFilter = filterConfig;
+
+        locker.unlock();
+        setDirtyWithoutUpdate({updateRect});
+        return;
+    }
+
+    if (m_d->isVirtual) {
+        m_d->dataSource.clear();
+        m_d->isVirtual = 0;
+        m_d->preparedForFilter = KisFilterConfigurationSP();
+    }
+
     if (filterConfig != m_d->preparedForFilter) {
         locker.unlock();
         resetCacheWithoutUpdate();
@@ -134,9 +197,6 @@ void KisGeneratorLayer::requestUpdateJobsWithStroke(KisStrokeId strokeId, KisFil
     if (processRegion.isEmpty())
         return;
 
-    KisGeneratorSP f = KisGeneratorRegistry::instance()->value(filterConfig->name());
-    KIS_SAFE_ASSERT_RECOVER_RETURN(f);
-
     KisProcessingVisitor::ProgressHelper helper(this);
 
     KisPaintDeviceSP originalDevice = original();
@@ -155,6 +215,28 @@ void KisGeneratorLayer::requestUpdateJobsWithStroke(KisStrokeId strokeId, KisFil
     m_d->preparedForFilter = filterConfig;
 }
 
+void KisGeneratorLayer::attachDataSource(KisGeneratorSP f, const KisFilterConfigurationSP filterConfig, const QRect &imageBounds)
+{
+    KisPaintDeviceSP originalDevice = original();
+
+    const int tileSize = KisTileData::WIDTH * KisTileData::HEIGHT * originalDevice->pixelSize();
+    const int maxCachedTiles =
+        qMax(1, int(qint64(KisImageConfig(true).virtualGeneratorLayerCacheSize()) * 1024 * 1024 / tileSize));
+
+    KisGeneratorDataSourceSP source(
+        new KisGeneratorDataSource(f, filterConfig,
+                                   originalDevice->colorSpace(),
+                                   originalDevice->defaultBounds(),
+                                   this));
+    source->setBounds(imageBounds);
+    source->setOffset(QPoint(originalDevice->x(), originalDevice->y()));
+
+    m_d->dataSource = source;
+    m_d->isVirtual = 1;
+
+    originalDevice->setDataSource(source, maxCachedTiles);
+}
+
 void KisGeneratorLayer::previewWithStroke(const KisStrokeId strokeId)
 {
     KisFilterConfigurationSP filterConfig = filter();
@@ -232,6 +314,29 @@ void KisGeneratorLayer::resetCache()
     m_d->updateSignalCompressor.start();
 }
 
+bool KisGeneratorLayer::isVirtual() const
+{
+    return m_d->isVirtual;
+}
+
+bool KisGeneratorLayer::needProjection() const
+{
+    // the data source applies the selection itself
+    return !m_d->isVirtual && KisSelectionBasedLayer::needProjection();
+}
+
+void KisGeneratorLayer::copyOriginalToProjection(const KisPaintDeviceSP original,
+                                                 KisPaintDeviceSP projection,
+                                                 const QRect& rect) const
+{
+    if (m_d->isVirtual) {
+        KisPainter::copyAreaOptimized(rect.topLeft(), original, projection, rect);
+        return;
+    }
+
+    KisSelectionBasedLayer::copyOriginalToProjection(original, projection, rect);
+}
+
 void KisGeneratorLayer::forceUpdateTimedNode()
 {
     if (hasPendingTimedUpdates()) {
@@ -258,6 +363,23 @@ void KisGeneratorLayer::resetCacheWithoutUpdate()
 
 void KisGeneratorLayer::setDirty(const QVector<QRect> &rects)
 {
+    if (m_d->isVirtual) {
+        /**
+         * The generated pixels depend on the internal selection, so the
+         * changed areas should be generated again. Everything else is
+         * handled by update().
+         */
+        if (internalSelection()) {
+            KisPaintDeviceSP originalDevice = original();
+            Q_FOREACH (const QRect &rc, rects) {
+                originalDevice->invalidateDataSourceCache(rc);
+            }
+        }
+
+        setDirtyWithoutUpdate(rects);
+        return;
+    }
+
     setDirtyWithoutUpdate(rects);
     m_d->updateSignalCompressor.start();
 }
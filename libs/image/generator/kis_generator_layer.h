@@ -90,9 +90,25 @@ public:
 
     void resetCache() override;
 
+    /**
+     * A virtual generator layer stores no pixels. Its paint device reads
+     * them from the generator on demand and caches just a few tiles
+     * (see KisGeneratorDataSource). The layer becomes virtual on the next
+     * update if the generator allows splitting into patches and the
+     * feature is enabled in the configuration.
+     */
+    bool isVirtual() const;
+
+    bool needProjection() const override;
+
     void forceUpdateTimedNode() override;
     bool hasPendingTimedUpdates() const override;
 
+protected:
+    void copyOriginalToProjection(const KisPaintDeviceSP original,
+                                  KisPaintDeviceSP projection,
+                                  const QRect& rect) const override;
+
 private Q_SLOTS:
     void slotDelayedStaticUpdate();
 
@@ -105,6 +121,11 @@ private:
      * Resets the projection cache without triggering the update job.
      */
     void resetCacheWithoutUpdate();
+    /**
+     * Attaches a new generator data source to the paint device,
+     * which makes the layer virtual
+     */
+    void attachDataSource(KisGeneratorSP f, const KisFilterConfigurationSP filterConfig, const QRect &imageBounds);
 
 public:
     // KisIndirectPaintingSupport
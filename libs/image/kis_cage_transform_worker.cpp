@@ -28,6 +28,7 @@
 #include "kis_painter.h"
 #include "kis_image.h"
 #include "krita_utils.h"
+#include "KisFakeRunnableStrokeJobsExecutor.h"
 
 #include <qnumeric.h>
 
@@ -74,11 +75,6 @@ struct Q_DECL_HIDDEN KisCageTransformWorker::Private
 
     QVector<QPointF> calculateTransformedPoints();
 
-    inline QVector<int> calculateMappedIndexes(int col, int row,
-                                               int *numExistingPoints);
-
-    int tryGetValidIndex(const QPoint &cellPt);
-
     struct MapIndexesOp;
 };
 
@@ -218,67 +214,59 @@ QVector<QPointF> KisCageTransformWorker::Private::calculateTransformedPoints()
     return transformedPoints;
 }
 
-inline QVector<int> KisCageTransformWorker::Private::
-calculateMappedIndexes(int col, int row,
-                       int *numExistingPoints)
-{
-    *numExistingPoints = 0;
-    QVector<int> cellIndexes =
-        GridIterationTools::calculateCellIndexes(col, row, gridSize);
-
-    for (int i = 0; i < 4; i++) {
-        cellIndexes[i] = allToValidPointsMap[cellIndexes[i]];
-        *numExistingPoints += cellIndexes[i] >= 0;
-    }
-
-    return cellIndexes;
-}
-
-
-
-int KisCageTransformWorker::Private::
-tryGetValidIndex(const QPoint &cellPt)
-{
-    int index = -1;
-    if (cellPt.x() >= 0 &&
-        cellPt.y() >= 0 &&
-        cellPt.x() < gridSize.width() - 1 &&
-        cellPt.y() < gridSize.height() - 1) {
-
-        index = allToValidPointsMap[GridIterationTools::pointToIndex(cellPt, gridSize)];
-    }
-
-    return index;
-}
-
-
+/**
+ * The op keeps its own (implicitly shared) copies of the grid, so it
+ * can be passed to the concurrent jobs, which may outlive the worker
+ */
 struct KisCageTransformWorker::Private::MapIndexesOp {
 
     MapIndexesOp(KisCageTransformWorker::Private *d)
-        : m_d(d),
-          m_srcCagePolygon(QPolygonF(m_d->origCage))
+        : m_gridSize(d->gridSize),
+          m_allToValidPointsMap(d->allToValidPointsMap),
+          m_allSrcPoints(d->allSrcPoints),
+          m_srcCagePolygon(QPolygonF(d->origCage))
     {
     }
 
     inline QVector<int> calculateMappedIndexes(int col, int row,
                                                int *numExistingPoints) const {
 
-        return m_d->calculateMappedIndexes(col, row, numExistingPoints);
+        *numExistingPoints = 0;
+        QVector<int> cellIndexes =
+            GridIterationTools::calculateCellIndexes(col, row, m_gridSize);
+
+        for (int i = 0; i < 4; i++) {
+            cellIndexes[i] = m_allToValidPointsMap[cellIndexes[i]];
+            *numExistingPoints += cellIndexes[i] >= 0;
+        }
+
+        return cellIndexes;
     }
 
     inline int tryGetValidIndex(const QPoint &cellPt) const {
-        return m_d->tryGetValidIndex(cellPt);
+        int index = -1;
+        if (cellPt.x() >= 0 &&
+            cellPt.y() >= 0 &&
+            cellPt.x() < m_gridSize.width() - 1 &&
+            cellPt.y() < m_gridSize.height() - 1) {
+
+            index = m_allToValidPointsMap[GridIterationTools::pointToIndex(cellPt, m_gridSize)];
+        }
+
+        return index;
     }
 
     inline QPointF getSrcPointForce(const QPoint &cellPt) const {
-        return m_d->allSrcPoints[GridIterationTools::pointToIndex(cellPt, m_d->gridSize)];
+        return m_allSrcPoints[GridIterationTools::pointToIndex(cellPt, m_gridSize)];
     }
 
     inline const QPolygonF srcCropPolygon() const {
         return m_srcCagePolygon;
     }
 
-    KisCageTransformWorker::Private *m_d;
+    QSize m_gridSize;
+    QVector<int> m_allToValidPointsMap;
+    QVector<QPointF> m_allSrcPoints;
     QPolygonF m_srcCagePolygon;
 };
 
@@ -342,6 +330,15 @@ QRect KisCageTransformWorker::approxNeedRect(const QRect &rc, const QRect &fullB
 }
 
 void KisCageTransformWorker::run()
+{
+    QVector<KisRunnableStrokeJobDataBase*> jobs;
+    createRunJobs(jobs);
+
+    KisFakeRunnableStrokeJobsExecutor executor;
+    executor.addRunnableJobs(jobs);
+}
+
+void KisCageTransformWorker::createRunJobs(QVector<KisRunnableStrokeJobDataBase*> &jobs)
 {
     if (m_d->isGridEmpty()) return;
 
@@ -367,17 +364,28 @@ void KisCageTransformWorker::run()
         m_d->dev->clearSelection(selection);
     }
 
-    GridIterationTools::PaintDevicePolygonOp polygonOp(srcDev, tempDevice);
-    Private::MapIndexesOp indexesOp(m_d.data());
-    GridIterationTools::iterateThroughGrid
-        <GridIterationTools::IncompletePolygonPolicy>(polygonOp, indexesOp,
-                                                      m_d->gridSize,
-                                                      m_d->validPoints,
-                                                      transformedPoints);
+    using namespace GridIterationTools;
+
+    typedef GridCellsOp<IncompletePolygonPolicy, Private::MapIndexesOp> CellsOp;
+
+    CellsOp cellsOp(Private::MapIndexesOp(m_d.data()),
+                    m_d->gridSize,
+                    m_d->validPoints,
+                    transformedPoints);
+
+    const QVector<GridPatch> patches =
+        splitGridIntoPatches(cellsOp, KritaUtils::optimalPatchSize());
+
+    PaintDevicePolygonOp polygonOp(srcDev, tempDevice);
+    addGridPatchJobs(jobs, cellsOp, polygonOp, patches);
+
+    KisPaintDeviceSP dstDev = m_d->dev;
 
-    QRect rect = tempDevice->extent();
-    KisPainter gc(m_d->dev);
-    gc.bitBlt(rect.topLeft(), tempDevice, rect);
+    KritaUtils::addJobSequential(jobs, [dstDev, tempDevice] () {
+        QRect rect = tempDevice->extent();
+        KisPainter gc(dstDev);
+        gc.bitBlt(rect.topLeft(), tempDevice, rect);
+    });
 }
 
 QImage KisCageTransformWorker::runOnQImage(QPointF *newOffset)
@@ -24,6 +24,7 @@
 #include <kis_types.h>
 
 class QImage;
+class KisRunnableStrokeJobDataBase;
 
 class KRITAIMAGE_EXPORT KisCageTransformWorker
 {
@@ -45,6 +46,15 @@ public:
     void setTransformedCage(const QVector<QPointF> &transformedCage);
     void run();
 
+    /**
+     * Appends to \p jobs the jobs that perform the prepared transformation:
+     * the concurrent jobs that transform the patches of the device and
+     * a sequential job that merges the result back into the device. The
+     * jobs do not refer to the worker, so it can be deleted before they
+     * are executed.
+     */
+    void createRunJobs(QVector<KisRunnableStrokeJobDataBase*> &jobs);
+
     QRect approxChangeRect(const QRect &rc);
     QRect approxNeedRect(const QRect &rc, const QRect &fullBounds);
 
@@ -29,6 +29,7 @@
 #include "kis_four_point_interpolator_backward.h"
 #include "kis_iterator_ng.h"
 #include "kis_random_sub_accessor.h"
+#include "KisRunnableStrokeJobUtils.h"
 
 //#define DEBUG_PAINTING_POLYGONS
 
@@ -185,6 +186,9 @@ struct PaintDevicePolygonOp
 
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
         QRect boundRect = clipDstPolygon.boundingRect().toAlignedRect();
+        if (m_clipRect.isValid()) {
+            boundRect &= m_clipRect;
+        }
         if (boundRect.isEmpty()) return;
 
         KisSequentialIterator dstIt(m_dstDev, boundRect);
@@ -225,8 +229,18 @@ struct PaintDevicePolygonOp
 
     }
 
+    /**
+     * Limits the written pixels to \p rect of the destination device,
+     * so that several copies of the op could write into different
+     * patches of the same device concurrently
+     */
+    void setClipRect(const QRect &rect) {
+        m_clipRect = rect;
+    }
+
     KisPaintDeviceSP m_srcDev;
     KisPaintDeviceSP m_dstDev;
+    QRect m_clipRect;
 };
 
 struct QImagePolygonOp
@@ -248,6 +262,11 @@ struct QImagePolygonOp
 
     void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
         QRect boundRect = clipDstPolygon.boundingRect().toAlignedRect();
+        if (m_clipRect.isValid()) {
+            boundRect &= m_clipRect;
+        }
+        if (boundRect.isEmpty()) return;
+
         KisFourPointInterpolatorBackward interp(srcPolygon, dstPolygon);
 
         for (int y = boundRect.top(); y <= boundRect.bottom(); y++) {
@@ -292,6 +311,15 @@ struct QImagePolygonOp
 
     }
 
+    /**
+     * Limits the written pixels to \p rect. The rect is defined in the
+     * coordinates of the transformed polygons, that is, before
+     * the destination image offset is applied.
+     */
+    void setClipRect(const QRect &rect) {
+        m_clipRect = rect;
+    }
+
     const QImage &m_srcImage;
     QImage &m_dstImage;
     QPointF m_srcImageOffset;
@@ -299,6 +327,7 @@ struct QImagePolygonOp
 
     QRect m_srcImageRect;
     QRect m_dstImageRect;
+    QRect m_clipRect;
 };
 
 /*************************************************************/
@@ -551,6 +580,44 @@ inline void adjustAlignedPolygon(QPolygonF &polygon)
     polygon[3] += p3;
 }
 
+template <template <class PolygonOp, class IndexesOp> class IncompletePolygonPolicy,
+          class PolygonOp,
+          class IndexesOp>
+inline void processGridCell(int col, int row,
+                            PolygonOp &polygonOp,
+                            IndexesOp &indexesOp,
+                            const QVector<QPointF> &originalPoints,
+                            const QVector<QPointF> &transformedPoints)
+{
+    int numExistingPoints = 0;
+
+    QVector<int> polygonPoints = indexesOp.calculateMappedIndexes(col, row, &numExistingPoints);
+
+    if (!IncompletePolygonPolicy<PolygonOp, IndexesOp>::
+         tryProcessPolygon(col, row,
+                           numExistingPoints,
+                           polygonOp,
+                           indexesOp,
+                           polygonPoints,
+                           originalPoints,
+                           transformedPoints)) {
+
+        QPolygonF srcPolygon;
+        QPolygonF dstPolygon;
+
+        for (int i = 0; i < 4; i++) {
+            const int index = polygonPoints[i];
+            srcPolygon << originalPoints[index];
+            dstPolygon << transformedPoints[index];
+        }
+
+        adjustAlignedPolygon(srcPolygon);
+        adjustAlignedPolygon(dstPolygon);
+
+        polygonOp(srcPolygon, dstPolygon);
+    }
+}
+
 template <template <class PolygonOp, class IndexesOp> class IncompletePolygonPolicy,
           class PolygonOp,
           class IndexesOp>
@@ -560,39 +627,268 @@ void iterateThroughGrid(PolygonOp &polygonOp,
                         const QVector<QPointF> &originalPoints,
                         const QVector<QPointF> &transformedPoints)
 {
-    QVector<int> polygonPoints(4);
-
     for (int row = 0; row < gridSize.height() - 1; row++) {
         for (int col = 0; col < gridSize.width() - 1; col++) {
-            int numExistingPoints = 0;
-
-            polygonPoints = indexesOp.calculateMappedIndexes(col, row, &numExistingPoints);
-
-            if (!IncompletePolygonPolicy<PolygonOp, IndexesOp>::
-                 tryProcessPolygon(col, row,
-                                   numExistingPoints,
-                                   polygonOp,
-                                   indexesOp,
-                                   polygonPoints,
-                                   originalPoints,
-                                   transformedPoints)) {
-
-                QPolygonF srcPolygon;
-                QPolygonF dstPolygon;
-
-                for (int i = 0; i < 4; i++) {
-                    const int index = polygonPoints[i];
-                    srcPolygon << originalPoints[index];
-                    dstPolygon << transformedPoints[index];
-                }
+            processGridCell<IncompletePolygonPolicy>(col, row,
+                                                     polygonOp, indexesOp,
+                                                     originalPoints,
+                                                     transformedPoints);
+        }
+    }
+}
 
-                adjustAlignedPolygon(srcPolygon);
-                adjustAlignedPolygon(dstPolygon);
+/*************************************************************/
+/*      Concurrent processing of the grid                    */
+/*************************************************************/
+
+/**
+ * A polygon op that only collects the bounds of the pixels
+ * that would be written by the real op
+ */
+struct CellBoundsOp
+{
+    void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon) {
+        this->operator() (srcPolygon, dstPolygon, dstPolygon);
+    }
+
+    void operator() (const QPolygonF &srcPolygon, const QPolygonF &dstPolygon, const QPolygonF &clipDstPolygon) {
+        Q_UNUSED(srcPolygon);
+        Q_UNUSED(dstPolygon);
+        bounds |= clipDstPolygon.boundingRect().toAlignedRect();
+    }
+
+    QRect bounds;
+};
+
+inline QRect cellPointsBounds(const QPointF &pt0, const QPointF &pt1,
+                              const QPointF &pt2, const QPointF &pt3)
+{
+    const qreal left = std::min(std::min(pt0.x(), pt1.x()), std::min(pt2.x(), pt3.x()));
+    const qreal right = std::max(std::max(pt0.x(), pt1.x()), std::max(pt2.x(), pt3.x()));
+    const qreal top = std::min(std::min(pt0.y(), pt1.y()), std::min(pt2.y(), pt3.y()));
+    const qreal bottom = std::max(std::max(pt0.y(), pt1.y()), std::max(pt2.y(), pt3.y()));
+
+    // a pixel of margin covers the epsilon added by adjustAlignedPolygon()
+    return QRectF(QPointF(left, top), QPointF(right, bottom)).toAlignedRect().adjusted(-1, -1, 1, 1);
+}
+
+/**
+ * Provides the cells of a grid iterated by iterateThroughGrid() one by
+ * one. All the data is stored by value, so the op can be safely copied
+ * into the concurrent jobs.
+ */
+template <template <class PolygonOp, class IndexesOp> class IncompletePolygonPolicy,
+          class IndexesOp>
+struct GridCellsOp
+{
+    GridCellsOp(const IndexesOp &_indexesOp,
+                const QSize &_gridSize,
+                const QVector<QPointF> &_originalPoints,
+                const QVector<QPointF> &_transformedPoints)
+        : indexesOp(_indexesOp),
+          gridSize(_gridSize),
+          originalPoints(_originalPoints),
+          transformedPoints(_transformedPoints)
+    {
+    }
+
+    template <class PolygonOp>
+    inline void processCell(int col, int row, PolygonOp &polygonOp) {
+        processGridCell<IncompletePolygonPolicy>(col, row,
+                                                 polygonOp, indexesOp,
+                                                 originalPoints,
+                                                 transformedPoints);
+    }
+
+    /**
+     * Returns a rect, which is guaranteed to contain all the pixels
+     * written for the cell
+     */
+    inline QRect cellDstBounds(int col, int row) {
+        int numExistingPoints = 0;
+        QVector<int> polygonPoints = indexesOp.calculateMappedIndexes(col, row, &numExistingPoints);
+
+        if (numExistingPoints == 4) {
+            return cellPointsBounds(transformedPoints[polygonPoints[0]],
+                                    transformedPoints[polygonPoints[1]],
+                                    transformedPoints[polygonPoints[2]],
+                                    transformedPoints[polygonPoints[3]]);
+        }
+
+        CellBoundsOp boundsOp;
+        processCell(col, row, boundsOp);
+        return boundsOp.bounds;
+    }
 
-                polygonOp(srcPolygon, dstPolygon);
+    IndexesOp indexesOp;
+    QSize gridSize;
+    QVector<QPointF> originalPoints;
+    QVector<QPointF> transformedPoints;
+};
+
+/**
+ * Provides the cells of a grid in the same way as processGrid() does,
+ * but from the precalculated source and transformed points of the grid
+ * nodes, as returned by processGrid() with AllPointsFetcherOp-like op.
+ */
+struct RegularGridCellsOp
+{
+    RegularGridCellsOp(const QSize &_gridSize,
+                       const QVector<QPointF> &_originalPoints,
+                       const QVector<QPointF> &_transformedPoints)
+        : gridSize(_gridSize),
+          originalPoints(_originalPoints),
+          transformedPoints(_transformedPoints)
+    {
+    }
+
+    template <class PolygonOp>
+    inline void processCell(int col, int row, PolygonOp &polygonOp) {
+        const QVector<int> indexes = calculateCellIndexes(col, row, gridSize);
+
+        QPolygonF srcPolygon;
+        QPolygonF dstPolygon;
+
+        for (int i = 0; i < 4; i++) {
+            srcPolygon << originalPoints[indexes[i]];
+            dstPolygon << transformedPoints[indexes[i]];
+        }
+
+        polygonOp(srcPolygon, dstPolygon);
+    }
+
+    inline QRect cellDstBounds(int col, int row) {
+        const int tl = col + row * gridSize.width();
+        const int bl = tl + gridSize.width();
+
+        return cellPointsBounds(transformedPoints[tl],
+                                transformedPoints[tl + 1],
+                                transformedPoints[bl + 1],
+                                transformedPoints[bl]);
+    }
+
+    QSize gridSize;
+    QVector<QPointF> originalPoints;
+    QVector<QPointF> transformedPoints;
+};
+
+/**
+ * A tile-aligned patch of the destination device and the cells of
+ * the grid that write into it. The cells are stored in the order of the
+ * sequential iteration, so processing them one by one produces
+ * exactly the same pixels in the patch, even when the transformed
+ * cells overlap.
+ */
+struct GridPatch
+{
+    QRect rect;
+    QVector<QPoint> cells;
+};
+
+/**
+ * Distributes the cells of the grid between the patches of the
+ * destination. The patches are aligned to \p patchSize, so the
+ * patches never share a tile if the size is a multiple of the tile
+ * size. If \p dstClipRect is valid, only the cells touching this rect
+ * are returned, and the patches are cropped by it.
+ */
+template <class CellsOp>
+QVector<GridPatch> splitGridIntoPatches(CellsOp &cellsOp,
+                                        const QSize &patchSize,
+                                        const QRect &dstClipRect = QRect())
+{
+    using KisAlgebra2D::divideFloor;
+
+    const int numCols = cellsOp.gridSize.width() - 1;
+    const int numRows = cellsOp.gridSize.height() - 1;
+
+    if (numCols <= 0 || numRows <= 0) return QVector<GridPatch>();
+
+    QVector<QRect> cellBounds(numCols * numRows);
+    QRect totalBounds;
+
+    for (int row = 0; row < numRows; row++) {
+        for (int col = 0; col < numCols; col++) {
+            QRect rc = cellsOp.cellDstBounds(col, row);
+            if (dstClipRect.isValid()) {
+                rc &= dstClipRect;
+            }
+
+            cellBounds[col + row * numCols] = rc;
+            totalBounds |= rc;
+        }
+    }
+
+    if (totalBounds.isEmpty()) return QVector<GridPatch>();
+
+    const int firstPatchCol = divideFloor(totalBounds.left(), patchSize.width());
+    const int firstPatchRow = divideFloor(totalBounds.top(), patchSize.height());
+    const int numPatchCols = divideFloor(totalBounds.right(), patchSize.width()) - firstPatchCol + 1;
+    const int numPatchRows = divideFloor(totalBounds.bottom(), patchSize.height()) - firstPatchRow + 1;
+
+    QVector<GridPatch> patches(numPatchCols * numPatchRows);
+
+    for (int row = 0; row < numRows; row++) {
+        for (int col = 0; col < numCols; col++) {
+            const QRect &rc = cellBounds[col + row * numCols];
+            if (rc.isEmpty()) continue;
+
+            const int left = divideFloor(rc.left(), patchSize.width()) - firstPatchCol;
+            const int right = divideFloor(rc.right(), patchSize.width()) - firstPatchCol;
+            const int top = divideFloor(rc.top(), patchSize.height()) - firstPatchRow;
+            const int bottom = divideFloor(rc.bottom(), patchSize.height()) - firstPatchRow;
+
+            for (int i = top; i <= bottom; i++) {
+                for (int j = left; j <= right; j++) {
+                    patches[j + i * numPatchCols].cells.append(QPoint(col, row));
+                }
             }
         }
     }
+
+    QVector<GridPatch> result;
+
+    for (int i = 0; i < numPatchRows; i++) {
+        for (int j = 0; j < numPatchCols; j++) {
+            GridPatch &patch = patches[j + i * numPatchCols];
+            if (patch.cells.isEmpty()) continue;
+
+            patch.rect = QRect((firstPatchCol + j) * patchSize.width(),
+                               (firstPatchRow + i) * patchSize.height(),
+                               patchSize.width(), patchSize.height()) & totalBounds;
+            result.append(patch);
+        }
+    }
+
+    return result;
+}
+
+template <class CellsOp, class PolygonOp>
+void processGridPatch(CellsOp &cellsOp, PolygonOp &polygonOp, const GridPatch &patch)
+{
+    polygonOp.setClipRect(patch.rect);
+
+    Q_FOREACH (const QPoint &cell, patch.cells) {
+        cellsOp.processCell(cell.x(), cell.y(), polygonOp);
+    }
+}
+
+/**
+ * Appends one concurrent job per patch to \p jobs. Both the ops are
+ * copied into every job, so they should not refer to any external
+ * objects, which may be deleted before the jobs are executed.
+ */
+template <class CellsOp, class PolygonOp, class Job>
+void addGridPatchJobs(QVector<Job*> &jobs,
+                      const CellsOp &cellsOp,
+                      const PolygonOp &polygonOp,
+                      const QVector<GridPatch> &patches)
+{
+    Q_FOREACH (const GridPatch &patch, patches) {
+        KritaUtils::addJobConcurrent(jobs, [cellsOp, polygonOp, patch] () mutable {
+            processGridPatch(cellsOp, polygonOp, patch);
+        });
+    }
 }
 
 }
@@ -174,6 +174,28 @@ void KisImageConfig::setSwapWindowSize(int value)
     m_config.writeEntry("swapWindowSize", value);
 }
 
+bool KisImageConfig::compressUndoHistory(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("compressUndoHistory", true) : true;
+}
+
+void KisImageConfig::setCompressUndoHistory(bool value)
+{
+    m_config.writeEntry("compressUndoHistory", value);
+}
+
+int KisImageConfig::undoHistorySwapDepth(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("undoHistorySwapDepth", 0) : 0;
+}
+
+void KisImageConfig::setUndoHistorySwapDepth(int value)
+{
+    m_config.writeEntry("undoHistorySwapDepth", value);
+}
+
 int KisImageConfig::tilesHardLimit() const
 {
     qreal hp = qreal(memoryHardLimitPercent()) / 100.0;
@@ -537,6 +559,50 @@ void KisImageConfig::setUseLodForColorizeMask(bool value)
     m_config.writeEntry("useLodForColorizeMask", value);
 }
 
+bool KisImageConfig::useIncrementalLodSync(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("useIncrementalLodSync", true) : true;
+}
+
+void KisImageConfig::setUseIncrementalLodSync(bool value)
+{
+    m_config.writeEntry("useIncrementalLodSync", value);
+}
+
+bool KisImageConfig::useVirtualGeneratorLayers(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("useVirtualGeneratorLayers", false) : false;
+}
+
+void KisImageConfig::setUseVirtualGeneratorLayers(bool value)
+{
+    m_config.writeEntry("useVirtualGeneratorLayers", value);
+}
+
+int KisImageConfig::virtualGeneratorLayerCacheSize(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("virtualGeneratorLayerCacheSize", 8) : 8;
+}
+
+void KisImageConfig::setVirtualGeneratorLayerCacheSize(int value)
+{
+    m_config.writeEntry("virtualGeneratorLayerCacheSize", value);
+}
+
+bool KisImageConfig::useBakedColorAdjustments(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("useBakedColorAdjustments", false) : false;
+}
+
+void KisImageConfig::setUseBakedColorAdjustments(bool value)
+{
+    m_config.writeEntry("useBakedColorAdjustments", value);
+}
+
 int KisImageConfig::maxNumberOfThreads(bool defaultValue) const
 {
     return (defaultValue ? QThread::idealThreadCount() : m_config.readEntry("maxNumberOfThreads", QThread::idealThreadCount()));
@@ -58,6 +58,12 @@ public:
     int swapWindowSize() const;
     void setSwapWindowSize(int value);
 
+    bool compressUndoHistory(bool requestDefault = false) const;
+    void setCompressUndoHistory(bool value);
+
+    int undoHistorySwapDepth(bool requestDefault = false) const; // in undo steps, 0 means "never"
+    void setUndoHistorySwapDepth(int value);
+
     int tilesHardLimit() const; // MiB
     int tilesSoftLimit() const; // MiB
     int poolLimit() const; // MiB
@@ -114,6 +120,18 @@ public:
     bool useLodForColorizeMask(bool requestDefault = false) const;
     void setUseLodForColorizeMask(bool value);
 
+    bool useIncrementalLodSync(bool requestDefault = false) const;
+    void setUseIncrementalLodSync(bool value);
+
+    bool useVirtualGeneratorLayers(bool requestDefault = false) const;
+    void setUseVirtualGeneratorLayers(bool value);
+
+    int virtualGeneratorLayerCacheSize(bool requestDefault = false) const; // MiB
+    void setVirtualGeneratorLayerCacheSize(int value);
+
+    bool useBakedColorAdjustments(bool requestDefault = false) const;
+    void setUseBakedColorAdjustments(bool value);
+
     int maxNumberOfThreads(bool defaultValue = false) const;
     void setMaxNumberOfThreads(int value);
 
@@ -21,6 +21,7 @@
 #include "kis_grid_interpolation_tools.h"
 #include "kis_dom_utils.h"
 #include "krita_utils.h"
+#include "KisFakeRunnableStrokeJobsExecutor.h"
 
 
 struct Q_DECL_HIDDEN KisLiquifyTransformWorker::Private
@@ -34,6 +35,17 @@ struct Q_DECL_HIDDEN KisLiquifyTransformWorker::Private
     {
     }
 
+    Private(const Private &rhs)
+        : srcBounds(rhs.srcBounds),
+          originalPoints(rhs.originalPoints),
+          transformedPoints(rhs.transformedPoints),
+          progress(rhs.progress),
+          pixelPrecision(rhs.pixelPrecision),
+          gridSize(rhs.gridSize)
+    {
+        // the copy has never been rendered, so it cannot be updated incrementally
+    }
+
     const QRect srcBounds;
 
     QVector<QPointF> originalPoints;
@@ -43,8 +55,29 @@ struct Q_DECL_HIDDEN KisLiquifyTransformWorker::Private
     int pixelPrecision;
     QSize gridSize;
 
+    /**
+     * The grid nodes changed since the last call to runOnQImage() or
+     * updateQImage() and the bounds of their positions before the change.
+     * When changesAreTracked is false, the points have been changed in
+     * some untracked way and the preview should be regenerated from scratch.
+     */
+    bool changesAreTracked = false;
+    QRect changedNodes;
+    QRectF changedNodesOldBounds;
+
     void preparePoints();
 
+    inline void addChangedNode(int index, const QPointF &oldPos) {
+        changedNodes |= QRect(index % gridSize.width(), index / gridSize.width(), 1, 1);
+        changedNodesOldBounds |= QRectF(oldPos, QSizeF(1.0, 1.0));
+    }
+
+    inline void resetChangedNodes() {
+        changesAreTracked = true;
+        changedNodes = QRect();
+        changedNodesOldBounds = QRectF();
+    }
+
     struct MapIndexesOp;
 
     template <class ProcessOp>
@@ -129,6 +162,7 @@ const QVector<QPointF>& KisLiquifyTransformWorker::originalPoints() const
 
 QVector<QPointF>& KisLiquifyTransformWorker::transformedPoints()
 {
+    m_d->changesAreTracked = false;
     return m_d->transformedPoints;
 }
 
@@ -174,6 +208,8 @@ void KisLiquifyTransformWorker::Private::preparePoints()
 
 void KisLiquifyTransformWorker::translate(const QPointF &offset)
 {
+    m_d->changesAreTracked = false;
+
     QVector<QPointF>::iterator it = m_d->transformedPoints.begin();
     QVector<QPointF>::iterator end = m_d->transformedPoints.end();
 
@@ -212,6 +248,8 @@ void KisLiquifyTransformWorker::undoPoints(const QPointF &base,
 
         qreal lambda = exp(-0.5 * pow2(dist / sigma));
         lambda *= amount;
+
+        m_d->addChangedNode(it - m_d->transformedPoints.begin(), *it);
         *it = *refIt * lambda + *it * (1.0 - lambda);
     }
 }
@@ -237,6 +275,8 @@ processTransformedPixelsBuildUp(ProcessOp op,
         if (dist > maxDist) continue;
 
         const qreal lambda = exp(-0.5 * pow2(dist / sigma));
+
+        addChangedNode(it - transformedPoints.begin(), *it);
         *it = op(*it, base, diff, lambda);
     }
 }
@@ -270,6 +310,7 @@ processTransformedPixelsWash(ProcessOp op,
         QPointF dstPt = op(*refIt, base, diff, lambda);
 
         if (kisDistance(dstPt, *refIt) > kisDistance(*it, *refIt)) {
+            addChangedNode(it - transformedPoints.begin(), *it);
             *it = (1.0 - flow) * (*it) + flow * dstPt;
         }
     }
@@ -393,7 +434,7 @@ void KisLiquifyTransformWorker::rotatePoints(const QPointF &base,
 struct KisLiquifyTransformWorker::Private::MapIndexesOp {
 
     MapIndexesOp(KisLiquifyTransformWorker::Private *d)
-        : m_d(d)
+        : m_gridSize(d->gridSize)
     {
     }
 
@@ -402,7 +443,7 @@ struct KisLiquifyTransformWorker::Private::MapIndexesOp {
 
         *numExistingPoints = 4;
         QVector<int> cellIndexes =
-            GridIterationTools::calculateCellIndexes(col, row, m_d->gridSize);
+            GridIterationTools::calculateCellIndexes(col, row, m_gridSize);
 
         return cellIndexes;
     }
@@ -426,23 +467,39 @@ struct KisLiquifyTransformWorker::Private::MapIndexesOp {
         return QPolygonF();
     }
 
-    KisLiquifyTransformWorker::Private *m_d;
+    QSize m_gridSize;
 };
 
 
 void KisLiquifyTransformWorker::run(KisPaintDeviceSP device)
+{
+    QVector<KisRunnableStrokeJobDataBase*> jobs;
+    createRunJobs(device, jobs);
+
+    KisFakeRunnableStrokeJobsExecutor executor;
+    executor.addRunnableJobs(jobs);
+}
+
+void KisLiquifyTransformWorker::createRunJobs(KisPaintDeviceSP device,
+                                              QVector<KisRunnableStrokeJobDataBase*> &jobs)
 {
     KisPaintDeviceSP srcDev = new KisPaintDevice(*device.data());
     device->clear();
 
     using namespace GridIterationTools;
 
+    typedef GridCellsOp<AlwaysCompletePolygonPolicy, Private::MapIndexesOp> CellsOp;
+
+    CellsOp cellsOp(Private::MapIndexesOp(m_d.data()),
+                    m_d->gridSize,
+                    m_d->originalPoints,
+                    m_d->transformedPoints);
+
+    const QVector<GridPatch> patches =
+        splitGridIntoPatches(cellsOp, KritaUtils::optimalPatchSize());
+
     PaintDevicePolygonOp polygonOp(srcDev, device);
-    Private::MapIndexesOp indexesOp(m_d.data());
-    iterateThroughGrid<AlwaysCompletePolygonPolicy>(polygonOp, indexesOp,
-                                                    m_d->gridSize,
-                                                    m_d->originalPoints,
-                                                    m_d->transformedPoints);
+    addGridPatchJobs(jobs, cellsOp, polygonOp, patches);
 }
 
 QRect KisLiquifyTransformWorker::approxChangeRect(const QRect &rc)
@@ -536,9 +593,121 @@ QImage KisLiquifyTransformWorker::runOnQImage(const QImage &srcImage,
                                                           m_d->gridSize,
                                                           originalPointsLocal,
                                                           transformedPointsLocal);
+
+    m_d->resetChangedNodes();
+
     return dstImage;
 }
 
+bool KisLiquifyTransformWorker::updateQImage(const QImage &srcImage,
+                                             const QPointF &srcImageOffset,
+                                             const QTransform &imageToThumbTransform,
+                                             QImage *dstImage,
+                                             const QPointF &dstImageOffset)
+{
+    KIS_ASSERT_RECOVER(m_d->originalPoints.size() == m_d->transformedPoints.size()) {
+        return false;
+    }
+
+    if (!m_d->changesAreTracked ||
+        srcImage.isNull() ||
+        dstImage->isNull() ||
+        dstImage->format() != srcImage.format()) {
+
+        return false;
+    }
+
+    if (m_d->changedNodes.isEmpty()) return true;
+
+    /**
+     * The area to regenerate consists of the old and the new positions
+     * of all the cells touching the changed nodes. The old positions of
+     * the unchanged nodes are the same as the new ones.
+     */
+    const QRect changedCells =
+        m_d->changedNodes.adjusted(-1, -1, 1, 1) &
+        QRect(QPoint(), m_d->gridSize);
+
+    QRectF dirtyRect = m_d->changedNodesOldBounds;
+
+    for (int row = changedCells.top(); row <= changedCells.bottom(); row++) {
+        for (int col = changedCells.left(); col <= changedCells.right(); col++) {
+            const int index = GridIterationTools::pointToIndex(QPoint(col, row), m_d->gridSize);
+            dirtyRect |= QRectF(m_d->transformedPoints[index], QSizeF(1.0, 1.0));
+        }
+    }
+
+    QVector<QPointF> originalPointsLocal(m_d->originalPoints.size());
+    QVector<QPointF> transformedPointsLocal(m_d->transformedPoints.size());
+
+    QRectF dstBounds;
+
+    for (int i = 0; i < originalPointsLocal.size(); i++) {
+        originalPointsLocal[i] = imageToThumbTransform.map(m_d->originalPoints[i]);
+        transformedPointsLocal[i] = imageToThumbTransform.map(m_d->transformedPoints[i]);
+        KisAlgebra2D::accumulateBounds(transformedPointsLocal[i], &dstBounds);
+    }
+
+    const QRectF srcBounds(srcImageOffset, srcImage.size());
+    dstBounds |= srcBounds;
+
+    const qreal eps = 1e-6;
+
+    if (dstBounds.toAlignedRect().size() != dstImage->size() ||
+        !KisAlgebra2D::fuzzyPointCompare(dstBounds.topLeft(), dstImageOffset, eps)) {
+
+        return false;
+    }
+
+    const QRect clipRect =
+        imageToThumbTransform.mapRect(dirtyRect).toAlignedRect().adjusted(-1, -1, 1, 1);
+
+    // clear exactly the pixels QImagePolygonOp is going to write into
+    const QRect dstImageRect = dstImage->rect();
+    for (int y = clipRect.top(); y <= clipRect.bottom(); y++) {
+        for (int x = clipRect.left(); x <= clipRect.right(); x++) {
+            const QPoint pt = (QPointF(x, y) - dstImageOffset).toPoint();
+            if (dstImageRect.contains(pt)) {
+                dstImage->setPixel(pt, 0);
+            }
+        }
+    }
+
+    using namespace GridIterationTools;
+
+    QImagePolygonOp polygonOp(srcImage, *dstImage, srcImageOffset, dstImageOffset);
+    polygonOp.setClipRect(clipRect);
+
+    Private::MapIndexesOp indexesOp(m_d.data());
+
+    const int numCols = m_d->gridSize.width() - 1;
+    const int numRows = m_d->gridSize.height() - 1;
+
+    for (int row = 0; row < numRows; row++) {
+        for (int col = 0; col < numCols; col++) {
+            const int tl = col + row * m_d->gridSize.width();
+            const int bl = tl + m_d->gridSize.width();
+
+            const QRect cellBounds =
+                cellPointsBounds(transformedPointsLocal[tl],
+                                 transformedPointsLocal[tl + 1],
+                                 transformedPointsLocal[bl + 1],
+                                 transformedPointsLocal[bl]);
+
+            if (!cellBounds.intersects(clipRect)) continue;
+
+            processGridCell<AlwaysCompletePolygonPolicy>(col, row,
+                                                         polygonOp, indexesOp,
+                                                         originalPointsLocal,
+                                                         transformedPointsLocal);
+        }
+    }
+
+    m_d->resetChangedNodes();
+
+    return true;
+}
+
 void KisLiquifyTransformWorker::toXML(QDomElement *e) const
 {
     QDomDocument doc = e->ownerDocument();
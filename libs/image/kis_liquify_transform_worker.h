@@ -30,6 +30,7 @@ class QRect;
 class QSize;
 class QTransform;
 class QDomElement;
+class KisRunnableStrokeJobDataBase;
 
 
 class KRITAIMAGE_EXPORT KisLiquifyTransformWorker : boost::equality_comparable<KisLiquifyTransformWorker>
@@ -76,11 +77,39 @@ public:
     QVector<QPointF>& transformedPoints();
 
     void run(KisPaintDeviceSP device);
+
+    /**
+     * Clears \p device and appends to \p jobs the concurrent jobs that
+     * write the transformed pixels into it, one job per tile-aligned
+     * patch of the device. The result is the same as the one of run().
+     * The jobs do not refer to the worker, so it can be deleted before
+     * the jobs are executed.
+     */
+    void createRunJobs(KisPaintDeviceSP device,
+                       QVector<KisRunnableStrokeJobDataBase*> &jobs);
+
     QImage runOnQImage(const QImage &srcImage,
                        const QPointF &srcImageOffset,
                        const QTransform &imageToThumbTransform,
                        QPointF *newOffset);
 
+    /**
+     * Updates \p dstImage, generated by runOnQImage() from the same
+     * source image and with the same transform, after the points have
+     * been changed by translatePoints(), scalePoints(), rotatePoints() or
+     * undoPoints(). Only the cells touched since the last update are
+     * rendered again.
+     *
+     * \return false if the image cannot be updated incrementally, e.g.
+     *         when the bounds of the transformed grid have changed. In
+     *         such a case runOnQImage() should be called instead.
+     */
+    bool updateQImage(const QImage &srcImage,
+                      const QPointF &srcImageOffset,
+                      const QTransform &imageToThumbTransform,
+                      QImage *dstImage,
+                      const QPointF &dstImageOffset);
+
     void toXML(QDomElement *e) const;
     static KisLiquifyTransformWorker* fromXML(const QDomElement &e);
 
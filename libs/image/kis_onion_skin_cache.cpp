@@ -21,9 +21,13 @@
 #include <QReadWriteLock>
 #include <QReadLocker>
 #include <QWriteLocker>
+#include <QHash>
 
 
 #include "kis_paint_device.h"
+#include "kis_paint_device_frames_interface.h"
+#include "kis_painter.h"
+#include "kis_datamanager.h"
 #include "kis_onion_skin_compositor.h"
 #include "kis_default_bounds.h"
 #include "kis_image.h"
@@ -34,7 +38,24 @@
 
 struct KisOnionSkinCache::Private
 {
+    /**
+     * A tinted copy of a frame shown as a skin together with a
+     * copy-on-write snapshot of the frame data it was made from.
+     * Comparing the frame with the snapshot tells which tiles should
+     * be re-tinted when the frame changes.
+     */
+    struct TintedFrame {
+        KisPaintDeviceSP device;
+        KisDataManagerSP sourceSnapshot;
+        QPoint sourceOffset;
+        int tintSeqNo = -1;
+    };
+
+    // (frameId, isBackward)
+    typedef QPair<int, bool> TintedFrameKey;
+
     KisPaintDeviceSP cachedProjection;
+    QHash<TintedFrameKey, TintedFrame> tintedFrames;
 
     int cacheTime = 0;
     int cacheConfigSeqNo = 0;
@@ -62,8 +83,63 @@ struct KisOnionSkinCache::Private
         cacheConfigSeqNo = seqNo;
         framesHash = hash;
     }
+
+    TintedFrame fetchTintedFrame(KisPaintDeviceSP source,
+                                 const KisOnionSkinCompositor::Skin &skin,
+                                 KisOnionSkinCompositor *compositor);
 };
 
+KisOnionSkinCache::Private::TintedFrame
+KisOnionSkinCache::Private::fetchTintedFrame(KisPaintDeviceSP source,
+                                             const KisOnionSkinCompositor::Skin &skin,
+                                             KisOnionSkinCompositor *compositor)
+{
+    KisPaintDeviceFramesInterface *frames = source->framesInterface();
+
+    const int frameId = skin.keyframe->frameID();
+    const QPoint offset = frames->frameOffset(frameId);
+    const int tintSeqNo = compositor->tintSeqNo();
+
+    /**
+     * The snapshot is taken before the frame is read, so the changes
+     * made in the meantime will be caught on the next request.
+     */
+    KisDataManagerSP dataManager = frames->frameDataManager(frameId);
+
+    TintedFrame frame = tintedFrames.value(TintedFrameKey(frameId, skin.isBackward));
+    QVector<QRect> changedTiles;
+
+    if (frame.device &&
+        frame.tintSeqNo == tintSeqNo &&
+        frame.sourceOffset == offset &&
+        *frame.device->colorSpace() == *source->colorSpace() &&
+        dataManager->collectChangedTiles(frame.sourceSnapshot.data(), &changedTiles)) {
+
+        if (!changedTiles.isEmpty()) {
+            frame.sourceSnapshot = new KisDataManager(*dataManager);
+
+            KisPaintDeviceSP frameDevice = new KisPaintDevice(source->colorSpace());
+            skin.keyframe->writeFrameToDevice(frameDevice);
+
+            Q_FOREACH (const QRect &tileRect, changedTiles) {
+                const QRect rc = tileRect.translated(offset);
+                KisPainter::copyAreaOptimized(rc.topLeft(), frameDevice, frame.device, rc);
+                compositor->tintFrame(frame.device, skin.isBackward, rc);
+            }
+        }
+    } else {
+        frame.sourceSnapshot = new KisDataManager(*dataManager);
+        frame.sourceOffset = offset;
+        frame.tintSeqNo = tintSeqNo;
+
+        frame.device = new KisPaintDevice(source->colorSpace());
+        skin.keyframe->writeFrameToDevice(frame.device);
+        compositor->tintFrame(frame.device, skin.isBackward, frame.device->extent());
+    }
+
+    return frame;
+}
+
 KisOnionSkinCache::KisOnionSkinCache()
     : m_d(new Private)
 {
@@ -103,7 +179,27 @@ KisPaintDeviceSP KisOnionSkinCache::projection(KisPaintDeviceSP source)
             }
 
             const QRect extent = compositor->calculateExtent(source);
-            compositor->composite(source, cachedProjection, extent);
+            const QVector<KisOnionSkinCompositor::Skin> skins = compositor->collectSkins(source);
+
+            QHash<Private::TintedFrameKey, Private::TintedFrame> usedFrames;
+            QVector<KisPaintDeviceSP> tintedDevices;
+            QVector<int> opacities;
+
+            Q_FOREACH (const KisOnionSkinCompositor::Skin &skin, skins) {
+                const Private::TintedFrameKey key(skin.keyframe->frameID(), skin.isBackward);
+
+                if (!usedFrames.contains(key)) {
+                    usedFrames.insert(key, m_d->fetchTintedFrame(source, skin, compositor));
+                }
+
+                tintedDevices << usedFrames[key].device;
+                opacities << skin.opacity;
+            }
+
+            // the frames that are not visible anymore are dropped
+            m_d->tintedFrames = usedFrames;
+
+            compositor->blendSkins(tintedDevices, opacities, cachedProjection, extent);
 
             cachedProjection->setDefaultBounds(source->defaultBounds());
 
@@ -128,6 +224,13 @@ KisPaintDeviceSP KisOnionSkinCache::projection(KisPaintDeviceSP source)
 }
 
 void KisOnionSkinCache::reset()
+{
+    QWriteLocker writeLocker(&m_d->lock);
+    m_d->cachedProjection = 0;
+    m_d->tintedFrames.clear();
+}
+
+void KisOnionSkinCache::invalidate()
 {
     QWriteLocker writeLocker(&m_d->lock);
     m_d->cachedProjection = 0;
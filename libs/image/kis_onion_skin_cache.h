@@ -21,17 +21,29 @@
 
 #include <QScopedPointer>
 #include "kis_types.h"
+#include "kritaimage_export.h"
 
 
-class KisOnionSkinCache
+class KRITAIMAGE_EXPORT KisOnionSkinCache
 {
 public:
     KisOnionSkinCache();
     ~KisOnionSkinCache();
 
     KisPaintDeviceSP projection(KisPaintDeviceSP source);
+
+    /**
+     * Drops the cached projection together with the tinted frames
+     */
     void reset();
 
+    /**
+     * Forces the projection to be regenerated on the next request. The
+     * tinted frames are kept, since they are checked against the content
+     * of the frames anyway and only the changed tiles are re-tinted.
+     */
+    void invalidate();
+
     KisPaintDeviceSP lodCapableDevice() const;
 
 private:
@@ -22,9 +22,11 @@
 #include "kis_painter.h"
 #include "KoColor.h"
 #include "KoColorSpace.h"
+#include "KoCompositeOp.h"
 #include "KoCompositeOpRegistry.h"
 #include "KoColorSpaceConstants.h"
 
+#include "kis_assert.h"
 #include "kis_image_config.h"
 #include "kis_raster_keyframe_channel.h"
 
@@ -39,6 +41,7 @@ struct KisOnionSkinCompositor::Private
     QVector<int> backwardOpacities;
     QVector<int> forwardOpacities;
     int configSeqNo = 0;
+    int tintSeqNo = 0;
     QList<int> colorLabelFilter;
 
     int skinOpacity(int offset)
@@ -73,26 +76,25 @@ struct KisOnionSkinCompositor::Private
         return channel->keyframeAt<KisRasterKeyframe>(outFrame);
     }
 
-    void tryCompositeFrame(KisRasterKeyframeSP keyframe, KisPainter &gcFrame, KisPainter &gcDest, KisPaintDeviceSP tintSource, int opacity, const QRect &rect)
-    {
-        if (keyframe.isNull() || opacity == OPACITY_TRANSPARENT_U8) return;
-
-        keyframe->writeFrameToDevice(gcFrame.device());
-
-        gcFrame.bitBlt(rect.topLeft(), tintSource, rect);
-
-        gcDest.setOpacity(opacity);
-        gcDest.bitBlt(rect.topLeft(), gcFrame.device(), rect);
-    }
-
     void refreshConfig()
     {
         KisImageConfig config(true);
 
         numberOfSkins = config.numberOfOnionSkins();
-        tintFactor = config.onionSkinTintFactor();
-        backwardTintColor = config.onionSkinTintColorBackward();
-        forwardTintColor = config.onionSkinTintColorForward();
+
+        const int newTintFactor = config.onionSkinTintFactor();
+        const QColor newBackwardTintColor = config.onionSkinTintColorBackward();
+        const QColor newForwardTintColor = config.onionSkinTintColorForward();
+
+        if (newTintFactor != tintFactor ||
+            newBackwardTintColor != backwardTintColor ||
+            newForwardTintColor != forwardTintColor) {
+
+            tintFactor = newTintFactor;
+            backwardTintColor = newBackwardTintColor;
+            forwardTintColor = newForwardTintColor;
+            tintSeqNo++;
+        }
 
         backwardOpacities.resize(numberOfSkins);
         forwardOpacities.resize(numberOfSkins);
@@ -131,6 +133,11 @@ int KisOnionSkinCompositor::configSeqNo() const
     return m_d->configSeqNo;
 }
 
+int KisOnionSkinCompositor::tintSeqNo() const
+{
+    return m_d->tintSeqNo;
+}
+
 void KisOnionSkinCompositor::setColorLabelFilter(QList<int> colors)
 {
     m_d->colorLabelFilter = colors;
@@ -138,44 +145,157 @@ void KisOnionSkinCompositor::setColorLabelFilter(QList<int> colors)
 
 void KisOnionSkinCompositor::composite(const KisPaintDeviceSP sourceDevice, KisPaintDeviceSP targetDevice, const QRect& rect)
 {
-    KisRasterKeyframeChannel *keyframes = sourceDevice->keyframeChannel();
+    const QVector<Skin> skins = collectSkins(sourceDevice);
 
-    KisPaintDeviceSP frameDevice = new KisPaintDevice(sourceDevice->colorSpace());
-    KisPainter gcFrame(frameDevice);
-    QBitArray channelFlags = targetDevice->colorSpace()->channelFlags(true, false);
-    gcFrame.setChannelFlags(channelFlags);
-    gcFrame.setOpacity(m_d->tintFactor);
+    QVector<KisPaintDeviceSP> tintedFrames;
+    QVector<int> opacities;
 
-    KisPaintDeviceSP backwardTintDevice = m_d->setUpTintDevice(m_d->backwardTintColor, sourceDevice->colorSpace());
-    KisPaintDeviceSP forwardTintDevice = m_d->setUpTintDevice(m_d->forwardTintColor, sourceDevice->colorSpace());
+    Q_FOREACH (const Skin &skin, skins) {
+        KisPaintDeviceSP frameDevice = new KisPaintDevice(sourceDevice->colorSpace());
+        skin.keyframe->writeFrameToDevice(frameDevice);
+        tintFrame(frameDevice, skin.isBackward, rect);
 
-    KisPainter gcDest(targetDevice);
-    gcDest.setCompositeOp(sourceDevice->colorSpace()->compositeOp(COMPOSITE_BEHIND));
+        tintedFrames << frameDevice;
+        opacities << skin.opacity;
+    }
 
-    int keyframeTimeBck;
-    int keyframeTimeFwd;
+    blendSkins(tintedFrames, opacities, targetDevice, rect);
+}
 
-    int time = sourceDevice->defaultBounds()->currentTime();
+QVector<KisOnionSkinCompositor::Skin> KisOnionSkinCompositor::collectSkins(const KisPaintDeviceSP sourceDevice)
+{
+    QVector<Skin> skins;
+
+    KisRasterKeyframeChannel *keyframes = sourceDevice->keyframeChannel();
 
     if (!keyframes) { // it happens when you try to show onion skins on non-animated layer with opacity keyframes
-        return;
+        return skins;
     }
 
+    int keyframeTimeBck;
+    int keyframeTimeFwd;
+
+    int time = sourceDevice->defaultBounds()->currentTime();
+
     keyframeTimeBck = keyframeTimeFwd = keyframes->activeKeyframeTime(time);
 
     for (int offset = 1; offset <= m_d->numberOfSkins; offset++) {
         KisRasterKeyframeSP backKeyframe = m_d->getNextFrameToComposite(keyframes, keyframeTimeBck, true);
         KisRasterKeyframeSP forwardKeyframe = m_d->getNextFrameToComposite(keyframes, keyframeTimeFwd, false);
 
-        if (!backKeyframe.isNull()) {
-            m_d->tryCompositeFrame(backKeyframe, gcFrame, gcDest, backwardTintDevice, m_d->skinOpacity(-offset), rect);
+        const int backOpacity = m_d->skinOpacity(-offset);
+        const int forwardOpacity = m_d->skinOpacity(offset);
+
+        if (!backKeyframe.isNull() && backOpacity != OPACITY_TRANSPARENT_U8) {
+            Skin skin;
+            skin.keyframe = backKeyframe;
+            skin.isBackward = true;
+            skin.opacity = backOpacity;
+            skins << skin;
         }
 
-        if (!forwardKeyframe.isNull()) {
-            m_d->tryCompositeFrame(forwardKeyframe, gcFrame, gcDest, forwardTintDevice, m_d->skinOpacity(offset), rect);
+        if (!forwardKeyframe.isNull() && forwardOpacity != OPACITY_TRANSPARENT_U8) {
+            Skin skin;
+            skin.keyframe = forwardKeyframe;
+            skin.isBackward = false;
+            skin.opacity = forwardOpacity;
+            skins << skin;
         }
     }
 
+    return skins;
+}
+
+void KisOnionSkinCompositor::tintFrame(KisPaintDeviceSP frameDevice, bool isBackward, const QRect &rect)
+{
+    if (m_d->tintFactor == OPACITY_TRANSPARENT_U8 || rect.isEmpty()) return;
+
+    const KoColorSpace *colorSpace = frameDevice->colorSpace();
+    const QColor &tintColor = isBackward ? m_d->backwardTintColor : m_d->forwardTintColor;
+    KisPaintDeviceSP tintDevice = m_d->setUpTintDevice(tintColor, colorSpace);
+
+    KisPainter gcFrame(frameDevice);
+    gcFrame.setChannelFlags(colorSpace->channelFlags(true, false));
+    gcFrame.setOpacity(m_d->tintFactor);
+    gcFrame.bitBlt(rect.topLeft(), tintDevice, rect);
+}
+
+void KisOnionSkinCompositor::blendSkins(const QVector<KisPaintDeviceSP> &skins, const QVector<int> &opacities,
+                                        KisPaintDeviceSP targetDevice, const QRect &rect)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(skins.size() == opacities.size());
+    if (skins.isEmpty() || rect.isEmpty()) return;
+
+    const KoColorSpace *colorSpace = targetDevice->colorSpace();
+
+    bool sameColorSpace = true;
+    Q_FOREACH (KisPaintDeviceSP skin, skins) {
+        sameColorSpace &= *skin->colorSpace() == *colorSpace;
+    }
+
+    if (!sameColorSpace) {
+        KisPainter gcDest(targetDevice);
+        gcDest.setCompositeOp(colorSpace->compositeOp(COMPOSITE_BEHIND));
+
+        for (int i = 0; i < skins.size(); i++) {
+            gcDest.setOpacity(opacities[i]);
+            gcDest.bitBlt(rect.topLeft(), skins[i], rect);
+        }
+        return;
+    }
+
+    /**
+     * All the skins are blended into a buffer that is read from and
+     * written back to the target only once per strip of the rect. The
+     * skins are applied in the same order as if they were bitBlt'ed one
+     * after another, so the result is the same.
+     */
+    QVector<QRect> skinRects;
+    Q_FOREACH (KisPaintDeviceSP skin, skins) {
+        const bool hasTransparentDefault =
+            skin->defaultPixel().opacityU8() == OPACITY_TRANSPARENT_U8;
+
+        skinRects << (hasTransparentDefault ? skin->extent() & rect : rect);
+    }
+
+    const KoCompositeOp *op = colorSpace->compositeOp(COMPOSITE_BEHIND);
+    const int pixelSize = colorSpace->pixelSize();
+    const int stripHeight = 64;
+
+    QVector<quint8> dstBuffer;
+    QVector<quint8> srcBuffer;
+
+    for (int y = rect.y(); y <= rect.bottom(); y += stripHeight) {
+        const QRect strip(rect.x(), y, rect.width(), qMin(stripHeight, rect.bottom() - y + 1));
+
+        QRect blendRect;
+        Q_FOREACH (const QRect &rc, skinRects) {
+            blendRect |= rc & strip;
+        }
+
+        if (blendRect.isEmpty()) continue;
+
+        const int rowStride = blendRect.width() * pixelSize;
+        const int bufferSize = rowStride * blendRect.height();
+
+        dstBuffer.resize(bufferSize);
+        srcBuffer.resize(bufferSize);
+
+        targetDevice->readBytes(dstBuffer.data(), blendRect);
+
+        for (int i = 0; i < skins.size(); i++) {
+            if (!skinRects[i].intersects(blendRect)) continue;
+
+            skins[i]->readBytes(srcBuffer.data(), blendRect);
+            op->composite(dstBuffer.data(), rowStride,
+                          srcBuffer.data(), rowStride,
+                          0, 0,
+                          blendRect.height(), blendRect.width(),
+                          opacities[i]);
+        }
+
+        targetDevice->writeBytes(dstBuffer.data(), blendRect);
+    }
 }
 
 QRect KisOnionSkinCompositor::calculateFullExtent(const KisPaintDeviceSP device)
@@ -19,6 +19,8 @@
 #ifndef KIS_ONION_SKIN_COMPOSITOR_H
 #define KIS_ONION_SKIN_COMPOSITOR_H
 
+#include <QVector>
+
 #include "kis_types.h"
 #include "kritaimage_export.h"
 
@@ -31,12 +33,43 @@ public:
     ~KisOnionSkinCompositor() override;
     static KisOnionSkinCompositor *instance();
 
+    /**
+     * A keyframe of the source device that should be shown as an onion
+     * skin at the current time together with its tint and opacity.
+     */
+    struct Skin {
+        KisRasterKeyframeSP keyframe;
+        bool isBackward = false;
+        int opacity = 0;
+    };
+
     void composite(const KisPaintDeviceSP sourceDevice, KisPaintDeviceSP targetDevice, const QRect &rect);
 
+    /**
+     * Returns the skins visible at the current time of \p sourceDevice
+     * in the order they should be blended behind the target
+     */
+    QVector<Skin> collectSkins(const KisPaintDeviceSP sourceDevice);
+
+    /**
+     * Tints the content of \p frameDevice inside \p rect with the tint of
+     * the backward or forward skins. The tint does not depend on the skin
+     * opacity, so the tinted frames can be reused until tintSeqNo() changes.
+     */
+    void tintFrame(KisPaintDeviceSP frameDevice, bool isBackward, const QRect &rect);
+
+    /**
+     * Blends the tinted \p skins behind the content of \p targetDevice
+     * in a single pass over \p rect
+     */
+    void blendSkins(const QVector<KisPaintDeviceSP> &skins, const QVector<int> &opacities,
+                    KisPaintDeviceSP targetDevice, const QRect &rect);
+
     QRect calculateFullExtent(const KisPaintDeviceSP device);
     QRect calculateExtent(const KisPaintDeviceSP device);
 
     int configSeqNo() const;
+    int tintSeqNo() const;
 
     void setColorLabelFilter(QList<int> colors);
 
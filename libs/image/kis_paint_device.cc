@@ -54,10 +54,12 @@
 #include "tiles3/kis_hline_iterator.h"
 #include "tiles3/kis_vline_iterator.h"
 #include "tiles3/kis_random_accessor.h"
+#include "tiles3/KisTileContentIndex.h"
 
 #include "kis_default_bounds.h"
 
 #include "kis_lod_transform.h"
+#include "kis_image_config.h"
 
 #include "kis_raster_keyframe_channel.h"
 
@@ -158,6 +160,7 @@ public:
     {
 
         m_lodData.reset();
+        m_lodSyncCache.reset();
         m_externalFrameData.reset();
 
         if (!m_frames.isEmpty()) {
@@ -229,6 +232,18 @@ public:
         return data->cache()->invalidate();
     }
 
+    int shareEqualFrameTiles()
+    {
+        KisTileContentIndex index;
+        int numSharedTiles = 0;
+
+        Q_FOREACH (DataSP data, m_frames) {
+            numSharedTiles += data->dataManager()->shareEqualTiles(&index);
+        }
+
+        return numSharedTiles;
+    }
+
 private:
     typedef KisPaintDeviceData Data;
     typedef QSharedPointer<Data> DataSP;
@@ -417,6 +432,7 @@ public:
     void uploadFrameData(DataSP srcData, DataSP dstData);
 
     struct LodDataStructImpl;
+    class LodDataSource;
     LodDataStruct* createLodDataStruct(int lod);
     void updateLodDataStruct(LodDataStruct *dst, const QRect &srcRect);
     void uploadLodDataStruct(LodDataStruct *dst);
@@ -452,6 +468,10 @@ public:
             lodData += estimateDataSize(m_lodData.data());
         }
 
+        if (m_lodSyncCache.lodData) {
+            lodData += estimateDataSize(m_lodSyncCache.lodData.data());
+        }
+
         if (m_externalFrameData) {
             temporaryData += estimateDataSize(m_externalFrameData.data());
         }
@@ -462,6 +482,50 @@ public:
     }
 
 
+    void setDataSource(KisTiledDataSourceSP source, int maxCachedTiles)
+    {
+        Data *data = currentNonLodData();
+
+        dataSourceCacheSize = maxCachedTiles;
+        data->dataManager()->setDataSource(source, maxCachedTiles);
+        data->cache()->invalidate();
+
+        /**
+         * The level of detail generated from the previous source
+         * is not valid anymore, it will be recreated on the next
+         * synchronization
+         */
+        if (m_lodData && m_lodData->dataManager()->dataSource()) {
+            m_lodData->dataManager()->clear();
+            m_lodData->cache()->invalidate();
+        }
+        m_lodSyncCache.reset();
+    }
+
+    KisTiledDataSourceSP dataSource() const
+    {
+        return currentNonLodData()->dataManager()->dataSource();
+    }
+
+    void invalidateDataSourceCache(const QRect &rc)
+    {
+        if (rc.isEmpty()) return;
+
+        Data *data = currentNonLodData();
+        data->dataManager()->invalidateDataSourceTiles(rc.translated(-data->x(), -data->y()));
+        data->cache()->invalidate();
+
+        if (m_lodData && m_lodData->dataManager()->dataSource()) {
+            const int lod = m_lodData->levelOfDetail();
+            const QRect lodRect =
+                KisLodTransform::scaledRect(KisLodTransform::alignedRect(rc, lod), lod);
+
+            m_lodData->dataManager()->invalidateDataSourceTiles(
+                lodRect.translated(-m_lodData->x(), -m_lodData->y()));
+            m_lodData->cache()->invalidate();
+        }
+    }
+
 private:
 
     inline DataSP currentFrameData() const
@@ -595,6 +659,33 @@ private:
     DataSP m_data;
     mutable QScopedPointer<Data> m_lodData;
     mutable QScopedPointer<Data> m_externalFrameData;
+
+    /**
+     * The result of the last LoD synchronization together with a
+     * copy-on-write snapshot of the source data it was generated
+     * from. The next synchronization compares the source tiles with
+     * the snapshot and downsamples only the tiles that changed in the
+     * meantime.
+     */
+    struct LodSyncCache {
+        QScopedPointer<Data> lodData;
+        KisDataManagerSP sourceSnapshot;
+
+        void reset() {
+            lodData.reset();
+            sourceSnapshot = 0;
+        }
+    };
+    LodSyncCache m_lodSyncCache;
+
+public:
+    /**
+     * The cache size passed to the last setDataSource() call, the
+     * levels of detail generated from the source use the same limit
+     */
+    int dataSourceCacheSize;
+
+private:
     mutable QMutex m_dataSwitchLock;
 
     FramesHash m_frames;
@@ -610,6 +701,7 @@ KisPaintDevice::Private::Private(KisPaintDevice *paintDevice)
       basicStrategy(new KisPaintDeviceStrategy(paintDevice, this)),
       isProjectionDevice(false),
       m_data(new Data(paintDevice)),
+      dataSourceCacheSize(-1),
       m_nextFreeFrameId(0)
 {
 }
@@ -674,13 +766,121 @@ struct KisPaintDevice::Private::StrategyPolicy {
 };
 
 struct KisPaintDevice::Private::LodDataStructImpl : public KisPaintDevice::LodDataStruct {
-    LodDataStructImpl(Data *_lodData) : lodData(_lodData) {}
+    LodDataStructImpl(Data *_lodData)
+        : lodData(_lodData),
+          isIncremental(false),
+          expectedArea(0),
+          processedArea(0)
+    {
+    }
+
     QScopedPointer<Data> lodData;
+
+    /**
+     * When the struct is based on the previous synchronization, only
+     * \p changedRects (in the coordinates of the source device) are
+     * downsampled.
+     */
+    bool isIncremental;
+    QVector<QRect> changedRects;
+
+    /**
+     * The source data at the moment the struct was created. It
+     * becomes the base for the next incremental synchronization,
+     * but only if all the area that needed syncing was actually
+     * processed, which is not the case when the source device has
+     * grown after the jobs for the sync have been generated.
+     */
+    KisDataManagerSP sourceSnapshot;
+    qint64 expectedArea;
+    qint64 processedArea;
+    QMutex processedAreaLock;
+
+    /**
+     * Set when the source device reads its pixels from a data source.
+     * The level of detail is not synchronized then, but is generated
+     * from the source on demand.
+     */
+    KisTiledDataSourceSP dataSource;
+};
+
+/**
+ * Produces a level of detail of a data source by downsampling the
+ * pixels of the original source on the fly
+ */
+class KisPaintDevice::Private::LodDataSource : public KisTiledDataSource
+{
+public:
+    LodDataSource(KisTiledDataSourceSP source, const KoColorSpace *colorSpace, int lod,
+                  const QPoint &srcOffset, const QPoint &lodOffset)
+        : m_source(source),
+          m_colorSpace(colorSpace),
+          m_lod(lod),
+          m_srcOffset(srcOffset),
+          m_lodOffset(lodOffset)
+    {
+    }
+
+    void readBytes(quint8 *data, const QRect &rect) override {
+        const int step = 1 << m_lod;
+        const int pixelSize = m_colorSpace->pixelSize();
+
+        const QRect srcRect(
+            (rect.x() + m_lodOffset.x()) * step - m_srcOffset.x(),
+            (rect.y() + m_lodOffset.y()) * step - m_srcOffset.y(),
+            rect.width() * step, rect.height() * step);
+
+        QScopedArrayPointer<quint8> srcData(new quint8[srcRect.width() * srcRect.height() * pixelSize]);
+        m_source->readBytes(srcData.data(), srcRect);
+
+        KoMixColorsOp *mixOp = m_colorSpace->mixColorsOp();
+        const int srcRowStride = srcRect.width() * pixelSize;
+        QVector<const quint8*> cell(step * step);
+
+        quint8 *dstPtr = data;
+        for (int y = 0; y < rect.height(); y++) {
+            for (int x = 0; x < rect.width(); x++) {
+                const quint8 *cellPtr = srcData.data() + (y * step) * srcRowStride + (x * step) * pixelSize;
+
+                for (int i = 0; i < step; i++) {
+                    for (int j = 0; j < step; j++) {
+                        cell[i * step + j] = cellPtr + i * srcRowStride + j * pixelSize;
+                    }
+                }
+
+                mixOp->mixColors(cell.constData(), cell.size(), dstPtr);
+                dstPtr += pixelSize;
+            }
+        }
+    }
+
+    QRect bounds() const override {
+        const QRect srcBounds = m_source->bounds();
+        if (srcBounds.isEmpty()) return QRect();
+
+        const QRect alignedBounds =
+            KisLodTransform::alignedRect(srcBounds.translated(m_srcOffset), m_lod);
+
+        return KisLodTransform::scaledRect(alignedBounds, m_lod).translated(-m_lodOffset);
+    }
+
+private:
+    KisTiledDataSourceSP m_source;
+    const KoColorSpace *m_colorSpace;
+    int m_lod;
+    QPoint m_srcOffset;
+    QPoint m_lodOffset;
 };
 
 KisRegion KisPaintDevice::Private::regionForLodSyncing() const
 {
     Data *srcData = currentNonLodData();
+
+    // the level of detail of a sourced device needs no syncing
+    if (srcData->dataManager()->dataSource()) {
+        return KisRegion();
+    }
+
     return srcData->dataManager()->region().translated(srcData->x(), srcData->y());
 }
 
@@ -690,12 +890,73 @@ KisPaintDevice::LodDataStruct* KisPaintDevice::Private::createLodDataStruct(int
 
     Data *srcData = currentNonLodData();
 
-    Data *lodData = new Data(q, srcData, false);
-    LodDataStruct *lodStruct = new LodDataStructImpl(lodData);
-
     int expectedX = KisLodTransform::coordToLodCoord(srcData->x(), newLod);
     int expectedY = KisLodTransform::coordToLodCoord(srcData->y(), newLod);
 
+    KisTiledDataSourceSP dataSource = srcData->dataManager()->dataSource();
+    if (dataSource) {
+        m_lodSyncCache.reset();
+
+        Data *lodData = new Data(q, srcData, false);
+        lodData->setLevelOfDetail(newLod);
+        lodData->setX(expectedX);
+        lodData->setY(expectedY);
+
+        LodDataStructImpl *lodStruct = new LodDataStructImpl(lodData);
+        lodStruct->dataSource = toQShared(
+            new LodDataSource(dataSource, srcData->colorSpace(), newLod,
+                              QPoint(srcData->x(), srcData->y()),
+                              QPoint(expectedX, expectedY)));
+
+        return lodStruct;
+    }
+
+    const bool useIncrementalSync = KisImageConfig(true).useIncrementalLodSync();
+    if (!useIncrementalSync) {
+        m_lodSyncCache.reset();
+    }
+
+    Data *cachedLodData = m_lodSyncCache.lodData.data();
+    QVector<QRect> changedTiles;
+
+    /**
+     * The cached plane can be reused only if it was generated for the
+     * same level of detail and offset, and the source data has changed
+     * only tile-wise since then.
+     */
+    if (cachedLodData &&
+        cachedLodData->levelOfDetail() == newLod &&
+        cachedLodData->colorSpace() == srcData->colorSpace() &&
+        cachedLodData->x() == expectedX &&
+        cachedLodData->y() == expectedY &&
+        srcData->dataManager()->collectChangedTiles(m_lodSyncCache.sourceSnapshot.data(), &changedTiles)) {
+
+        LodDataStructImpl *lodStruct = new LodDataStructImpl(new Data(q, cachedLodData, true));
+        lodStruct->isIncremental = true;
+        lodStruct->sourceSnapshot = new KisDataManager(*srcData->dataManager());
+
+        const QPoint srcOffset(srcData->x(), srcData->y());
+        Q_FOREACH (const QRect &rc, changedTiles) {
+            lodStruct->changedRects << rc.translated(srcOffset);
+            lodStruct->expectedArea += qint64(rc.width()) * rc.height();
+        }
+
+        lodStruct->lodData->cache()->invalidate();
+
+        return lodStruct;
+    }
+
+    Data *lodData = new Data(q, srcData, false);
+    LodDataStructImpl *lodStruct = new LodDataStructImpl(lodData);
+
+    if (useIncrementalSync) {
+        lodStruct->sourceSnapshot = new KisDataManager(*srcData->dataManager());
+
+        Q_FOREACH (const QRect &rc, lodStruct->sourceSnapshot->region().rects()) {
+            lodStruct->expectedArea += qint64(rc.width()) * rc.height();
+        }
+    }
+
     /**
      * We compare color spaces as pure pointers, because they must be
      * exactly the same, since they come from the common source.
@@ -826,11 +1087,31 @@ void KisPaintDevice::Private::updateLodDataStruct(LodDataStruct *_dst, const QRe
     Data *srcData = currentNonLodData();
 
     const int lod = lodData->levelOfDetail();
+    qint64 processedArea = 0;
 
-    updateLodDataManager(srcData->dataManager().data(), lodData->dataManager().data(),
-                         QPoint(srcData->x(), srcData->y()),
-                         QPoint(lodData->x(), lodData->y()),
-                         originalRect, lod);
+    if (dst->isIncremental) {
+        Q_FOREACH (const QRect &changedRect, dst->changedRects) {
+            const QRect rc = changedRect & originalRect;
+            if (rc.isEmpty()) continue;
+
+            updateLodDataManager(srcData->dataManager().data(), lodData->dataManager().data(),
+                                 QPoint(srcData->x(), srcData->y()),
+                                 QPoint(lodData->x(), lodData->y()),
+                                 rc, lod);
+
+            processedArea += qint64(rc.width()) * rc.height();
+        }
+    } else {
+        updateLodDataManager(srcData->dataManager().data(), lodData->dataManager().data(),
+                             QPoint(srcData->x(), srcData->y()),
+                             QPoint(lodData->x(), lodData->y()),
+                             originalRect, lod);
+
+        processedArea = qint64(originalRect.width()) * originalRect.height();
+    }
+
+    QMutexLocker l(&dst->processedAreaLock);
+    dst->processedArea += processedArea;
 }
 
 void KisPaintDevice::Private::generateLodCloneDevice(KisPaintDeviceSP dst, const QRect &originalRect, int lod)
@@ -855,7 +1136,22 @@ void KisPaintDevice::Private::uploadLodDataStruct(LodDataStruct *_dst)
     ensureLodDataPresent();
 
     m_lodData->prepareClone(dst->lodData.data());
+
+    if (dst->dataSource) {
+        m_lodData->dataManager()->setDataSource(dst->dataSource, dataSourceCacheSize);
+        m_lodData->cache()->invalidate();
+        m_lodSyncCache.reset();
+        return;
+    }
+
     m_lodData->dataManager()->bitBltRough(dst->lodData->dataManager(), dst->lodData->dataManager()->extent());
+
+    if (dst->sourceSnapshot && dst->processedArea == dst->expectedArea) {
+        m_lodSyncCache.lodData.reset(new Data(q, dst->lodData.data(), true));
+        m_lodSyncCache.sourceSnapshot = dst->sourceSnapshot;
+    } else {
+        m_lodSyncCache.reset();
+    }
 }
 
 void KisPaintDevice::Private::transferFromData(Data *data, KisPaintDeviceSP targetDevice)
@@ -1513,6 +1809,21 @@ void KisPaintDevice::purgeDefaultPixels()
     dm->purge(dm->extent());
 }
 
+void KisPaintDevice::setDataSource(KisTiledDataSourceSP source, int maxCachedTiles)
+{
+    m_d->setDataSource(source, maxCachedTiles);
+}
+
+KisTiledDataSourceSP KisPaintDevice::dataSource() const
+{
+    return m_d->dataSource();
+}
+
+void KisPaintDevice::invalidateDataSourceCache(const QRect &rc)
+{
+    m_d->invalidateDataSourceCache(rc);
+}
+
 void KisPaintDevice::setDefaultPixel(const KoColor &defPixel)
 {
     KoColor color(defPixel);
@@ -2265,6 +2576,11 @@ void KisPaintDeviceFramesInterface::invalidateFrameCache(int frameId)
     return q->m_d->invalidateFrameCache(frameId);
 }
 
+int KisPaintDeviceFramesInterface::shareEqualFrameTiles()
+{
+    return q->m_d->shareEqualFrameTiles();
+}
+
 void KisPaintDeviceFramesInterface::setFrameOffset(int frameId, const QPoint &offset)
 {
     KIS_ASSERT_RECOVER_RETURN(frameId >= 0);
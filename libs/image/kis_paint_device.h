@@ -291,6 +291,32 @@ public:
      */
     void purgeDefaultPixels();
 
+    /**
+     * Makes the device produce its pixels on demand from \p source
+     * instead of storing them. The pixels are read from the source
+     * tile-wise when they are accessed, and at most \p maxCachedTiles
+     * tiles are kept in memory (-1 means all of them). The current
+     * content of the device is dropped. Pass a null source to turn the
+     * device back into a normal one. Note that clear() detaches the
+     * source as well.
+     *
+     * The levels of detail of the device are generated from the source
+     * on demand as well, so they take no memory either.
+     *
+     * The source works in the coordinates of the device without its
+     * offset, that is, the caller should take x() and y() into account.
+     *
+     * \see KisTiledDataManager::setDataSource()
+     */
+    void setDataSource(KisTiledDataSourceSP source, int maxCachedTiles = -1);
+    KisTiledDataSourceSP dataSource() const;
+
+    /**
+     * Drops the cached pixels of \p rc, so that they are read from the
+     * data source again on the next access. Doesn't emit any updates.
+     */
+    void invalidateDataSourceCache(const QRect &rc);
+
     /**
      * Sets the default pixel. New data will be initialised with this pixel. The pixel is copied: the
      * caller still owns the pointer and needs to delete it to avoid memory leaks.
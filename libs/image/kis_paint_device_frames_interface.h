@@ -108,6 +108,19 @@ public:
     bool readFrame(QIODevice *stream, int frameId);
 
 
+    /**
+     * Makes the tiles of equal content share the same tile data across
+     * all the frames of the device, e.g. in the held or cycled frames that
+     * were loaded or imported as separate images. The shared tiles are
+     * copied-on-write as soon as one of the frames is changed.
+     *
+     * Should be used only for the frames that have no undo history yet,
+     * e.g. right after the device has been loaded.
+     *
+     * @return the number of tiles that started sharing their data
+     */
+    int shareEqualFrameTiles();
+
     /**
      * Returns frameId of the currently active frame.
      * Should be used by Undo framework only!
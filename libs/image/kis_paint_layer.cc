@@ -316,7 +316,7 @@ void KisPaintLayer::setOnionSkinEnabled(bool state)
 }
 
 void KisPaintLayer::flushOnionSkinCache() {
-    m_d->onionSkinCache.reset();
+    m_d->onionSkinCache.invalidate();
 }
 
 void KisPaintLayer::slotExternalUpdateOnionSkins()
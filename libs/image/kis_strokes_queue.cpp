@@ -32,6 +32,7 @@ typedef QQueue<KisStrokeSP> StrokesQueue;
 typedef QQueue<KisStrokeSP>::iterator StrokesQueueIterator;
 
 #include "kis_image_interfaces.h"
+#include "KisLatencyTracer.h"
 class KisStrokesQueue::LodNUndoStrokesFacade : public KisStrokesFacade
 {
 public:
@@ -321,6 +322,10 @@ KisStrokeId KisStrokesQueue::startStroke(KisStrokeStrategy *strokeStrategy)
 
 void KisStrokesQueue::addJob(KisStrokeId id, KisStrokeJobData *data)
 {
+    if (KisLatencyTracer::isEnabled()) {
+        KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::StrokeJobQueued);
+    }
+
     QMutexLocker locker(&m_d->mutex);
 
     KisStrokeSP stroke = id.toStrongRef();
@@ -22,6 +22,7 @@
 #include <kundo2magicstring.h>
 #include "krita_utils.h"
 #include "kis_layer_utils.h"
+#include "kis_update_time_monitor.h"
 
 
 struct KisSyncLodCacheStrokeStrategy::Private
@@ -90,6 +91,11 @@ KisSyncLodCacheStrokeStrategy::~KisSyncLodCacheStrokeStrategy()
 {
 }
 
+void KisSyncLodCacheStrokeStrategy::initStrokeCallback()
+{
+    KisUpdateTimeMonitor::instance()->reportLodSyncStarted(this);
+}
+
 void KisSyncLodCacheStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
 {
     Private::InitData *initData = dynamic_cast<Private::InitData*>(data);
@@ -121,12 +127,16 @@ void KisSyncLodCacheStrokeStrategy::finishStrokeCallback()
         dev->uploadLodDataStruct(it.value());
     }
 
+    KisUpdateTimeMonitor::instance()->reportLodSyncFinished(this, m_d->dataObjects.size());
+
     qDeleteAll(m_d->dataObjects);
     m_d->dataObjects.clear();
 }
 
 void KisSyncLodCacheStrokeStrategy::cancelStrokeCallback()
 {
+    KisUpdateTimeMonitor::instance()->reportLodSyncCancelled(this);
+
     qDeleteAll(m_d->dataObjects);
     m_d->dataObjects.clear();
 }
@@ -32,6 +32,7 @@ public:
     static QList<KisStrokeJobData*> createJobsData(KisImageWSP image);
 
 private:
+    void initStrokeCallback() override;
     void doStrokeCallback(KisStrokeJobData *data) override;
     void finishStrokeCallback() override;
     void cancelStrokeCallback() override;
@@ -67,6 +67,9 @@ typedef KisWeakSharedPtr<KisPaintDevice> KisPaintDeviceWSP;
 typedef QVector<KisPaintDeviceSP> vKisPaintDeviceSP;
 typedef vKisPaintDeviceSP::iterator vKisPaintDeviceSP_it;
 
+class KisTiledDataSource;
+typedef QSharedPointer<KisTiledDataSource> KisTiledDataSourceSP;
+
 class KisFixedPaintDevice;
 typedef KisSharedPtr<KisFixedPaintDevice> KisFixedPaintDeviceSP;
 
@@ -29,6 +29,7 @@
 #include "kis_base_rects_walker.h"
 #include "kis_async_merger.h"
 #include "kis_updater_context.h"
+#include "KisLatencyTracer.h"
 
 //#define DEBUG_JOBS_SEQUENCE
 
@@ -99,7 +100,12 @@ public:
                     }
 #endif
 
-                    m_runnableJob->run();
+                    if (m_atomicType == Type::STROKE) {
+                        KisLatencyTracer::Span span(KisLatencyTracer::StrokeJob);
+                        m_runnableJob->run();
+                    } else {
+                        m_runnableJob->run();
+                    }
                 }
             }
 
@@ -132,7 +138,10 @@ public:
 
 #endif
 
-        m_merger.startMerge(*m_walker);
+        {
+            KisLatencyTracer::Span span(KisLatencyTracer::ProjectionMerge, m_changeRect);
+            m_merger.startMerge(*m_walker);
+        }
 
         QRect changeRect = m_walker->changeRect();
         m_updaterContext->continueUpdate(changeRect);
@@ -85,6 +85,8 @@ struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
           numTickets(0),
           numUpdates(0),
           mousePath(0.0),
+          numLodSyncs(0),
+          lodSyncTime(0),
           loggingEnabled(false)
     {
         loggingEnabled = KisImageConfig(true).enablePerfLog();
@@ -104,6 +106,10 @@ struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
     QElapsedTimer strokeTime;
     KisPaintOpPresetSP preset;
 
+    QHash<void*, QElapsedTimer> lodSyncTimers;
+    qint32 numLodSyncs;
+    qint64 lodSyncTime;
+
     bool loggingEnabled;
 };
 
@@ -256,3 +262,47 @@ void KisUpdateTimeMonitor::reportUpdateFinished(const QRect &rect)
     }
     m_d->numUpdates++;
 }
+
+void KisUpdateTimeMonitor::reportLodSyncStarted(void *key)
+{
+    if (!m_d->loggingEnabled) return;
+
+    QMutexLocker locker(&m_d->mutex);
+
+    QElapsedTimer timer;
+    timer.start();
+    m_d->lodSyncTimers.insert(key, timer);
+}
+
+void KisUpdateTimeMonitor::reportLodSyncFinished(void *key, int numDevices)
+{
+    if (!m_d->loggingEnabled) return;
+
+    QMutexLocker locker(&m_d->mutex);
+
+    if (!m_d->lodSyncTimers.contains(key)) return;
+
+    const qint64 syncTime = m_d->lodSyncTimers.take(key).elapsed();
+    m_d->numLodSyncs++;
+    m_d->lodSyncTime += syncTime;
+
+    const qreal averageSyncTime = qreal(m_d->lodSyncTime) / m_d->numLodSyncs;
+
+    QFile logFile("log/lodsync.rdata");
+    logFile.open(QIODevice::Append);
+    QTextStream stream(&logFile);
+
+    stream << i18n("LoD Sync Time:") << syncTime << "\t"
+           << i18n("Devices:") << numDevices << "\t"
+           << i18n("Average LoD Sync Time:") << QString::number( averageSyncTime, 'f', 3 ) << endl;
+    logFile.close();
+}
+
+void KisUpdateTimeMonitor::reportLodSyncCancelled(void *key)
+{
+    if (!m_d->loggingEnabled) return;
+
+    QMutexLocker locker(&m_d->mutex);
+
+    m_d->lodSyncTimers.remove(key);
+}
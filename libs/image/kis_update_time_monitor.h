@@ -46,6 +46,10 @@ public:
     void reportJobFinished(void *key, const QVector<QRect> &rects);
     void reportUpdateFinished(const QRect &rect);
 
+    void reportLodSyncStarted(void *key);
+    void reportLodSyncFinished(void *key, int numDevices);
+    void reportLodSyncCancelled(void *key);
+
 
 private:
     struct Private;
@@ -23,6 +23,7 @@
 
 #include "kis_update_job_item.h"
 #include "kis_stroke_job.h"
+#include "KisLatencyTracer.h"
 
 const int KisUpdaterContext::useIdealThreadCountTag = -1;
 
@@ -139,6 +140,10 @@ bool KisUpdaterContext::isJobAllowed(KisBaseRectsWalkerSP walker)
  */
 void KisUpdaterContext::addMergeJob(KisBaseRectsWalkerSP walker)
 {
+    if (KisLatencyTracer::isEnabled()) {
+        KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::MergeJobQueued, walker->changeRect());
+    }
+
     m_lodCounter.addLod(walker->levelOfDetail());
     qint32 jobIndex = findSpareThread();
     Q_ASSERT(jobIndex >= 0);
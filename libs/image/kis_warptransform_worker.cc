@@ -34,6 +34,8 @@
 #include <math.h>
 
 #include "kis_grid_interpolation_tools.h"
+#include "KisFakeRunnableStrokeJobsExecutor.h"
+#include "krita_utils.h"
 
 QPointF KisWarpTransformWorker::affineTransformMath(QPointF v, QVector<QPointF> p, QVector<QPointF> q, qreal alpha)
 {
@@ -232,7 +234,46 @@ struct KisWarpTransformWorker::FunctionTransformOp
     qreal m_alpha;
 };
 
+template <class TransformOp>
+struct GridPointsFetcherOp
+{
+    GridPointsFetcherOp(const TransformOp &transformOp)
+        : m_transformOp(transformOp)
+    {
+    }
+
+    inline void processPoint(int col, int row,
+                             int prevCol, int prevRow,
+                             int colIndex, int rowIndex) {
+
+        Q_UNUSED(prevCol);
+        Q_UNUSED(prevRow);
+        Q_UNUSED(colIndex);
+        Q_UNUSED(rowIndex);
+
+        const QPointF pt(col, row);
+        m_srcPoints << pt;
+        m_dstPoints << m_transformOp(pt);
+    }
+
+    inline void nextLine() {
+    }
+
+    const TransformOp &m_transformOp;
+    QVector<QPointF> m_srcPoints;
+    QVector<QPointF> m_dstPoints;
+};
+
 void KisWarpTransformWorker::run()
+{
+    QVector<KisRunnableStrokeJobDataBase*> jobs;
+    createRunJobs(jobs);
+
+    KisFakeRunnableStrokeJobsExecutor executor;
+    executor.addRunnableJobs(jobs);
+}
+
+void KisWarpTransformWorker::createRunJobs(QVector<KisRunnableStrokeJobDataBase*> &jobs)
 {
 
     if (!m_warpMathFunction ||
@@ -254,16 +295,30 @@ void KisWarpTransformWorker::run()
 
     m_dev->clear();
 
+    if (srcBounds.isEmpty()) return;
+
     const int pixelPrecision = 8;
 
+    /**
+     * The transformed grid is calculated beforehand, so that the cells
+     * could be distributed between the patches of the destination
+     */
     FunctionTransformOp functionOp(m_warpMathFunction, m_origPoint, m_transfPoint, m_alpha);
+    GridPointsFetcherOp<FunctionTransformOp> pointsOp(functionOp);
+    GridIterationTools::processGrid(pointsOp, srcBounds, pixelPrecision);
+
+    const QSize gridSize = GridIterationTools::calcGridSize(srcBounds, pixelPrecision);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(pointsOp.m_srcPoints.size() == gridSize.width() * gridSize.height());
+
+    GridIterationTools::RegularGridCellsOp cellsOp(gridSize, pointsOp.m_srcPoints, pointsOp.m_dstPoints);
+
+    const QVector<GridIterationTools::GridPatch> patches =
+        GridIterationTools::splitGridIntoPatches(cellsOp, KritaUtils::optimalPatchSize());
+
     GridIterationTools::PaintDevicePolygonOp polygonOp(srcdev, m_dev);
-    GridIterationTools::processGrid(polygonOp, functionOp,
-                                    srcBounds, pixelPrecision);
+    GridIterationTools::addGridPatchJobs(jobs, cellsOp, polygonOp, patches);
 }
 
-#include "krita_utils.h"
-
 QRect KisWarpTransformWorker::approxChangeRect(const QRect &rc)
 {
     const qreal margin = 0.05;
@@ -32,6 +32,8 @@
 
 #include <KoUpdater.h>
 
+class KisRunnableStrokeJobDataBase;
+
 /**
  * Class to apply a transformation (affine, similitude, MLS) to a paintDevice
  * or a QImage according an original set of points p, a new set of points q,
@@ -67,6 +69,13 @@ public:
     // Perform the prepared transformation
     void run();
 
+    /**
+     * Clears the device and appends to \p jobs the concurrent jobs that
+     * write the transformed pixels into it. The jobs do not refer to the
+     * worker, so it can be deleted before they are executed.
+     */
+    void createRunJobs(QVector<KisRunnableStrokeJobDataBase*> &jobs);
+
     QRect approxChangeRect(const QRect &rc);
     QRect approxNeedRect(const QRect &rc, const QRect &fullBounds);
 
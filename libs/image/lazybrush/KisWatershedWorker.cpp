@@ -32,20 +32,107 @@
 #include "kis_sequential_iterator.h"
 #include "kis_scanline_fill.h"
 
-#include "kis_random_accessor_ng.h"
+#include "kis_algebra_2d.h"
+
+#include <QtConcurrent>
 
 #include <boost/heap/fibonacci_heap.hpp>
-#include <set>
+#include <algorithm>
+#include <vector>
 
 using namespace KisLazyFillTools;
 
 namespace {
 
-struct CompareQPoints
+/**
+ * A multiset of points, tuned for the access pattern of the worker:
+ * points are inserted and removed very often, but the contents of the
+ * set are requested only when the group is being removed.
+ *
+ * Insertions and removals are just appended to flat arrays, which are
+ * resolved into the real contents lazily. That is much cheaper than
+ * keeping a node-based std::multiset balanced on every single step.
+ */
+class ConflictPointSet
 {
-    bool operator() (const QPoint &p1, const QPoint &p2) const {
-        return p1.y() < p2.y() || (p1.y() == p2.y() && p1.x() < p2.x());
+public:
+    void insert(const QPoint &pt) {
+        m_inserted.push_back(packPoint(pt));
+    }
+
+    /**
+     * Removes one instance of \p pt, the point must be present in the set
+     */
+    void erase(const QPoint &pt) {
+        m_removed.push_back(packPoint(pt));
+
+        if (m_removed.size() > 64 && 2 * m_removed.size() > m_inserted.size()) {
+            compact();
+        }
+    }
+
+    int size() const {
+        return int(m_inserted.size() - m_removed.size());
+    }
+
+    bool empty() const {
+        return m_inserted.size() == m_removed.size();
+    }
+
+    /**
+     * @return all the points of the set without duplicates, sorted
+     *         in a row-major order
+     */
+    std::vector<QPoint> uniquePoints() {
+        compact();
+
+        std::vector<QPoint> result;
+        result.reserve(m_inserted.size());
+
+        quint64 lastKey = 0;
+        for (auto it = m_inserted.begin(); it != m_inserted.end(); ++it) {
+            if (it == m_inserted.begin() || *it != lastKey) {
+                result.push_back(unpackPoint(*it));
+                lastKey = *it;
+            }
+        }
+
+        return result;
     }
+
+private:
+    void compact() {
+        std::sort(m_inserted.begin(), m_inserted.end());
+        std::sort(m_removed.begin(), m_removed.end());
+
+        std::vector<quint64> result;
+        result.reserve(m_inserted.size() - m_removed.size());
+
+        std::set_difference(m_inserted.begin(), m_inserted.end(),
+                            m_removed.begin(), m_removed.end(),
+                            std::back_inserter(result));
+
+        m_inserted.swap(result);
+        m_removed.clear();
+    }
+
+    /**
+     * Packs the point into a key that sorts in the row-major order. The
+     * sign bits are flipped to keep negative coordinates in order.
+     */
+    static quint64 packPoint(const QPoint &pt) {
+        return (quint64(quint32(pt.y()) ^ 0x80000000u) << 32) |
+                quint64(quint32(pt.x()) ^ 0x80000000u);
+    }
+
+    static QPoint unpackPoint(quint64 key) {
+        return QPoint(qint32(quint32(key) ^ 0x80000000u),
+                      qint32(quint32(key >> 32) ^ 0x80000000u));
+    }
+
+private:
+    std::vector<quint64> m_inserted;
+    std::vector<quint64> m_removed;
 };
 
 struct FillGroup {
@@ -67,7 +154,7 @@ struct FillGroup {
             return positiveEdgeSize + negativeEdgeSize + foreignEdgeSize + allyEdgeSize;
         }
 
-        QMap<qint32, std::multiset<QPoint, CompareQPoints>> conflictWithGroup;
+        QMap<qint32, ConflictPointSet> conflictWithGroup;
     };
 
     QMap<int, LevelData> levels;
@@ -198,6 +285,57 @@ void parseColorIntoGroups(QVector<FillGroup> &groups,
 
 using PointsPriorityQueue = boost::heap::fibonacci_heap<TaskPoint, boost::heap::compare<CompareTaskPoints>>;
 
+/**
+ * Writes colors of the groups into one horizontal band of the destination
+ * device. The bands are independent, so they are processed concurrently.
+ */
+struct WriteColoringBand
+{
+    WriteColoringBand(const qint32 *groupsData,
+                      const QRect &groupsDataRect,
+                      const QVector<int> &groupColorIndexes,
+                      const QVector<KoColor> &colors,
+                      KisPaintDeviceSP dstDevice)
+        : m_groupsData(groupsData),
+          m_groupsDataRect(groupsDataRect),
+          m_groupColorIndexes(groupColorIndexes),
+          m_colors(colors),
+          m_dstDevice(dstDevice)
+    {
+    }
+
+    void operator()(const QRect &band) {
+        const int pixelSize = m_dstDevice->pixelSize();
+
+        QVector<quint8> buffer(band.width() * band.height() * pixelSize);
+        m_dstDevice->readBytes(buffer.data(), band);
+
+        quint8 *dstPtr = buffer.data();
+
+        for (int y = band.top(); y <= band.bottom(); y++) {
+            const qint32 *srcPtr = m_groupsData +
+                qint64(y - m_groupsDataRect.y()) * m_groupsDataRect.width() +
+                band.x() - m_groupsDataRect.x();
+
+            for (int x = 0; x < band.width(); x++) {
+                const int colorIndex = m_groupColorIndexes[srcPtr[x]];
+                if (colorIndex >= 0) {
+                    memcpy(dstPtr, m_colors[colorIndex].data(), pixelSize);
+                }
+                dstPtr += pixelSize;
+            }
+        }
+
+        m_dstDevice->writeBytes(buffer.constData(), band);
+    }
+
+    const qint32 *m_groupsData;
+    QRect m_groupsDataRect;
+    const QVector<int> &m_groupColorIndexes;
+    const QVector<KoColor> &m_colors;
+    KisPaintDeviceSP m_dstDevice;
+};
+
 }
 
 /***********************************************************************/
@@ -217,12 +355,22 @@ struct KisWatershedWorker::Private
     QVector<FillGroup> groups;
     KisPaintDeviceSP groupsMap;
 
+    // flat copies of the group map and the height map covering boundingRect;
+    // the flooding accesses them directly instead of the random accessors.
+    // They take 5 bytes per pixel of the whole boundingRect, which is about
+    // 320 MiB for an 8k page.
+    //
+    // NOTE: the flooding itself is sequential. The edge statistics that
+    //       drive cleanupForeignEdgeGroups() depend on the global order of
+    //       the queue, so a tile-partitioned flood would change the result.
+    //       Only writeColoring() is run concurrently.
+    std::vector<qint32> groupsData;
+    std::vector<quint8> levelsData;
+
     CompareTaskPoints pointsComparator;
     PointsPriorityQueue pointsQueue;
 
     // temporary "global" variables for the processing routines
-    KisRandomAccessorSP groupIt;
-    KisRandomConstAccessorSP levelIt;
     qint32 backgroundGroupId = 0;
     int backgroundGroupColor = -1;
     bool recolorMode = false;
@@ -232,6 +380,13 @@ struct KisWatershedWorker::Private
 
     KoUpdater *progressUpdater = 0;
 
+    ALWAYS_INLINE size_t pixelOffset(int x, int y) const {
+        return size_t(y - boundingRect.y()) * boundingRect.width() + (x - boundingRect.x());
+    }
+
+    void loadFlatMaps();
+    void storeGroupsMap();
+
     void initializeQueueFromGroupMap(const QRect &rc);
 
     ALWAYS_INLINE void visitNeighbour(const QPoint &currPt, const QPoint &prevPt, quint8 fromDirection, int prevDistance, quint8 prevLevel, qint32 prevGroupId, FillGroup &prevGroup, FillGroup::LevelData &prevLevelData, qint32 prevPrevGroupId, FillGroup &prevPrevGroup, bool statsOnly = false);
@@ -325,6 +480,7 @@ void KisWatershedWorker::run(qreal cleanUpAmount)
     const QRect initRect =
         m_d->boundingRect & m_d->groupsMap->nonDefaultPixelArea();
 
+    m_d->loadFlatMaps();
     m_d->initializeQueueFromGroupMap(initRect);
     m_d->processQueue(0);
 
@@ -381,30 +537,47 @@ void KisWatershedWorker::testingTryRemoveGroup(qint32 group, quint8 levelIndex)
     m_d->calcNumGroupMaps();
 }
 
-void KisWatershedWorker::Private::initializeQueueFromGroupMap(const QRect &rc)
+void KisWatershedWorker::Private::loadFlatMaps()
 {
-    KisSequentialIterator groupMapIt(groupsMap, rc);
-    KisSequentialConstIterator heightMapIt(heightMap, rc);
+    const size_t numPixels = size_t(boundingRect.width()) * boundingRect.height();
 
-    while (groupMapIt.nextPixel() &&
-           heightMapIt.nextPixel()) {
+    groupsData.resize(numPixels);
+    levelsData.resize(numPixels);
 
-        qint32 *groupPtr = reinterpret_cast<qint32*>(groupMapIt.rawData());
-        const quint8 *heightPtr = heightMapIt.rawDataConst();
+    groupsMap->readBytes(reinterpret_cast<quint8*>(groupsData.data()), boundingRect);
+    heightMap->readBytes(levelsData.data(), boundingRect);
 
-        if (*groupPtr > 0) {
-            TaskPoint pt;
-            pt.x = groupMapIt.x();
-            pt.y = groupMapIt.y();
-            pt.group = *groupPtr;
-            pt.level = *heightPtr;
+    // from now on the flat copy is the only valid version of the map
+    groupsMap->clear();
+}
 
-            pointsQueue.push(pt);
+void KisWatershedWorker::Private::storeGroupsMap()
+{
+    if (groupsData.empty()) return;
 
-            // we must clear the pixel to make sure foreign metric is calculated correctly
-            *groupPtr = 0;
-        }
+    groupsMap->writeBytes(reinterpret_cast<const quint8*>(groupsData.data()), boundingRect);
+}
 
+void KisWatershedWorker::Private::initializeQueueFromGroupMap(const QRect &rc)
+{
+    for (int y = rc.top(); y <= rc.bottom(); y++) {
+        qint32 *groupPtr = &groupsData[pixelOffset(rc.x(), y)];
+        const quint8 *heightPtr = &levelsData[pixelOffset(rc.x(), y)];
+
+        for (int x = rc.left(); x <= rc.right(); x++, groupPtr++, heightPtr++) {
+            if (*groupPtr > 0) {
+                TaskPoint pt;
+                pt.x = x;
+                pt.y = y;
+                pt.group = *groupPtr;
+                pt.level = *heightPtr;
+
+                pointsQueue.push(pt);
+
+                // we must clear the pixel to make sure foreign metric is calculated correctly
+                *groupPtr = 0;
+            }
+        }
     }
 }
 
@@ -448,11 +621,8 @@ ALWAYS_INLINE  void removeForeignAlly(qint32 currGroupId,
         currLevelData.foreignEdgeSize--;
 
         if (sameLevel) {
-            std::multiset<QPoint, CompareQPoints> &currSet = currLevelData.conflictWithGroup[prevGroupId];
-            currSet.erase(currSet.find(currPt));
-
-            std::multiset<QPoint, CompareQPoints> &prevSet = prevLevelData.conflictWithGroup[currGroupId];
-            prevSet.erase(prevSet.find(prevPt));
+            currLevelData.conflictWithGroup[prevGroupId].erase(currPt);
+            prevLevelData.conflictWithGroup[currGroupId].erase(prevPt);
         }
 
     } else {
@@ -513,11 +683,9 @@ void KisWatershedWorker::Private::visitNeighbour(const QPoint &currPt, const QPo
 
     KIS_SAFE_ASSERT_RECOVER_RETURN(prevGroupId != backgroundGroupId);
 
-    groupIt->moveTo(currPt.x(), currPt.y());
-    levelIt->moveTo(currPt.x(), currPt.y());
-
-    const qint32 currGroupId = *reinterpret_cast<const qint32*>(groupIt->rawDataConst());
-    const quint8 newLevel = *levelIt->rawDataConst();
+    const size_t currOffset = pixelOffset(currPt.x(), currPt.y());
+    const qint32 currGroupId = groupsData[currOffset];
+    const quint8 newLevel = levelsData[currOffset];
 
     FillGroup &currGroup = groups[currGroupId];
     FillGroup::LevelData &currLevelData = currGroup.levels[newLevel];
@@ -636,10 +804,6 @@ void KisWatershedWorker::Private::processQueue(qint32 _backgroundGroupId)
     QElapsedTimer tt; tt.start();
 
 
-    // TODO: lazy initialization of the iterator's position
-    // TODO: reuse iterators if possible!
-    groupIt = groupsMap->createRandomAccessorNG();
-    levelIt = heightMap->createRandomConstAccessorNG();
     backgroundGroupId = _backgroundGroupId;
     backgroundGroupColor = groups[backgroundGroupId].colorIndex;
     recolorMode = backgroundGroupId > 1;
@@ -657,8 +821,7 @@ void KisWatershedWorker::Private::processQueue(qint32 _backgroundGroupId)
         TaskPoint pt = pointsQueue.top();
         pointsQueue.pop();
 
-        groupIt->moveTo(pt.x, pt.y);
-        qint32 *groupPtr = reinterpret_cast<qint32*>(groupIt->rawData());
+        qint32 *groupPtr = &groupsData[pixelOffset(pt.x, pt.y)];
 
         const qint32 prevGroupId = *groupPtr;
         FillGroup &prevGroup = groups[prevGroupId];
@@ -706,9 +869,6 @@ void KisWatershedWorker::Private::processQueue(qint32 _backgroundGroupId)
 
     }
 
-    // cleaup iterators
-    groupIt.clear();
-    levelIt.clear();
     backgroundGroupId = 0;
     backgroundGroupColor = -1;
     recolorMode = false;
@@ -718,8 +878,7 @@ void KisWatershedWorker::Private::processQueue(qint32 _backgroundGroupId)
 
 void KisWatershedWorker::Private::writeColoring()
 {
-    KisSequentialConstIterator srcIt(groupsMap, boundingRect);
-    KisSequentialIterator dstIt(dstDevice, boundingRect);
+    if (groupsData.empty()) return;
 
     QVector<KoColor> colors;
     for (auto it = keyStrokes.begin(); it != keyStrokes.end(); ++it) {
@@ -727,18 +886,31 @@ void KisWatershedWorker::Private::writeColoring()
         color.convertTo(dstDevice->colorSpace());
         colors << color;
     }
-    const int colorPixelSize = dstDevice->pixelSize();
 
+    QVector<int> groupColorIndexes;
+    groupColorIndexes.reserve(groups.size());
+    Q_FOREACH (const FillGroup &group, groups) {
+        groupColorIndexes << group.colorIndex;
+    }
 
-    while (srcIt.nextPixel() && dstIt.nextPixel()) {
-        const qint32 *srcPtr = reinterpret_cast<const qint32*>(srcIt.rawDataConst());
+    // split the rect into bands aligned to the tile rows
+    const int bandHeight = 64;
+    QVector<QRect> bands;
 
-        const int colorIndex = groups[*srcPtr].colorIndex;
-        if (colorIndex >= 0) {
-            memcpy(dstIt.rawData(), colors[colorIndex].data(), colorPixelSize);
-        }
+    int y = boundingRect.top();
+    while (y <= boundingRect.bottom()) {
+        const int bandBottom =
+            qMin(boundingRect.bottom(),
+                 KisAlgebra2D::divideFloor(y, bandHeight) * bandHeight + bandHeight - 1);
 
+        bands << QRect(boundingRect.left(), y, boundingRect.width(), bandBottom - y + 1);
+        y = bandBottom + 1;
     }
+
+    QtConcurrent::blockingMap(bands,
+                              WriteColoringBand(groupsData.data(), boundingRect,
+                                                groupColorIndexes, colors,
+                                                dstDevice));
 }
 
 QVector<TaskPoint> KisWatershedWorker::Private::tryRemoveConflictingPlane(qint32 group, quint8 level)
@@ -750,8 +922,7 @@ QVector<TaskPoint> KisWatershedWorker::Private::tryRemoveConflictingPlane(qint32
 
     for (auto conflictIt = l.conflictWithGroup.begin(); conflictIt != l.conflictWithGroup.end(); ++conflictIt) {
 
-        std::vector<QPoint> uniquePoints;
-        std::unique_copy(conflictIt->begin(), conflictIt->end(), std::back_inserter(uniquePoints));
+        const std::vector<QPoint> uniquePoints = conflictIt->uniquePoints();
 
         for (auto pointIt = uniquePoints.begin(); pointIt != uniquePoints.end(); ++pointIt) {
             TaskPoint pt;
@@ -898,6 +1069,8 @@ void KisWatershedWorker::Private::cleanupForeignEdgeGroups(qreal cleanUpAmount)
 
 void KisWatershedWorker::Private::dumpGroupMaps()
 {
+    storeGroupsMap();
+
     KisPaintDeviceSP groupDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
     KisPaintDeviceSP colorDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
     KisPaintDeviceSP pedgeDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
@@ -963,6 +1136,8 @@ void KisWatershedWorker::Private::dumpGroupMaps()
 
 void KisWatershedWorker::Private::calcNumGroupMaps()
 {
+    storeGroupsMap();
+
     KisSequentialConstIterator groupIt(groupsMap, boundingRect);
     KisSequentialConstIterator levelIt(heightMap, boundingRect);
 
@@ -0,0 +1,237 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisLatencyTracerTest.h"
+
+#include <QTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include "KisLatencyTracer.h"
+
+namespace {
+
+QJsonArray loadTraceEvents(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return QJsonArray();
+
+    return QJsonDocument::fromJson(file.readAll()).object()["traceEvents"].toArray();
+}
+
+int countEvents(const QJsonArray &events, const QString &name, const QString &phase)
+{
+    int count = 0;
+
+    Q_FOREACH (const QJsonValue &value, events) {
+        const QJsonObject event = value.toObject();
+        if (event["name"].toString() == name && event["ph"].toString() == phase) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+class MergeThread : public QThread
+{
+public:
+    void run() override {
+        KisLatencyTracer::Span span(KisLatencyTracer::ProjectionMerge, QRect(0, 0, 64, 64));
+        QThread::msleep(2);
+    }
+};
+
+/**
+ * Records numbered events as fast as possible, the number is encoded
+ * in the rect twice, so that torn records could be detected
+ */
+class FloodThread : public QThread
+{
+public:
+    void run() override {
+        for (int i = 1; !stop.loadAcquire(); i++) {
+            KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::StrokeJobQueued, QRect(i, 0, 1, i));
+        }
+    }
+
+    QAtomicInt stop;
+};
+
+}
+
+void KisLatencyTracerTest::init()
+{
+    KisLatencyTracer::instance()->clear();
+    KisLatencyTracer::instance()->setEnabled(true);
+}
+
+void KisLatencyTracerTest::cleanup()
+{
+    KisLatencyTracer::instance()->setEnabled(false);
+}
+
+void KisLatencyTracerTest::testDisabled()
+{
+    KisLatencyTracer::instance()->setEnabled(false);
+
+    {
+        KisLatencyTracer::Span span(KisLatencyTracer::StrokeJob);
+    }
+
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/trace.json";
+    QVERIFY(KisLatencyTracer::instance()->saveChromeTrace(fileName));
+
+    const QJsonArray events = loadTraceEvents(fileName);
+    QCOMPARE(countEvents(events, "StrokeJob", "B"), 0);
+    QCOMPARE(countEvents(events, "StrokeJob", "E"), 0);
+}
+
+void KisLatencyTracerTest::testChromeTrace()
+{
+    KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::TabletEvent);
+    KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::PaintInfoCreated, QPointF(10, 10));
+
+    {
+        KisLatencyTracer::Span span(KisLatencyTracer::StrokeJob);
+    }
+
+    MergeThread thread;
+    thread.start();
+    QVERIFY(thread.wait());
+
+    KisLatencyTracer::instance()->setEnabled(false);
+
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/trace.json";
+    QVERIFY(KisLatencyTracer::instance()->saveChromeTrace(fileName));
+
+    const QJsonArray events = loadTraceEvents(fileName);
+    QCOMPARE(countEvents(events, "TabletEvent", "i"), 1);
+    QCOMPARE(countEvents(events, "PaintInfoCreated", "i"), 1);
+    QCOMPARE(countEvents(events, "StrokeJob", "B"), 1);
+    QCOMPARE(countEvents(events, "StrokeJob", "E"), 1);
+    QCOMPARE(countEvents(events, "ProjectionMerge", "B"), 1);
+    QCOMPARE(countEvents(events, "ProjectionMerge", "E"), 1);
+
+    // the merge has been recorded in a separate thread
+    int strokeThread = -1;
+    int mergeThread = -1;
+
+    Q_FOREACH (const QJsonValue &value, events) {
+        const QJsonObject event = value.toObject();
+        if (event["name"].toString() == "StrokeJob") {
+            strokeThread = event["tid"].toInt();
+        } else if (event["name"].toString() == "ProjectionMerge") {
+            mergeThread = event["tid"].toInt();
+        }
+    }
+
+    QVERIFY(strokeThread >= 0);
+    QVERIFY(mergeThread >= 0);
+    QVERIFY(strokeThread != mergeThread);
+}
+
+void KisLatencyTracerTest::testSummary()
+{
+    KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::TabletEvent);
+    KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::PaintInfoCreated, QPointF(10, 10));
+
+    QThread::msleep(1);
+
+    {
+        // doesn't cover the paint information
+        KisLatencyTracer::Span span(KisLatencyTracer::CanvasTextureUpdate, QRect(100, 100, 10, 10));
+    }
+
+    {
+        KisLatencyTracer::Span span(KisLatencyTracer::CanvasTextureUpdate, QRect(0, 0, 64, 64));
+    }
+
+    KisLatencyTracer::instance()->setEnabled(false);
+
+    const QString summary = KisLatencyTracer::instance()->summary();
+
+    QVERIFY(summary.contains(QRegExp("TabletEvent->PaintInfo\\s*: count 1")));
+    QVERIFY(summary.contains(QRegExp("PaintInfo->Canvas\\s*: count 1")));
+    QVERIFY(summary.contains(QRegExp("TabletEvent->Canvas\\s*: count 1")));
+    QVERIFY(summary.contains(QRegExp("CanvasTextureUpdate\\s*: count 2")));
+}
+
+void KisLatencyTracerTest::testRecycleThreadBuffers()
+{
+    for (int i = 0; i < 4; i++) {
+        MergeThread thread;
+        thread.start();
+        QVERIFY(thread.wait());
+    }
+
+    KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::TabletEvent);
+
+    KisLatencyTracer::instance()->setEnabled(false);
+
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/trace.json";
+    QVERIFY(KisLatencyTracer::instance()->saveChromeTrace(fileName));
+
+    const QJsonArray events = loadTraceEvents(fileName);
+
+    // the finished threads pass their buffer to each other, so only
+    // the events of the last one are left
+    QCOMPARE(countEvents(events, "ProjectionMerge", "B"), 1);
+    QCOMPARE(countEvents(events, "ProjectionMerge", "E"), 1);
+
+    // one buffer for the main thread and one for all the merge threads
+    QCOMPARE(countEvents(events, "thread_name", "M"), 2);
+}
+
+void KisLatencyTracerTest::testSnapshotWhileWrapping()
+{
+    FloodThread thread;
+    thread.start();
+
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/trace.json";
+
+    for (int i = 0; i < 20; i++) {
+        QVERIFY(KisLatencyTracer::instance()->saveChromeTrace(fileName));
+
+        int lastNumber = 0;
+
+        Q_FOREACH (const QJsonValue &value, loadTraceEvents(fileName)) {
+            const QJsonObject event = value.toObject();
+            if (event["name"].toString() != "StrokeJobQueued") continue;
+
+            const QJsonObject args = event["args"].toObject();
+            const int number = args["x"].toInt();
+
+            QCOMPARE(args["height"].toInt(), number);
+            QVERIFY(number > lastNumber);
+            lastNumber = number;
+        }
+    }
+
+    thread.stop.storeRelease(1);
+    QVERIFY(thread.wait());
+}
+
+QTEST_MAIN(KisLatencyTracerTest)
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTileHistogramCacheTest.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "KisTileHistogramCache.h"
+#include "kis_paint_device.h"
+#include "kis_iterator_ng.h"
+
+
+QVector<quint32> referenceBins(KisPaintDeviceSP dev, const QRect &bounds, int channel)
+{
+    QVector<quint32> bins(KisTileHistogramCache::numBins, 0);
+    const KoColorSpace *cs = dev->colorSpace();
+
+    KisSequentialConstIterator it(dev, bounds & dev->extent());
+    while (it.nextPixel()) {
+        bins[cs->scaleToU8(it.rawDataConst(), channel)]++;
+    }
+
+    return bins;
+}
+
+void checkAllChannels(KisTileHistogramCache &cache, KisPaintDeviceSP dev, const QRect &bounds)
+{
+    QCOMPARE(cache.channelCount(), int(dev->channelCount()));
+
+    for (int i = 0; i < cache.channelCount(); i++) {
+        QCOMPARE(cache.channelBins(i), referenceBins(dev, bounds, i));
+    }
+}
+
+void KisTileHistogramCacheTest::testFullCount()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const QRect bounds(0, 0, 300, 200);
+    dev->fill(QRect(10, 10, 250, 150), KoColor(Qt::red, cs));
+    dev->fill(QRect(100, 50, 30, 30), KoColor(Qt::blue, cs));
+
+    KisTileHistogramCache cache;
+    cache.update(dev, bounds);
+
+    checkAllChannels(cache, dev, bounds);
+}
+
+void KisTileHistogramCacheTest::testIncrementalUpdate()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const QRect bounds(0, 0, 300, 200);
+    dev->fill(bounds, KoColor(Qt::white, cs));
+
+    KisTileHistogramCache cache;
+    cache.update(dev, bounds);
+    checkAllChannels(cache, dev, bounds);
+
+    const QRect dabRect(50, 50, 20, 20);
+    dev->fill(dabRect, KoColor(Qt::green, cs));
+    cache.setDirty(dabRect);
+    cache.update(dev, bounds);
+
+    QCOMPARE(cache.numRecountedTiles(), 4);
+    checkAllChannels(cache, dev, bounds);
+
+    // the part of the dab outside the bounds is not counted
+    const QRect edgeDabRect(290, 190, 20, 20);
+    dev->fill(edgeDabRect, KoColor(Qt::blue, cs));
+    cache.setDirty(edgeDabRect);
+    cache.update(dev, bounds);
+
+    checkAllChannels(cache, dev, bounds);
+
+    dev->clear(QRect(0, 0, 128, 128));
+    cache.setDirty(QRect(0, 0, 128, 128));
+    cache.update(dev, bounds);
+
+    checkAllChannels(cache, dev, bounds);
+
+    // nothing is dirty
+    cache.update(dev, bounds);
+    QCOMPARE(cache.numRecountedTiles(), 0);
+    checkAllChannels(cache, dev, bounds);
+}
+
+void KisTileHistogramCacheTest::testExtentChange()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const QRect bounds(0, 0, 300, 200);
+    dev->fill(QRect(10, 10, 50, 50), KoColor(Qt::red, cs));
+
+    KisTileHistogramCache cache;
+    cache.update(dev, bounds);
+    checkAllChannels(cache, dev, bounds);
+
+    // the default pixels between the two dabs get into the extent
+    const QRect dabRect(250, 150, 10, 10);
+    dev->fill(dabRect, KoColor(Qt::blue, cs));
+    cache.setDirty(dabRect);
+    cache.update(dev, bounds);
+
+    checkAllChannels(cache, dev, bounds);
+
+    // and leave it again
+    dev->clear(dabRect);
+    dev->purgeDefaultPixels();
+    cache.setDirty(dabRect);
+    cache.update(dev, bounds);
+
+    checkAllChannels(cache, dev, bounds);
+}
+
+void KisTileHistogramCacheTest::testColorSpaceChange()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const QRect bounds(0, 0, 300, 200);
+    dev->fill(bounds, KoColor(Qt::red, cs));
+
+    KisTileHistogramCache cache;
+    cache.update(dev, bounds);
+    checkAllChannels(cache, dev, bounds);
+
+    dev->convertTo(KoColorSpaceRegistry::instance()->rgb16());
+    cache.update(dev, bounds);
+
+    QCOMPARE(cache.numRecountedTiles(), 20);
+    checkAllChannels(cache, dev, bounds);
+}
+
+QTEST_MAIN(KisTileHistogramCacheTest)
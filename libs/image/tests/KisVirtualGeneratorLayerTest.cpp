@@ -0,0 +1,197 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisVirtualGeneratorLayerTest.h"
+
+#include <QTest>
+#include <testutil.h>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KisGlobalResourcesInterface.h>
+
+#include "generator/kis_generator.h"
+#include "generator/kis_generator_layer.h"
+#include "generator/kis_generator_registry.h"
+#include "filter/kis_filter_configuration.h"
+#include "kis_image.h"
+#include "kis_image_config.h"
+#include "kis_paint_device.h"
+#include "kis_processing_information.h"
+#include "kis_selection.h"
+
+
+/**
+ * Fills the requested area with the red value from the
+ * configuration and counts the calls
+ */
+class TestGenerator : public KisGenerator
+{
+public:
+    TestGenerator()
+        : KisGenerator(id(), KoID("basic"), "Test")
+    {
+    }
+
+    static KoID id() {
+        return KoID("virtual_layer_test_generator", "Test");
+    }
+
+    void generate(KisProcessingInformation dst,
+                  const QSize &size,
+                  const KisFilterConfigurationSP config,
+                  KoUpdater *progressUpdater) const override
+    {
+        Q_UNUSED(progressUpdater);
+
+        numCalls.ref();
+
+        KisPaintDeviceSP dev = dst.paintDevice();
+        const KoColor color(QColor(config->getInt("value"), 0, 0), dev->colorSpace());
+        dev->fill(QRect(dst.topLeft(), size), color);
+    }
+
+    mutable QAtomicInt numCalls;
+};
+
+int redAt(KisPaintDeviceSP dev, int x, int y)
+{
+    QColor c;
+    dev->pixel(x, y, &c);
+    return c.alpha() ? c.red() : -1;
+}
+
+KisFilterConfigurationSP testConfiguration(int value)
+{
+    KisGeneratorSP generator = KisGeneratorRegistry::instance()->value(TestGenerator::id().id());
+    KisFilterConfigurationSP config = generator->factoryConfiguration(KisGlobalResourcesInterface::instance());
+    config->setProperty("value", value);
+    return config;
+}
+
+/**
+ * Enables the virtual generator layers with a cache of a single
+ * tile for the lifetime of the object
+ */
+struct VirtualLayersOverride
+{
+    VirtualLayersOverride()
+    {
+        KisImageConfig cfg(true);
+        m_oldUseVirtualLayers = cfg.useVirtualGeneratorLayers();
+        m_oldCacheSize = cfg.virtualGeneratorLayerCacheSize();
+
+        KisImageConfig(false).setUseVirtualGeneratorLayers(true);
+        KisImageConfig(false).setVirtualGeneratorLayerCacheSize(0);
+    }
+
+    ~VirtualLayersOverride()
+    {
+        KisImageConfig(false).setUseVirtualGeneratorLayers(m_oldUseVirtualLayers);
+        KisImageConfig(false).setVirtualGeneratorLayerCacheSize(m_oldCacheSize);
+    }
+
+private:
+    bool m_oldUseVirtualLayers;
+    int m_oldCacheSize;
+};
+
+void KisVirtualGeneratorLayerTest::initTestCase()
+{
+    KisGeneratorRegistry::instance()->add(new TestGenerator());
+}
+
+void KisVirtualGeneratorLayerTest::testGeneratedPixels()
+{
+    VirtualLayersOverride virtualLayers;
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 256, 256, cs, "virtual generator layer test");
+
+    KisGeneratorLayerSP layer = new KisGeneratorLayer(image, "generator", testConfiguration(200), KisSelectionSP());
+    image->addNode(layer, image->rootLayer());
+    layer->update();
+    image->waitForDone();
+
+    QVERIFY(layer->isVirtual());
+    QCOMPARE(redAt(layer->original(), 10, 10), 200);
+    QCOMPARE(redAt(layer->original(), 250, 250), 200);
+    QCOMPARE(redAt(image->projection(), 100, 100), 200);
+
+    layer->setFilterWithoutUpdate(testConfiguration(100));
+    layer->update();
+    image->waitForDone();
+
+    QVERIFY(layer->isVirtual());
+    QCOMPARE(redAt(layer->original(), 10, 10), 100);
+    QCOMPARE(redAt(image->projection(), 100, 100), 100);
+}
+
+void KisVirtualGeneratorLayerTest::testWrittenTilesAreKept()
+{
+    VirtualLayersOverride virtualLayers;
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 256, 256, cs, "virtual generator layer test");
+
+    KisGeneratorLayerSP layer = new KisGeneratorLayer(image, "generator", testConfiguration(200), KisSelectionSP());
+    image->addNode(layer, image->rootLayer());
+    layer->update();
+    image->waitForDone();
+
+    KisPaintDeviceSP dev = layer->original();
+    QVERIFY(dev->dataSource());
+
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    src->fill(QRect(0, 0, 64, 64), KoColor(QColor(50, 0, 0), cs));
+
+    // both tiles get into the cache first
+    QCOMPARE(redAt(dev, 10, 10), 200);
+    dev->fastBitBlt(src, QRect(0, 0, 64, 64));
+    QCOMPARE(redAt(dev, 70, 10), 200);
+    dev->clear(QRect(64, 0, 64, 64));
+
+    // evict all the cached tiles
+    for (int y = 0; y < 256; y += 64) {
+        for (int x = 0; x < 256; x += 64) {
+            redAt(dev, x + 10, y + 10);
+        }
+    }
+
+    TestGenerator *generator = dynamic_cast<TestGenerator*>(
+        KisGeneratorRegistry::instance()->value(TestGenerator::id().id()).data());
+    QVERIFY(generator);
+    const int numCalls = generator->numCalls;
+
+    QCOMPARE(redAt(dev, 10, 10), 50);
+    QCOMPARE(redAt(dev, 70, 10), -1);
+    QCOMPARE(int(generator->numCalls), numCalls);
+
+    // the invalidated tiles are generated again, the written ones are not
+    dev->invalidateDataSourceCache(image->bounds());
+
+    QCOMPARE(redAt(dev, 10, 10), 50);
+    QCOMPARE(redAt(dev, 70, 10), -1);
+    QCOMPARE(int(generator->numCalls), numCalls);
+
+    QCOMPARE(redAt(dev, 130, 10), 200);
+    QCOMPARE(int(generator->numCalls), numCalls + 1);
+}
+
+KISTEST_MAIN(KisVirtualGeneratorLayerTest)
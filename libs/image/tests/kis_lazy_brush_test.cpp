@@ -1411,6 +1411,90 @@ void KisLazyBrushTest::multiwayCutBenchmark()
     // KIS_DUMP_DEVICE_2(filteredMainDev, mainRect, "2filtered", "dd");
 }
 
+#include "lazybrush/KisWatershedWorker.h"
 
+void KisLazyBrushTest::watershedBenchmark_data()
+{
+    QTest::addColumn<int>("pageSize");
+
+    QTest::newRow("1k") << 1024;
+    QTest::newRow("4k") << 4096;
+    QTest::newRow("8k") << 8192;
+}
+
+void KisLazyBrushTest::watershedBenchmark()
+{
+    QFETCH(int, pageSize);
+
+    const QRect mainRect(0, 0, pageSize, pageSize);
+    const int cellSize = 256;
+
+    /**
+     * Generate a page of "line art": a grid of cells with a circle
+     * inside each cell, some of the cells have small gaps in the lines
+     */
+    QImage lineArt(mainRect.size(), QImage::Format_ARGB32);
+    lineArt.fill(Qt::white);
+
+    {
+        QPainter gc(&lineArt);
+        gc.setRenderHint(QPainter::Antialiasing);
+        gc.setPen(QPen(Qt::black, 5));
+
+        for (int i = 0; i <= pageSize / cellSize; i++) {
+            const int gapOffset = (i % 3 == 0) ? cellSize / 2 : pageSize;
+            gc.drawLine(QPoint(i * cellSize, 0), QPoint(i * cellSize, gapOffset - 4));
+            gc.drawLine(QPoint(i * cellSize, gapOffset + 4), QPoint(i * cellSize, pageSize));
+            gc.drawLine(QPoint(0, i * cellSize), QPoint(pageSize, i * cellSize));
+        }
+
+        for (int y = 0; y < pageSize; y += cellSize) {
+            for (int x = 0; x < pageSize; x += cellSize) {
+                gc.drawEllipse(QRect(x + cellSize / 4, y + cellSize / 4, cellSize / 2, cellSize / 2));
+            }
+        }
+    }
+
+    KisPaintDeviceSP mainDev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    mainDev->convertFromQImage(lineArt, 0);
+
+    KisPaintDeviceSP filteredMainDev = KisPainter::convertToAlphaAsGray(mainDev);
+    KisLazyFillTools::normalizeAndInvertAlpha8Device(filteredMainDev, mainRect);
+
+    const KoColor strokeColor(Qt::black, KoColorSpaceRegistry::instance()->alpha8());
+    const QVector<QColor> colors({Qt::red, Qt::green, Qt::blue, Qt::yellow});
+
+    QVector<KisPaintDeviceSP> strokes;
+    for (int i = 0; i < colors.size() + 1; i++) {
+        strokes << new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
+    }
+
+    // a stroke inside every circle and in every cell around it, some
+    // of them are put into the "transparent" background stroke
+    int cellIndex = 0;
+    for (int y = 0; y < pageSize; y += cellSize) {
+        for (int x = 0; x < pageSize; x += cellSize, cellIndex++) {
+            strokes[cellIndex % colors.size()]->fill(QRect(x + cellSize / 2 - 10, y + cellSize / 2 - 10, 20, 20), strokeColor);
+            strokes[(cellIndex + 1) % (colors.size() + 1)]->fill(QRect(x + 16, y + 16, 20, 20), strokeColor);
+        }
+    }
+
+    KisPaintDeviceSP resultColoring = new KisPaintDevice(mainDev->colorSpace());
+
+    KisWatershedWorker worker(filteredMainDev, resultColoring, mainRect);
+
+    for (int i = 0; i < colors.size(); i++) {
+        worker.addKeyStroke(strokes[i], KoColor(colors[i], mainDev->colorSpace()));
+    }
+    worker.addKeyStroke(strokes.last(), KoColor(Qt::transparent, mainDev->colorSpace()));
+
+    QBENCHMARK_ONCE {
+        worker.run(0.7);
+    }
+
+    QVERIFY(!resultColoring->exactBounds().isEmpty());
+
+    // KIS_DUMP_DEVICE_2(resultColoring, mainRect, "00result", "dd");
+}
 
 QTEST_MAIN(KisLazyBrushTest)
@@ -40,6 +40,9 @@ private Q_SLOTS:
     void testEstimateTransparentPixels();
 
     void multiwayCutBenchmark();
+
+    void watershedBenchmark_data();
+    void watershedBenchmark();
 };
 
 #endif /* __KIS_LAZY_BRUSH_TEST_H */
@@ -19,6 +19,7 @@
 #include "kis_liquify_transform_worker_test.h"
 
 #include <QTest>
+#include <QtConcurrent>
 
 #include <KoColor.h>
 #include <KoProgressUpdater.h>
@@ -27,6 +28,7 @@
 #include <testutil.h>
 #include <kis_liquify_transform_worker.h>
 #include <kis_algebra_2d.h>
+#include <KisRunnableStrokeJobData.h>
 
 
 void KisLiquifyTransformWorkerTest::testPoints()
@@ -154,4 +156,145 @@ void KisLiquifyTransformWorkerTest::testIdentityTransform()
     TestUtil::checkQImage(result, "liquify_transform_test", "liquify_dev", "identity");
 }
 
+namespace {
+
+void applyTestDabs(KisLiquifyTransformWorker &worker, const QPointF &offset)
+{
+    worker.translatePoints(QPointF(100,100) + offset,
+                           QPointF(50, 0),
+                           50, false, 0.2);
+
+    worker.scalePoints(QPointF(400,300) + offset,
+                       0.5,
+                       50, false, 0.2);
+
+    worker.rotatePoints(QPointF(100,500) + offset,
+                        M_PI / 4,
+                        50, false, 0.2);
+}
+
+void runJobsConcurrently(QVector<KisRunnableStrokeJobDataBase*> &jobs)
+{
+    QtConcurrent::blockingMap(jobs, [] (KisRunnableStrokeJobDataBase *job) { job->run(); });
+    qDeleteAll(jobs);
+    jobs.clear();
+}
+
+KisPaintDeviceSP createTiledDevice(const QImage &image, int numTiles)
+{
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+    for (int row = 0; row < numTiles; row++) {
+        for (int col = 0; col < numTiles; col++) {
+            dev->convertFromQImage(image, 0, col * image.width(), row * image.height());
+        }
+    }
+
+    return dev;
+}
+
+}
+
+void KisLiquifyTransformWorkerTest::testConcurrentRun()
+{
+    QImage image(TestUtil::fetchDataFileLazy("test_transform_quality_second.png"));
+    KisPaintDeviceSP dev = createTiledDevice(image, 2);
+    KisPaintDeviceSP refDev = new KisPaintDevice(*dev);
+
+    KisLiquifyTransformWorker worker(dev->exactBounds(), 0, 8);
+
+    applyTestDabs(worker, QPointF());
+    applyTestDabs(worker, QPointF(image.width(), image.height()));
+
+    // make the transformed cells cross the patch borders
+    worker.translatePoints(QPointF(image.width(), image.height()),
+                           QPointF(-200, -200),
+                           100, false, 0.5);
+
+    worker.run(refDev);
+
+    QVector<KisRunnableStrokeJobDataBase*> jobs;
+    worker.createRunJobs(dev, jobs);
+    QVERIFY(jobs.size() > 1);
+
+    runJobsConcurrently(jobs);
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, dev, refDev));
+}
+
+void KisLiquifyTransformWorkerTest::testIncrementalQImageUpdate()
+{
+    QImage image(TestUtil::fetchDataFileLazy("test_transform_quality_second.png"));
+    image = image.convertToFormat(QImage::Format_ARGB32);
+
+    KisLiquifyTransformWorker worker(image.rect(), 0, 8);
+
+    const QTransform imageToThumbTransform = QTransform::fromScale(0.5, 0.5);
+    const QImage thumb = image.transformed(imageToThumbTransform);
+    const QPointF thumbOffset(10, 10);
+
+    applyTestDabs(worker, QPointF());
+
+    QPointF offset;
+    QImage result = worker.runOnQImage(thumb, thumbOffset, imageToThumbTransform, &offset);
+
+    // a dab well inside the image doesn't change the bounds of the preview
+    worker.translatePoints(QPointF(300, 250),
+                           QPointF(20, 10),
+                           30, false, 0.5);
+
+    worker.undoPoints(QPointF(120, 120), 0.5, 30);
+
+    QVERIFY(worker.updateQImage(thumb, thumbOffset, imageToThumbTransform, &result, offset));
+
+    KisLiquifyTransformWorker refWorker(worker);
+
+    // the copy of the worker doesn't track the changes until it is run once
+    QImage refResult = result;
+    QVERIFY(!refWorker.updateQImage(thumb, thumbOffset, imageToThumbTransform, &refResult, offset));
+
+    refResult = refWorker.runOnQImage(thumb, thumbOffset, imageToThumbTransform, &offset);
+
+    QCOMPARE(result, refResult);
+
+    // the dab moving the border of the grid makes the preview larger
+    worker.translatePoints(QPointF(0, 0),
+                           QPointF(-50, -50),
+                           30, false, 0.5);
+
+    QVERIFY(!worker.updateQImage(thumb, thumbOffset, imageToThumbTransform, &result, offset));
+}
+
+void KisLiquifyTransformWorkerTest::benchmarkRun()
+{
+    QImage image(TestUtil::fetchDataFileLazy("test_transform_quality_second.png"));
+    KisPaintDeviceSP srcDev = createTiledDevice(image, 4);
+
+    KisLiquifyTransformWorker worker(srcDev->exactBounds(), 0, 8);
+    applyTestDabs(worker, QPointF(image.width(), image.height()));
+
+    QBENCHMARK {
+        KisPaintDeviceSP dev = new KisPaintDevice(*srcDev);
+        worker.run(dev);
+    }
+}
+
+void KisLiquifyTransformWorkerTest::benchmarkRunConcurrently()
+{
+    QImage image(TestUtil::fetchDataFileLazy("test_transform_quality_second.png"));
+    KisPaintDeviceSP srcDev = createTiledDevice(image, 4);
+
+    KisLiquifyTransformWorker worker(srcDev->exactBounds(), 0, 8);
+    applyTestDabs(worker, QPointF(image.width(), image.height()));
+
+    QBENCHMARK {
+        KisPaintDeviceSP dev = new KisPaintDevice(*srcDev);
+
+        QVector<KisRunnableStrokeJobDataBase*> jobs;
+        worker.createRunJobs(dev, jobs);
+        runJobsConcurrently(jobs);
+    }
+}
+
 QTEST_MAIN(KisLiquifyTransformWorkerTest)
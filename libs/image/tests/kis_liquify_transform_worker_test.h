@@ -28,6 +28,11 @@ private Q_SLOTS:
     void testPoints();
     void testPointsQImage();
     void testIdentityTransform();
+    void testConcurrentRun();
+    void testIncrementalQImageUpdate();
+
+    void benchmarkRun();
+    void benchmarkRunConcurrently();
 };
 
 #endif /* __KIS_LIQUIFY_TRANSFORM_WORKER_TEST_H */
@@ -21,6 +21,7 @@
 #include <QTest>
 
 #include "kis_onion_skin_compositor.h"
+#include "kis_onion_skin_cache.h"
 #include "kis_paint_device.h"
 #include "kis_raster_keyframe_channel.h"
 #include "kis_image_animation_interface.h"
@@ -158,4 +159,106 @@ void KisOnionSkinCompositorTest::testSettings()
     QVERIFY(chk.checkDevice(compositeDevice, p.image, "02_single_skin_tinted"));
 }
 
+namespace {
+
+void setUpManySkins(TestUtil::MaskParent &p, int numFrames, int numSkins)
+{
+    KisImageConfig config(false);
+    config.setNumberOfOnionSkins(numSkins);
+    config.setOnionSkinTintFactor(64);
+    config.setOnionSkinTintColorBackward(Qt::blue);
+    config.setOnionSkinTintColorForward(Qt::red);
+    config.setOnionSkinState(0, true);
+    config.setOnionSkinOpacity(0, 255);
+
+    for (int i = 1; i <= numSkins; i++) {
+        config.setOnionSkinState(-i, true);
+        config.setOnionSkinState(i, true);
+        config.setOnionSkinOpacity(-i, 128);
+        config.setOnionSkinOpacity(i, 128);
+    }
+
+    KisOnionSkinCompositor::instance()->configChanged();
+
+    KisImageAnimationInterface *i = p.image->animationInterface();
+    KisPaintDeviceSP paintDevice = p.layer->paintDevice();
+    paintDevice->createKeyframeChannel(KoID());
+    KisKeyframeChannel *keyframes = paintDevice->keyframeChannel();
+
+    for (int frame = 0; frame < numFrames; frame++) {
+        keyframes->addKeyframe(frame);
+    }
+
+    for (int frame = 0; frame < numFrames; frame++) {
+        i->switchCurrentTimeAsync(frame);
+        p.image->waitForDone();
+
+        const QColor color = QColor::fromHsv(frame * 360 / numFrames, 255, 255);
+        paintDevice->fill(QRect(8 * frame, 8 * frame, 256, 256), KoColor(color, paintDevice->colorSpace()));
+    }
+}
+
+}
+
+void KisOnionSkinCompositorTest::testCachedProjection()
+{
+    TestUtil::MaskParent p;
+    setUpManySkins(p, 10, 3);
+
+    KisImageAnimationInterface *i = p.image->animationInterface();
+    KisPaintDeviceSP paintDevice = p.layer->paintDevice();
+    KisOnionSkinCompositor *compositor = KisOnionSkinCompositor::instance();
+
+    KisOnionSkinCache cache;
+
+    for (int frame = 0; frame < 10; frame++) {
+        i->switchCurrentTimeAsync(frame);
+        p.image->waitForDone();
+
+        // the changed frame is shown as a skin on the next iteration
+        paintDevice->fill(QRect(300, 10 * frame, 64, 32), KoColor(Qt::black, paintDevice->colorSpace()));
+        paintDevice->setDirty(QRect(300, 10 * frame, 64, 32));
+        cache.invalidate();
+
+        KisPaintDeviceSP cached = cache.projection(paintDevice);
+
+        KisPaintDeviceSP expected = new KisPaintDevice(paintDevice->colorSpace());
+        compositor->composite(paintDevice, expected, compositor->calculateExtent(paintDevice));
+
+        QImage cachedImage = cached->convertToQImage(0, p.image->bounds());
+        QImage expectedImage = expected->convertToQImage(0, p.image->bounds());
+
+        QPoint pt;
+        QVERIFY2(TestUtil::compareQImages(pt, expectedImage, cachedImage),
+                 QString("frame %1 differs at %2, %3").arg(frame).arg(pt.x()).arg(pt.y()).toLatin1());
+    }
+}
+
+void KisOnionSkinCompositorTest::benchmarkPaintWithManySkins()
+{
+    const int numFrames = 24;
+
+    TestUtil::MaskParent p;
+    setUpManySkins(p, numFrames, 10);
+
+    KisImageAnimationInterface *i = p.image->animationInterface();
+    KisPaintDeviceSP paintDevice = p.layer->paintDevice();
+
+    KisOnionSkinCache cache;
+
+    QBENCHMARK {
+        for (int frame = 0; frame < numFrames; frame++) {
+            i->switchCurrentTimeAsync(frame);
+            p.image->waitForDone();
+
+            const QRect dab(100 + frame, 100, 32, 32);
+            paintDevice->fill(dab, KoColor(Qt::black, paintDevice->colorSpace()));
+            paintDevice->setDirty(dab);
+
+            cache.invalidate();
+            cache.projection(paintDevice);
+        }
+    }
+}
+
 QTEST_MAIN(KisOnionSkinCompositorTest)
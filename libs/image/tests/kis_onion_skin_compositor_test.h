@@ -29,6 +29,9 @@ private Q_SLOTS:
 
     void testComposite();
     void testSettings();
+    void testCachedProjection();
+
+    void benchmarkPaintWithManySkins();
 };
 
 #endif
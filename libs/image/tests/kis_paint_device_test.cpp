@@ -1611,6 +1611,119 @@ void KisPaintDeviceTest::benchmarkLod4Generation()
     }
 }
 
+void checkLodPlane(KisPaintDeviceSP dev, TestingLodDefaultBounds *bounds, int lod, const QString &name)
+{
+    const KoColorSpace *cs = dev->colorSpace();
+    KisPaintDeviceSP ref = new KisPaintDevice(cs);
+    ref->setX(dev->x());
+    ref->setY(dev->y());
+
+    bounds->testingSetLevelOfDetail(0);
+    const QRect srcRect = dev->exactBounds();
+    if (!srcRect.isEmpty()) {
+        dev->generateLodCloneDevice(ref, srcRect, lod);
+    }
+
+    ref->setX(KisLodTransform::coordToLodCoord(dev->x(), lod));
+    ref->setY(KisLodTransform::coordToLodCoord(dev->y(), lod));
+
+    bounds->testingSetLevelOfDetail(lod);
+    syncLodCache(dev, lod);
+
+    const QRect rc = KisLodTransform::scaledRect(dev->defaultBounds()->bounds(), lod);
+
+    QPoint pt;
+    if (!TestUtil::compareQImages(pt,
+                                  ref->convertToQImage(0, rc),
+                                  dev->convertToQImage(0, rc))) {
+        QFAIL(QString("LoD plane differs from the reference, stage: %1, point: (%2, %3)")
+              .arg(name).arg(pt.x()).arg(pt.y()).toLatin1());
+    }
+}
+
+void KisPaintDeviceTest::testIncrementalLodSync()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    TestingLodDefaultBounds *bounds = new TestingLodDefaultBounds(QRect(0,0,1000,1000));
+    dev->setDefaultBounds(bounds);
+
+    fillGradientDevice(dev, QRect(100,100,600,600));
+    checkLodPlane(dev, bounds, 1, "initial");
+
+    // nothing changed
+    checkLodPlane(dev, bounds, 1, "unchanged");
+
+    // a small edit inside the existing tiles
+    bounds->testingSetLevelOfDetail(0);
+    dev->fill(QRect(300,300,17,9), KoColor(Qt::blue, cs));
+    checkLodPlane(dev, bounds, 1, "small-edit");
+
+    // an edit that creates new tiles
+    bounds->testingSetLevelOfDetail(0);
+    dev->fill(QRect(750,810,100,50), KoColor(Qt::green, cs));
+    checkLodPlane(dev, bounds, 1, "new-tiles");
+
+    // removing the tiles needs a full resync
+    bounds->testingSetLevelOfDetail(0);
+    dev->clear(QRect(0,0,1000,400));
+    checkLodPlane(dev, bounds, 1, "removed-tiles");
+
+    // different level of detail
+    bounds->testingSetLevelOfDetail(0);
+    dev->fill(QRect(500,500,31,31), KoColor(Qt::red, cs));
+    checkLodPlane(dev, bounds, 2, "lod2");
+
+    // moved device
+    bounds->testingSetLevelOfDetail(0);
+    dev->setX(13);
+    dev->setY(7);
+    checkLodPlane(dev, bounds, 2, "offset");
+}
+
+void KisPaintDeviceTest::benchmarkIncrementalLodSync()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect imageRect(0,0,4000,3000);
+    const int numDevices = 10;
+
+    TestingLodDefaultBounds *bounds = new TestingLodDefaultBounds(imageRect);
+    KisDefaultBoundsBaseSP boundsSP(bounds);
+
+    QVector<KisPaintDeviceSP> devices;
+    for (int i = 0; i < numDevices; i++) {
+        KisPaintDeviceSP dev = new KisPaintDevice(cs);
+        dev->setDefaultBounds(boundsSP);
+        fillGradientDevice(dev, imageRect, true);
+        devices << dev;
+    }
+
+    Q_FOREACH (KisPaintDeviceSP dev, devices) {
+        bounds->testingSetLevelOfDetail(1);
+        syncLodCache(dev, 1);
+    }
+
+    int step = 0;
+
+    /**
+     * Every iteration paints a small dab on one of the devices on
+     * LoD0 and then syncs the LoD planes of all the devices, like
+     * instant preview does before every LoD stroke.
+     */
+    QBENCHMARK {
+        bounds->testingSetLevelOfDetail(0);
+        devices[step % numDevices]->fill(QRect(100 + 37 * step % 3800, 100 + 23 * step % 2800, 50, 50),
+                                         KoColor(Qt::blue, cs));
+        step++;
+
+        bounds->testingSetLevelOfDetail(1);
+        Q_FOREACH (KisPaintDeviceSP dev, devices) {
+            syncLodCache(dev, 1);
+        }
+    }
+}
+
 #include "kis_keyframe_channel.h"
 #include "kis_raster_keyframe_channel.h"
 #include "kis_paint_device_frames_interface.h"
@@ -2210,6 +2323,137 @@ void KisPaintDeviceTest::testCopyPaintDeviceWithFrames()
     QVERIFY(channel->keyframeAt(10));
 }
 
+#include "tiles3/kis_tile_data_store.h"
+
+namespace {
+
+/**
+ * Writes a "pose" of a walk cycle: a figure that depends on the pose
+ * over a static background. Every call creates new tile data, the same
+ * way as loading the frames from separate files does.
+ */
+void writeWalkCyclePose(KisPaintDeviceSP dev, int pose)
+{
+    const QRect rc(0, 0, 512, 256);
+    const int pixelSize = dev->pixelSize();
+
+    QVector<quint8> buffer(rc.width() * rc.height() * pixelSize);
+    quint8 *ptr = buffer.data();
+
+    for (int y = 0; y < rc.height(); y++) {
+        for (int x = 0; x < rc.width(); x++) {
+            const bool isFigure = x < 256 && qAbs(x - 128 - 8 * pose) < 48;
+
+            ptr[0] = isFigure ? quint8(pose * 31) : quint8(x / 2);
+            ptr[1] = quint8(y);
+            ptr[2] = quint8((x / 2) ^ y);
+            ptr[3] = 255;
+
+            ptr += pixelSize;
+        }
+    }
+
+    dev->writeBytes(buffer.data(), rc);
+}
+
+}
+
+void KisPaintDeviceTest::testShareEqualFrameTiles()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    TestUtil::TestingTimedDefaultBounds *bounds = new TestUtil::TestingTimedDefaultBounds();
+    dev->setDefaultBounds(bounds);
+
+    KisRasterKeyframeChannel *channel = dev->createKeyframeChannel(KisKeyframeChannel::Raster);
+    KisPaintDeviceFramesInterface *i = dev->framesInterface();
+
+    channel->addKeyframe(1);
+    channel->addKeyframe(2);
+
+    // frames 0 and 2 are equal, but were written separately
+    bounds->testingSetTime(0);
+    writeWalkCyclePose(dev, 0);
+    bounds->testingSetTime(1);
+    writeWalkCyclePose(dev, 1);
+    bounds->testingSetTime(2);
+    writeWalkCyclePose(dev, 0);
+
+    const QRect rc(0, 0, 512, 256);
+    bounds->testingSetTime(0);
+    QImage refFrame0 = dev->convertToQImage(0, rc);
+    bounds->testingSetTime(1);
+    QImage refFrame1 = dev->convertToQImage(0, rc);
+
+    /**
+     * Every frame has 32 tiles. The 24 background tiles are equal in all
+     * three frames, the 8 figure tiles only in the frames 0 and 2.
+     */
+    QCOMPARE(i->shareEqualFrameTiles(), 24 * 2 + 8);
+
+    // the second pass has nothing to share
+    QCOMPARE(i->shareEqualFrameTiles(), 0);
+
+    QPoint pt;
+    bounds->testingSetTime(0);
+    QVERIFY(TestUtil::compareQImages(pt, refFrame0, dev->convertToQImage(0, rc)));
+    bounds->testingSetTime(1);
+    QVERIFY(TestUtil::compareQImages(pt, refFrame1, dev->convertToQImage(0, rc)));
+    bounds->testingSetTime(2);
+    QVERIFY(TestUtil::compareQImages(pt, refFrame0, dev->convertToQImage(0, rc)));
+
+    // the shared tiles are copied on write
+    dev->fill(rc, KoColor(Qt::black, cs));
+
+    bounds->testingSetTime(0);
+    QVERIFY(TestUtil::compareQImages(pt, refFrame0, dev->convertToQImage(0, rc)));
+    bounds->testingSetTime(1);
+    QVERIFY(TestUtil::compareQImages(pt, refFrame1, dev->convertToQImage(0, rc)));
+}
+
+void KisPaintDeviceTest::benchmarkWalkCycleFrameSharing()
+{
+    const int numPoses = 8;
+    const int numCycles = 6;
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    TestUtil::TestingTimedDefaultBounds *bounds = new TestUtil::TestingTimedDefaultBounds();
+    dev->setDefaultBounds(bounds);
+
+    KisRasterKeyframeChannel *channel = dev->createKeyframeChannel(KisKeyframeChannel::Raster);
+    KisPaintDeviceFramesInterface *i = dev->framesInterface();
+
+    for (int frame = 0; frame < numPoses * numCycles; frame++) {
+        if (frame > 0) {
+            channel->addKeyframe(frame);
+        }
+
+        bounds->testingSetTime(frame);
+        writeWalkCyclePose(dev, frame % numPoses);
+    }
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    const qint64 tilesBefore = store->numTilesInMemory();
+
+    int numSharedTiles = 0;
+
+    QBENCHMARK_ONCE {
+        numSharedTiles = i->shareEqualFrameTiles();
+    }
+
+    const qint64 tilesAfter = store->numTilesInMemory();
+
+    qDebug() << "Walk cycle of" << numPoses << "poses looped" << numCycles << "times";
+    qDebug() << "    shared tiles:" << numSharedTiles;
+    qDebug() << "    tiles in memory:" << tilesBefore << "->" << tilesAfter;
+
+    // all the loops after the first one are shared completely
+    QVERIFY(numSharedTiles >= numPoses * (numCycles - 1) * 32);
+}
+
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/stats.hpp>
 #include <boost/accumulators/statistics/variance.hpp>
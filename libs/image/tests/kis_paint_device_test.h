@@ -69,6 +69,8 @@ private Q_SLOTS:
     void benchmarkLod2Generation();
     void benchmarkLod3Generation();
     void benchmarkLod4Generation();
+    void testIncrementalLodSync();
+    void benchmarkIncrementalLodSync();
 
     void testFramesLeaking();
     void testFramesUndoRedo();
@@ -77,6 +79,8 @@ private Q_SLOTS:
     void testCrossDeviceFrameCopyChannel();
     void testLazyFrameCreation();
     void testCopyPaintDeviceWithFrames();
+    void testShareEqualFrameTiles();
+    void benchmarkWalkCycleFrameSharing();
 
     void testCompositionAssociativity();
 
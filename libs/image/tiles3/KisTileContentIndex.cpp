@@ -0,0 +1,83 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTileContentIndex.h"
+
+#include <cstring>
+#include <QHash>
+
+#include "kis_tile_data.h"
+
+
+KisTileContentIndex::KisTileContentIndex()
+{
+}
+
+KisTileContentIndex::~KisTileContentIndex()
+{
+    Q_FOREACH (KisTileData *td, m_tiles) {
+        td->deref();
+    }
+}
+
+KisTileData* KisTileContentIndex::findOrAdd(KisTileData *tileData)
+{
+    const quint32 pixelSize = tileData->pixelSize();
+    const size_t dataSize = pixelSize * KisTileData::WIDTH * KisTileData::HEIGHT;
+
+    tileData->blockSwapping();
+
+    const uint hash = qHashBits(tileData->data(), dataSize);
+    KisTileData *result = 0;
+
+    QMultiHash<uint, KisTileData*>::const_iterator it = m_tiles.constFind(hash);
+    for (; it != m_tiles.constEnd() && it.key() == hash; ++it) {
+        KisTileData *candidate = it.value();
+
+        if (candidate == tileData) {
+            result = tileData;
+            break;
+        }
+
+        if (candidate->pixelSize() != pixelSize) continue;
+
+        candidate->blockSwapping();
+        const bool isEqual = !memcmp(candidate->data(), tileData->data(), dataSize);
+        candidate->unblockSwapping();
+
+        if (isEqual) {
+            result = candidate;
+            break;
+        }
+    }
+
+    if (!result) {
+        tileData->ref();
+        m_tiles.insert(hash, tileData);
+        result = tileData;
+    }
+
+    tileData->unblockSwapping();
+
+    return result;
+}
+
+int KisTileContentIndex::size() const
+{
+    return m_tiles.size();
+}
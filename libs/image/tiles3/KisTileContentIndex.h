@@ -0,0 +1,59 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISTILECONTENTINDEX_H
+#define KISTILECONTENTINDEX_H
+
+#include <QMultiHash>
+#include "kritaimage_export.h"
+
+class KisTileData;
+
+
+/**
+ * A content-addressed index of tile data. It is used to find the tiles
+ * with equal content in several data managers, e.g. in the frames of an
+ * animated paint device, and make them share the same tile data in the
+ * copy-on-write manner.
+ *
+ * The index only refs the registered tile data, so the data can still be
+ * changed in place by its owner. That is why the index should live only
+ * during a single sharing pass and should be dropped right after that.
+ */
+class KRITAIMAGE_EXPORT KisTileContentIndex
+{
+public:
+    KisTileContentIndex();
+    ~KisTileContentIndex();
+
+    /**
+     * Returns the tile data with the same content as \p tileData
+     * registered earlier. If there is no such data, \p tileData is
+     * registered in the index and returned.
+     */
+    KisTileData* findOrAdd(KisTileData *tileData);
+
+    int size() const;
+
+private:
+    Q_DISABLE_COPY(KisTileContentIndex)
+
+    QMultiHash<uint, KisTileData*> m_tiles;
+};
+
+#endif /* KISTILECONTENTINDEX_H */
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISTILEDDATASOURCE_H
+#define KISTILEDDATASOURCE_H
+
+#include <QRect>
+#include <QSharedPointer>
+
+/**
+ * A source of pixel data for a KisTiledDataManager whose tiles are
+ * not stored, but produced on demand when they are read for the
+ * first time (see KisTiledDataManager::setDataSource()).
+ *
+ * All the coordinates are in the coordinate system of the data
+ * manager, that is, they do not include the offset of the paint
+ * device.
+ *
+ * The methods are called from the threads that access the data
+ * manager, possibly from several of them at once, so the
+ * implementation must be reentrant.
+ */
+class KisTiledDataSource
+{
+public:
+    virtual ~KisTiledDataSource() {}
+
+    /**
+     * Writes the pixels of \p rect into \p data, which is a buffer
+     * of rect.width() * rect.height() pixels with no gaps between
+     * the rows
+     */
+    virtual void readBytes(quint8 *data, const QRect &rect) = 0;
+
+    /**
+     * The area where the source may return pixels different from the
+     * default pixel of the data manager. Tiles outside the bounds are
+     * never requested from the source.
+     */
+    virtual QRect bounds() const = 0;
+};
+
+typedef QSharedPointer<KisTiledDataSource> KisTiledDataSourceSP;
+
+#endif // KISTILEDDATASOURCE_H
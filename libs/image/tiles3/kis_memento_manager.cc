@@ -189,6 +189,8 @@ void KisMementoManager::commit()
         }
     }
 
+    KisTileDataStore *store = KisTileDataStore::instance();
+
     KisMementoItemList revisionList;
     KisMementoItemSP mi;
     KisMementoItemSP parentMI;
@@ -202,6 +204,20 @@ void KisMementoManager::commit()
         mi->commit();
         revisionList.append(mi);
 
+        /**
+         * Tell the store which data replaced the previous revision
+         * of the tile, so that it could be used as a base for delta
+         * compression of the history
+         */
+        if (store->historyCompressionEnabled() &&
+            mi->type() == KisMementoItem::CHANGED &&
+            parentMI->type() == KisMementoItem::CHANGED &&
+            mi->tileData() && parentMI->tileData() &&
+            mi->tileData() != parentMI->tileData()) {
+
+            store->setNextRevision(parentMI->tileData(), mi->tileData());
+        }
+
         m_headsHashTable.deleteTile(mi->col(), mi->row());
 
         iter.moveCurrentToHashTable(&m_headsHashTable);
@@ -213,13 +229,26 @@ void KisMementoManager::commit()
     hItem.memento = m_currentMemento.data();
     m_revisions.append(hItem);
 
+    /**
+     * The revisions that went deep enough into history are not
+     * likely to be needed soon, let the swapper move them to disk
+     */
+    const int swapDepth = store->historySwapDepth();
+    if (swapDepth > 0 && m_revisions.size() > swapDepth) {
+        Q_FOREACH (mi, m_revisions[m_revisions.size() - 1 - swapDepth].itemList) {
+            if (mi->type() == KisMementoItem::CHANGED && mi->tileData()) {
+                store->markColdHistory(mi->tileData());
+            }
+        }
+    }
+
     m_currentMemento = 0;
     KIS_ASSERT(m_index.isEmpty());
 
     DEBUG_DUMP_MESSAGE("COMMIT_DONE");
 
     // Waking up pooler to prepare copies for us
-    KisTileDataStore::instance()->kickPooler();
+    store->kickPooler();
 }
 
 KisTileSP KisMementoManager::getCommitedTile(qint32 col, qint32 row, bool &existingTile)
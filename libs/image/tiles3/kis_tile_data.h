@@ -66,6 +66,15 @@ inline bool KisTileData::acquire() {
 
 inline bool KisTileData::release() {
     m_usersCount.deref();
+
+    /**
+     * When all the users except the memento manager are gone,
+     * the tile data can be compressed by the swapper
+     */
+    if (historical() && m_store->historyCompressionEnabled()) {
+        m_store->addHistoryCandidate(this);
+    }
+
     bool _ref = deref();
     return _ref;
 }
@@ -115,8 +124,19 @@ inline void KisTileData::setMementoed(bool value) {
     m_mementoFlag += value ? 1 : -1;
 }
 
+inline bool KisTileData::coldHistory() const {
+    return m_coldHistoryFlag.loadAcquire();
+}
+inline void KisTileData::markColdHistory() {
+    m_coldHistoryFlag.storeRelease(1);
+}
+
 inline bool KisTileData::historical() const {
-    return mementoed() && numUsers() <= 1;
+    const qint32 deltaUsers = m_deltaUsersCount.loadAcquire();
+    const qint32 regularUsers = numUsers() - deltaUsers;
+
+    return (mementoed() && regularUsers <= 1) ||
+        (deltaUsers > 0 && regularUsers <= 0);
 }
 
 inline int KisTileData::age() const {
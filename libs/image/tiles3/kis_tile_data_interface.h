@@ -171,6 +171,14 @@ public:
     inline bool mementoed() const;
     inline void setMementoed(bool value);
 
+    /**
+     * Marks the tile data as a part of history that is older than
+     * the configured number of undo steps. When such tile data is
+     * compressed, it is moved to the swap file.
+     */
+    inline bool coldHistory() const;
+    inline void markColdHistory();
+
     /**
      * Controlling methods for setting 'age' marks
      */
@@ -188,7 +196,9 @@ public:
      * Convenience method. Returns true iff the tile data is linked to
      * information only and therefore can be swapped out easily.
      *
-     * Effectively equivalent to: (mementoed() && numUsers() <= 1)
+     * Effectively equivalent to: (mementoed() && numUsers() <= 1),
+     * with the users that only keep the tile data as a base for delta
+     * compression of other tiles excluded.
      */
     inline bool historical() const;
 
@@ -274,6 +284,36 @@ private:
      */
     qint32 m_mementoFlag;
 
+    /**
+     * \see coldHistory()
+     */
+    QAtomicInt m_coldHistoryFlag;
+
+    /**
+     * The tile data that replaced this one in some revision of
+     * history. It is referenced (not acquired!) and is used as a
+     * reference for delta compression, when this tile data becomes
+     * historical. Guarded by the store.
+     */
+    KisTileData *m_nextRevision = 0;
+
+    /**
+     * The number of compressed tile datas, whose content is stored
+     * as a delta against this tile data. Each of them also holds
+     * one of m_usersCount, which guarantees the content is never
+     * changed, but these users should not prevent the tile data
+     * itself from being considered historical.
+     */
+    QAtomicInt m_deltaUsersCount;
+
+    /**
+     * The lists of the history compression candidates this tile data
+     * is present in, a combination of KisTileDataStore::HistoryListFlag.
+     * Modified under the store lock only, but can be read without it
+     * to avoid taking the lock for the tile datas that are not listed.
+     */
+    QAtomicInt m_historyListFlags;
+
     /**
      * Counts up time after last access to the tile data.
      * 0 - recently accessed
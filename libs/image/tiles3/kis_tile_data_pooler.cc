@@ -124,7 +124,7 @@ void KisTileDataPooler::terminatePooler()
 qint32 KisTileDataPooler::numClonesNeeded(KisTileData *td) const
 {
     RUNTIME_SANITY_CHECK(td);
-    qint32 numUsers = td->m_usersCount;
+    qint32 numUsers = td->m_usersCount - td->m_deltaUsersCount;
     qint32 numPresentClones = td->m_clonesStack.size();
     qint32 totalClones = qMin(numUsers - 1, MAX_NUM_CLONES);
 
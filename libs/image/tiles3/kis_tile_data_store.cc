@@ -27,6 +27,7 @@
 #include "kis_debug.h"
 
 #include "kis_tile_data_store_iterators.h"
+#include "kis_image_config.h"
 
 Q_GLOBAL_STATIC(KisTileDataStore, s_instance)
 
@@ -73,8 +74,12 @@ KisTileDataStore::KisTileDataStore()
       m_numTiles(0),
       m_memoryMetric(0),
       m_counter(1),
-      m_clockIndex(1)
+      m_clockIndex(1),
+      m_historyCompressionEnabled(true),
+      m_historySwapDepth(0)
 {
+    readHistoryConfig();
+
     m_pooler.start();
     m_swapper.start();
 }
@@ -110,11 +115,12 @@ KisTileDataStore::MemoryStatistics KisTileDataStore::memoryStatistics()
 
     const qint64 metricCoeff = qint64(KisTileData::WIDTH) * KisTileData::HEIGHT;
 
+    stats.compressedHistorySize = m_swappedStore.compressedHistorySize();
     stats.realMemorySize = m_pooler.lastRealMemoryMetric() * metricCoeff;
-    stats.historicalMemorySize = m_pooler.lastHistoricalMemoryMetric() * metricCoeff;
+    stats.historicalMemorySize = m_pooler.lastHistoricalMemoryMetric() * metricCoeff + stats.compressedHistorySize;
     stats.poolSize = m_pooler.lastPoolMemoryMetric() * metricCoeff;
 
-    stats.totalMemorySize = memoryMetric() * metricCoeff + stats.poolSize;
+    stats.totalMemorySize = memoryMetric() * metricCoeff + stats.poolSize + stats.compressedHistorySize;
 
     stats.swapSize = m_swappedStore.totalMemoryMetric() * metricCoeff;
 
@@ -203,10 +209,15 @@ void KisTileDataStore::freeTileData(KisTileData *td)
 
     DEBUG_FREE_ACTION(td);
 
+    forgetHistoryCandidate(td);
+
+    KisTileData *deltaBase = 0;
+
     m_iteratorLock.lockForRead();
     td->m_swapLock.lockForWrite();
 
     if (!td->data()) {
+        deltaBase = m_swappedStore.deltaBase(td);
         m_swappedStore.forgetTileData(td);
     } else {
         unregisterTileDataImp(td);
@@ -215,7 +226,60 @@ void KisTileDataStore::freeTileData(KisTileData *td)
     td->m_swapLock.unlock();
     m_iteratorLock.unlock();
 
+    KisTileData *nextRevision = takeNextRevision(td);
+
     delete td;
+
+    /**
+     * Releasing can cause recursive freeing of the tile datas,
+     * so we should do that without any locks held
+     */
+    if (deltaBase) {
+        releaseDeltaBase(deltaBase);
+    }
+
+    if (nextRevision) {
+        nextRevision->deref();
+    }
+}
+
+void KisTileDataStore::swapInTileDataImp(KisTileData *td, QVector<KisTileData*> &releasedDeltaBases)
+{
+    /**
+     * This function is called with m_iteratorLock and td->m_swapLock
+     * acquired in write mode
+     */
+
+    KisTileData *base = m_swappedStore.deltaBase(td);
+
+    /**
+     * The base of the delta might have been compressed or swapped
+     * out itself, so load it first. The bases always refer to the
+     * tile datas that are in memory at the moment of compression,
+     * so the chain cannot be cyclic.
+     */
+    if (base && !base->data()) {
+        base->m_swapLock.lockForWrite();
+        swapInTileDataImp(base, releasedDeltaBases);
+        base->m_swapLock.unlock();
+    }
+
+    m_swappedStore.swapInTileData(td);
+    registerTileDataImp(td);
+
+    if (m_historyCompressionEnabled && td->historical()) {
+        addHistoryCandidate(td);
+    }
+
+    if (base) {
+        releasedDeltaBases.append(base);
+    }
+}
+
+void KisTileDataStore::releaseDeltaBase(KisTileData *base)
+{
+    base->m_deltaUsersCount.deref();
+    base->release();
 }
 
 void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
@@ -247,17 +311,20 @@ void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
          * m_listLock.
          */
 
+        QVector<KisTileData*> releasedDeltaBases;
+
         if (!td->data()) {
             td->m_swapLock.lockForWrite();
-
-            m_swappedStore.swapInTileData(td);
-            registerTileDataImp(td);
-
+            swapInTileDataImp(td, releasedDeltaBases);
             td->m_swapLock.unlock();
         }
 
         m_iteratorLock.unlock();
 
+        Q_FOREACH (KisTileData *base, releasedDeltaBases) {
+            releaseDeltaBase(base);
+        }
+
         /**
          * <-- In theory, livelock is possible here...
          */
@@ -286,6 +353,192 @@ bool KisTileDataStore::trySwapTileData(KisTileData *td)
     return result;
 }
 
+bool KisTileDataStore::tryCompressTileData(KisTileData *td, QVector<KisTileData*> &unusedRevisions)
+{
+    /**
+     * This function is called with m_iteratorLock acquired
+     */
+
+    bool result = false;
+    if (!td->m_swapLock.tryLockForWrite()) return result;
+
+    if (td->data()) {
+        KisTileData *base = takeNextRevision(td);
+        bool useBase = false;
+
+        if (base) {
+            unusedRevisions.append(base);
+
+            /**
+             * The base should be in memory, and no one should be
+             * writing into it at the moment. After we acquire it,
+             * all the writers will have to do COW, so its content
+             * will never change.
+             */
+            if (base->data() &&
+                base->pixelSize() == td->pixelSize() &&
+                base->m_swapLock.tryLockForWrite()) {
+
+                base->acquire();
+                base->m_deltaUsersCount.ref();
+                useBase = true;
+            }
+        }
+
+        m_swappedStore.compressTileData(td, useBase ? base : 0);
+        unregisterTileDataImp(td);
+        result = true;
+
+        if (td->coldHistory()) {
+            m_swappedStore.swapOutCompressedTileData(td);
+        }
+
+        if (useBase) {
+            base->m_swapLock.unlock();
+        }
+    }
+    td->m_swapLock.unlock();
+
+    return result;
+}
+
+void KisTileDataStore::compressHistory()
+{
+    QVector<KisTileData*> unusedRevisions;
+
+    {
+        QWriteLocker l(&m_iteratorLock);
+        QMutexLocker candidatesLocker(&m_historyCandidatesLock);
+
+        /**
+         * The history that has already been compressed is moved into
+         * the swap file as soon as it becomes cold. The rest of it
+         * is moved right after compression.
+         */
+        Q_FOREACH (KisTileData *td, m_coldHistoryCandidates) {
+            if (!td->data()) {
+                m_swappedStore.swapOutCompressedTileData(td);
+            }
+            td->m_historyListFlags.storeRelease(td->m_historyListFlags.loadAcquire() & ~ColdHistoryCandidate);
+        }
+        m_coldHistoryCandidates.clear();
+
+        QSet<KisTileData*>::iterator it = m_historyCandidates.begin();
+
+        while (it != m_historyCandidates.end()) {
+            KisTileData *td = *it;
+            bool keepCandidate = false;
+
+            /**
+             * The historical tiles are compressed when they are not
+             * accessed for two cycles in a row, that is, the tiles that
+             * are still being accessed by undo/redo are left untouched.
+             *
+             * The tile datas that are not historical anymore are dropped
+             * from the list, they will be added back when released.
+             */
+            if (td->data() && td->historical()) {
+                if (td->age() > 0) {
+                    keepCandidate = !tryCompressTileData(td, unusedRevisions);
+                } else {
+                    td->markOld();
+                    keepCandidate = true;
+                }
+            }
+
+            if (keepCandidate) {
+                ++it;
+            } else {
+                td->m_historyListFlags.storeRelease(td->m_historyListFlags.loadAcquire() & ~HistoryCandidate);
+                it = m_historyCandidates.erase(it);
+            }
+        }
+    }
+
+    Q_FOREACH (KisTileData *td, unusedRevisions) {
+        td->deref();
+    }
+}
+
+qint64 KisTileDataStore::swapOutCompressedHistory(qint64 needToFreeMetric)
+{
+    const qint64 metricCoeff = qint64(KisTileData::WIDTH) * KisTileData::HEIGHT;
+
+    QWriteLocker l(&m_iteratorLock);
+    return m_swappedStore.swapOutCompressedHistory(needToFreeMetric * metricCoeff) / metricCoeff;
+}
+
+qint64 KisTileDataStore::compressedHistoryMetric() const
+{
+    return m_swappedStore.compressedHistorySize() / (KisTileData::WIDTH * KisTileData::HEIGHT);
+}
+
+void KisTileDataStore::addHistoryCandidate(KisTileData *td)
+{
+    QMutexLocker l(&m_historyCandidatesLock);
+
+    m_historyCandidates.insert(td);
+    td->m_historyListFlags.storeRelease(td->m_historyListFlags.loadAcquire() | HistoryCandidate);
+}
+
+void KisTileDataStore::markColdHistory(KisTileData *td)
+{
+    td->markColdHistory();
+
+    QMutexLocker l(&m_historyCandidatesLock);
+
+    m_coldHistoryCandidates.insert(td);
+    td->m_historyListFlags.storeRelease(td->m_historyListFlags.loadAcquire() | ColdHistoryCandidate);
+}
+
+void KisTileDataStore::forgetHistoryCandidate(KisTileData *td)
+{
+    /**
+     * No one can add the tile data into the lists while it is being
+     * freed, so it is safe to check the flags without the lock
+     */
+    if (!td->m_historyListFlags.loadAcquire()) return;
+
+    QMutexLocker l(&m_historyCandidatesLock);
+
+    m_historyCandidates.remove(td);
+    m_coldHistoryCandidates.remove(td);
+    td->m_historyListFlags.storeRelease(0);
+}
+
+void KisTileDataStore::setNextRevision(KisTileData *td, KisTileData *nextRevision)
+{
+    KisTileData *oldRevision = 0;
+
+    nextRevision->ref();
+
+    {
+        QMutexLocker l(&m_nextRevisionLock);
+        oldRevision = td->m_nextRevision;
+        td->m_nextRevision = nextRevision;
+    }
+
+    if (oldRevision) {
+        oldRevision->deref();
+    }
+}
+
+KisTileData* KisTileDataStore::takeNextRevision(KisTileData *td)
+{
+    QMutexLocker l(&m_nextRevisionLock);
+
+    KisTileData *nextRevision = td->m_nextRevision;
+    td->m_nextRevision = 0;
+    return nextRevision;
+}
+
+void KisTileDataStore::readHistoryConfig()
+{
+    KisImageConfig config(true);
+    m_historyCompressionEnabled = config.compressUndoHistory();
+    m_historySwapDepth = config.undoHistorySwapDepth();
+}
+
 KisTileDataStoreIterator* KisTileDataStore::beginIteration()
 {
     m_iteratorLock.lockForWrite();
@@ -364,6 +617,12 @@ void KisTileDataStore::debugClear()
         iter.next();
     }
 
+    {
+        QMutexLocker candidatesLocker(&m_historyCandidatesLock);
+        m_historyCandidates.clear();
+        m_coldHistoryCandidates.clear();
+    }
+
     m_counter = 1;
     m_clockIndex = 1;
     m_numTiles = 0;
@@ -372,6 +631,7 @@ void KisTileDataStore::debugClear()
 
 void KisTileDataStore::testingRereadConfig()
 {
+    readHistoryConfig();
     m_pooler.testingRereadConfig();
     m_swapper.testingRereadConfig();
     kickPooler();
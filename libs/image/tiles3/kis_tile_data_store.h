@@ -23,6 +23,8 @@
 #include "kritaimage_export.h"
 
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QSet>
 #include "kis_tile_data_interface.h"
 
 #include "kis_tile_data_pooler.h"
@@ -51,6 +53,12 @@ public:
         qint64 realMemorySize;
         qint64 historicalMemorySize;
 
+        /**
+         * The part of historicalMemorySize occupied
+         * by the compressed history
+         */
+        qint64 compressedHistorySize;
+
         qint64 poolSize;
 
         qint64 swapSize;
@@ -88,6 +96,13 @@ public:
         return m_memoryMetric.loadAcquire();
     }
 
+    /**
+     * The metric of the memory occupied by the compressed history.
+     * It is not a part of memoryMetric(), but should be accounted
+     * by the swapper when checking the memory limits.
+     */
+    qint64 compressedHistoryMetric() const;
+
     KisTileDataStoreIterator* beginIteration();
     void endIteration(KisTileDataStoreIterator* iterator);
 
@@ -118,6 +133,55 @@ public:
      */
     bool trySwapTileData(KisTileData *td);
 
+    /**
+     * Compresses the historical tile datas that have not been accessed
+     * since the previous call and moves the compressed history older
+     * than historySwapDepth() undo steps into the swap file. Only the
+     * tile datas registered with addHistoryCandidate() are checked.
+     */
+    void compressHistory();
+
+    /**
+     * Moves the compressed history into the swap file until at
+     * least \p needToFreeMetric of memory is released.
+     * Returns the metric of the released memory.
+     */
+    qint64 swapOutCompressedHistory(qint64 needToFreeMetric);
+
+    /**
+     * Tells the store that \p td might have become historical,
+     * that is, the memento manager might be its only user now
+     */
+    void addHistoryCandidate(KisTileData *td);
+
+    /**
+     * Marks \p td as a part of history that is older than
+     * historySwapDepth() undo steps. Its compressed data will
+     * be moved into the swap file.
+     */
+    void markColdHistory(KisTileData *td);
+
+    /**
+     * Tells the store that \p nextRevision replaced \p td in the
+     * history of some paint device. Called by the Memento Manager on
+     * every commit.
+     */
+    void setNextRevision(KisTileData *td, KisTileData *nextRevision);
+
+    inline bool historyCompressionEnabled() const
+    {
+        return m_historyCompressionEnabled;
+    }
+
+    /**
+     * The number of undo steps after which the compressed history
+     * is moved into the swap file, zero if it should stay in memory
+     */
+    inline int historySwapDepth() const
+    {
+        return m_historySwapDepth;
+    }
+
 
     /**
      * WARN: The following three method are only for usage
@@ -150,6 +214,13 @@ private:
     inline void unregisterTileDataImp(KisTileData *td);
     void freeRegisteredTiles();
 
+    bool tryCompressTileData(KisTileData *td, QVector<KisTileData*> &unusedRevisions);
+    void forgetHistoryCandidate(KisTileData *td);
+    void swapInTileDataImp(KisTileData *td, QVector<KisTileData*> &releasedDeltaBases);
+    static void releaseDeltaBase(KisTileData *base);
+    KisTileData* takeNextRevision(KisTileData *td);
+    void readHistoryConfig();
+
     friend class DeadlockyThread;
     friend class KisLowMemoryTests;
     void debugSwapAll();
@@ -180,6 +251,26 @@ private:
     QAtomicInt m_clockIndex;
     ConcurrentMap<int, KisTileData*> m_tileDataMap;
     QReadWriteLock m_iteratorLock;
+
+    QMutex m_nextRevisionLock;
+
+    enum HistoryListFlag {
+        HistoryCandidate = 0x1,
+        ColdHistoryCandidate = 0x2
+    };
+
+    /**
+     * The tile datas that might have gone down into history since the
+     * last compression cycle, so the swapper doesn't need to walk
+     * through all the tile datas in the store. Guarded by
+     * m_historyCandidatesLock.
+     */
+    QSet<KisTileData*> m_historyCandidates;
+    QSet<KisTileData*> m_coldHistoryCandidates;
+    QMutex m_historyCandidatesLock;
+
+    bool m_historyCompressionEnabled;
+    int m_historySwapDepth;
 };
 
 template<typename T>
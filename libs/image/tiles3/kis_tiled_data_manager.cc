@@ -20,11 +20,16 @@
 
 #include <QRect>
 #include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QSet>
 
 #include "kis_tile.h"
 #include "kis_tiled_data_manager.h"
 #include "kis_tile_data_wrapper.h"
 #include "kis_tiled_data_manager_p.h"
+#include "KisTileContentIndex.h"
 #include "kis_memento_manager.h"
 #include "swap/kis_legacy_tile_compressor.h"
 #include "swap/kis_tile_compressor_factory.h"
@@ -34,6 +39,61 @@
 #include "kis_global.h"
 
 
+struct KisTiledDataManager::DataSourceState
+{
+    static inline quint64 tileKey(qint32 col, qint32 row) {
+        return (quint64(quint32(col)) << 32) | quint32(row);
+    }
+
+    static inline qint32 keyCol(quint64 key) {
+        return qint32(quint32(key >> 32));
+    }
+
+    static inline qint32 keyRow(quint64 key) {
+        return qint32(quint32(key & 0xFFFFFFFF));
+    }
+
+    void resetCache() {
+        cachedTilesQueue.clear();
+        cachedTiles.clear();
+        generation++;
+    }
+
+    QMutex mutex;
+    KisTiledDataSourceSP source;
+    int maxCachedTiles = -1;
+
+    /**
+     * Incremented every time the source is replaced or its tiles are
+     * invalidated. A tile that was being generated at that moment may
+     * be stale, so it is generated again.
+     */
+    quint64 generation = 0;
+
+    bool isSourceTile(qint32 col, qint32 row) const {
+        if (!source) return false;
+
+        const QRect tileRect(col * KisTileData::WIDTH, row * KisTileData::HEIGHT,
+                             KisTileData::WIDTH, KisTileData::HEIGHT);
+        return source->bounds().intersects(tileRect);
+    }
+
+    bool uncacheTile(quint64 key) {
+        if (!cachedTiles.remove(key)) return false;
+        cachedTilesQueue.removeOne(key);
+        return true;
+    }
+
+    /**
+     * The tiles that were read from the source and may be dropped
+     * again, in the order of their creation. The tiles that were
+     * accessed for writing are removed from the cache, so they are
+     * never dropped.
+     */
+    QQueue<quint64> cachedTilesQueue;
+    QSet<quint64> cachedTiles;
+};
+
 /* The data area is divided into tiles each say 64x64 pixels (defined at compiletime)
  * The tiles are laid out in a matrix that can have negative indexes.
  * The matrix grows automatically if needed (a call for writeacces to a tile
@@ -75,6 +135,19 @@ KisTiledDataManager::KisTiledDataManager(const KisTiledDataManager &dm)
      * has already been made shared in m_hashTable(dm->m_hashTable)
      */
     memcpy(m_defaultPixel, dm.m_defaultPixel, m_pixelSize);
+
+    KisTiledDataSourceSP source = dm.dataSource();
+    if (source) {
+        /**
+         * The copied tiles are not added to the cache, the copy
+         * owns them just like normal tiles
+         */
+        DataSourceState *state = new DataSourceState();
+        state->source = source;
+        state->maxCachedTiles = dm.m_sourceState.loadAcquire()->maxCachedTiles;
+        m_sourceState.storeRelease(state);
+    }
+
     recalculateExtent();
 }
 
@@ -92,6 +165,7 @@ KisTiledDataManager::~KisTiledDataManager()
     delete m_mementoManager;
 
     delete[] m_defaultPixel;
+    delete m_sourceState.loadAcquire();
 }
 
 void KisTiledDataManager::setDefaultPixel(const quint8 *defaultPixel)
@@ -274,6 +348,14 @@ wrongString:
 
 void KisTiledDataManager::purge(const QRect& area)
 {
+    /**
+     * A deleted tile inside the bounds of the data source would be
+     * generated again with the content of the source, so such tiles
+     * are kept even when they are empty
+     */
+    KisTiledDataSourceSP source = dataSource();
+    const QRect sourceBounds = source ? source->bounds() : QRect();
+
     QList<KisTileSP> tilesToDelete;
     {
         const qint32 tileDataSize = KisTileData::HEIGHT * KisTileData::WIDTH * pixelSize();
@@ -285,7 +367,9 @@ void KisTiledDataManager::purge(const QRect& area)
         KisTileSP tile;
 
         while ((tile = iter.tile())) {
-            if (tile->extent().intersects(area)) {
+            if (tile->extent().intersects(area) &&
+                !tile->extent().intersects(sourceBounds)) {
+
                 tile->lockForRead();
                 if(memcmp(defaultData, tile->data(), tileDataSize) == 0) {
                     tilesToDelete.push_back(tile);
@@ -339,7 +423,7 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
     }
 
     if (pixelBytesAreDefault) {
-        clearRect &= m_extentManager.extent();
+        clearRect &= extent();
     }
 
     qint32 firstColumn = xToCol(clearRect.left());
@@ -373,19 +457,13 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
 
             if (clearTileRect == tileRect) {
                  // Clear whole tile
-                 const bool wasDeleted =
-                     m_hashTable->deleteTile(column, row);
-
-                 if (wasDeleted) {
-                     m_extentManager.notifyTileRemoved(column, row);
-                 }
-
+                 KisTileSP clearedTile;
 
                  if (!pixelBytesAreDefault) {
-                     KisTileSP clearedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
-                     m_hashTable->addTile(clearedTile);
-                     m_extentManager.notifyTileAdded(column, row);
+                     clearedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
                  }
+
+                 replaceTile(column, row, clearedTile);
             } else {
                 const qint32 lineSize = clearTileRect.width() * pixelSize;
                 qint32 rowsRemaining = clearTileRect.height();
@@ -436,10 +514,225 @@ void KisTiledDataManager::clear(qint32 x, qint32 y, qint32 w, qint32 h, quint8 c
 
 void KisTiledDataManager::clear()
 {
+    DataSourceState *state = m_sourceState.loadAcquire();
+    if (state) {
+        QMutexLocker l(&state->mutex);
+        state->source.clear();
+        state->resetCache();
+    }
+
+    m_hashTable->clear();
+    m_extentManager.clear();
+}
+
+void KisTiledDataManager::setDataSource(KisTiledDataSourceSP source, int maxCachedTiles)
+{
+    DataSourceState *state = m_sourceState.loadAcquire();
+
+    if (!state) {
+        if (!source) return;
+
+        DataSourceState *newState = new DataSourceState();
+        if (!m_sourceState.testAndSetOrdered(0, newState)) {
+            delete newState;
+        }
+        state = m_sourceState.loadAcquire();
+    }
+
+    {
+        QMutexLocker l(&state->mutex);
+        state->source = source;
+        state->maxCachedTiles = maxCachedTiles;
+        state->resetCache();
+    }
+
     m_hashTable->clear();
     m_extentManager.clear();
 }
 
+KisTiledDataSourceSP KisTiledDataManager::dataSource() const
+{
+    DataSourceState *state = m_sourceState.loadAcquire();
+    if (!state) return KisTiledDataSourceSP();
+
+    QMutexLocker l(&state->mutex);
+    return state->source;
+}
+
+void KisTiledDataManager::invalidateDataSourceTiles(const QRect &rect)
+{
+    DataSourceState *state = m_sourceState.loadAcquire();
+    if (!state || rect.isEmpty()) return;
+
+    const qint32 firstCol = xToCol(rect.left());
+    const qint32 firstRow = yToRow(rect.top());
+    const qint32 lastCol = xToCol(rect.right());
+    const qint32 lastRow = yToRow(rect.bottom());
+
+    QMutexLocker l(&state->mutex);
+
+    state->generation++;
+
+    auto it = state->cachedTilesQueue.begin();
+    while (it != state->cachedTilesQueue.end()) {
+        const qint32 col = DataSourceState::keyCol(*it);
+        const qint32 row = DataSourceState::keyRow(*it);
+
+        if (col >= firstCol && col <= lastCol &&
+            row >= firstRow && row <= lastRow) {
+
+            if (m_hashTable->deleteTile(col, row)) {
+                m_extentManager.notifyTileRemoved(col, row);
+            }
+            state->cachedTiles.remove(*it);
+            it = state->cachedTilesQueue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+KisTileSP KisTiledDataManager::fetchSourceTile(qint32 col, qint32 row, bool writable)
+{
+    DataSourceState *state = m_sourceState.loadAcquire();
+    const quint64 key = DataSourceState::tileKey(col, row);
+
+    KisTileSP tile = m_hashTable->getExistingTile(col, row);
+
+    if (tile) {
+        if (!writable) return tile;
+
+        QMutexLocker l(&state->mutex);
+
+        /**
+         * A cached tile could have been evicted from the hash table
+         * after we fetched it, and the data written into it would be
+         * lost. So only return the tile if it is still in the table,
+         * otherwise generate it again.
+         */
+        if (m_hashTable->getExistingTile(col, row) == tile) {
+            if (state->uncacheTile(key)) {
+                tile->notifyAttachedToDataManager(m_mementoManager);
+            }
+            return tile;
+        }
+
+        tile = 0;
+    }
+
+    const QRect tileRect(col * KisTileData::WIDTH, row * KisTileData::HEIGHT,
+                         KisTileData::WIDTH, KisTileData::HEIGHT);
+
+    while (true) {
+        KisTiledDataSourceSP source;
+        quint64 generation = 0;
+        {
+            QMutexLocker l(&state->mutex);
+            source = state->source;
+            generation = state->generation;
+        }
+
+        if (!source) return KisTileSP();
+        if (!source->bounds().intersects(tileRect)) return KisTileSP();
+
+        /**
+         * The source is read without holding the lock, so several threads
+         * may generate the same tile at once. Only the first of them gets
+         * into the hash table.
+         */
+        KisTileData *defaultTileData = m_hashTable->refAndFetchDefaultTileData();
+        KisTileSP newTile = new KisTile(col, row, defaultTileData, 0);
+        defaultTileData->deref();
+
+        newTile->lockForWrite();
+        source->readBytes(newTile->data(), tileRect);
+        newTile->unlockForWrite();
+
+        QMutexLocker l(&state->mutex);
+
+        /**
+         * The tile could have been created by another thread or
+         * written by a bitBlt in the meantime
+         */
+        tile = m_hashTable->getExistingTile(col, row);
+        if (tile) {
+            if (writable && state->uncacheTile(key)) {
+                tile->notifyAttachedToDataManager(m_mementoManager);
+            }
+            return tile;
+        }
+
+        /**
+         * The source could have been replaced or invalidated while we
+         * were reading it, then the generated tile may be outdated
+         */
+        if (state->generation != generation) continue;
+
+        tile = newTile;
+        m_hashTable->addTile(tile);
+        m_extentManager.notifyTileAdded(col, row);
+
+        if (writable) {
+            tile->notifyAttachedToDataManager(m_mementoManager);
+            return tile;
+        }
+
+        state->cachedTilesQueue.enqueue(key);
+        state->cachedTiles.insert(key);
+
+        while (state->maxCachedTiles >= 0 &&
+               state->cachedTilesQueue.size() > state->maxCachedTiles) {
+
+            const quint64 oldKey = state->cachedTilesQueue.dequeue();
+            state->cachedTiles.remove(oldKey);
+
+            const qint32 oldCol = DataSourceState::keyCol(oldKey);
+            const qint32 oldRow = DataSourceState::keyRow(oldKey);
+
+            if (m_hashTable->deleteTile(oldCol, oldRow)) {
+                m_extentManager.notifyTileRemoved(oldCol, oldRow);
+            }
+        }
+
+        return tile;
+    }
+}
+
+void KisTiledDataManager::replaceTile(qint32 col, qint32 row, KisTileSP newTile)
+{
+    DataSourceState *state = m_sourceState.loadAcquire();
+
+    /**
+     * The source cache must forget the replaced tile, otherwise it
+     * would drop the new one later. The tiles that the source can
+     * produce are never just deleted, because the source would
+     * bring their old content back on the next access.
+     */
+    QMutexLocker l(state ? &state->mutex : 0);
+
+    if (state) {
+        state->uncacheTile(DataSourceState::tileKey(col, row));
+
+        if (!newTile && state->isSourceTile(col, row)) {
+            KisTileData *defaultTileData = m_hashTable->refAndFetchDefaultTileData();
+            newTile = new KisTile(col, row, defaultTileData, m_mementoManager);
+            defaultTileData->deref();
+        }
+    }
+
+    const bool wasDeleted = m_hashTable->deleteTile(col, row);
+
+    if (newTile) {
+        m_hashTable->addTile(newTile);
+
+        if (!wasDeleted) {
+            m_extentManager.notifyTileAdded(col, row);
+        }
+    } else if (wasDeleted) {
+        m_extentManager.notifyTileRemoved(col, row);
+    }
+}
+
 
 template<bool useOldSrcData>
 void KisTiledDataManager::bitBltImpl(KisTiledDataManager *srcDM, const QRect &rect)
@@ -474,24 +767,17 @@ void KisTiledDataManager::bitBltImpl(KisTiledDataManager *srcDM, const QRect &re
 
             if (cloneTileRect == tileRect) {
                  // Clone whole tile
-                 const bool wasDeleted =
-                     m_hashTable->deleteTile(column, row);
+                 KisTileSP clonedTile;
 
                  if (srcTileExists || !defaultPixelsCoincide) {
                      srcTile->lockForRead();
                      KisTileData *td = srcTile->tileData();
-                     KisTileSP clonedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
+                     clonedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
                      srcTile->unlockForRead();
-
-                     m_hashTable->addTile(clonedTile);
-
-                     if (!wasDeleted) {
-                         m_extentManager.notifyTileAdded(column, row);
-                     }
-                 } else if (wasDeleted) {
-                     m_extentManager.notifyTileRemoved(column, row);
                  }
 
+                 replaceTile(column, row, clonedTile);
+
             } else {
                 const qint32 lineSize = cloneTileRect.width() * pixelSize;
                 qint32 rowsRemaining = cloneTileRect.height();
@@ -548,23 +834,16 @@ void KisTiledDataManager::bitBltRoughImpl(KisTiledDataManager *srcDM, const QRec
                 srcDM->getOldTile(column, row, srcTileExists) :
                 srcDM->getReadOnlyTileLazy(column, row, srcTileExists);
 
-            const bool wasDeleted =
-                m_hashTable->deleteTile(column, row);
+            KisTileSP clonedTile;
 
             if (srcTileExists || !defaultPixelsCoincide) {
                 srcTile->lockForRead();
                 KisTileData *td = srcTile->tileData();
-                KisTileSP clonedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
+                clonedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
                 srcTile->unlockForRead();
-
-                m_hashTable->addTile(clonedTile);
-
-                if (!wasDeleted) {
-                    m_extentManager.notifyTileAdded(column, row);
-                }
-            } else if (wasDeleted) {
-                m_extentManager.notifyTileRemoved(column, row);
             }
+
+            replaceTile(column, row, clonedTile);
         }
     }
 }
@@ -669,24 +948,127 @@ void KisTiledDataManager::extent(qint32 &x, qint32 &y, qint32 &w, qint32 &h) con
 
 QRect KisTiledDataManager::extent() const
 {
-    return m_extentManager.extent();
+    KisTiledDataSourceSP source = dataSource();
+    return source ? source->bounds() | m_extentManager.extent() : m_extentManager.extent();
 }
 
 KisRegion KisTiledDataManager::region() const
 {
     QVector<QRect> rects;
 
+    /**
+     * All the tiles the source can produce are considered existing,
+     * even if they are not cached at the moment
+     */
+    QRect sourceRect;
+    KisTiledDataSourceSP source = dataSource();
+    if (source && !source->bounds().isEmpty()) {
+        const QRect bounds = source->bounds();
+        const QPoint topLeft(xToCol(bounds.left()) * KisTileData::WIDTH,
+                             yToRow(bounds.top()) * KisTileData::HEIGHT);
+        const QPoint bottomRight((xToCol(bounds.right()) + 1) * KisTileData::WIDTH - 1,
+                                 (yToRow(bounds.bottom()) + 1) * KisTileData::HEIGHT - 1);
+        sourceRect = QRect(topLeft, bottomRight);
+        rects << sourceRect;
+    }
+
     KisTileHashTableConstIterator iter(m_hashTable);
     KisTileSP tile;
 
     while ((tile = iter.tile())) {
-        rects << tile->extent();
+        if (!sourceRect.contains(tile->extent())) {
+            rects << tile->extent();
+        }
         iter.next();
     }
 
     return KisRegion(std::move(rects));
 }
 
+bool KisTiledDataManager::collectChangedTiles(KisTiledDataManager *snapshot, QVector<QRect> *changedTiles) const
+{
+    KisTileData *defaultTileData = m_hashTable->refAndFetchDefaultTileData();
+    KisTileData *snapshotDefaultTileData = snapshot->m_hashTable->refAndFetchDefaultTileData();
+    const bool defaultPixelChanged = defaultTileData != snapshotDefaultTileData;
+    defaultTileData->deref();
+    snapshotDefaultTileData->deref();
+
+    if (defaultPixelChanged) return false;
+
+    /**
+     * Writing into a shared tile clones its tile data, so the tiles
+     * that still share the data with the snapshot are unchanged.
+     */
+    qint32 numMatchedTiles = 0;
+
+    KisTileHashTableConstIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        KisTileSP snapshotTile = snapshot->m_hashTable->getExistingTile(tile->col(), tile->row());
+
+        if (snapshotTile) {
+            numMatchedTiles++;
+        }
+
+        if (!snapshotTile || snapshotTile->tileData() != tile->tileData()) {
+            *changedTiles << tile->extent();
+        }
+
+        iter.next();
+    }
+
+    return numMatchedTiles == snapshot->m_hashTable->numTiles();
+}
+
+qint32 KisTiledDataManager::shareEqualTiles(KisTileContentIndex *index)
+{
+    QWriteLocker locker(&m_lock);
+
+    QVector<KisTileSP> sharedTiles;
+
+    {
+        /**
+         * The tiles cached from the data source are skipped. They are
+         * dropped soon anyway, and sharing would pin them in memory.
+         */
+        DataSourceState *state = m_sourceState.loadAcquire();
+        QMutexLocker l(state ? &state->mutex : 0);
+
+        KisTileHashTableConstIterator iter(m_hashTable);
+        KisTileSP tile;
+
+        while ((tile = iter.tile())) {
+            if (state && state->cachedTiles.contains(DataSourceState::tileKey(tile->col(), tile->row()))) {
+                iter.next();
+                continue;
+            }
+
+            tile->lockForRead();
+            KisTileData *td = tile->tileData();
+            tile->unlockForRead();
+
+            KisTileData *sharedTd = index->findOrAdd(td);
+
+            if (sharedTd != td) {
+                sharedTiles << KisTileSP(new KisTile(tile->col(), tile->row(), sharedTd, m_mementoManager));
+            }
+
+            iter.next();
+        }
+    }
+
+    /**
+     * The replaced tiles are at the same positions, so the extent
+     * does not change
+     */
+    Q_FOREACH (KisTileSP tile, sharedTiles) {
+        replaceTile(tile->col(), tile->row(), tile);
+    }
+
+    return sharedTiles.size();
+}
+
 void KisTiledDataManager::setPixel(qint32 x, qint32 y, const quint8 * data)
 {
     KisTileDataWrapper tw(this, x, y, KisTileDataWrapper::WRITE);
@@ -21,6 +21,7 @@
 
 #include <QtGlobal>
 #include <QVector>
+#include <QAtomicPointer>
 #include <KisRegion.h>
 
 #include <kis_shared.h>
@@ -39,6 +40,7 @@
 #include "kis_memento_manager.h"
 #include "kis_memento.h"
 #include "KisTiledExtentManager.h"
+#include "KisTiledDataSource.h"
 
 class KisTiledDataManager;
 typedef KisSharedPtr<KisTiledDataManager> KisTiledDataManagerSP;
@@ -46,6 +48,7 @@ typedef KisSharedPtr<KisTiledDataManager> KisTiledDataManagerSP;
 class KisTiledIterator;
 class KisTiledRandomAccessor;
 class KisPaintDeviceWriter;
+class KisTileContentIndex;
 class QIODevice;
 
 /**
@@ -115,6 +118,11 @@ public:
     }
 
     inline KisTileSP getTile(qint32 col, qint32 row, bool writable) {
+        if (m_sourceState.loadAcquire()) {
+            KisTileSP tile = fetchSourceTile(col, row, writable);
+            if (tile) return tile;
+        }
+
         if (writable) {
             bool newTile;
             KisTileSP tile = m_hashTable->getTileLazy(col, row, newTile);
@@ -130,6 +138,14 @@ public:
     }
 
     inline KisTileSP getReadOnlyTileLazy(qint32 col, qint32 row, bool &existingTile) {
+        if (m_sourceState.loadAcquire()) {
+            KisTileSP tile = fetchSourceTile(col, row, false);
+            if (tile) {
+                existingTile = true;
+                return tile;
+            }
+        }
+
         return m_hashTable->getReadOnlyTileLazy(col, row, existingTile);
     }
 
@@ -204,6 +220,35 @@ public:
 
     static void releaseInternalPools();
 
+    /**
+     * Makes the data manager produce its tiles on demand from \p source
+     * instead of storing them. A tile inside source->bounds() is read
+     * from the source the first time it is accessed and is kept in a
+     * cache of at most \p maxCachedTiles tiles (-1 means unbounded);
+     * the oldest cached tiles are dropped when the cache overflows and
+     * will be read from the source again when needed.
+     *
+     * A tile that is accessed for writing is never dropped, so writing
+     * into such a data manager works as usual, though it is not what
+     * the sources are supposed to be used for.
+     *
+     * All the tiles of the data manager are removed. Passing a null
+     * \p source turns the data manager back into a normal one. clear()
+     * detaches the source as well.
+     *
+     * Copies of the data manager share the source, but keep all the
+     * tiles they have copied.
+     */
+    void setDataSource(KisTiledDataSourceSP source, int maxCachedTiles = -1);
+    KisTiledDataSourceSP dataSource() const;
+
+    /**
+     * Drops the cached tiles intersecting \p rect, so that they are
+     * read from the data source again on the next access. Does nothing
+     * if there is no data source attached.
+     */
+    void invalidateDataSourceTiles(const QRect &rect);
+
 protected:
     /**
      * Reads and writes the tiles 
@@ -228,6 +273,34 @@ public:
 
     KisRegion region() const;
 
+    /**
+     * Compares the tiles of this data manager with the tiles of \p
+     * snapshot, which is supposed to be a copy-on-write copy of this
+     * data manager made some time ago. The extents of the tiles that
+     * were created or written to since then are appended to \p
+     * changedTiles.
+     *
+     * @return false if the difference cannot be expressed as a set of
+     *         changed tiles, that is, some tiles were removed or the
+     *         default pixel was changed. \p changedTiles is incomplete
+     *         in such a case.
+     */
+    bool collectChangedTiles(KisTiledDataManager *snapshot, QVector<QRect> *changedTiles) const;
+
+    /**
+     * Makes the tiles of this data manager share the tile data with the
+     * tiles of equal content registered in \p index earlier, and registers
+     * the rest of the tiles in \p index. The content of the data manager
+     * stays the same.
+     *
+     * The replaced tiles are registered in the memento manager as changed,
+     * so it should be used only on the data that has no undo history yet,
+     * e.g. right after it has been loaded.
+     *
+     * @return the number of tiles that started sharing their data
+     */
+    qint32 shareEqualTiles(KisTileContentIndex *index);
+
     void clear(QRect clearRect, quint8 clearValue);
     void clear(QRect clearRect, const quint8 *clearPixel);
     void clear(qint32 x, qint32 y, qint32 w, qint32 h, quint8 clearValue);
@@ -352,6 +425,14 @@ private:
 
     mutable QReadWriteLock m_lock;
 
+    struct DataSourceState;
+    /**
+     * Created when a data source is attached for the first time and
+     * kept until destruction, so that the tile fetching functions can
+     * check it without locking
+     */
+    QAtomicPointer<DataSourceState> m_sourceState;
+
 private:
     // Allow compression routines to calculate (col,row) coordinates
     // and pixel size
@@ -370,6 +451,15 @@ private:
 
     void recalculateExtent();
 
+    KisTileSP fetchSourceTile(qint32 col, qint32 row, bool writable);
+
+    /**
+     * Replaces the tile at (col, row) with \p newTile, or deletes it
+     * when \p newTile is null. Keeps the extent and the cache of the
+     * data source in sync.
+     */
+    void replaceTile(qint32 col, qint32 row, KisTileSP newTile);
+
     quint8* duplicatePixel(qint32 num, const quint8 *pixel);
 
     template<bool useOldSrcData>
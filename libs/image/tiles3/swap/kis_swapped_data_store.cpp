@@ -25,8 +25,29 @@
 
 //#define COMPRESSOR_VERSION 2
 
+namespace {
+
+void applyDelta(quint8 *data, const quint8 *base, qint32 size)
+{
+    /**
+     * The size of the tile data is always a multiple of 8, and the
+     * data is allocated with, at least, 8-byte alignment
+     */
+    quint64 *dst = reinterpret_cast<quint64*>(data);
+    const quint64 *src = reinterpret_cast<const quint64*>(base);
+    const qint32 numWords = size / 8;
+
+    for (qint32 i = 0; i < numWords; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+}
+
 KisSwappedDataStore::KisSwappedDataStore()
-    : m_memoryMetric(0)
+    : m_memoryMetric(0),
+      m_numCompressedTiles(0),
+      m_compressedHistorySize(0)
 {
     KisImageConfig config(true);
     const quint64 maxSwapSize = config.maxSwapSize() * MiB;
@@ -52,7 +73,7 @@ quint64 KisSwappedDataStore::numTiles() const
     // We are not acquiring the lock here...
     // Hope QLinkedList will ensure atomic access to it's size...
 
-    return m_allocator->numChunks();
+    return m_allocator->numChunks() + m_numCompressedTiles.loadAcquire();
 }
 
 bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
@@ -89,6 +110,43 @@ bool KisSwappedDataStore::trySwapOutTileData(KisTileData *td)
     return true;
 }
 
+void KisSwappedDataStore::compressTileData(KisTileData *td, KisTileData *deltaBase)
+{
+    Q_ASSERT(td->data());
+    QMutexLocker locker(&m_lock);
+
+    // see comment in swapOutTileData()
+
+    const qint32 tileDataSize = td->pixelSize() * KisTileData::WIDTH * KisTileData::HEIGHT;
+
+    if (deltaBase) {
+        Q_ASSERT(deltaBase->data());
+        Q_ASSERT(deltaBase->pixelSize() == td->pixelSize());
+
+        applyDelta(td->data(), deltaBase->data(), tileDataSize);
+        m_deltaBases.insert(td, deltaBase);
+    }
+
+    const qint32 expectedBufferSize = m_compressor->tileDataBufferSize(td);
+    if(m_buffer.size() < expectedBufferSize)
+        m_buffer.resize(expectedBufferSize);
+
+    qint32 bytesWritten;
+    m_compressor->compressTileData(td, (quint8*) m_buffer.data(), m_buffer.size(), bytesWritten);
+
+    m_compressedHistory.insert(td, QByteArray(m_buffer.constData(), bytesWritten));
+    m_compressedHistorySize += bytesWritten;
+    m_numCompressedTiles.ref();
+
+    td->releaseMemory();
+}
+
+KisTileData* KisSwappedDataStore::deltaBase(KisTileData *td)
+{
+    QMutexLocker locker(&m_lock);
+    return m_deltaBases.value(td, 0);
+}
+
 void KisSwappedDataStore::swapInTileData(KisTileData *td)
 {
     Q_ASSERT(!td->data());
@@ -96,27 +154,122 @@ void KisSwappedDataStore::swapInTileData(KisTileData *td)
 
     // see comment in swapOutTileData()
 
-    KisChunk chunk = td->swapChunk();
+    QHash<KisTileData*, QByteArray>::iterator it = m_compressedHistory.find(td);
 
     td->allocateMemory();
-    td->setSwapChunk(KisChunk());
 
-    quint8 *ptr = m_swapSpace->getReadChunkPtr(chunk);
-    Q_ASSERT(ptr);
-    m_compressor->decompressTileData(ptr, chunk.size(), td);
-    m_allocator->freeChunk(chunk);
+    if (it != m_compressedHistory.end()) {
+        m_compressor->decompressTileData((quint8*) it.value().data(), it.value().size(), td);
 
-    m_memoryMetric -= td->pixelSize();
+        m_compressedHistorySize -= it.value().size();
+        m_numCompressedTiles.deref();
+        m_compressedHistory.erase(it);
+    } else {
+        KisChunk chunk = td->swapChunk();
+        td->setSwapChunk(KisChunk());
+
+        quint8 *ptr = m_swapSpace->getReadChunkPtr(chunk);
+        Q_ASSERT(ptr);
+        m_compressor->decompressTileData(ptr, chunk.size(), td);
+        m_allocator->freeChunk(chunk);
+
+        m_memoryMetric -= td->pixelSize();
+    }
+
+    KisTileData *base = m_deltaBases.take(td);
+    if (base) {
+        Q_ASSERT(base->data());
+        applyDelta(td->data(), base->data(), td->pixelSize() * KisTileData::WIDTH * KisTileData::HEIGHT);
+    }
 }
 
 void KisSwappedDataStore::forgetTileData(KisTileData *td)
 {
     QMutexLocker locker(&m_lock);
 
-    m_allocator->freeChunk(td->swapChunk());
-    td->setSwapChunk(KisChunk());
+    m_deltaBases.remove(td);
 
-    m_memoryMetric -= td->pixelSize();
+    QHash<KisTileData*, QByteArray>::iterator it = m_compressedHistory.find(td);
+
+    if (it != m_compressedHistory.end()) {
+        m_compressedHistorySize -= it.value().size();
+        m_numCompressedTiles.deref();
+        m_compressedHistory.erase(it);
+    } else {
+        m_allocator->freeChunk(td->swapChunk());
+        td->setSwapChunk(KisChunk());
+
+        m_memoryMetric -= td->pixelSize();
+    }
+}
+
+bool KisSwappedDataStore::swapOutCompressedTileData(KisTileData *td)
+{
+    QMutexLocker locker(&m_lock);
+
+    QHash<KisTileData*, QByteArray>::iterator it = m_compressedHistory.find(td);
+    if (it == m_compressedHistory.end()) return false;
+
+    return swapOutCompressedTileDataImp(it) > 0;
+}
+
+qint64 KisSwappedDataStore::swapOutCompressedHistory(qint64 needToFreeBytes)
+{
+    QMutexLocker locker(&m_lock);
+
+    qint64 freedBytes = 0;
+
+    /**
+     * First, move the history that is marked as cold, and only
+     * then the rest of it
+     */
+    for (int pass = 0; pass < 2; pass++) {
+        QHash<KisTileData*, QByteArray>::iterator it = m_compressedHistory.begin();
+
+        while (it != m_compressedHistory.end() && freedBytes < needToFreeBytes) {
+            if (!pass && !it.key()->coldHistory()) {
+                ++it;
+                continue;
+            }
+
+            const qint64 bytes = swapOutCompressedTileDataImp(it);
+            if (!bytes) return freedBytes;
+
+            freedBytes += bytes;
+        }
+    }
+
+    return freedBytes;
+}
+
+qint64 KisSwappedDataStore::swapOutCompressedTileDataImp(QHash<KisTileData*, QByteArray>::iterator &it)
+{
+    /**
+     * This function is called with m_lock held
+     */
+
+    KisTileData *td = it.key();
+    const QByteArray &compressedData = it.value();
+    const qint64 bytes = compressedData.size();
+
+    KisChunk chunk = m_allocator->getChunk(compressedData.size());
+    quint8 *ptr = m_swapSpace->getWriteChunkPtr(chunk);
+    if (!ptr) {
+        qWarning() << "swap out of compressed history failed";
+        m_allocator->freeChunk(chunk);
+        ++it;
+        return 0;
+    }
+    memcpy(ptr, compressedData.constData(), compressedData.size());
+
+    td->setSwapChunk(chunk);
+    m_memoryMetric += td->pixelSize();
+
+    m_compressedHistorySize -= bytes;
+    m_numCompressedTiles.deref();
+    it = m_compressedHistory.erase(it);
+
+    return bytes;
 }
 
 qint64 KisSwappedDataStore::totalMemoryMetric() const
@@ -124,6 +277,11 @@ qint64 KisSwappedDataStore::totalMemoryMetric() const
     return m_memoryMetric;
 }
 
+qint64 KisSwappedDataStore::compressedHistorySize() const
+{
+    return m_compressedHistorySize;
+}
+
 void KisSwappedDataStore::debugStatistics()
 {
     m_allocator->sanityCheck();
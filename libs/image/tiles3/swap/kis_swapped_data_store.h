@@ -23,6 +23,8 @@
 
 #include <QMutex>
 #include <QByteArray>
+#include <QHash>
+#include <QAtomicInt>
 
 
 class QMutex;
@@ -50,9 +52,32 @@ public:
      */
     bool trySwapOutTileData(KisTileData *td);
 
+    /**
+     * Compress the data stored in the \a td and keep it in memory,
+     * freeing the memory occupied by td->data(). Used for the tile
+     * data that went down into history.
+     *
+     * If \a deltaBase is not null, only the difference (XOR) between
+     * the two tile datas is stored, which is almost empty in case
+     * the tile has been changed partially. The caller must guarantee
+     * that the content of \a deltaBase is not changed and that it is
+     * kept alive until the data is swapped in or forgotten.
+     *
+     * LOCKING: the lock on the tile data should be taken
+     *          by the caller before making a call.
+     */
+    void compressTileData(KisTileData *td, KisTileData *deltaBase);
+
+    /**
+     * Returns the tile data, \a td is stored as a delta against,
+     * or null if it is stored as is. The base must be loaded before
+     * calling swapInTileData().
+     */
+    KisTileData* deltaBase(KisTileData *td);
+
     /**
      * Restore the data of a \a td basing on information
-     * stored in the swap file.
+     * stored in the swap file or in the compressed history.
      * LOCKING: the lock on the tile data should be taken
      *          by the caller before making a call.
      */
@@ -65,17 +90,45 @@ public:
      */
     void forgetTileData(KisTileData *td);
 
+    /**
+     * Moves the compressed data of \a td into the swap file.
+     * Returns false if \a td is not stored in the compressed history
+     * or the swap file is full.
+     * LOCKING: no one should be able to swap in or forget \a td
+     *          while the function is running
+     */
+    bool swapOutCompressedTileData(KisTileData *td);
+
+    /**
+     * Moves the compressed history into the swap file until at
+     * least \a needToFreeBytes bytes of memory are released. The tile
+     * datas marked with KisTileData::markColdHistory() go first.
+     * Returns the number of bytes released.
+     * LOCKING: no one should be able to swap in or forget tile
+     *          datas while the function is running
+     */
+    qint64 swapOutCompressedHistory(qint64 needToFreeBytes);
+
     /**
      * Retorns the metric of the total memory stored in the swap
      * in *uncompressed* form!
      */
     qint64 totalMemoryMetric() const;
 
+    /**
+     * Returns the number of bytes occupied in memory by compressed
+     * history
+     */
+    qint64 compressedHistorySize() const;
+
     /**
      * Some debugging output
      */
     void debugStatistics();
 
+private:
+    qint64 swapOutCompressedTileDataImp(QHash<KisTileData*, QByteArray>::iterator &it);
+
 private:
     QByteArray m_buffer;
     KisAbstractTileCompressor *m_compressor;
@@ -86,6 +139,11 @@ private:
     QMutex m_lock;
 
     qint64 m_memoryMetric;
+
+    QHash<KisTileData*, QByteArray> m_compressedHistory;
+    QHash<KisTileData*, KisTileData*> m_deltaBases;
+    QAtomicInt m_numCompressedTiles;
+    qint64 m_compressedHistorySize;
 };
 
 #endif /* __KIS_SWAPPED_DATA_STORE_H */
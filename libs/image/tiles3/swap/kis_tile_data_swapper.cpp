@@ -103,7 +103,8 @@ void KisTileDataSwapper::run()
 void KisTileDataSwapper::checkFreeMemory()
 {
 //    dbgKrita <<"check memory: high limit -" << m_d->limits.emergencyThreshold() <<"in mem -" << m_d->store->numTilesInMemory();
-    if(m_d->store->memoryMetric() > m_d->limits.emergencyThreshold())
+    if(m_d->store->memoryMetric() + m_d->store->compressedHistoryMetric() >
+       m_d->limits.emergencyThreshold())
         doJob();
 }
 
@@ -115,7 +116,11 @@ void KisTileDataSwapper::doJob()
      */
     QMutexLocker locker(&m_d->cycleLock);
 
-    qint32 memoryMetric = m_d->store->memoryMetric();
+    /**
+     * The compressed history is not a part of the store's memory
+     * metric, but it still occupies memory, so it must be accounted
+     */
+    qint32 memoryMetric = m_d->store->memoryMetric() + m_d->store->compressedHistoryMetric();
 
     DEBUG_ACTION("Started swap cycle");
     DEBUG_VALUE(m_d->store->numTiles());
@@ -125,14 +130,33 @@ void KisTileDataSwapper::doJob()
     DEBUG_VALUE(m_d->limits.softLimitThreshold());
     DEBUG_VALUE(m_d->limits.hardLimitThreshold());
 
+    if (m_d->store->historyCompressionEnabled()) {
+        DEBUG_ACTION("\t compress history");
+        m_d->store->compressHistory();
+        memoryMetric = m_d->store->memoryMetric() + m_d->store->compressedHistoryMetric();
+        DEBUG_VALUE(memoryMetric);
+    }
 
     if(memoryMetric > m_d->limits.softLimitThreshold()) {
         qint32 softFree =  memoryMetric - m_d->limits.softLimit();
         DEBUG_VALUE(softFree);
-        DEBUG_ACTION("\t pass0");
-        memoryMetric -= pass<SoftSwapStrategy>(softFree);
+
+        /**
+         * The compressed history is the cheapest thing to move out,
+         * it needs no compression anymore
+         */
+        DEBUG_ACTION("\t spill compressed history");
+        const qint32 historyFreed = m_d->store->swapOutCompressedHistory(softFree);
+        memoryMetric -= historyFreed;
+        softFree -= historyFreed;
         DEBUG_VALUE(memoryMetric);
 
+        if (softFree > 0) {
+            DEBUG_ACTION("\t pass0");
+            memoryMetric -= pass<SoftSwapStrategy>(softFree);
+            DEBUG_VALUE(memoryMetric);
+        }
+
         if(memoryMetric > m_d->limits.hardLimitThreshold()) {
             qint32 hardFree =  memoryMetric - m_d->limits.hardLimit();
             DEBUG_VALUE(hardFree);
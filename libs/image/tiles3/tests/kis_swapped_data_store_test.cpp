@@ -131,5 +131,102 @@ void KisSwappedDataStoreTest::testRandomAccess()
         delete tileDataList[i];
 }
 
+void KisSwappedDataStoreTest::testCompressedHistory()
+{
+    const qint32 pixelSize = 1;
+    const quint8 defaultPixel = 128;
+    const qint32 NUM_TILES = 100;
+    const qint32 ROWSIZE = KisTileData::WIDTH;
+
+    KisImageConfig config(false);
+    config.setMaxSwapSize(4);
+    config.setSwapSlabSize(1);
+    config.setSwapWindowSize(1);
+
+
+    KisSwappedDataStore store;
+
+    KisTileData *base = new KisTileData(pixelSize, &defaultPixel, KisTileDataStore::instance());
+    memset(base->data(), 10, TILESIZE);
+
+    QList<KisTileData*> tileDataList;
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = new KisTileData(pixelSize, &defaultPixel, KisTileDataStore::instance());
+
+        // the history revision differs from the base in one row only
+        memset(td->data(), 10, TILESIZE);
+        memset(td->data() + (i % KisTileData::HEIGHT) * ROWSIZE, COLUMN2COLOR(i), ROWSIZE);
+
+        tileDataList.append(td);
+    }
+
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = tileDataList[i];
+
+        // FIXME: take a lock of the tile data
+        store.compressTileData(td, i % 2 ? base : 0);
+        QVERIFY(!td->data());
+        QCOMPARE(store.deltaBase(td), i % 2 ? base : 0);
+    }
+
+    QCOMPARE(store.numTiles(), quint64(NUM_TILES));
+    QCOMPARE(store.totalMemoryMetric(), qint64(0));
+    QVERIFY(store.compressedHistorySize() > 0);
+    QVERIFY(store.compressedHistorySize() < NUM_TILES * TILESIZE / 10);
+
+    // the base is not changed by the compression
+    QVERIFY(memoryIsFilled(10, base->data(), TILESIZE));
+
+    // move the first half of the history into the swap file
+    const qint64 compressedSize = store.compressedHistorySize();
+
+    for(qint32 i = 0; i < NUM_TILES / 2; i++) {
+        QVERIFY(store.swapOutCompressedTileData(tileDataList[i]));
+    }
+
+    // the data is not in the compressed history anymore
+    QVERIFY(!store.swapOutCompressedTileData(tileDataList[0]));
+
+    QCOMPARE(store.numTiles(), quint64(NUM_TILES));
+    QCOMPARE(store.totalMemoryMetric(), qint64(NUM_TILES / 2 * pixelSize));
+    QVERIFY(store.compressedHistorySize() < compressedSize);
+
+    // the cold history is the first to go under memory pressure
+    tileDataList[NUM_TILES - 1]->markColdHistory();
+
+    const qint64 halfCompressedSize = store.compressedHistorySize();
+    const qint64 freedBytes = store.swapOutCompressedHistory(1);
+
+    QVERIFY(freedBytes > 0);
+    QCOMPARE(store.compressedHistorySize(), halfCompressedSize - freedBytes);
+    QCOMPARE(store.totalMemoryMetric(), qint64((NUM_TILES / 2 + 1) * pixelSize));
+    QVERIFY(!store.swapOutCompressedTileData(tileDataList[NUM_TILES - 1]));
+
+    for(qint32 i = 0; i < NUM_TILES; i++) {
+        KisTileData *td = tileDataList[i];
+        QVERIFY(!td->data());
+
+        // FIXME: take a lock of the tile data
+        store.swapInTileData(td);
+        QVERIFY(!store.deltaBase(td));
+
+        const qint32 changedRow = i % KisTileData::HEIGHT;
+
+        QVERIFY(memoryIsFilled(10, td->data(), changedRow * ROWSIZE));
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(i), td->data() + changedRow * ROWSIZE, ROWSIZE));
+        QVERIFY(memoryIsFilled(10, td->data() + (changedRow + 1) * ROWSIZE,
+                               TILESIZE - (changedRow + 1) * ROWSIZE));
+    }
+
+    QCOMPARE(store.numTiles(), quint64(0));
+    QCOMPARE(store.totalMemoryMetric(), qint64(0));
+    QCOMPARE(store.compressedHistorySize(), qint64(0));
+
+    for(qint32 i = 0; i < NUM_TILES; i++)
+        delete tileDataList[i];
+
+    delete base;
+}
+
 QTEST_MAIN(KisSwappedDataStoreTest)
 
@@ -188,5 +188,81 @@ void KisTileDataStoreTest::testSwapping()
     }
 }
 
+QByteArray readDataManager(KisTiledDataManager &dm, const QRect &rect)
+{
+    QByteArray buffer(rect.width() * rect.height(), 0);
+    dm.readBytes((quint8*)buffer.data(), rect.x(), rect.y(), rect.width(), rect.height());
+    return buffer;
+}
+
+void KisTileDataStoreTest::testCompressedHistoryRoundTrip()
+{
+    KisImageConfig config(false);
+    config.setCompressUndoHistory(true);
+    config.setUndoHistorySwapDepth(2);
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->debugClear();
+    store->testingRereadConfig();
+
+    const qint32 pixelSize = 1;
+    quint8 defaultPixel = 128;
+    KisTiledDataManager dm(pixelSize, &defaultPixel);
+
+    const qint32 NUM_COLUMNS = 16;
+    const qint32 NUM_STEPS = 6;
+    const QRect rect(0, 0, NUM_COLUMNS * KisTileData::WIDTH, KisTileData::HEIGHT);
+
+    QVector<KisMementoSP> mementos;
+    QVector<QByteArray> revisions;
+
+    dm.clear(rect, 10);
+    revisions.append(readDataManager(dm, rect));
+
+    for (qint32 step = 0; step < NUM_STEPS; step++) {
+        KisMementoSP memento = dm.getMemento();
+
+        // every step changes a single row of every tile, so
+        // the history is stored as a delta
+        for (qint32 col = 0; col < NUM_COLUMNS; col++) {
+            dm.clear(QRect(col * KisTileData::WIDTH, step, KisTileData::WIDTH, 1),
+                     COLUMN2COLOR(col + step * NUM_COLUMNS));
+        }
+
+        dm.commit();
+
+        mementos.append(memento);
+        revisions.append(readDataManager(dm, rect));
+    }
+
+    // the tiles are compressed when not accessed for two cycles
+    store->compressHistory();
+    store->compressHistory();
+
+    // the steps older than the swap depth went into the swap file
+    QVERIFY(store->m_swappedStore.compressedHistorySize() > 0);
+    QVERIFY(store->m_swappedStore.totalMemoryMetric() > 0);
+
+    for (qint32 step = NUM_STEPS - 1; step >= 0; step--) {
+        dm.rollback(mementos[step]);
+        QCOMPARE(readDataManager(dm, rect), revisions[step]);
+
+        // let the undone revisions go down into history as well
+        store->compressHistory();
+        store->compressHistory();
+    }
+
+    // spill a part of the compressed redo history under pressure
+    store->m_swappedStore.swapOutCompressedHistory(store->m_swappedStore.compressedHistorySize() / 2);
+
+    for (qint32 step = 0; step < NUM_STEPS; step++) {
+        dm.rollforward(mementos[step]);
+        QCOMPARE(readDataManager(dm, rect), revisions[step + 1]);
+    }
+
+    config.setUndoHistorySwapDepth(0);
+    store->testingRereadConfig();
+}
+
 QTEST_MAIN(KisTileDataStoreTest)
 
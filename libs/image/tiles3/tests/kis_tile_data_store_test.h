@@ -30,6 +30,7 @@ private Q_SLOTS:
     void testClockIterator();
     void testLeaks();
     void testSwapping();
+    void testCompressedHistoryRoundTrip();
 };
 
 #endif /* KIS_TILE_DATA_STORE_TEST_H */
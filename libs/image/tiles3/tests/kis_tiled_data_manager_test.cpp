@@ -19,6 +19,8 @@
 #include "kis_tiled_data_manager_test.h"
 #include <QTest>
 
+#include <functional>
+
 #include "tiles3/kis_tiled_data_manager.h"
 
 #include "tiles_test_utils.h"
@@ -541,6 +543,191 @@ void KisTiledDataManagerTest::testUndoSetDefaultPixel()
 
 //#include <valgrind/callgrind.h>
 
+class TestDataSource : public KisTiledDataSource
+{
+public:
+    TestDataSource(const QRect &bounds)
+        : value(7),
+          m_bounds(bounds)
+    {
+    }
+
+    void readBytes(quint8 *data, const QRect &rect) override {
+        numReads.ref();
+        memset(data, value, rect.width() * rect.height());
+
+        if (readCallback) {
+            std::function<void()> callback;
+            std::swap(callback, readCallback);
+            callback();
+        }
+    }
+
+    QRect bounds() const override {
+        return m_bounds;
+    }
+
+    QAtomicInt numReads;
+    quint8 value;
+
+    /**
+     * Called once after the next tile is generated, but before
+     * it gets into the data manager
+     */
+    std::function<void()> readCallback;
+
+private:
+    QRect m_bounds;
+};
+
+void KisTiledDataManagerTest::testDataSource()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    QSharedPointer<TestDataSource> source(new TestDataSource(QRect(0, 0, 256, 64)));
+    dm.setDataSource(source, 2);
+
+    QCOMPARE(dm.extent(), QRect(0, 0, 256, 64));
+
+    quint8 pixel = 0;
+
+    dm.readBytes(&pixel, 10, 10, 1, 1);
+    QCOMPARE(pixel, quint8(7));
+    QCOMPARE(int(source->numReads), 1);
+
+    // the tile is cached
+    dm.readBytes(&pixel, 20, 20, 1, 1);
+    QCOMPARE(pixel, quint8(7));
+    QCOMPARE(int(source->numReads), 1);
+
+    // the source is not asked for tiles outside its bounds
+    dm.readBytes(&pixel, 10, 100, 1, 1);
+    QCOMPARE(pixel, quint8(0));
+    QCOMPARE(int(source->numReads), 1);
+
+    // the first tile is dropped from the cache
+    dm.readBytes(&pixel, 70, 10, 1, 1);
+    dm.readBytes(&pixel, 134, 10, 1, 1);
+    dm.readBytes(&pixel, 198, 10, 1, 1);
+    QCOMPARE(int(source->numReads), 4);
+
+    dm.readBytes(&pixel, 10, 10, 1, 1);
+    QCOMPARE(pixel, quint8(7));
+    QCOMPARE(int(source->numReads), 5);
+
+    source->value = 9;
+    dm.invalidateDataSourceTiles(QRect(0, 0, 10, 10));
+
+    dm.readBytes(&pixel, 10, 10, 1, 1);
+    QCOMPARE(pixel, quint8(9));
+    QCOMPARE(int(source->numReads), 6);
+
+    // written tiles are never dropped
+    const quint8 writtenPixel = 42;
+    dm.writeBytes(&writtenPixel, 70, 10, 1, 1);
+    QCOMPARE(int(source->numReads), 7);
+
+    dm.readBytes(&pixel, 134, 10, 1, 1);
+    dm.readBytes(&pixel, 198, 10, 1, 1);
+    dm.readBytes(&pixel, 10, 10, 1, 1);
+    dm.invalidateDataSourceTiles(QRect(0, 0, 256, 64));
+
+    dm.readBytes(&pixel, 70, 10, 1, 1);
+    QCOMPARE(pixel, writtenPixel);
+    dm.readBytes(&pixel, 71, 10, 1, 1);
+    QCOMPARE(pixel, quint8(9));
+
+    // the copies share the source
+    KisTiledDataManager copy(dm);
+    QCOMPARE(copy.extent(), QRect(0, 0, 256, 64));
+    copy.readBytes(&pixel, 200, 50, 1, 1);
+    QCOMPARE(pixel, quint8(9));
+
+    dm.setDataSource(KisTiledDataSourceSP());
+    QCOMPARE(dm.extent(), QRect());
+    dm.readBytes(&pixel, 10, 10, 1, 1);
+    QCOMPARE(pixel, quint8(0));
+}
+
+void KisTiledDataManagerTest::testDataSourceBitBltAndClear()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    QSharedPointer<TestDataSource> source(new TestDataSource(QRect(0, 0, 256, 128)));
+    dm.setDataSource(source, 1);
+
+    quint8 oddPixel = 128;
+    KisTiledDataManager srcDM(1, &defaultPixel);
+    srcDM.clear(QRect(0, 0, 256, 64), &oddPixel);
+
+    quint8 pixel = 0;
+
+    // the tiles are cached before they are replaced
+    dm.readBytes(&pixel, 10, 10, 1, 1);
+    dm.bitBlt(&srcDM, QRect(0, 0, 64, 64));
+
+    dm.readBytes(&pixel, 70, 10, 1, 1);
+    dm.bitBltRough(&srcDM, QRect(64, 0, 64, 64));
+
+    dm.readBytes(&pixel, 134, 10, 1, 1);
+    dm.clear(QRect(128, 0, 64, 64), &defaultPixel);
+
+    // the default pixels of the empty source tiles are copied as well
+    KisTiledDataManager emptyDM(1, &defaultPixel);
+    dm.bitBlt(&emptyDM, QRect(192, 0, 64, 64));
+
+    // evict everything from the cache
+    for (int i = 0; i < 4; i++) {
+        dm.readBytes(&pixel, 10 + 64 * i, 100, 1, 1);
+    }
+    dm.invalidateDataSourceTiles(QRect(0, 0, 256, 64));
+    dm.purge(QRect(0, 0, 256, 64));
+
+    const int numReads = source->numReads;
+
+    dm.readBytes(&pixel, 10, 10, 1, 1);
+    QCOMPARE(pixel, oddPixel);
+    dm.readBytes(&pixel, 70, 10, 1, 1);
+    QCOMPARE(pixel, oddPixel);
+    dm.readBytes(&pixel, 134, 10, 1, 1);
+    QCOMPARE(pixel, defaultPixel);
+    dm.readBytes(&pixel, 198, 10, 1, 1);
+    QCOMPARE(pixel, defaultPixel);
+
+    // the replaced tiles are not generated again
+    QCOMPARE(int(source->numReads), numReads);
+
+    QCOMPARE(dm.extent(), QRect(0, 0, 256, 128));
+}
+
+void KisTiledDataManagerTest::testDataSourceInvalidatedWhileReading()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    QSharedPointer<TestDataSource> source(new TestDataSource(QRect(0, 0, 256, 64)));
+    dm.setDataSource(source, 2);
+
+    source->readCallback = [&dm, source] () {
+        source->value = 9;
+        dm.invalidateDataSourceTiles(QRect(0, 0, 64, 64));
+    };
+
+    quint8 pixel = 0;
+
+    // the tile generated before the invalidation is dropped
+    dm.readBytes(&pixel, 10, 10, 1, 1);
+    QCOMPARE(pixel, quint8(9));
+    QCOMPARE(int(source->numReads), 2);
+
+    // the new tile is cached
+    dm.readBytes(&pixel, 20, 20, 1, 1);
+    QCOMPARE(pixel, quint8(9));
+    QCOMPARE(int(source->numReads), 2);
+}
+
 void KisTiledDataManagerTest::benchmarkReadOnlyTileLazy()
 {
     quint8 defaultPixel = 0;
@@ -52,6 +52,9 @@ private Q_SLOTS:
     void testTransactions();
     void testPurgeHistory();
     void testUndoSetDefaultPixel();
+    void testDataSource();
+    void testDataSourceBitBltAndClear();
+    void testDataSourceInvalidatedWhileReading();
 
     void benchmarkReadOnlyTileLazy();
     void benchmarkSharedPointers();
@@ -56,6 +56,7 @@
 #include <KisResourceModel.h>
 #include <KisResourceModelProvider.h>
 #include <KisGlobalResourcesInterface.h>
+#include <KisLatencyTracer.h>
 
 #include "View.h"
 #include "Document.h"
@@ -368,6 +369,29 @@ QString Krita::readSetting(const QString &group, const QString &name, const QStr
     return grp.readEntry(name, defaultValue);
 }
 
+void Krita::setLatencyTracingEnabled(bool value)
+{
+    if (value && !KisLatencyTracer::isEnabled()) {
+        KisLatencyTracer::instance()->clear();
+    }
+    KisLatencyTracer::instance()->setEnabled(value);
+}
+
+bool Krita::latencyTracingEnabled() const
+{
+    return KisLatencyTracer::isEnabled();
+}
+
+bool Krita::saveLatencyTrace(const QString &filename) const
+{
+    return KisLatencyTracer::instance()->saveChromeTrace(filename);
+}
+
+QString Krita::latencyTraceSummary() const
+{
+    return KisLatencyTracer::instance()->summary();
+}
+
 QIcon Krita::icon(QString &iconName) const
 {
     return KisIconUtils::loadIcon(iconName);
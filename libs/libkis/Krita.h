@@ -316,6 +316,33 @@ add_document_to_window()
      */
     QString readSetting(const QString &group, const QString &name, const QString &defaultValue);
 
+    /**
+     * @brief setLatencyTracingEnabled starts or stops recording the timestamps of
+     * tablet events, stroke jobs, projection merges and canvas updates. Starting
+     * the tracing drops all the previously recorded events.
+     * @param value true to start recording
+     */
+    void setLatencyTracingEnabled(bool value);
+
+    /**
+     * @return true if the latency tracing is active
+     */
+    bool latencyTracingEnabled() const;
+
+    /**
+     * @brief saveLatencyTrace saves the recorded events in Chrome trace event
+     * format, which can be opened in chrome://tracing or Perfetto.
+     * @param filename the name of the JSON file
+     * @return true if the file was saved successfully
+     */
+    bool saveLatencyTrace(const QString &filename) const;
+
+    /**
+     * @return the percentiles of the input-to-canvas latency and of the
+     * duration of the traced operations
+     */
+    QString latencyTraceSummary() const;
+
     /**
      * @brief icon
      * This allows you to get icons from Krita's internal icons.
@@ -59,6 +59,7 @@
 #include "Channel.h"
 #include "Filter.h"
 #include "Selection.h"
+#include "PixelRegion.h"
 
 #include "GroupLayer.h"
 #include "CloneLayer.h"
@@ -550,6 +551,22 @@ void Node::setPixelData(QByteArray value, int x, int y, int w, int h)
     dev->writeBytes((const quint8*)value.constData(), x, y, w, h);
 }
 
+PixelRegion *Node::lockPixelData(int x, int y, int w, int h, bool writable)
+{
+    if (!d->node) return 0;
+    KisPaintDeviceSP dev = d->node->paintDevice();
+    if (!dev) return 0;
+    return new PixelRegion(d->image, dev, QRect(x, y, w, h), writable);
+}
+
+PixelRegion *Node::lockProjectionPixelData(int x, int y, int w, int h) const
+{
+    if (!d->node) return 0;
+    KisPaintDeviceSP dev = d->node->projection();
+    if (!dev) return 0;
+    return new PixelRegion(d->image, dev, QRect(x, y, w, h), false);
+}
+
 QRect Node::bounds() const
 {
     if (!d->node) return QRect();
@@ -444,6 +444,33 @@ public Q_SLOTS:
      */
     void setPixelData(QByteArray value, int x, int y, int w, int h);
 
+    /**
+     * @brief lockPixelData reads the given rectangle from the Node's paintable pixels into a
+     * PixelRegion, whose buffer can be processed in place from Python through the buffer
+     * protocol, e.g. with numpy.frombuffer(), without copying it into and out of byte arrays.
+     *
+     * The layout of the pixels is the same as the one of pixelData(). If the region is writable,
+     * the changed pixels are written back to the Node with PixelRegion::commit(), which can be undone.
+     *
+     * @param x x position from where to start reading
+     * @param y y position from where to start reading
+     * @param w row length to read
+     * @param h number of rows to read
+     * @param writable whether the region may be committed back into the Node
+     * @return the locked region, or 0 if the Node has no paintable pixels. The region is owned
+     * by the caller.
+     */
+    PixelRegion *lockPixelData(int x, int y, int w, int h, bool writable = true);
+
+    /**
+     * @brief lockProjectionPixelData reads the given rectangle from the Node's projection
+     * into a read-only PixelRegion. \see lockPixelData(), projectionPixelData()
+     *
+     * @return the locked region, or 0 if the Node has no projection. The region is owned
+     * by the caller.
+     */
+    PixelRegion *lockProjectionPixelData(int x, int y, int w, int h) const;
+
     /**
      * @brief bounds return the exact bounds of the node's paint device
      * @return the bounds, or an empty QRect if the node has no paint device or is empty.
@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "PixelRegion.h"
+
+#include <QByteArray>
+#include <QDebug>
+
+#include <kis_image.h>
+#include <kis_paint_device.h>
+#include <kis_transaction.h>
+#include <kis_command_utils.h>
+#include <kis_processing_applicator.h>
+#include <kundo2magicstring.h>
+#include <kis_assert.h>
+
+
+struct PixelRegion::Private {
+    Private() {}
+
+    KisImageWSP image;
+    KisPaintDeviceSP device;
+    QRect rect;
+    bool writable {false};
+    QByteArray data;
+    int numBufferViews {0};
+};
+
+PixelRegion::PixelRegion(KisImageSP image, KisPaintDeviceSP device, const QRect &rect, bool writable, QObject *parent)
+    : QObject(parent)
+    , d(new Private)
+{
+    d->image = image;
+    d->device = device;
+    d->rect = rect;
+    d->writable = writable;
+
+    if (d->device && !d->rect.isEmpty()) {
+        d->data.resize(d->rect.width() * d->rect.height() * d->device->pixelSize());
+        d->device->readBytes(reinterpret_cast<quint8*>(d->data.data()), d->rect);
+    }
+}
+
+PixelRegion::~PixelRegion()
+{
+    if (d->numBufferViews > 0) {
+        qWarning() << "PixelRegion is destroyed while" << d->numBufferViews << "views of its buffer are alive";
+
+        /**
+         * The views still point into the buffer, so it should never be
+         * freed. The copy shares the memory of the buffer and is leaked
+         * intentionally.
+         */
+        new QByteArray(d->data);
+    }
+
+    delete d;
+}
+
+QRect PixelRegion::rect() const
+{
+    return d->rect;
+}
+
+int PixelRegion::pixelSize() const
+{
+    return d->device ? d->device->pixelSize() : 0;
+}
+
+int PixelRegion::stride() const
+{
+    return d->rect.width() * pixelSize();
+}
+
+bool PixelRegion::isWritable() const
+{
+    return d->writable;
+}
+
+bool PixelRegion::isLocked() const
+{
+    return !d->data.isEmpty();
+}
+
+void PixelRegion::commit()
+{
+    if (!d->device || !d->writable || d->data.isEmpty()) return;
+
+    KisPaintDeviceSP device = d->device;
+    const QRect rect = d->rect;
+
+    /**
+     * The buffer is not copied into the command, the stroke is
+     * waited for below, so the buffer outlives the write.
+     */
+    const quint8 *data = reinterpret_cast<const quint8*>(d->data.constData());
+
+    KisImageSP image = d->image;
+    if (!image) {
+        device->writeBytes(data, rect);
+        return;
+    }
+
+    KUndo2Command *cmd =
+        new KisCommandUtils::LambdaCommand(kundo2_i18n("Set Pixel Data"),
+            [device, rect, data] () {
+                KisTransaction transaction(device);
+                device->writeBytes(data, rect);
+                device->setDirty(rect);
+                return transaction.endAndTake();
+            });
+
+    KisProcessingApplicator::runSingleCommandStroke(image, cmd);
+    image->waitForDone();
+}
+
+bool PixelRegion::unlock()
+{
+    if (d->numBufferViews > 0) return false;
+
+    d->data = QByteArray();
+    return true;
+}
+
+char *PixelRegion::data()
+{
+    return d->data.data();
+}
+
+char *PixelRegion::acquireBuffer()
+{
+    if (!isLocked()) return 0;
+
+    d->numBufferViews++;
+    return d->data.data();
+}
+
+void PixelRegion::releaseBuffer()
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(d->numBufferViews > 0);
+    d->numBufferViews--;
+}
+
+int PixelRegion::size() const
+{
+    return d->data.size();
+}
@@ -0,0 +1,151 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef LIBKIS_PIXELREGION_H
+#define LIBKIS_PIXELREGION_H
+
+#include <QObject>
+#include <QRect>
+
+#include "kritalibkis_export.h"
+#include "libkis.h"
+
+#include <kis_types.h>
+
+/**
+ * A PixelRegion is a rectangle of pixels of a Node locked into a single
+ * contiguous buffer. Unlike Node::pixelData() and Node::setPixelData(),
+ * which copy the pixels into and out of a new byte array on every call,
+ * the buffer of a region is shared with Python through the buffer
+ * protocol, so NumPy and friends can process the pixels in place:
+ *
+ * @code
+ * import numpy as np
+ * from krita import *
+ *
+ * d = Application.activeDocument()
+ * n = d.activeNode()
+ * r = n.lockPixelData(0, 0, d.width(), d.height())
+ * pixels = np.frombuffer(r, dtype=np.uint8).reshape(d.height(), d.width(), r.pixelSize())
+ * pixels[:, :, 3] //= 2
+ * r.commit()
+ * del pixels
+ * r.unlock()
+ * d.refreshProjection()
+ * @endcode
+ *
+ * The pixels are read from the node when the region is locked, changes
+ * of the node made after that are not visible in the region. The changes
+ * made to the buffer are written back to the node only by commit(), which
+ * can be undone by the user as a single action.
+ *
+ * The layout of the buffer is the same as the one of Node::pixelData().
+ */
+class KRITALIBKIS_EXPORT PixelRegion : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(PixelRegion)
+
+public:
+    /**
+     * For internal use only. Use Node::lockPixelData() or
+     * Node::lockProjectionPixelData() to create a region.
+     */
+    PixelRegion(KisImageSP image, KisPaintDeviceSP device, const QRect &rect, bool writable, QObject *parent = 0);
+    ~PixelRegion() override;
+
+public Q_SLOTS:
+
+    /**
+     * @return the rectangle of the node the region covers
+     */
+    QRect rect() const;
+
+    /**
+     * @return the number of bytes of a single pixel in the buffer
+     */
+    int pixelSize() const;
+
+    /**
+     * @return the number of bytes of a single row in the buffer
+     */
+    int stride() const;
+
+    /**
+     * @return true if the changes in the buffer can be written back
+     * with commit(). The regions of projections are always read-only.
+     */
+    bool isWritable() const;
+
+    /**
+     * @return true if the region still owns its buffer, that is,
+     * unlock() has not been called yet.
+     */
+    bool isLocked() const;
+
+    /**
+     * Writes the buffer back into the node as one undoable action and
+     * waits until the write is finished. The region stays locked, so it
+     * can be changed and committed again.
+     */
+    void commit();
+
+    /**
+     * Releases the buffer without writing it back. All the views of
+     * the buffer created in Python (NumPy arrays, memoryviews) must be
+     * released before that, otherwise the buffer is kept and an error
+     * is raised.
+     *
+     * @return false if the buffer is still used by some views
+     */
+    bool unlock();
+
+public:
+
+    /**
+     * For internal use only: the pointer to the locked buffer,
+     * used by the buffer protocol implementation of the bindings.
+     */
+    char *data();
+
+    /**
+     * For internal use only: registers a new view of the buffer, created
+     * by the buffer protocol implementation of the bindings. The buffer
+     * cannot be unlocked until every acquired view is released with
+     * releaseBuffer().
+     *
+     * @return the pointer to the buffer or null if the region is unlocked
+     */
+    char *acquireBuffer();
+
+    /**
+     * For internal use only: unregisters a view acquired
+     * with acquireBuffer()
+     */
+    void releaseBuffer();
+
+    /**
+     * For internal use only: the size of the locked buffer in bytes
+     */
+    int size() const;
+
+private:
+    struct Private;
+    Private *const d;
+};
+
+#endif // LIBKIS_PIXELREGION_H
@@ -19,6 +19,7 @@ class InfoObject;
 class Krita;
 class Node;
 class Notifier;
+class PixelRegion;
 class Resource;
 class Scratchpad;
 class Selection;
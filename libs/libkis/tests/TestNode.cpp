@@ -19,9 +19,11 @@
 #include <QTest>
 #include <QColor>
 #include <QDataStream>
+#include <QScopedPointer>
 
 #include <KritaVersionWrapper.h>
 #include <Node.h>
+#include <PixelRegion.h>
 #include <Krita.h>
 
 #include <KoColorSpaceRegistry.h>
@@ -119,6 +121,71 @@ void TestNode::testProjectionPixelData()
     }
 }
 
+void TestNode::testLockPixelData()
+{
+    KisImageSP image = new KisImage(0, 100, 100, KoColorSpaceRegistry::instance()->rgb8(), "test");
+    KisNodeSP layer = new KisPaintLayer(image, "test1", 255);
+    image->addNode(layer);
+    KisFillPainter gc(layer->paintDevice());
+    gc.fillRect(0, 0, 100, 100, KoColor(Qt::red, layer->colorSpace()));
+    NodeSP node = NodeSP(Node::createNode(image, layer));
+
+    QScopedPointer<PixelRegion> region(node->lockPixelData(10, 20, 30, 40));
+    QVERIFY(region);
+    QVERIFY(region->isLocked());
+    QVERIFY(region->isWritable());
+    QCOMPARE(region->rect(), QRect(10, 20, 30, 40));
+    QCOMPARE(region->stride(), 30 * 4);
+    QCOMPARE(region->size(), 30 * 40 * 4);
+
+    quint8 *data = reinterpret_cast<quint8*>(region->data());
+    for (int i = 0; i < 30 * 40; i++) {
+        QCOMPARE(data[4 * i + 0], quint8(0));
+        QCOMPARE(data[4 * i + 1], quint8(0));
+        QCOMPARE(data[4 * i + 2], quint8(255));
+        QCOMPARE(data[4 * i + 3], quint8(255));
+
+        data[4 * i + 2] = 0;
+    }
+
+    // nothing is written before the commit
+    QColor pixel;
+    layer->paintDevice()->pixel(15, 25, &pixel);
+    QCOMPARE(pixel, QColor(Qt::red));
+
+    region->commit();
+
+    for (int i = 0; i < 100 ; i++) {
+        for (int j = 0; j < 100 ; j++) {
+            layer->paintDevice()->pixel(i, j, &pixel);
+            const bool insideRegion = QRect(10, 20, 30, 40).contains(i, j);
+            QCOMPARE(pixel, insideRegion ? QColor(Qt::black) : QColor(Qt::red));
+        }
+    }
+
+    // a view of the buffer (e.g. a memoryview) keeps the region locked
+    char *view = region->acquireBuffer();
+    QCOMPARE(view, region->data());
+    QVERIFY(!region->unlock());
+    QVERIFY(region->isLocked());
+    QCOMPARE(region->data(), view);
+
+    // writing into the view is still valid
+    view[0] = 42;
+    QCOMPARE(quint8(region->data()[0]), quint8(42));
+
+    region->releaseBuffer();
+    QVERIFY(region->unlock());
+    QVERIFY(!region->isLocked());
+
+    // no new views of the unlocked region
+    QVERIFY(!region->acquireBuffer());
+
+    QScopedPointer<PixelRegion> projectionRegion(node->lockProjectionPixelData(0, 0, 10, 10));
+    QVERIFY(projectionRegion);
+    QVERIFY(!projectionRegion->isWritable());
+}
+
 void TestNode::testThumbnail()
 {
     KisImageSP image = new KisImage(0, 100, 100, KoColorSpaceRegistry::instance()->rgb8(), "test");
@@ -29,6 +29,7 @@ private Q_SLOTS:
     void testSetColorProfile();
     void testPixelData();
     void testProjectionPixelData();
+    void testLockPixelData();
     void testThumbnail();
     void testMergeDown();
 };
@@ -385,6 +385,26 @@ const KoColorConversionTransformation* KoColorSpace::fromRgbA16Converter() const
     return d->transfoFromRGBA16;
 }
 
+void KoColorSpace::fromQColors(const QColor *colors, quint8 *dst, qint32 nColors, const KoColorProfile *profile) const
+{
+    const qint32 pixelSize = this->pixelSize();
+
+    for (qint32 i = 0; i < nColors; i++) {
+        fromQColor(colors[i], dst, profile);
+        dst += pixelSize;
+    }
+}
+
+void KoColorSpace::toQColors(const quint8 *src, QColor *colors, qint32 nColors, const KoColorProfile *profile) const
+{
+    const qint32 pixelSize = this->pixelSize();
+
+    for (qint32 i = 0; i < nColors; i++) {
+        toQColor(src, &colors[i], profile);
+        src += pixelSize;
+    }
+}
+
 void KoColorSpace::toLabA16(const quint8 * src, quint8 * dst, quint32 nPixels) const
 {
     toLabA16Converter()->transform(src, dst, nPixels);
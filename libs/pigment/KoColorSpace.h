@@ -302,6 +302,29 @@ public:
      */
     virtual void toQColor(const quint8 *src, QColor *c, const KoColorProfile * profile = 0) const = 0;
 
+    /**
+     * Converts \p nColors QColors into a contiguous array of pixels at once.
+     * It is equivalent to calling fromQColor() for every color, but the
+     * color spaces may override it to convert all the colors in one pass.
+     *
+     * @param colors the array of the colors to be converted
+     * @param dst a pointer to at least nColors * pixelSize() bytes
+     * @param nColors the number of colors in the array
+     * @param profile the optional profile that describes the color values of the QColors
+     */
+    virtual void fromQColors(const QColor *colors, quint8 *dst, qint32 nColors, const KoColorProfile * profile = 0) const;
+
+    /**
+     * Converts a contiguous array of \p nColors pixels into QColors at once.
+     * It is equivalent to calling toQColor() for every pixel.
+     *
+     * @param src a pointer to nColors source pixels
+     * @param colors the array that will be filled with the converted colors
+     * @param nColors the number of pixels to convert
+     * @param profile the optional profile that describes the colors in \p colors
+     */
+    virtual void toQColors(const quint8 *src, QColor *colors, qint32 nColors, const KoColorProfile * profile = 0) const;
+
     /**
      * Convert the pixels in data to (8-bit BGRA) QImage using the specified profiles.
      *
@@ -0,0 +1,198 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoLut3DColorTransformation.h"
+
+#include <QVector>
+
+#include "KoColorSpace.h"
+#include "KoColorSpaceMaths.h"
+#include "KoColorModelStandardIds.h"
+#include "KoBgrColorSpaceTraits.h"
+#include "KoLut3DInterpolatorFactoryImpl.h"
+#include "DebugPigment.h"
+#include "kis_assert.h"
+
+
+namespace {
+
+template <typename channel_type>
+channel_type nodeValue(int index, int gridSize)
+{
+    const qreal unitValue = KoColorSpaceMathsTraits<channel_type>::unitValue;
+    return channel_type(qRound(index * unitValue / (gridSize - 1)));
+}
+
+template <typename channel_type>
+void fillGrid(channel_type *pixels, int gridSize, channel_type alpha)
+{
+    typedef KoBgrTraits<channel_type> Traits;
+
+    for (int r = 0; r < gridSize; r++) {
+        for (int g = 0; g < gridSize; g++) {
+            for (int b = 0; b < gridSize; b++) {
+                pixels[Traits::red_pos] = nodeValue<channel_type>(r, gridSize);
+                pixels[Traits::green_pos] = nodeValue<channel_type>(g, gridSize);
+                pixels[Traits::blue_pos] = nodeValue<channel_type>(b, gridSize);
+                pixels[Traits::alpha_pos] = alpha;
+                pixels += Traits::channels_nb;
+            }
+        }
+    }
+}
+
+template <typename channel_type>
+bool bakeImpl(const KoColorTransformation *transform, int gridSize, QVector<float> *table)
+{
+    typedef KoBgrTraits<channel_type> Traits;
+    const channel_type unitValue = KoColorSpaceMathsTraits<channel_type>::unitValue;
+    const int numNodes = gridSize * gridSize * gridSize;
+
+    QVector<channel_type> src(numNodes * Traits::channels_nb);
+    QVector<channel_type> dst(src.size());
+
+    fillGrid(src.data(), gridSize, unitValue);
+    transform->transform(reinterpret_cast<const quint8*>(src.constData()),
+                         reinterpret_cast<quint8*>(dst.data()), numNodes);
+
+    /**
+     * The table cannot represent the transformations that depend on
+     * alpha or modify it, so check a part of the nodes once more with
+     * a semi-transparent alpha, the result should be the same.
+     */
+    const channel_type probeAlpha = unitValue / 2;
+    const int tolerance = unitValue / 255;
+
+    QVector<channel_type> probe(src.size());
+    fillGrid(probe.data(), gridSize, probeAlpha);
+    transform->transform(reinterpret_cast<const quint8*>(probe.constData()),
+                         reinterpret_cast<quint8*>(probe.data()), numNodes);
+
+    for (int i = 0; i < numNodes; i++) {
+        const channel_type *opaquePixel = dst.constData() + i * Traits::channels_nb;
+        const channel_type *probePixel = probe.constData() + i * Traits::channels_nb;
+
+        if (opaquePixel[Traits::alpha_pos] != unitValue ||
+            probePixel[Traits::alpha_pos] != probeAlpha) {
+
+            return false;
+        }
+
+        for (int ch = 0; ch < Traits::channels_nb; ch++) {
+            if (ch == Traits::alpha_pos) continue;
+
+            if (qAbs(int(opaquePixel[ch]) - int(probePixel[ch])) > tolerance) {
+                return false;
+            }
+        }
+    }
+
+    table->resize(numNodes * lut3DNodeSize);
+    float *tablePtr = table->data();
+    const channel_type *dstPtr = dst.constData();
+
+    for (int i = 0; i < numNodes; i++) {
+        tablePtr[0] = dstPtr[Traits::red_pos];
+        tablePtr[1] = dstPtr[Traits::green_pos];
+        tablePtr[2] = dstPtr[Traits::blue_pos];
+
+        tablePtr += lut3DNodeSize;
+        dstPtr += Traits::channels_nb;
+    }
+
+    return true;
+}
+
+}
+
+struct Q_DECL_HIDDEN KoLut3DColorTransformation::Private
+{
+    int gridSize = 0;
+    QVector<float> table;
+    KoLut3DTransformFunc transformFunc = 0;
+};
+
+
+KoLut3DColorTransformation::KoLut3DColorTransformation()
+    : m_d(new Private)
+{
+}
+
+KoLut3DColorTransformation::~KoLut3DColorTransformation()
+{
+}
+
+void KoLut3DColorTransformation::transform(const quint8 *src, quint8 *dst, qint32 nPixels) const
+{
+    m_d->transformFunc(m_d->table.constData(), m_d->gridSize, src, dst, nPixels);
+}
+
+int KoLut3DColorTransformation::gridSize() const
+{
+    return m_d->gridSize;
+}
+
+bool KoLut3DColorTransformation::supportsColorSpace(const KoColorSpace *cs)
+{
+    return cs->colorModelId() == RGBAColorModelID &&
+        (cs->colorDepthId() == Integer8BitsColorDepthID ||
+         cs->colorDepthId() == Integer16BitsColorDepthID);
+}
+
+int KoLut3DColorTransformation::defaultGridSize(const KoColorSpace *cs)
+{
+    Q_UNUSED(cs);
+
+    /**
+     * 51 divides both 255 and 65535, so the nodes of the grid hit the
+     * channel values exactly for both the supported depths
+     */
+    return 52;
+}
+
+KoLut3DColorTransformation* KoLut3DColorTransformation::bake(const KoColorTransformation *transform,
+                                                             const KoColorSpace *cs,
+                                                             int gridSize)
+{
+    if (!transform || !supportsColorSpace(cs)) return 0;
+
+    if (gridSize <= 0) {
+        gridSize = defaultGridSize(cs);
+    }
+    KIS_ASSERT_RECOVER_RETURN_VALUE(gridSize >= 2, 0);
+
+    QScopedPointer<KoLut3DColorTransformation> lut(new KoLut3DColorTransformation());
+    lut->m_d->gridSize = gridSize;
+
+    bool result = false;
+
+    if (cs->colorDepthId() == Integer8BitsColorDepthID) {
+        result = bakeImpl<quint8>(transform, gridSize, &lut->m_d->table);
+        lut->m_d->transformFunc = createOptimizedClass<KoLut3DInterpolatorFactoryImpl<quint8>>(0);
+    } else {
+        result = bakeImpl<quint16>(transform, gridSize, &lut->m_d->table);
+        lut->m_d->transformFunc = createOptimizedClass<KoLut3DInterpolatorFactoryImpl<quint16>>(0);
+    }
+
+    if (!result) {
+        dbgPigment << "Cannot bake a color transformation into a 3D LUT: it depends on alpha";
+        return 0;
+    }
+
+    return lut.take();
+}
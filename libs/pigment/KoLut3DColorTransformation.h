@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_LUT_3D_COLOR_TRANSFORMATION_H
+#define __KO_LUT_3D_COLOR_TRANSFORMATION_H
+
+#include "KoColorTransformation.h"
+
+#include <QScopedPointer>
+
+class KoColorSpace;
+
+
+/**
+ * A color transformation that evaluates another (baked) transformation
+ * by tetrahedral interpolation in a 3D lookup table. The table is
+ * sampled once in bake(), so chains of expensive adjustments (e.g. a
+ * KoCompositeColorTransformation of several HSV, curves and color
+ * balance transformations) cost the same as a single table lookup
+ * afterwards.
+ *
+ * Only RGBA color spaces with 8- and 16-bit integer channels are
+ * supported. The grid has to cover the whole range of the input values,
+ * which is known only for integer channels: float and half channels
+ * may hold HDR values outside [0, 1] that the table cannot represent
+ * without clipping them. Other color models would need a table of a
+ * different dimension (e.g. 4D for CMYK) and a different interpolation
+ * scheme, and the adjustments baked in practice (HSV, curves, color
+ * balance) are applied to RGB images anyway.
+ *
+ * The interpolation is vectorized with Vc (see KoLut3DInterpolator),
+ * the implementation for the current CPU is selected in bake().
+ *
+ * The alpha channel is copied from the source pixels, so the
+ * baked transformation must not change alpha and its result must not
+ * depend on alpha. bake() checks that and refuses to bake the
+ * transformations that do not fulfill it.
+ *
+ * Please note that the result is an approximation: the maximum error
+ * depends on the grid size and on the smoothness of the baked
+ * transformation.
+ *
+ * Unlike most of the color transformations, the baked transformation
+ * has no mutable state, so it can be used from several threads at once.
+ */
+class KRITAPIGMENT_EXPORT KoLut3DColorTransformation : public KoColorTransformation
+{
+public:
+    ~KoLut3DColorTransformation() override;
+
+    void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const override;
+
+    /**
+     * The number of the nodes of the table along each axis
+     */
+    int gridSize() const;
+
+    /**
+     * @return true if transformations in \p cs can be baked
+     */
+    static bool supportsColorSpace(const KoColorSpace *cs);
+
+    /**
+     * The grid size used for \p cs when bake() is called with
+     * \p gridSize equal to zero
+     */
+    static int defaultGridSize(const KoColorSpace *cs);
+
+    /**
+     * Samples \p transform in \p cs into a new lookup table transformation.
+     * The ownership of \p transform is not taken, it is not used after
+     * bake() returns.
+     *
+     * @return the baked transformation or null if \p cs is not supported
+     *         or \p transform touches the alpha channel
+     */
+    static KoLut3DColorTransformation* bake(const KoColorTransformation *transform,
+                                            const KoColorSpace *cs,
+                                            int gridSize = 0);
+
+private:
+    KoLut3DColorTransformation();
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KO_LUT_3D_COLOR_TRANSFORMATION_H */
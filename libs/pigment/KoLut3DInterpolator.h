@@ -0,0 +1,257 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_LUT_3D_INTERPOLATOR_H
+#define __KO_LUT_3D_INTERPOLATOR_H
+
+#include <QtGlobal>
+
+#include "KoColorSpaceMaths.h"
+#include "KoBgrColorSpaceTraits.h"
+#include "KoLut3DInterpolatorFactoryImpl.h"
+
+/**
+ * Applies a table baked by KoLut3DColorTransformation to BGRA pixels
+ * of \p channel_type using tetrahedral interpolation
+ */
+template <typename channel_type,
+          Vc::Implementation _impl,
+          typename EnableDummyType = void>
+struct KoLut3DInterpolator
+{
+    static void transform(const float *table, int gridSize, const quint8 *src8, quint8 *dst8, qint32 nPixels)
+    {
+        typedef KoBgrTraits<channel_type> Traits;
+
+        const float unitValue = KoColorSpaceMathsTraits<channel_type>::unitValue;
+        const float scale = (gridSize - 1) / unitValue;
+        const int maxIndex = gridSize - 2;
+
+        const int strideB = lut3DNodeSize;
+        const int strideG = strideB * gridSize;
+        const int strideR = strideG * gridSize;
+
+        const channel_type *src = reinterpret_cast<const channel_type*>(src8);
+        channel_type *dst = reinterpret_cast<channel_type*>(dst8);
+
+        for (; nPixels > 0; nPixels--, src += Traits::channels_nb, dst += Traits::channels_nb) {
+            const float r = src[Traits::red_pos] * scale;
+            const float g = src[Traits::green_pos] * scale;
+            const float b = src[Traits::blue_pos] * scale;
+            const channel_type alpha = src[Traits::alpha_pos];
+
+            const int ri = qMin(int(r), maxIndex);
+            const int gi = qMin(int(g), maxIndex);
+            const int bi = qMin(int(b), maxIndex);
+
+            const float fr = r - ri;
+            const float fg = g - gi;
+            const float fb = b - bi;
+
+            /**
+             * Tetrahedral interpolation: the cube of the grid is split into
+             * six tetrahedrons along its main diagonal, the one containing
+             * the pixel is selected by the order of the fractional parts
+             */
+            const float *c000 = table + ri * strideR + gi * strideG + bi * strideB;
+            const float *c111 = c000 + strideR + strideG + strideB;
+            const float *c1;
+            const float *c2;
+            float w0, w1, w2, w3;
+
+            if (fr > fg) {
+                if (fg > fb) {
+                    c1 = c000 + strideR; c2 = c1 + strideG;
+                    w0 = 1.0f - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+                } else if (fr > fb) {
+                    c1 = c000 + strideR; c2 = c1 + strideB;
+                    w0 = 1.0f - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+                } else {
+                    c1 = c000 + strideB; c2 = c1 + strideR;
+                    w0 = 1.0f - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+                }
+            } else {
+                if (fb > fg) {
+                    c1 = c000 + strideB; c2 = c1 + strideG;
+                    w0 = 1.0f - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+                } else if (fb > fr) {
+                    c1 = c000 + strideG; c2 = c1 + strideB;
+                    w0 = 1.0f - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+                } else {
+                    c1 = c000 + strideG; c2 = c1 + strideR;
+                    w0 = 1.0f - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+                }
+            }
+
+            float result[lut3DNodeSize];
+            for (int i = 0; i < lut3DNodeSize; i++) {
+                result[i] = w0 * c000[i] + w1 * c1[i] + w2 * c2[i] + w3 * c111[i];
+            }
+
+            dst[Traits::red_pos] = channel_type(qBound(0.0f, result[0], unitValue) + 0.5f);
+            dst[Traits::green_pos] = channel_type(qBound(0.0f, result[1], unitValue) + 0.5f);
+            dst[Traits::blue_pos] = channel_type(qBound(0.0f, result[2], unitValue) + 0.5f);
+            dst[Traits::alpha_pos] = alpha;
+        }
+    }
+};
+
+#ifdef HAVE_VC
+
+/**
+ * The vectorized version processes Vc::float_v::size() pixels at once.
+ * The tetrahedron is selected without branches: the corners are the
+ * nodes reached by stepping along the axes in the descending order of
+ * the fractional parts, so only the largest and the smallest axes are
+ * needed. All the offsets stay below 2^24, so they are computed exactly
+ * in floats and converted to indexes only for the gathers from the table.
+ */
+template <typename channel_type, Vc::Implementation _impl>
+struct KoLut3DInterpolator<channel_type, _impl,
+        typename std::enable_if<_impl != Vc::ScalarImpl>::type>
+{
+    static void transform(const float *table, int gridSize, const quint8 *src8, quint8 *dst8, qint32 nPixels)
+    {
+        typedef KoBgrTraits<channel_type> Traits;
+        typedef Vc::float_v::IndexType index_v;
+        const int vectorSize = Vc::float_v::Size;
+
+        const float unitValue = KoColorSpaceMathsTraits<channel_type>::unitValue;
+
+        const Vc::float_v vScale((gridSize - 1) / unitValue);
+        const Vc::float_v vMaxIndex(gridSize - 2);
+        const Vc::float_v vUnitValue(unitValue);
+        const Vc::float_v vZero(Vc::Zero);
+        const Vc::float_v vOne(Vc::One);
+        const Vc::float_v vHalf(0.5f);
+
+        const Vc::float_v vStrideB(lut3DNodeSize);
+        const Vc::float_v vStrideG(lut3DNodeSize * gridSize);
+        const Vc::float_v vStrideR(lut3DNodeSize * gridSize * gridSize);
+        const Vc::float_v vStrideRGB = vStrideR + vStrideG + vStrideB;
+
+        const channel_type *src = reinterpret_cast<const channel_type*>(src8);
+        channel_type *dst = reinterpret_cast<channel_type*>(dst8);
+
+        float srcRed[vectorSize];
+        float srcGreen[vectorSize];
+        float srcBlue[vectorSize];
+        channel_type srcAlpha[vectorSize];
+
+        int dstRed[vectorSize];
+        int dstGreen[vectorSize];
+        int dstBlue[vectorSize];
+
+        while (nPixels > 0) {
+            /**
+             * The last block is padded with black pixels, so the tail
+             * doesn't need a separate scalar code path
+             */
+            const int blockSize = qMin(nPixels, vectorSize);
+
+            for (int i = 0; i < vectorSize; i++) {
+                if (i < blockSize) {
+                    const channel_type *pixel = src + i * Traits::channels_nb;
+                    srcRed[i] = pixel[Traits::red_pos];
+                    srcGreen[i] = pixel[Traits::green_pos];
+                    srcBlue[i] = pixel[Traits::blue_pos];
+                    srcAlpha[i] = pixel[Traits::alpha_pos];
+                } else {
+                    srcRed[i] = srcGreen[i] = srcBlue[i] = 0.0f;
+                }
+            }
+
+            const Vc::float_v r = Vc::float_v(srcRed, Vc::Unaligned) * vScale;
+            const Vc::float_v g = Vc::float_v(srcGreen, Vc::Unaligned) * vScale;
+            const Vc::float_v b = Vc::float_v(srcBlue, Vc::Unaligned) * vScale;
+
+            const Vc::float_v ri = Vc::min(Vc::floor(r), vMaxIndex);
+            const Vc::float_v gi = Vc::min(Vc::floor(g), vMaxIndex);
+            const Vc::float_v bi = Vc::min(Vc::floor(b), vMaxIndex);
+
+            const Vc::float_v fr = r - ri;
+            const Vc::float_v fg = g - gi;
+            const Vc::float_v fb = b - bi;
+
+            const Vc::float_m rg = fr > fg;
+            const Vc::float_m gb = fg > fb;
+            const Vc::float_m rb = fr > fb;
+
+            // the axis with the largest fractional part
+            const Vc::float_v offset1 =
+                Vc::iif(rg && rb, vStrideR, Vc::iif(gb, vStrideG, vStrideB));
+
+            // the two axes with the largest fractional parts
+            const Vc::float_v offset2 = vStrideRGB -
+                Vc::iif(rb && gb, vStrideB, Vc::iif(!rg && !rb, vStrideR, vStrideG));
+
+            const Vc::float_v x1 = Vc::max(fr, Vc::max(fg, fb));
+            const Vc::float_v x2 = Vc::max(Vc::min(fr, fg), Vc::min(Vc::max(fr, fg), fb));
+            const Vc::float_v x3 = Vc::min(fr, Vc::min(fg, fb));
+
+            const Vc::float_v w0 = vOne - x1;
+            const Vc::float_v w1 = x1 - x2;
+            const Vc::float_v w2 = x2 - x3;
+            const Vc::float_v &w3 = x3;
+
+            const Vc::float_v base = ri * vStrideR + gi * vStrideG + bi * vStrideB;
+
+            const index_v i000(base);
+            const index_v i1(base + offset1);
+            const index_v i2(base + offset2);
+            const index_v i111(base + vStrideRGB);
+
+            int *dstChannels[lut3DNodeSize] = {dstRed, dstGreen, dstBlue};
+
+            for (int ch = 0; ch < lut3DNodeSize; ch++) {
+                const float *channelTable = table + ch;
+
+                Vc::float_v c000;
+                Vc::float_v c1;
+                Vc::float_v c2;
+                Vc::float_v c111;
+
+                c000.gather(channelTable, i000);
+                c1.gather(channelTable, i1);
+                c2.gather(channelTable, i2);
+                c111.gather(channelTable, i111);
+
+                Vc::float_v result = w0 * c000 + w1 * c1 + w2 * c2 + w3 * c111;
+                result = Vc::min(Vc::max(result, vZero), vUnitValue) + vHalf;
+
+                index_v(result).store(dstChannels[ch], Vc::Unaligned);
+            }
+
+            for (int i = 0; i < blockSize; i++) {
+                channel_type *pixel = dst + i * Traits::channels_nb;
+                pixel[Traits::red_pos] = channel_type(dstRed[i]);
+                pixel[Traits::green_pos] = channel_type(dstGreen[i]);
+                pixel[Traits::blue_pos] = channel_type(dstBlue[i]);
+                pixel[Traits::alpha_pos] = srcAlpha[i];
+            }
+
+            src += blockSize * Traits::channels_nb;
+            dst += blockSize * Traits::channels_nb;
+            nPixels -= blockSize;
+        }
+    }
+};
+
+#endif /* HAVE_VC */
+
+#endif /* __KO_LUT_3D_INTERPOLATOR_H */
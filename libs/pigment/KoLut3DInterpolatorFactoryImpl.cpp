@@ -0,0 +1,31 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoLut3DInterpolatorFactoryImpl.h"
+#include "KoLut3DInterpolator.h"
+
+template <typename channel_type>
+template<Vc::Implementation _impl>
+KoLut3DTransformFunc
+KoLut3DInterpolatorFactoryImpl<channel_type>::create(int)
+{
+    return &KoLut3DInterpolator<channel_type, _impl>::transform;
+}
+
+template KoLut3DTransformFunc KoLut3DInterpolatorFactoryImpl<quint8>::create<Vc::CurrentImplementation::current()>(int);
+template KoLut3DTransformFunc KoLut3DInterpolatorFactoryImpl<quint16>::create<Vc::CurrentImplementation::current()>(int);
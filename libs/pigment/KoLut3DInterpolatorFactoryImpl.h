@@ -0,0 +1,46 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KO_LUT_3D_INTERPOLATOR_FACTORY_IMPL_H
+#define __KO_LUT_3D_INTERPOLATOR_FACTORY_IMPL_H
+
+#include <QtGlobal>
+#include <KoVcMultiArchBuildSupport.h>
+
+/**
+ * Every node of the 3D LUT table stores the red, green and blue values
+ * of the transformed pixel, in the units of the channel type. The nodes
+ * are ordered by red, then green, then blue.
+ */
+const int lut3DNodeSize = 3;
+
+typedef void (*KoLut3DTransformFunc)(const float *table, int gridSize,
+                                     const quint8 *src, quint8 *dst, qint32 nPixels);
+
+template <typename channel_type>
+class KoLut3DInterpolatorFactoryImpl
+{
+public:
+    typedef int ParamType;
+    typedef KoLut3DTransformFunc ReturnType;
+
+    template<Vc::Implementation _impl>
+    static KoLut3DTransformFunc create(int);
+};
+
+#endif /* __KO_LUT_3D_INTERPOLATOR_FACTORY_IMPL_H */
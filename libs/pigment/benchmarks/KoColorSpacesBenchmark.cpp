@@ -19,10 +19,13 @@
 #include "KoColorSpacesBenchmark.h"
 
 #include <QTest>
+#include <QVector>
+#include <QColor>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
 
 #define NB_PIXELS 1000000
+#define NB_COLORS 100000
 
 void KoColorSpacesBenchmark::createRowsColumns()
 {
@@ -46,6 +49,19 @@ void KoColorSpacesBenchmark::createRowsColumns()
 #define END_BENCHMARK \
     delete[] data;
 
+#define START_QCOLOR_BENCHMARK \
+    QFETCH(QString, modelID); \
+    QFETCH(QString, depthID); \
+    \
+    const KoColorSpace* colorSpace = KoColorSpaceRegistry::instance()->colorSpace(modelID, depthID, 0); \
+    int pixelSize = colorSpace->pixelSize(); \
+    QVector<quint8> data(NB_COLORS * pixelSize); \
+    QVector<QColor> colors(NB_COLORS); \
+    for (int i = 0; i < NB_COLORS; ++i) { \
+        colors[i] = QColor(i % 256, (i / 256) % 256, (i * 7) % 256, 255 - i % 256); \
+    } \
+    colorSpace->fromQColors(colors.constData(), data.data(), NB_COLORS);
+
 void KoColorSpacesBenchmark::benchmarkAlpha_data()
 {
     createRowsColumns();
@@ -146,4 +162,64 @@ void KoColorSpacesBenchmark::benchmarkSetAlpha2IndividualCall()
     END_BENCHMARK
 }
 
+void KoColorSpacesBenchmark::benchmarkFromQColorIndividualCall_data()
+{
+    createRowsColumns();
+}
+
+void KoColorSpacesBenchmark::benchmarkFromQColorIndividualCall()
+{
+    START_QCOLOR_BENCHMARK
+    QBENCHMARK {
+        quint8* data_it = data.data();
+        for (int i = 0; i < NB_COLORS; ++i) {
+            colorSpace->fromQColor(colors[i], data_it);
+            data_it += pixelSize;
+        }
+    }
+}
+
+void KoColorSpacesBenchmark::benchmarkFromQColors_data()
+{
+    createRowsColumns();
+}
+
+void KoColorSpacesBenchmark::benchmarkFromQColors()
+{
+    START_QCOLOR_BENCHMARK
+    QBENCHMARK {
+        colorSpace->fromQColors(colors.constData(), data.data(), NB_COLORS);
+    }
+}
+
+void KoColorSpacesBenchmark::benchmarkToQColorIndividualCall_data()
+{
+    createRowsColumns();
+}
+
+void KoColorSpacesBenchmark::benchmarkToQColorIndividualCall()
+{
+    START_QCOLOR_BENCHMARK
+    QBENCHMARK {
+        const quint8* data_it = data.constData();
+        for (int i = 0; i < NB_COLORS; ++i) {
+            colorSpace->toQColor(data_it, &colors[i]);
+            data_it += pixelSize;
+        }
+    }
+}
+
+void KoColorSpacesBenchmark::benchmarkToQColors_data()
+{
+    createRowsColumns();
+}
+
+void KoColorSpacesBenchmark::benchmarkToQColors()
+{
+    START_QCOLOR_BENCHMARK
+    QBENCHMARK {
+        colorSpace->toQColors(data.constData(), colors.data(), NB_COLORS);
+    }
+}
+
 QTEST_MAIN(KoColorSpacesBenchmark)
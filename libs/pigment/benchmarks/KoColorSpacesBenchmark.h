@@ -39,6 +39,14 @@ private Q_SLOTS:
     void benchmarkSetAlphaIndividualCall();
     void benchmarkSetAlpha2IndividualCall_data();
     void benchmarkSetAlpha2IndividualCall();
+    void benchmarkFromQColorIndividualCall_data();
+    void benchmarkFromQColorIndividualCall();
+    void benchmarkFromQColors_data();
+    void benchmarkFromQColors();
+    void benchmarkToQColorIndividualCall_data();
+    void benchmarkToQColorIndividualCall();
+    void benchmarkToQColors_data();
+    void benchmarkToQColors();
 };
 
 #endif
@@ -20,12 +20,15 @@
 
 #include "../compositeops/KoCompositeOpAlphaDarken.h"
 #include "../compositeops/KoCompositeOpOver.h"
+#include "../compositeops/KoCompositeOpGeneric.h"
 #include <KoOptimizedCompositeOpFactory.h>
 
 #include <KoColorSpaceTraits.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
 
 #include <QTest>
+#include <QScopedPointer>
 
 const int TILE_WIDTH = 64;
 const int TILE_HEIGHT = 64;
@@ -108,5 +111,57 @@ void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenCreamy()
     }
 }
 
+KoCompositeOp* createLegacyBlendModeOp(const KoColorSpace *cs, const QString &id)
+{
+    typedef KoBgrU8Traits::channels_type T;
+
+    if (id == COMPOSITE_MULT) {
+        return new KoCompositeOpGenericSC<KoBgrU8Traits, &cfMultiply<T> >(cs, id, "", "");
+    } else if (id == COMPOSITE_SCREEN) {
+        return new KoCompositeOpGenericSC<KoBgrU8Traits, &cfScreen<T> >(cs, id, "", "");
+    } else if (id == COMPOSITE_OVERLAY) {
+        return new KoCompositeOpGenericSC<KoBgrU8Traits, &cfOverlay<T> >(cs, id, "", "");
+    } else if (id == COMPOSITE_DODGE) {
+        return new KoCompositeOpGenericSC<KoBgrU8Traits, &cfColorDodge<T> >(cs, id, "", "");
+    } else if (id == COMPOSITE_SOFT_LIGHT_PHOTOSHOP) {
+        return new KoCompositeOpGenericSC<KoBgrU8Traits, &cfSoftLight<T> >(cs, id, "", "");
+    }
+
+    return 0;
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeBlendModes_data()
+{
+    QTest::addColumn<QString>("id");
+    QTest::addColumn<bool>("optimized");
+
+    QStringList ids;
+    ids << COMPOSITE_MULT
+        << COMPOSITE_SCREEN
+        << COMPOSITE_OVERLAY
+        << COMPOSITE_DODGE
+        << COMPOSITE_SOFT_LIGHT_PHOTOSHOP;
+
+    Q_FOREACH (const QString &id, ids) {
+        QTest::newRow(QString("%1-legacy").arg(id).toLatin1()) << id << false;
+        QTest::newRow(QString("%1-optimized").arg(id).toLatin1()) << id << true;
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeBlendModes()
+{
+    QFETCH(QString, id);
+    QFETCH(bool, optimized);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    // the color space uses the optimized version when the CPU supports it
+    QScopedPointer<KoCompositeOp> legacyOp(createLegacyBlendModeOp(cs, id));
+    const KoCompositeOp *compositeOp = optimized ? cs->compositeOp(id) : legacyOp.data();
+
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK
+    }
+}
 
 QTEST_GUILESS_MAIN(KoCompositeOpsBenchmark)
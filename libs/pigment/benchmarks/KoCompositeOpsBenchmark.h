@@ -34,6 +34,9 @@ private Q_SLOTS:
     void benchmarkCompositeAlphaDarkenHard();
     void benchmarkCompositeAlphaDarkenCreamy();
 
+    void benchmarkCompositeBlendModes_data();
+    void benchmarkCompositeBlendModes();
+
 private:
     quint8 * m_dstBuffer;
     quint8 * m_srcBuffer;
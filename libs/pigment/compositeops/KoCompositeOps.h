@@ -62,6 +62,13 @@ struct OptimizedOpsSelector
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return new KoCompositeOpOver<Traits>(cs);
     }
+    static KoCompositeOp* createGenericSCOp(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        Q_UNUSED(cs);
+        Q_UNUSED(id);
+        Q_UNUSED(description);
+        Q_UNUSED(category);
+        return 0;
+    }
 };
 
 template<>
@@ -75,6 +82,9 @@ struct OptimizedOpsSelector<KoBgrU8Traits>
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return KoOptimizedCompositeOpFactory::createOverOp32(cs);
     }
+    static KoCompositeOp* createGenericSCOp(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        return KoOptimizedCompositeOpFactory::createGenericSCOp32(cs, id, description, category);
+    }
 };
 
 template<>
@@ -88,6 +98,9 @@ struct OptimizedOpsSelector<KoLabU8Traits>
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return KoOptimizedCompositeOpFactory::createOverOp32(cs);
     }
+    static KoCompositeOp* createGenericSCOp(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        return KoOptimizedCompositeOpFactory::createGenericSCOp32(cs, id, description, category);
+    }
 };
 
 template<>
@@ -112,6 +125,9 @@ struct OptimizedOpsSelector<KoRgbF32Traits>
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return KoOptimizedCompositeOpFactory::createOverOp128(cs);
     }
+    static KoCompositeOp* createGenericSCOp(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        return KoOptimizedCompositeOpFactory::createGenericSCOp128(cs, id, description, category);
+    }
 };
 
 template<class Traits>
@@ -123,7 +139,13 @@ struct AddGeneralOps<Traits, true>
 
      template<CompositeFunc func>
      static void add(KoColorSpace* cs, const QString& id, const QString& description, const QString& category) {
-         cs->addCompositeOp(new KoCompositeOpGenericSC<Traits, func>(cs, id, description, category));
+         KoCompositeOp *op = OptimizedOpsSelector<Traits>::createGenericSCOp(cs, id, description, category);
+
+         if (!op) {
+             op = new KoCompositeOpGenericSC<Traits, func>(cs, id, description, category);
+         }
+
+         cs->addCompositeOp(op);
      }
 
      static void add(KoColorSpace* cs) {
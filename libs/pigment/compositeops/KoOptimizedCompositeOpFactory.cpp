@@ -63,3 +63,15 @@ KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp128(const KoColorSpace
 {
     return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128> >(cs);
 }
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericSCOp32(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    const KoOptimizedGenericSCOpParams params = {cs, id, description, category};
+    return createOptimizedClass<KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC32> >(params);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericSCOp128(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    const KoOptimizedGenericSCOpParams params = {cs, id, description, category};
+    return createOptimizedClass<KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC128> >(params);
+}
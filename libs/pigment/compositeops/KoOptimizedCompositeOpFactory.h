@@ -24,6 +24,7 @@
 
 class KoCompositeOp;
 class KoColorSpace;
+class QString;
 
 /**
  * The creation of the optimized composite ops is moved into a separate
@@ -46,6 +47,18 @@ public:
     static KoCompositeOp* createAlphaDarkenOpHard128(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOpCreamy128(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp128(const KoColorSpace *cs);
+
+    /**
+     * Create an optimized version of a separable blending mode (Multiply,
+     * Screen, Overlay, etc.), which gives the same result as
+     * KoCompositeOpGenericSC with the corresponding blending function
+     * (up to the rounding errors).
+     *
+     * \return null if there is no optimized version for the mode \p id
+     *         or the CPU does not support vector instructions
+     */
+    static KoCompositeOp* createGenericSCOp32(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
+    static KoCompositeOp* createGenericSCOp128(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
 };
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORY_H */
@@ -26,6 +26,8 @@
 #include "KoOptimizedCompositeOpAlphaDarken128.h"
 #include "KoOptimizedCompositeOpOver32.h"
 #include "KoOptimizedCompositeOpOver128.h"
+#include "KoOptimizedCompositeOpGenericSC32.h"
+#include "KoOptimizedCompositeOpGenericSC128.h"
 
 #include <QString>
 #include "DebugPigment.h"
@@ -85,3 +87,60 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoOptimizedCompositeOpOver128<Vc::CurrentImplementation::current()>(param);
 }
+
+template<template<Vc::Implementation I, class BlendFunction> class CompositeOp,
+         Vc::Implementation _impl,
+         class BlendFunction>
+KoCompositeOp* newOptimizedGenericSCOp(const KoOptimizedGenericSCOpParams &param)
+{
+    return new CompositeOp<_impl, BlendFunction>(param.colorSpace, param.id, param.description, param.category);
+}
+
+template<template<Vc::Implementation I, class BlendFunction> class CompositeOp,
+         Vc::Implementation _impl>
+KoCompositeOp* createOptimizedGenericSCOp(const KoOptimizedGenericSCOpParams &param)
+{
+    const QString &id = param.id;
+
+    if (id == COMPOSITE_MULT) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendMultiply>(param);
+    } else if (id == COMPOSITE_SCREEN) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendScreen>(param);
+    } else if (id == COMPOSITE_OVERLAY) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendOverlay>(param);
+    } else if (id == COMPOSITE_HARD_LIGHT) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendHardLight>(param);
+    } else if (id == COMPOSITE_DODGE) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendColorDodge>(param);
+    } else if (id == COMPOSITE_SOFT_LIGHT_PHOTOSHOP) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendSoftLight>(param);
+    } else if (id == COMPOSITE_DARKEN) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendDarken>(param);
+    } else if (id == COMPOSITE_LIGHTEN) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendLighten>(param);
+    } else if (id == COMPOSITE_ADD || id == COMPOSITE_LINEAR_DODGE) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendAddition>(param);
+    } else if (id == COMPOSITE_SUBTRACT) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendSubtract>(param);
+    } else if (id == COMPOSITE_DIFF) {
+        return newOptimizedGenericSCOp<CompositeOp, _impl, KoStreamedBlendDifference>(param);
+    }
+
+    return 0;
+}
+
+template<>
+template<>
+KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC32>::ReturnType
+KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC32>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return createOptimizedGenericSCOp<KoOptimizedCompositeOpGenericSC32, Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+template<>
+KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC128>::ReturnType
+KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC128>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return createOptimizedGenericSCOp<KoOptimizedCompositeOpGenericSC128, Vc::CurrentImplementation::current()>(param);
+}
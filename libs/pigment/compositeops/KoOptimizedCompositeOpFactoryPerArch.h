@@ -23,6 +23,8 @@
 
 #include <compositeops/KoVcMultiArchBuildSupport.h>
 
+#include <QString>
+
 
 class KoCompositeOp;
 class KoColorSpace;
@@ -46,6 +48,12 @@ class KoOptimizedCompositeOpAlphaDarkenCreamy128;
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpOver128;
 
+template<Vc::Implementation _impl, class BlendFunction>
+class KoOptimizedCompositeOpGenericSC32;
+
+template<Vc::Implementation _impl, class BlendFunction>
+class KoOptimizedCompositeOpGenericSC128;
+
 template<template<Vc::Implementation I> class CompositeOp>
 struct KoOptimizedCompositeOpFactoryPerArch
 {
@@ -56,5 +64,29 @@ struct KoOptimizedCompositeOpFactoryPerArch
     static ReturnType create(ParamType param);
 };
 
+struct KoOptimizedGenericSCOpParams
+{
+    const KoColorSpace *colorSpace;
+    QString id;
+    QString description;
+    QString category;
+};
+
+/**
+ * Creates an optimized version of the separable blending mode \p id,
+ * or returns null if there is no optimized version for the mode or for
+ * the architecture. In the latter case the caller should fall back to
+ * KoCompositeOpGenericSC.
+ */
+template<template<Vc::Implementation I, class BlendFunction> class CompositeOp>
+struct KoOptimizedGenericSCOpFactoryPerArch
+{
+    typedef const KoOptimizedGenericSCOpParams& ParamType;
+    typedef KoCompositeOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType param);
+};
+
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORYPERARCH_H */
@@ -72,3 +72,21 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoCompositeOpOver<KoRgbF32Traits>(param);
 }
+
+template<>
+template<>
+KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC32>::ReturnType
+KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC32>::create<Vc::ScalarImpl>(ParamType param)
+{
+    Q_UNUSED(param);
+    return 0;
+}
+
+template<>
+template<>
+KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC128>::ReturnType
+KoOptimizedGenericSCOpFactoryPerArch<KoOptimizedCompositeOpGenericSC128>::create<Vc::ScalarImpl>(ParamType param)
+{
+    Q_UNUSED(param);
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPGENERICSC128_H
+#define KOOPTIMIZEDCOMPOSITEOPGENERICSC128_H
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoStreamedBlendFunctions.h"
+
+
+/**
+ * The floating point version of GenericSCCompositor32. The channels
+ * are not clamped, the same way as KoCompositeOpGenericSC does not
+ * clamp them for floating point color spaces.
+ */
+template<class BlendFunction, bool alphaLocked, bool allChannelsFlag>
+struct GenericSCCompositor128 {
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    struct Pixel {
+        float red;
+        float green;
+        float blue;
+        float alpha;
+    };
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        const Pixel *sp = reinterpret_cast<const Pixel*>(src);
+        Pixel *dp = reinterpret_cast<Pixel*>(dst);
+
+        Vc::float_v src_alpha;
+        Vc::float_v dst_alpha;
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+
+        const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> data(const_cast<Pixel*>(sp));
+        tie(src_c1, src_c2, src_c3, src_alpha) = data[indexes];
+
+        src_alpha *= Vc::float_v(opacity);
+
+        if (haveMask) {
+            const Vc::float_v uint8MaxRec1((float)1.0 / 255);
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> dataDest(dp);
+        tie(dst_c1, dst_c2, dst_c3, dst_alpha) = dataDest[indexes];
+
+        // \see docs in GenericSCCompositor32::blendChannel()
+        const Vc::float_v src_weight = src_alpha * (oneValue - dst_alpha);
+        const Vc::float_v dst_weight = dst_alpha * (oneValue - src_alpha);
+        const Vc::float_v blend_weight = src_alpha * dst_alpha;
+        const Vc::float_v new_alpha = src_weight + dst_weight + blend_weight;
+
+        const Vc::float_m opaque_pixels_mask = new_alpha != zeroValue;
+        const Vc::float_v new_alpha_rec = oneValue / new_alpha;
+
+        dst_c1(opaque_pixels_mask) =
+            (src_weight * src_c1 + dst_weight * dst_c1 +
+             blend_weight * BlendFunction::template blendVector<_impl>(src_c1, dst_c1)) * new_alpha_rec;
+
+        dst_c2(opaque_pixels_mask) =
+            (src_weight * src_c2 + dst_weight * dst_c2 +
+             blend_weight * BlendFunction::template blendVector<_impl>(src_c2, dst_c2)) * new_alpha_rec;
+
+        dst_c3(opaque_pixels_mask) =
+            (src_weight * src_c3 + dst_weight * dst_c3 +
+             blend_weight * BlendFunction::template blendVector<_impl>(src_c3, dst_c3)) * new_alpha_rec;
+
+        dataDest[indexes] = tie(dst_c1, dst_c2, dst_c3, new_alpha);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        const qint32 alpha_pos = 3;
+
+        const float *s = reinterpret_cast<const float*>(src);
+        float *d = reinterpret_cast<float*>(dst);
+
+        float srcAlpha = s[alpha_pos] * opacity;
+
+        if (haveMask) {
+            const float uint8Rec1 = 1.0 / 255;
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        if (!allChannelsFlag && d[alpha_pos] == 0.0f) {
+            KoStreamedMathFunctions::clearPixel<16>(dst);
+        }
+
+        if (srcAlpha == 0.0f) return;
+
+        const float dstAlpha = d[alpha_pos];
+
+        if (alphaLocked) {
+            if (dstAlpha == 0.0f) return;
+
+            for (int i = 0; i < alpha_pos; i++) {
+                if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                    const float result = BlendFunction::template blendScalar<_impl>(s[i], d[i]);
+                    d[i] = (result - d[i]) * srcAlpha + d[i];
+                }
+            }
+        } else {
+            const float srcWeight = srcAlpha * (1.0f - dstAlpha);
+            const float dstWeight = dstAlpha * (1.0f - srcAlpha);
+            const float blendWeight = srcAlpha * dstAlpha;
+            const float newAlpha = srcWeight + dstWeight + blendWeight;
+
+            if (newAlpha != 0.0f) {
+                const float newAlphaRec = 1.0f / newAlpha;
+
+                for (int i = 0; i < alpha_pos; i++) {
+                    if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                        const float result = BlendFunction::template blendScalar<_impl>(s[i], d[i]);
+                        d[i] = (srcWeight * s[i] + dstWeight * d[i] + blendWeight * result) * newAlphaRec;
+                    }
+                }
+            }
+
+            d[alpha_pos] = newAlpha;
+        }
+    }
+};
+
+/**
+ * An optimized version of KoCompositeOpGenericSC for the use in 16 byte
+ * colorspaces with alpha channel placed at the last channel of
+ * the pixel: C1_C2_C3_A.
+ */
+template<Vc::Implementation _impl, class BlendFunction>
+class KoOptimizedCompositeOpGenericSC128 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGenericSC128(const KoColorSpace* cs, const QString& id, const QString& description, const QString& category)
+        : KoCompositeOp(cs, id, description, category) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite128<haveMask, false, GenericSCCompositor128<BlendFunction, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite128_novector<haveMask, false, GenericSCCompositor128<BlendFunction, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite128_novector<haveMask, false, GenericSCCompositor128<BlendFunction, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite128_novector<haveMask, false, GenericSCCompositor128<BlendFunction, true, false> >(params);
+            }
+        }
+    }
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPGENERICSC128_H
@@ -0,0 +1,233 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPGENERICSC32_H
+#define KOOPTIMIZEDCOMPOSITEOPGENERICSC32_H
+
+#include "KoCompositeOpBase.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoStreamedBlendFunctions.h"
+
+
+template<class BlendFunction, bool alphaLocked, bool allChannelsFlag>
+struct GenericSCCompositor32 {
+    struct ParamsWrapper {
+        ParamsWrapper(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    /**
+     * Returns the sum of the three parts of the resulting color: the source
+     * over the transparent part of the destination, the destination under
+     * the transparent part of the source and the blending function where
+     * both of them are opaque. The color channels are in 0...255 range.
+     */
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendChannel(Vc::float_v::AsArg src, Vc::float_v::AsArg dst,
+                                                  Vc::float_v::AsArg src_weight,
+                                                  Vc::float_v::AsArg dst_weight,
+                                                  Vc::float_v::AsArg blend_weight)
+    {
+        const Vc::float_v uint8Max((float)255.0);
+        const Vc::float_v uint8MaxRec1((float)1.0 / 255.0);
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        Vc::float_v result =
+            BlendFunction::template blendVector<_impl>(src * uint8MaxRec1, dst * uint8MaxRec1);
+        result = Vc::min(Vc::max(result, zeroValue), oneValue) * uint8Max;
+
+        return src_weight * src + dst_weight * dst + blend_weight * result;
+    }
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        const Vc::float_v uint8Max((float)255.0);
+        const Vc::float_v uint8MaxRec1((float)1.0 / 255.0);
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        Vc::float_v src_alpha = KoStreamedMath<_impl>::template fetch_alpha_32<src_aligned>(src);
+        src_alpha *= Vc::float_v(opacity) * uint8MaxRec1;
+
+        if (haveMask) {
+            Vc::float_v mask_vec = KoStreamedMath<_impl>::fetch_mask_8(mask);
+            src_alpha *= mask_vec * uint8MaxRec1;
+        }
+
+        // The source cannot change the colors in the destination,
+        // since its fully transparent
+        if ((src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_alpha = KoStreamedMath<_impl>::template fetch_alpha_32<true>(dst) * uint8MaxRec1;
+
+        Vc::float_v src_c1;
+        Vc::float_v src_c2;
+        Vc::float_v src_c3;
+
+        Vc::float_v dst_c1;
+        Vc::float_v dst_c2;
+        Vc::float_v dst_c3;
+
+        KoStreamedMath<_impl>::template fetch_colors_32<src_aligned>(src, src_c1, src_c2, src_c3);
+        KoStreamedMath<_impl>::template fetch_colors_32<true>(dst, dst_c1, dst_c2, dst_c3);
+
+        const Vc::float_v src_weight = src_alpha * (oneValue - dst_alpha);
+        const Vc::float_v dst_weight = dst_alpha * (oneValue - src_alpha);
+        const Vc::float_v blend_weight = src_alpha * dst_alpha;
+        const Vc::float_v new_alpha = src_weight + dst_weight + blend_weight;
+
+        /**
+         * The pixels that are still transparent keep their color,
+         * the same way as KoCompositeOpGenericSC does. Their
+         * reciprocal is infinite, but it is never used.
+         */
+        const Vc::float_m opaque_pixels_mask = new_alpha != zeroValue;
+        const Vc::float_v new_alpha_rec = oneValue / new_alpha;
+
+        dst_c1(opaque_pixels_mask) = blendChannel<_impl>(src_c1, dst_c1, src_weight, dst_weight, blend_weight) * new_alpha_rec;
+        dst_c2(opaque_pixels_mask) = blendChannel<_impl>(src_c2, dst_c2, src_weight, dst_weight, blend_weight) * new_alpha_rec;
+        dst_c3(opaque_pixels_mask) = blendChannel<_impl>(src_c3, dst_c3, src_weight, dst_weight, blend_weight) * new_alpha_rec;
+
+        KoStreamedMath<_impl>::write_channels_32(dst, new_alpha * uint8Max, dst_c1, dst_c2, dst_c3);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const ParamsWrapper &oparams)
+    {
+        const qint32 alpha_pos = 3;
+
+        const float uint8Rec1 = 1.0 / 255.0;
+        const float uint8Max = 255.0;
+
+        float srcAlpha = src[alpha_pos] * uint8Rec1 * opacity;
+
+        if (haveMask) {
+            srcAlpha *= float(*mask) * uint8Rec1;
+        }
+
+        if (!allChannelsFlag && dst[alpha_pos] == 0) {
+            KoStreamedMathFunctions::clearPixel<4>(dst);
+        }
+
+        if (srcAlpha == 0.0) return;
+
+        const float dstAlpha = dst[alpha_pos] * uint8Rec1;
+
+        if (alphaLocked) {
+            if (dstAlpha == 0.0) return;
+
+            for (int i = 0; i < alpha_pos; i++) {
+                if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                    const float result = blendChannelScalar<_impl>(src[i], dst[i]);
+                    dst[i] = KoStreamedMath<_impl>::round_float_to_uint((result - dst[i]) * srcAlpha + dst[i]);
+                }
+            }
+        } else {
+            const float srcWeight = srcAlpha * (1.0f - dstAlpha);
+            const float dstWeight = dstAlpha * (1.0f - srcAlpha);
+            const float blendWeight = srcAlpha * dstAlpha;
+
+            // cannot be zero, since the source is not transparent
+            const float newAlpha = srcWeight + dstWeight + blendWeight;
+            const float newAlphaRec = 1.0f / newAlpha;
+
+            for (int i = 0; i < alpha_pos; i++) {
+                if (allChannelsFlag || oparams.channelFlags.at(i)) {
+                    const float result = blendChannelScalar<_impl>(src[i], dst[i]);
+                    dst[i] = KoStreamedMath<_impl>::round_float_to_uint(
+                        (srcWeight * src[i] + dstWeight * dst[i] + blendWeight * result) * newAlphaRec);
+                }
+            }
+
+            dst[alpha_pos] = KoStreamedMath<_impl>::round_float_to_uint(newAlpha * uint8Max);
+        }
+    }
+
+    template <Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendChannelScalar(quint8 src, quint8 dst)
+    {
+        const float uint8Rec1 = 1.0 / 255.0;
+        const float uint8Max = 255.0;
+
+        const float result = BlendFunction::template blendScalar<_impl>(src * uint8Rec1, dst * uint8Rec1);
+        return qBound(0.0f, result, 1.0f) * uint8Max;
+    }
+};
+
+/**
+ * An optimized version of KoCompositeOpGenericSC for the use in 4 byte
+ * colorspaces with alpha channel placed at the last byte of
+ * the pixel: C1_C2_C3_A. The blending function is passed as one of
+ * the structs from KoStreamedBlendFunctions.h.
+ */
+template<Vc::Implementation _impl, class BlendFunction>
+class KoOptimizedCompositeOpGenericSC32 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpGenericSC32(const KoColorSpace* cs, const QString& id, const QString& description, const QString& category)
+        : KoCompositeOp(cs, id, description, category) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMath<_impl>::template genericComposite32<haveMask, false, GenericSCCompositor32<BlendFunction, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericSCCompositor32<BlendFunction, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericSCCompositor32<BlendFunction, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMath<_impl>::template genericComposite32_novector<haveMask, false, GenericSCCompositor32<BlendFunction, true, false> >(params);
+            }
+        }
+    }
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPGENERICSC32_H
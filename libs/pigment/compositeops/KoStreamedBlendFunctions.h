@@ -0,0 +1,216 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KOSTREAMED_BLEND_FUNCTIONS_H
+#define __KOSTREAMED_BLEND_FUNCTIONS_H
+
+#include <cmath>
+#include "KoStreamedMath.h"
+
+/**
+ * Vector versions of the separable blending functions from
+ * KoCompositeOpFunctions.h, used by KoOptimizedCompositeOpGenericSC32
+ * and KoOptimizedCompositeOpGenericSC128.
+ *
+ * Every function gets the channel values normalized into 0.0...1.0 range
+ * and returns the value of the blending function in the same range. The
+ * result is *not* clamped, it is up to the caller to do that for the
+ * integer color spaces.
+ *
+ * Both versions are templated by the implementation, because they
+ * are compiled once for every architecture and should not be merged
+ * by the linker.
+ */
+
+struct KoStreamedBlendMultiply {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return src * dst;
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        return src * dst;
+    }
+};
+
+struct KoStreamedBlendScreen {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return src + dst - src * dst;
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        return src + dst - src * dst;
+    }
+};
+
+struct KoStreamedBlendHardLight {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        const Vc::float_v halfValue(0.5f);
+        const Vc::float_v oneValue(Vc::One);
+
+        const Vc::float_v src2 = src + src;
+        Vc::float_v result = src2 * dst;
+
+        const Vc::float_m screen_mask = src > halfValue;
+        if (!screen_mask.isEmpty()) {
+            // screen(src * 2.0 - 1.0, dst)
+            const Vc::float_v screenSrc = src2 - oneValue;
+            result(screen_mask) = screenSrc + dst - screenSrc * dst;
+        }
+
+        return result;
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        const float src2 = src + src;
+
+        if (src > 0.5f) {
+            const float screenSrc = src2 - 1.0f;
+            return screenSrc + dst - screenSrc * dst;
+        }
+
+        return src2 * dst;
+    }
+};
+
+struct KoStreamedBlendOverlay {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return KoStreamedBlendHardLight::blendVector<_impl>(dst, src);
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        return KoStreamedBlendHardLight::blendScalar<_impl>(dst, src);
+    }
+};
+
+struct KoStreamedBlendColorDodge {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        const Vc::float_v oneValue(Vc::One);
+
+        /**
+         * The lanes with unit source get a division by zero here,
+         * but they are overwritten right after that
+         */
+        Vc::float_v result = dst / (oneValue - src);
+        result(src == oneValue) = oneValue;
+
+        return result;
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        return src == 1.0f ? 1.0f : dst / (1.0f - src);
+    }
+};
+
+struct KoStreamedBlendSoftLight {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        const Vc::float_v halfValue(0.5f);
+        const Vc::float_v oneValue(Vc::One);
+
+        const Vc::float_v src2 = src + src;
+        Vc::float_v result = dst - (oneValue - src2) * dst * (oneValue - dst);
+
+        const Vc::float_m light_mask = src > halfValue;
+        if (!light_mask.isEmpty()) {
+            result(light_mask) = dst + (src2 - oneValue) * (Vc::sqrt(dst) - dst);
+        }
+
+        return result;
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        if (src > 0.5f) {
+            return dst + (2.0f * src - 1.0f) * (std::sqrt(dst) - dst);
+        }
+
+        return dst - (1.0f - 2.0f * src) * dst * (1.0f - dst);
+    }
+};
+
+struct KoStreamedBlendDarken {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::min(src, dst);
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        return qMin(src, dst);
+    }
+};
+
+struct KoStreamedBlendLighten {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::max(src, dst);
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        return qMax(src, dst);
+    }
+};
+
+struct KoStreamedBlendAddition {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return src + dst;
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        return src + dst;
+    }
+};
+
+struct KoStreamedBlendSubtract {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return dst - src;
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        return dst - src;
+    }
+};
+
+struct KoStreamedBlendDifference {
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE Vc::float_v blendVector(Vc::float_v::AsArg src, Vc::float_v::AsArg dst) {
+        return Vc::abs(src - dst);
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE float blendScalar(float src, float dst) {
+        return qAbs(src - dst);
+    }
+};
+
+#endif /* __KOSTREAMED_BLEND_FUNCTIONS_H */
@@ -0,0 +1,185 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoLut3DColorTransformation.h"
+
+#include <QTest>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <KoLut3DColorTransformation.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorSpaceMaths.h>
+#include <KoBgrColorSpaceTraits.h>
+#include <KoColorModelStandardIds.h>
+
+/**
+ * A smooth, but non-linear transformation that mixes the channels
+ */
+template <typename channel_type>
+struct KoMixChannelsTransformation : public KoColorTransformation
+{
+    KoMixChannelsTransformation(bool touchAlpha = false)
+        : m_touchAlpha(touchAlpha)
+    {
+    }
+
+    void transform(const quint8 *src8, quint8 *dst8, qint32 nPixels) const override
+    {
+        typedef KoBgrTraits<channel_type> Traits;
+        const qreal unitValue = KoColorSpaceMathsTraits<channel_type>::unitValue;
+
+        const channel_type *src = reinterpret_cast<const channel_type*>(src8);
+        channel_type *dst = reinterpret_cast<channel_type*>(dst8);
+
+        for (; nPixels > 0; nPixels--, src += 4, dst += 4) {
+            const qreal r = src[Traits::red_pos] / unitValue;
+            const qreal g = src[Traits::green_pos] / unitValue;
+            const qreal b = src[Traits::blue_pos] / unitValue;
+            const channel_type alpha = src[Traits::alpha_pos];
+
+            dst[Traits::red_pos] = qRound(0.5 * (r + g) * unitValue);
+            dst[Traits::green_pos] = qRound(g * g * unitValue);
+            dst[Traits::blue_pos] = qRound((1.0 - b * r) * unitValue);
+            dst[Traits::alpha_pos] = m_touchAlpha ? alpha / 2 : alpha;
+        }
+    }
+
+    bool m_touchAlpha;
+};
+
+template <typename channel_type>
+int maxLutError(const KoColorSpace *cs)
+{
+    const int numPixels = 100000;
+    const int unitValue = KoColorSpaceMathsTraits<channel_type>::unitValue;
+
+    KoMixChannelsTransformation<channel_type> transform;
+    QScopedPointer<KoLut3DColorTransformation> lut(KoLut3DColorTransformation::bake(&transform, cs));
+    if (!lut) return -1;
+
+    QVector<channel_type> src(numPixels * 4);
+    QVector<channel_type> refDst(src.size());
+    QVector<channel_type> lutDst(src.size());
+
+    qsrand(31524744);
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = qrand() % (unitValue + 1);
+    }
+
+    transform.transform(reinterpret_cast<const quint8*>(src.constData()),
+                        reinterpret_cast<quint8*>(refDst.data()), numPixels);
+    lut->transform(reinterpret_cast<const quint8*>(src.constData()),
+                   reinterpret_cast<quint8*>(lutDst.data()), numPixels);
+
+    int maxError = 0;
+    for (int i = 0; i < src.size(); i++) {
+        maxError = qMax(maxError, qAbs(int(refDst[i]) - int(lutDst[i])));
+    }
+
+    return maxError;
+}
+
+void TestKoLut3DColorTransformation::testBakeU8()
+{
+    const int maxError = maxLutError<quint8>(KoColorSpaceRegistry::instance()->rgb8());
+    QVERIFY(maxError >= 0);
+    QVERIFY(maxError <= 1);
+}
+
+void TestKoLut3DColorTransformation::testBakeU16()
+{
+    const int maxError = maxLutError<quint16>(KoColorSpaceRegistry::instance()->rgb16());
+    QVERIFY(maxError >= 0);
+
+    /**
+     * The interpolation error of g^2 and b*r on a grid with the step
+     * of 1/51 is at most (1/51)^2 / 4 of the unit, that is 6.3 for
+     * 16-bit, plus the rounding of the table nodes, the result and the
+     * reference, so the error should never exceed 7
+     */
+    QVERIFY(maxError <= 7);
+}
+
+/**
+ * The vectorized interpolation pads the last block of pixels, so the
+ * result of a pixel must not depend on the number of the pixels
+ * transformed at once or on the pixels around it
+ */
+template <typename channel_type>
+bool checkPixelCounts(const KoColorSpace *cs)
+{
+    const int numPixels = 37;
+    const int unitValue = KoColorSpaceMathsTraits<channel_type>::unitValue;
+
+    KoMixChannelsTransformation<channel_type> transform;
+    QScopedPointer<KoLut3DColorTransformation> lut(KoLut3DColorTransformation::bake(&transform, cs));
+    if (!lut) return false;
+
+    QVector<channel_type> src(numPixels * 4);
+
+    qsrand(7152913);
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = qrand() % (unitValue + 1);
+    }
+
+    QVector<channel_type> bulkDst(src.size());
+    lut->transform(reinterpret_cast<const quint8*>(src.constData()),
+                   reinterpret_cast<quint8*>(bulkDst.data()), numPixels);
+
+    QVector<channel_type> singleDst(src.size());
+    for (int i = 0; i < numPixels; i++) {
+        lut->transform(reinterpret_cast<const quint8*>(src.constData() + i * 4),
+                       reinterpret_cast<quint8*>(singleDst.data() + i * 4), 1);
+    }
+
+    QVector<channel_type> inPlaceDst(src);
+    lut->transform(reinterpret_cast<const quint8*>(inPlaceDst.constData()),
+                   reinterpret_cast<quint8*>(inPlaceDst.data()), numPixels);
+
+    return bulkDst == singleDst && bulkDst == inPlaceDst;
+}
+
+void TestKoLut3DColorTransformation::testOddPixelCount()
+{
+    QVERIFY(checkPixelCounts<quint8>(KoColorSpaceRegistry::instance()->rgb8()));
+    QVERIFY(checkPixelCounts<quint16>(KoColorSpaceRegistry::instance()->rgb16()));
+}
+
+void TestKoLut3DColorTransformation::testRejectAlphaTransformation()
+{
+    KoMixChannelsTransformation<quint8> transform(true);
+    QScopedPointer<KoLut3DColorTransformation> lut(
+        KoLut3DColorTransformation::bake(&transform, KoColorSpaceRegistry::instance()->rgb8()));
+
+    QVERIFY(!lut);
+}
+
+void TestKoLut3DColorTransformation::testUnsupportedColorSpace()
+{
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(GrayAColorModelID.id(), Integer8BitsColorDepthID.id(), 0);
+
+    QVERIFY(!KoLut3DColorTransformation::supportsColorSpace(KoColorSpaceRegistry::instance()->alpha8()));
+    if (cs) {
+        QVERIFY(!KoLut3DColorTransformation::supportsColorSpace(cs));
+    }
+    QVERIFY(KoLut3DColorTransformation::supportsColorSpace(KoColorSpaceRegistry::instance()->rgb8()));
+}
+
+QTEST_GUILESS_MAIN(TestKoLut3DColorTransformation)
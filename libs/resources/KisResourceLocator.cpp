@@ -81,7 +81,7 @@ KisResourceLocator::~KisResourceLocator()
 {
 }
 
-KisResourceLocator::LocatorError KisResourceLocator::initialize(const QString &installationResourcesLocation)
+KisResourceLocator::LocatorError KisResourceLocator::initialize(const QString &installationResourcesLocation, bool synchronizeStorages)
 {
     InitializationStatus initializationStatus = InitializationStatus::Unknown;
 
@@ -133,11 +133,14 @@ KisResourceLocator::LocatorError KisResourceLocator::initialize(const QString &i
         }
         initializationStatus = InitializationStatus::Initialized;
     }
-    else {
+    else if (synchronizeStorages) {
         if (!synchronizeDb()) {
             return LocatorError::CannotSynchronizeDb;
         }
     }
+    else {
+        findStorages();
+    }
     return LocatorError::Ok;
 }
 
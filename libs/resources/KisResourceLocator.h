@@ -70,8 +70,13 @@ public:
      *
      * @param installationResourcesLocation the place where the resources
      * that come packaged with Krita reside.
+     * @param synchronizeStorages if false, the storages are not compared
+     * with the database and the database is used as it was left by the
+     * previous run. It is used by the headless batch jobs, which do not
+     * need the resources the user has added since then. The first
+     * installation and updates are always performed.
      */
-    LocatorError initialize(const QString &installationResourcesLocation);
+    LocatorError initialize(const QString &installationResourcesLocation, bool synchronizeStorages = true);
 
     /**
      * @brief errorMessages
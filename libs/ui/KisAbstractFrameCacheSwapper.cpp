@@ -17,6 +17,10 @@
  */
 #include "KisAbstractFrameCacheSwapper.h"
 
+KisAbstractFrameCacheSwapper::PreparedFrame::~PreparedFrame()
+{
+}
+
 KisAbstractFrameCacheSwapper::~KisAbstractFrameCacheSwapper()
 {
 }
@@ -19,6 +19,7 @@
 #define KISABSTRACTFRAMECACHESWAPPER_H
 
 #include "kritaui_export.h"
+#include <QSharedPointer>
 
 class QRect;
 
@@ -32,10 +33,34 @@ typedef KisSharedPtr<KisOpenGLUpdateInfo> KisOpenGLUpdateInfoSP;
 class KRITAUI_EXPORT KisAbstractFrameCacheSwapper
 {
 public:
+    /**
+     * A frame that has already been converted into the swapper's storage
+     * format, but is not yet registered under any frame id
+     */
+    struct KRITAUI_EXPORT PreparedFrame {
+        virtual ~PreparedFrame();
+    };
+    typedef QSharedPointer<PreparedFrame> PreparedFrameSP;
+
     virtual ~KisAbstractFrameCacheSwapper();
 
     // WARNING: after transferring \p info to saveFrame() the object becomes invalid
     virtual void saveFrame(int frameId, KisOpenGLUpdateInfoSP info, const QRect &imageBounds) = 0;
+
+    /**
+     * Does the heavy part of saveFrame(): converts and compresses \p info.
+     * The method is thread-safe, it can be called concurrently with any
+     * other method of the swapper, so the callers should not guard it
+     * with their locks.
+     *
+     * WARNING: after transferring \p info to prepareFrame() the object becomes invalid
+     */
+    virtual PreparedFrameSP prepareFrame(KisOpenGLUpdateInfoSP info, const QRect &imageBounds) = 0;
+
+    /**
+     * Registers \p frame, returned by prepareFrame(), under \p frameId
+     */
+    virtual void savePreparedFrame(int frameId, PreparedFrameSP frame) = 0;
     virtual KisOpenGLUpdateInfoSP loadFrame(int frameId) = 0;
 
     virtual void moveFrame(int srcFrameId, int dstFrameId) = 0;
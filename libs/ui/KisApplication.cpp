@@ -136,6 +136,7 @@ public:
     KisAutoSaveRecoveryDialog *autosaveDialog {0};
     QPointer<KisMainWindow> mainWindow; // The first mainwindow we create on startup
     bool batchRun {false};
+    bool leanStartup {false};
     QVector<QByteArray> earlyRemoteArguments;
 };
 
@@ -381,7 +382,7 @@ bool KisApplication::registerResources()
         //return false;
     }
 
-    KisResourceLocator::LocatorError r = KisResourceLocator::instance()->initialize(KoResourcePaths::getApplicationRoot() + "/share/krita");
+    KisResourceLocator::LocatorError r = KisResourceLocator::instance()->initialize(KoResourcePaths::getApplicationRoot() + "/share/krita", !d->leanStartup);
     connect(KisResourceLocator::instance(), SIGNAL(progressMessage(const QString&)), this, SLOT(setSplashScreenLoadingText(const QString&)));
     if (r != KisResourceLocator::LocatorError::Ok && qApp->inherits("KisApplication")) {
         QMessageBox::critical(0, i18nc("@title:window", "Krita: Fatal error"), KisResourceLocator::instance()->errorMessages().join('\n') + i18n("\n\nKrita will quit now."));
@@ -391,6 +392,16 @@ bool KisApplication::registerResources()
     return true;
 }
 
+void KisApplication::setLeanStartup(bool value)
+{
+    d->leanStartup = value && qEnvironmentVariableIsEmpty("KRITA_NO_LEAN_STARTUP");
+}
+
+bool KisApplication::leanStartup() const
+{
+    return d->leanStartup;
+}
+
 void KisApplication::loadPlugins()
 {
     //    qDebug() << "loadPlugins();";
@@ -398,9 +409,17 @@ void KisApplication::loadPlugins()
     KoShapeRegistry* r = KoShapeRegistry::instance();
     r->add(new KisShapeSelectionFactory());
     KoColorSpaceRegistry::instance();
-    KisActionRegistry::instance();
     KisFilterRegistry::instance();
     KisGeneratorRegistry::instance();
+
+    /**
+     * The rest of the registries are needed only by the GUI. They
+     * load their plugins on the first use anyway, so the headless
+     * jobs do not pay for them.
+     */
+    if (d->leanStartup) return;
+
+    KisActionRegistry::instance();
     KisPaintOpRegistry::instance();
     KoToolRegistry::instance();
     KoDockRegistry::instance();
@@ -454,6 +473,7 @@ bool KisApplication::start(const KisApplicationArguments &args)
 
     d->batchRun = (exportAs || exportSequence || !exportFileName.isEmpty());
     const bool needsMainWindow = (!exportAs && !exportSequence);
+    setLeanStartup(!needsMainWindow);
     // only show the mainWindow when no command-line mode option is passed
     bool showmainWindow = (!exportAs && !exportSequence); // would be !batchRun;
 
@@ -464,9 +484,11 @@ bool KisApplication::start(const KisApplicationArguments &args)
         processEvents();
     }
 
-    KConfigGroup group(KSharedConfig::openConfig(), "theme");
-    Digikam::ThemeManager themeManager;
-    themeManager.setCurrentTheme(group.readEntry("Theme", "Krita dark"));
+    if (!d->leanStartup) {
+        KConfigGroup group(KSharedConfig::openConfig(), "theme");
+        Digikam::ThemeManager themeManager;
+        themeManager.setCurrentTheme(group.readEntry("Theme", "Krita dark"));
+    }
 
     ResetStarting resetStarting(d->splashScreen, args.filenames().count()); // remove the splash when done
     Q_UNUSED(resetStarting);
@@ -93,6 +93,18 @@ public:
     /// Overridden to handle exceptions from event handlers.
     bool notify(QObject *receiver, QEvent *event) override;
 
+    /**
+     * Lean startup is used by the headless batch jobs, like command-line
+     * export or kritarunner. The registries needed only by the GUI are not
+     * created eagerly (all the registries are created on the first use
+     * anyway), the resource database is not synchronized with the resource
+     * folders and the GUI theme is not loaded.
+     *
+     * Setting KRITA_NO_LEAN_STARTUP environment variable disables it.
+     */
+    void setLeanStartup(bool value);
+    bool leanStartup() const;
+
     void addResourceTypes();
     bool registerResources();
     void loadPlugins();
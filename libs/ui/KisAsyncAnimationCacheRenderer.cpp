@@ -24,7 +24,14 @@
 struct KisAsyncAnimationCacheRenderer::Private
 {
     KisAnimationFrameCacheSP requestedCache;
-    KisOpenGLUpdateInfoSP requestInfo;
+    int requestedCacheSeqNo = -1;
+
+    /**
+     * The frame is compressed in the context of the image worker
+     * thread and is only committed into the cache in the GUI thread
+     */
+    KisAnimationFrameCacheSP savedCache;
+    int savedFrameId = -1;
 };
 
 
@@ -41,6 +48,7 @@ KisAsyncAnimationCacheRenderer::~KisAsyncAnimationCacheRenderer()
 void KisAsyncAnimationCacheRenderer::setFrameCache(KisAnimationFrameCacheSP cache)
 {
     m_d->requestedCache = cache;
+    m_d->requestedCacheSeqNo = cache ? cache->invalidationSeqNo() : -1;
 }
 
 void KisAsyncAnimationCacheRenderer::frameCompletedCallback(int frame, const KisRegion &requestedRegion)
@@ -49,20 +57,45 @@ void KisAsyncAnimationCacheRenderer::frameCompletedCallback(int frame, const Kis
     KisImageSP image = requestedImage();
     if (!cache || !image) return;
 
-    m_d->requestInfo = cache->fetchFrameData(frame, image, requestedRegion);
+    KisOpenGLUpdateInfoSP info = cache->fetchFrameData(frame, image, requestedRegion);
+
+    if (info) {
+        m_d->savedCache = cache;
+        m_d->savedFrameId = cache->saveConvertedFrameData(info, image);
+    }
+
     emit sigCompleteRegenerationInternal(frame);
 }
 
 void KisAsyncAnimationCacheRenderer::slotCompleteRegenerationInternal(int frame)
 {
-    if (!isActive()) return;
+    KisAnimationFrameCacheSP savedCache = m_d->savedCache;
+    const int savedFrameId = m_d->savedFrameId;
+
+    m_d->savedCache.clear();
+    m_d->savedFrameId = -1;
+
+    if (!isActive()) {
+        if (savedCache) {
+            savedCache->discardConvertedFrameData(savedFrameId);
+        }
+        return;
+    }
 
-    KIS_SAFE_ASSERT_RECOVER(m_d->requestInfo) {
+    KIS_SAFE_ASSERT_RECOVER(savedCache == m_d->requestedCache) {
+        if (savedCache) {
+            savedCache->discardConvertedFrameData(savedFrameId);
+        }
         frameCancelledCallback(frame);
         return;
     }
 
-    m_d->requestedCache->addConvertedFrameData(m_d->requestInfo, frame);
+    /**
+     * If the image has been changed while the frame was regenerated, the
+     * frame is dropped, but the rendering is still considered completed:
+     * the populator will request the frame again.
+     */
+    savedCache->commitConvertedFrameData(savedFrameId, frame, m_d->requestedCacheSeqNo);
     notifyFrameCompleted(frame);
 }
 
@@ -74,8 +107,8 @@ void KisAsyncAnimationCacheRenderer::frameCancelledCallback(int frame)
 
 void KisAsyncAnimationCacheRenderer::clearFrameRegenerationState(bool isCancelled)
 {
-    m_d->requestInfo.clear();
     m_d->requestedCache.clear();
+    m_d->requestedCacheSeqNo = -1;
 
     KisAsyncAnimationRendererBase::clearFrameRegenerationState(isCancelled);
 }
@@ -122,8 +122,49 @@ FrameInfo::~FrameInfo()
     }
 }
 
+bool convertToSerializableFrame(KisOpenGLUpdateInfoSP info, KisFrameDataSerializer::Frame *frame)
+{
+    int pixelSize = 0;
+
+    Q_FOREACH (auto tile, info->tileList) {
+#ifdef SANITY_CHECK
+        if (!pixelSize) {
+            pixelSize = tile->pixelSize();
+        } else {
+            KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(pixelSize == tile->pixelSize(), false);
+        }
+#else
+        pixelSize = tile->pixelSize();
+        break;
+#endif
+    }
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(pixelSize, false);
+
+    // TODO: assert that dirty image rect is equal to the full image rect
+    // TODO: assert tile color space coicides with the destination color space
+
+    frame->pixelSize = pixelSize;
+
+    for (auto it = info->tileList.begin(); it != info->tileList.end(); ++it) {
+        KisFrameDataSerializer::FrameTile tile(KisTextureTileInfoPoolSP(0)); // TODO: fix the pool should never be null!
+        tile.col = (*it)->tileCol();
+        tile.row = (*it)->tileRow();
+        tile.rect = (*it)->realPatchRect();
+        tile.data = std::move((*it)->takePixelData());
+
+        frame->frameTiles.push_back(std::move(tile));
+    }
+
+    return true;
+}
+
 }
 
+struct KisFrameCacheStore::PreparedFrame
+{
+    FrameInfoSP frameInfo;
+};
 
 struct KRITAUI_NO_EXPORT KisFrameCacheStore::Private
 {
@@ -162,38 +203,8 @@ KisFrameCacheStore::~KisFrameCacheStore()
 
 void KisFrameCacheStore::saveFrame(int frameId, KisOpenGLUpdateInfoSP info, const QRect &imageBounds)
 {
-    int pixelSize = 0;
-
-    Q_FOREACH (auto tile, info->tileList) {
-#ifdef SANITY_CHECK
-        if (!pixelSize) {
-            pixelSize = tile->pixelSize();
-        } else {
-            KIS_SAFE_ASSERT_RECOVER_RETURN(pixelSize == tile->pixelSize());
-        }
-#else
-        pixelSize = tile->pixelSize();
-        break;
-#endif
-    }
-
-    KIS_SAFE_ASSERT_RECOVER_RETURN(pixelSize);
-
-    // TODO: assert that dirty image rect is equal to the full image rect
-    // TODO: assert tile color space coicides with the destination color space
-
     KisFrameDataSerializer::Frame frame;
-    frame.pixelSize = pixelSize;
-
-    for (auto it = info->tileList.begin(); it != info->tileList.end(); ++it) {
-        KisFrameDataSerializer::FrameTile tile(KisTextureTileInfoPoolSP(0)); // TODO: fix the pool should never be null!
-        tile.col = (*it)->tileCol();
-        tile.row = (*it)->tileRow();
-        tile.rect = (*it)->realPatchRect();
-        tile.data = std::move((*it)->takePixelData());
-
-        frame.frameTiles.push_back(std::move(tile));
-    }
+    if (!convertToSerializableFrame(info, &frame)) return;
 
     FrameInfoSP frameInfo;
 
@@ -252,6 +263,30 @@ void KisFrameCacheStore::saveFrame(int frameId, KisOpenGLUpdateInfoSP info, cons
     }
 }
 
+KisFrameCacheStore::PreparedFrameSP KisFrameCacheStore::prepareFrame(KisOpenGLUpdateInfoSP info, const QRect &imageBounds)
+{
+    KisFrameDataSerializer::Frame frame;
+    if (!convertToSerializableFrame(info, &frame)) return PreparedFrameSP();
+
+    PreparedFrameSP preparedFrame(new PreparedFrame());
+    preparedFrame->frameInfo = toQShared(new FrameInfo(info->dirtyImageRect(),
+                                                       imageBounds,
+                                                       info->levelOfDetail(),
+                                                       m_d->serializer,
+                                                       frame));
+    return preparedFrame;
+}
+
+void KisFrameCacheStore::savePreparedFrame(int frameId, PreparedFrameSP frame)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(frame && frame->frameInfo);
+    KIS_SAFE_ASSERT_RECOVER(!m_d->savedFrames.contains(frameId)) {
+        forgetFrame(frameId);
+    }
+
+    m_d->savedFrames.insert(frameId, frame->frameInfo);
+}
+
 KisOpenGLUpdateInfoSP KisFrameCacheStore::loadFrame(int frameId, const KisOpenGLUpdateInfoBuilder &builder)
 {
     KisOpenGLUpdateInfoSP info = new KisOpenGLUpdateInfo();
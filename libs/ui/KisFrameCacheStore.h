@@ -20,6 +20,7 @@
 
 #include "kritaui_export.h"
 #include <QScopedPointer>
+#include <QSharedPointer>
 #include "kis_types.h"
 
 #include "opengl/kis_texture_tile_info_pool.h"
@@ -50,6 +51,9 @@ typedef KisSharedPtr<KisOpenGLUpdateInfo> KisOpenGLUpdateInfoSP;
 class KRITAUI_EXPORT KisFrameCacheStore
 {
 public:
+    struct PreparedFrame;
+    typedef QSharedPointer<PreparedFrame> PreparedFrameSP;
+
     KisFrameCacheStore();
     KisFrameCacheStore(const QString &frameCachePath);
 
@@ -59,6 +63,22 @@ public:
     void saveFrame(int frameId, KisOpenGLUpdateInfoSP info, const QRect &imageBounds);
     KisOpenGLUpdateInfoSP loadFrame(int frameId, const KisOpenGLUpdateInfoBuilder &builder);
 
+    /**
+     * Compresses \p info and writes it to disk as a standalone full frame,
+     * without registering it in the store. Unlike the rest of the methods,
+     * prepareFrame() may be called concurrently with any other call, so the
+     * heavy part of saving can be done without blocking the store.
+     *
+     * WARNING: after transferring \p info to prepareFrame() the object becomes invalid
+     */
+    PreparedFrameSP prepareFrame(KisOpenGLUpdateInfoSP info, const QRect &imageBounds);
+
+    /**
+     * Registers the frame, prepared by prepareFrame(), under \p frameId.
+     * The call is cheap: no compression or disk access happens here.
+     */
+    void savePreparedFrame(int frameId, PreparedFrameSP frame);
+
     void moveFrame(int srcFrameId, int dstFrameId);
 
     void forgetFrame(int frameId);
@@ -19,9 +19,18 @@
 
 #include "KisFrameCacheStore.h"
 
+#include "kis_assert.h"
+
 #include "kis_update_info.h"
 #include "opengl/KisOpenGLUpdateInfoBuilder.h"
 
+namespace {
+struct StorePreparedFrame : public KisAbstractFrameCacheSwapper::PreparedFrame
+{
+    KisFrameCacheStore::PreparedFrameSP frame;
+};
+}
+
 struct KisFrameCacheSwapper::Private
 {
     Private(const KisOpenGLUpdateInfoBuilder &_builder, const QString &frameCachePath)
@@ -53,6 +62,24 @@ void KisFrameCacheSwapper::saveFrame(int frameId, KisOpenGLUpdateInfoSP info, co
     m_d->frameStore.saveFrame(frameId, info, imageBounds);
 }
 
+KisAbstractFrameCacheSwapper::PreparedFrameSP KisFrameCacheSwapper::prepareFrame(KisOpenGLUpdateInfoSP info, const QRect &imageBounds)
+{
+    KisFrameCacheStore::PreparedFrameSP storeFrame = m_d->frameStore.prepareFrame(info, imageBounds);
+    if (!storeFrame) return PreparedFrameSP();
+
+    QSharedPointer<StorePreparedFrame> frame(new StorePreparedFrame());
+    frame->frame = storeFrame;
+    return frame;
+}
+
+void KisFrameCacheSwapper::savePreparedFrame(int frameId, PreparedFrameSP frame)
+{
+    QSharedPointer<StorePreparedFrame> storeFrame = frame.dynamicCast<StorePreparedFrame>();
+    KIS_SAFE_ASSERT_RECOVER_RETURN(storeFrame);
+
+    m_d->frameStore.savePreparedFrame(frameId, storeFrame->frame);
+}
+
 KisOpenGLUpdateInfoSP KisFrameCacheSwapper::loadFrame(int frameId)
 {
     return m_d->frameStore.loadFrame(frameId, m_d->builder);
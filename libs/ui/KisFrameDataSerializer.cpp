@@ -56,10 +56,10 @@ struct KRITAUI_NO_EXPORT KisFrameDataSerializer::Private
 
     int generateFrameId() {
         // TODO: handle wrapping and range compression
-        return nextFrameId++;
+        return nextFrameId.fetchAndAddOrdered(1);
     }
 
-    quint8* getCompressionBuffer(int size) {
+    static quint8* getCompressionBuffer(QByteArray &compressionBuffer, int size) {
         if (compressionBuffer.size() < size) {
             compressionBuffer.resize(size);
         }
@@ -68,8 +68,12 @@ struct KRITAUI_NO_EXPORT KisFrameDataSerializer::Private
 
     QTemporaryDir framesDir;
     QDir framesDirObject;
-    int nextFrameId = 0;
+    QAtomicInt nextFrameId;
 
+    /**
+     * Used by loadFrame() only, saveFrame() has its own buffer,
+     * because it may be called concurrently
+     */
     QByteArray compressionBuffer;
 };
 
@@ -90,6 +94,7 @@ KisFrameDataSerializer::~KisFrameDataSerializer()
 int KisFrameDataSerializer::saveFrame(const KisFrameDataSerializer::Frame &frame)
 {
     KisLzfCompression compression;
+    QByteArray compressionBuffer;
 
     const int frameId = m_d->generateFrameId();
 
@@ -126,7 +131,7 @@ int KisFrameDataSerializer::saveFrame(const KisFrameDataSerializer::Frame &frame
 
         const int frameByteSize = frame.pixelSize * tile.rect.width() * tile.rect.height();
         const int maxBufferSize = compression.outputBufferSize(frameByteSize);
-        quint8 *buffer = m_d->getCompressionBuffer(maxBufferSize);
+        quint8 *buffer = Private::getCompressionBuffer(compressionBuffer, maxBufferSize);
 
         const int compressedSize =
             compression.compress(tile.data.data(), frameByteSize, buffer, maxBufferSize);
@@ -197,7 +202,7 @@ KisFrameDataSerializer::Frame KisFrameDataSerializer::loadFrame(int frameId, Kis
 
         if (isCompressed) {
             const int maxBufferSize = compression.outputBufferSize(inputSize);
-            quint8 *buffer = m_d->getCompressionBuffer(maxBufferSize);
+            quint8 *buffer = Private::getCompressionBuffer(m_d->compressionBuffer, maxBufferSize);
             stream.readRawData((char*)buffer, inputSize);
 
             tile.data.allocate(frame.pixelSize);
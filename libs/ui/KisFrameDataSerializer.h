@@ -111,6 +111,11 @@ public:
     KisFrameDataSerializer(const QString &frameCachePath);
     ~KisFrameDataSerializer();
 
+    /**
+     * Compresses \p frame and saves it under a newly generated id. Unlike
+     * the other methods, it may be called concurrently with any call of
+     * the serializer, since it touches nothing but its own frame file.
+     */
     int saveFrame(const Frame &frame);
     Frame loadFrame(int frameId, KisTextureTileInfoPoolSP pool);
 
@@ -21,6 +21,13 @@
 #include <kis_update_info.h>
 
 
+namespace {
+struct InMemoryPreparedFrame : public KisAbstractFrameCacheSwapper::PreparedFrame
+{
+    KisOpenGLUpdateInfoSP info;
+};
+}
+
 struct KRITAUI_NO_EXPORT KisInMemoryFrameCacheSwapper::Private
 {
     QMap<int, KisOpenGLUpdateInfoSP> framesMap;
@@ -43,6 +50,23 @@ void KisInMemoryFrameCacheSwapper::saveFrame(int frameId, KisOpenGLUpdateInfoSP
     m_d->framesMap.insert(frameId, info);
 }
 
+KisAbstractFrameCacheSwapper::PreparedFrameSP KisInMemoryFrameCacheSwapper::prepareFrame(KisOpenGLUpdateInfoSP info, const QRect &imageBounds)
+{
+    Q_UNUSED(imageBounds);
+
+    QSharedPointer<InMemoryPreparedFrame> frame(new InMemoryPreparedFrame());
+    frame->info = info;
+    return frame;
+}
+
+void KisInMemoryFrameCacheSwapper::savePreparedFrame(int frameId, PreparedFrameSP frame)
+{
+    QSharedPointer<InMemoryPreparedFrame> memoryFrame = frame.dynamicCast<InMemoryPreparedFrame>();
+    KIS_SAFE_ASSERT_RECOVER_RETURN(memoryFrame);
+
+    saveFrame(frameId, memoryFrame->info, QRect());
+}
+
 KisOpenGLUpdateInfoSP KisInMemoryFrameCacheSwapper::loadFrame(int frameId)
 {
     KIS_SAFE_ASSERT_RECOVER_NOOP(m_d->framesMap.contains(frameId));
@@ -36,6 +36,9 @@ public:
     void saveFrame(int frameId, KisOpenGLUpdateInfoSP info, const QRect &imageBounds) override;
     KisOpenGLUpdateInfoSP loadFrame(int frameId) override;
 
+    PreparedFrameSP prepareFrame(KisOpenGLUpdateInfoSP info, const QRect &imageBounds) override;
+    void savePreparedFrame(int frameId, PreparedFrameSP frame) override;
+
     void moveFrame(int srcFrameId, int dstFrameId) override;
 
     void forgetFrame(int frameId) override;
@@ -0,0 +1,381 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#include "KisPNGParallelDeflate.h"
+
+#include <string.h>
+#include <vector>
+#include <zlib.h>
+
+#include <QIODevice>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <kis_assert.h>
+#include <kis_debug.h>
+
+
+namespace {
+
+/// amount of filtered data compressed by a single job, the same as pigz uses
+const int targetBlockSize = 128 * 1024;
+
+/// size of the deflate window, the maximum useful dictionary size
+const int windowSize = 32 * 1024;
+
+enum FilterType {
+    FilterNone = 0,
+    FilterSub,
+    FilterUp,
+    FilterAverage,
+    FilterPaeth,
+    NumFilterTypes
+};
+
+inline int paethPredictor(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = qAbs(p - a);
+    const int pb = qAbs(p - b);
+    const int pc = qAbs(p - c);
+
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+/**
+ * Writes the filter type byte followed by the filtered row into \p dst
+ */
+void applyFilter(int type, const quint8 *row, const quint8 *prev, int rowBytes, int bpp, quint8 *dst)
+{
+    *dst++ = quint8(type);
+
+    switch (type) {
+    case FilterNone:
+        memcpy(dst, row, rowBytes);
+        break;
+    case FilterSub:
+        for (int i = 0; i < bpp; i++) {
+            dst[i] = row[i];
+        }
+        for (int i = bpp; i < rowBytes; i++) {
+            dst[i] = quint8(row[i] - row[i - bpp]);
+        }
+        break;
+    case FilterUp:
+        for (int i = 0; i < rowBytes; i++) {
+            dst[i] = quint8(row[i] - prev[i]);
+        }
+        break;
+    case FilterAverage:
+        for (int i = 0; i < bpp; i++) {
+            dst[i] = quint8(row[i] - (prev[i] >> 1));
+        }
+        for (int i = bpp; i < rowBytes; i++) {
+            dst[i] = quint8(row[i] - ((int(row[i - bpp]) + prev[i]) >> 1));
+        }
+        break;
+    case FilterPaeth:
+        for (int i = 0; i < bpp; i++) {
+            dst[i] = quint8(row[i] - prev[i]);
+        }
+        for (int i = bpp; i < rowBytes; i++) {
+            dst[i] = quint8(row[i] - paethPredictor(row[i - bpp], prev[i], prev[i - bpp]));
+        }
+        break;
+    }
+}
+
+/**
+ * The "minimum sum of absolute differences" heuristic, the same
+ * libpng uses for choosing the filter of a row
+ */
+quint32 filterCost(const quint8 *filtered, int rowBytes)
+{
+    quint32 cost = 0;
+    for (int i = 0; i < rowBytes; i++) {
+        cost += qAbs(int(qint8(filtered[i])));
+    }
+    return cost;
+}
+
+struct Block {
+    int firstRow = 0;
+    int numRows = 0;
+    bool isLast = false;
+
+    QByteArray filtered;
+    const QByteArray *dictionary = 0;
+
+    QByteArray compressed;
+    uLong adler = 0;
+    bool succeeded = false;
+};
+
+struct SwapBytes {
+    SwapBytes(quint8 **rows, int rowBytes)
+        : m_rows(rows), m_rowBytes(rowBytes)
+    {
+    }
+
+    void operator()(Block &block) {
+        for (int row = block.firstRow; row < block.firstRow + block.numRows; row++) {
+            quint16 *samples = reinterpret_cast<quint16*>(m_rows[row]);
+            for (int i = 0; i < m_rowBytes / 2; i++) {
+                samples[i] = qToBigEndian(samples[i]);
+            }
+        }
+    }
+
+    quint8 **m_rows;
+    int m_rowBytes;
+};
+
+struct FilterRows {
+    FilterRows(quint8 **rows, int rowBytes, int bpp, bool allowFiltering, const QByteArray &zeroRow)
+        : m_rows(rows), m_rowBytes(rowBytes), m_bpp(bpp), m_allowFiltering(allowFiltering), m_zeroRow(zeroRow)
+    {
+    }
+
+    void operator()(Block &block) {
+        const int filteredRowBytes = m_rowBytes + 1;
+        block.filtered.resize(block.numRows * filteredRowBytes);
+        quint8 *dst = reinterpret_cast<quint8*>(block.filtered.data());
+
+        QByteArray candidates(m_allowFiltering ? NumFilterTypes * filteredRowBytes : 0, 0);
+
+        for (int row = block.firstRow; row < block.firstRow + block.numRows; row++) {
+            const quint8 *src = m_rows[row];
+
+            if (!m_allowFiltering) {
+                applyFilter(FilterNone, src, 0, m_rowBytes, m_bpp, dst);
+            } else {
+                const quint8 *prev = row > 0 ?
+                    m_rows[row - 1] :
+                    reinterpret_cast<const quint8*>(m_zeroRow.constData());
+
+                quint8 *candidate = reinterpret_cast<quint8*>(candidates.data());
+                int bestFilter = FilterNone;
+                quint32 bestCost = 0;
+
+                for (int type = FilterNone; type < NumFilterTypes; type++) {
+                    quint8 *filtered = candidate + type * filteredRowBytes;
+                    applyFilter(type, src, prev, m_rowBytes, m_bpp, filtered);
+
+                    const quint32 cost = filterCost(filtered + 1, m_rowBytes);
+                    if (type == FilterNone || cost < bestCost) {
+                        bestFilter = type;
+                        bestCost = cost;
+                    }
+                }
+
+                memcpy(dst, candidate + bestFilter * filteredRowBytes, filteredRowBytes);
+            }
+
+            dst += filteredRowBytes;
+        }
+    }
+
+    quint8 **m_rows;
+    int m_rowBytes;
+    int m_bpp;
+    bool m_allowFiltering;
+    const QByteArray &m_zeroRow;
+};
+
+struct DeflateBlock {
+    DeflateBlock(int compressionLevel)
+        : m_compressionLevel(compressionLevel)
+    {
+    }
+
+    void operator()(Block &block) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(z_stream));
+
+        // negative window bits: a raw deflate stream, the zlib header
+        // and checksum are written by the caller for the whole image
+        if (deflateInit2(&stream, m_compressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return;
+        }
+
+        if (block.dictionary) {
+            const int dictionarySize = qMin(windowSize, block.dictionary->size());
+            const Bytef *dictionary =
+                reinterpret_cast<const Bytef*>(block.dictionary->constData()) +
+                block.dictionary->size() - dictionarySize;
+
+            if (deflateSetDictionary(&stream, dictionary, dictionarySize) != Z_OK) {
+                deflateEnd(&stream);
+                return;
+            }
+        }
+
+        // the data may be read concurrently as a dictionary of the next block
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.filtered.constData()));
+        stream.avail_in = block.filtered.size();
+
+        const int flush = block.isLast ? Z_FINISH : Z_SYNC_FLUSH;
+
+        block.compressed.resize(deflateBound(&stream, block.filtered.size()) + 16);
+        int written = 0;
+        int result = Z_OK;
+
+        forever {
+            stream.next_out = reinterpret_cast<Bytef*>(block.compressed.data()) + written;
+            stream.avail_out = block.compressed.size() - written;
+
+            result = deflate(&stream, flush);
+            written = block.compressed.size() - stream.avail_out;
+
+            if (result == Z_STREAM_ERROR ||
+                stream.avail_out > 0 ||
+                result == Z_STREAM_END) {
+
+                break;
+            }
+
+            block.compressed.resize(2 * block.compressed.size());
+        }
+
+        deflateEnd(&stream);
+
+        block.compressed.resize(written);
+        block.adler = adler32(adler32(0, Z_NULL, 0),
+                              reinterpret_cast<const Bytef*>(block.filtered.constData()),
+                              block.filtered.size());
+
+        block.succeeded =
+            stream.avail_in == 0 &&
+            (block.isLast ? result == Z_STREAM_END : result == Z_OK || result == Z_BUF_ERROR);
+    }
+
+    int m_compressionLevel;
+};
+
+bool writeChunk(QIODevice *io, const char *type, const QByteArray &prefix, const QByteArray &data, const QByteArray &suffix)
+{
+    const quint32 length = prefix.size() + data.size() + suffix.size();
+
+    uLong crc = crc32(0, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(type), 4);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(prefix.constData()), prefix.size());
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(data.constData()), data.size());
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(suffix.constData()), suffix.size());
+
+    uchar header[8];
+    qToBigEndian(length, header);
+    memcpy(header + 4, type, 4);
+
+    uchar footer[4];
+    qToBigEndian(quint32(crc), footer);
+
+    return io->write(reinterpret_cast<const char*>(header), 8) == 8 &&
+        io->write(prefix) == prefix.size() &&
+        io->write(data) == data.size() &&
+        io->write(suffix) == suffix.size() &&
+        io->write(reinterpret_cast<const char*>(footer), 4) == 4;
+}
+
+QByteArray zlibHeader(int compressionLevel)
+{
+    // deflate with the 32KiB window
+    const quint8 cmf = 0x78;
+
+    const int levelFlag =
+        compressionLevel < 2 ? 0 :
+        compressionLevel < 6 ? 1 :
+        compressionLevel == 6 ? 2 : 3;
+
+    quint8 flg = levelFlag << 6;
+    flg += (31 - (cmf * 256 + flg) % 31) % 31;
+
+    QByteArray header;
+    header.append(char(cmf));
+    header.append(char(flg));
+    return header;
+}
+
+}
+
+
+KisPNGParallelDeflate::KisPNGParallelDeflate(int bitDepth, int channels, int compressionLevel, bool allowFiltering)
+    : m_bitDepth(bitDepth),
+      m_bytesPerPixel(qMax(1, bitDepth * channels / 8)),
+      m_compressionLevel(qBound(0, compressionLevel, 9)),
+      m_allowFiltering(allowFiltering && bitDepth >= 8)
+{
+}
+
+bool KisPNGParallelDeflate::writeImageData(QIODevice *io, quint8 **rows, int numRows, int rowBytes, bool swapBytes)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(numRows > 0 && rowBytes > 0, false);
+
+    const int rowsPerBlock = qMax(1, targetBlockSize / (rowBytes + 1));
+
+    std::vector<Block> blocks;
+    blocks.reserve((numRows + rowsPerBlock - 1) / rowsPerBlock);
+
+    for (int row = 0; row < numRows; row += rowsPerBlock) {
+        Block block;
+        block.firstRow = row;
+        block.numRows = qMin(rowsPerBlock, numRows - row);
+        blocks.push_back(block);
+    }
+    blocks.back().isLast = true;
+
+    if (swapBytes && m_bitDepth == 16) {
+        QtConcurrent::blockingMap(blocks, SwapBytes(rows, rowBytes));
+    }
+
+    const QByteArray zeroRow(rowBytes, 0);
+    QtConcurrent::blockingMap(blocks, FilterRows(rows, rowBytes, m_bytesPerPixel, m_allowFiltering, zeroRow));
+
+    for (size_t i = 1; i < blocks.size(); i++) {
+        blocks[i].dictionary = &blocks[i - 1].filtered;
+    }
+
+    QtConcurrent::blockingMap(blocks, DeflateBlock(m_compressionLevel));
+
+    uLong adler = blocks.front().adler;
+    for (size_t i = 1; i < blocks.size(); i++) {
+        adler = adler32_combine(adler, blocks[i].adler, blocks[i].filtered.size());
+    }
+
+    QByteArray trailer(4, 0);
+    qToBigEndian(quint32(adler), reinterpret_cast<uchar*>(trailer.data()));
+
+    const QByteArray header = zlibHeader(m_compressionLevel);
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        const Block &block = blocks[i];
+
+        if (!block.succeeded) {
+            dbgFile << "Failed to compress PNG rows" << block.firstRow << "to" << block.firstRow + block.numRows;
+            return false;
+        }
+
+        if (!writeChunk(io, "IDAT",
+                        i == 0 ? header : QByteArray(),
+                        block.compressed,
+                        block.isLast ? trailer : QByteArray())) {
+            return false;
+        }
+    }
+
+    return writeChunk(io, "IEND", QByteArray(), QByteArray(), QByteArray());
+}
@@ -0,0 +1,71 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef KISPNGPARALLELDEFLATE_H
+#define KISPNGPARALLELDEFLATE_H
+
+#include <QtGlobal>
+
+class QIODevice;
+
+/**
+ * Writes the image data of a non-interlaced PNG file, i.e. the IDAT
+ * chunks and the final IEND chunk, compressing the rows on all the
+ * available cores.
+ *
+ * The rows are split into blocks of roughly 128KiB. Every block is
+ * filtered and deflated independently into a raw deflate stream that
+ * ends on a byte boundary (Z_SYNC_FLUSH), primed with the last 32KiB
+ * of the previous block as a dictionary, so the concatenation of the
+ * blocks is a single valid zlib stream. The Adler-32 checksums of the
+ * blocks are merged with adler32_combine(). The result is a bit larger
+ * than what libpng would produce on one core, but any PNG decoder
+ * reads it.
+ *
+ * The PNG signature and all the chunks preceding the image data must
+ * already be written to the device (png_write_info()).
+ */
+class KisPNGParallelDeflate
+{
+public:
+    /**
+     * @param bitDepth bit depth of the samples, as written into IHDR
+     * @param channels number of samples per pixel
+     * @param compressionLevel zlib compression level, 0...9
+     * @param allowFiltering if false, every row uses filter type None,
+     *                       as required for palette images
+     */
+    KisPNGParallelDeflate(int bitDepth, int channels, int compressionLevel, bool allowFiltering);
+
+    /**
+     * Filters, compresses and writes \p numRows rows of \p rowBytes
+     * bytes each. If \p swapBytes is true, 16-bit samples are converted
+     * to the big endian order in place, which modifies \p rows.
+     *
+     * @return true on success
+     */
+    bool writeImageData(QIODevice *io, quint8 **rows, int numRows, int rowBytes, bool swapBytes);
+
+private:
+    int m_bitDepth;
+    int m_bytesPerPixel;
+    int m_compressionLevel;
+    bool m_allowFiltering;
+};
+
+#endif // KISPNGPARALLELDEFLATE_H
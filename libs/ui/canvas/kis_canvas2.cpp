@@ -100,6 +100,7 @@
 
 #include "kis_algebra_2d.h"
 #include "kis_image_signal_router.h"
+#include "KisLatencyTracer.h"
 
 #include "KisSnapPixelStrategy.h"
 
@@ -802,6 +803,16 @@ void KisCanvas2::updateCanvasProjection()
     };
 
     auto uploadData = [this, tryIssueCanvasUpdates](const QVector<KisUpdateInfoSP> &infoObjects) {
+        QRect dirtyImageRect;
+
+        if (KisLatencyTracer::isEnabled()) {
+            Q_FOREACH (KisUpdateInfoSP info, infoObjects) {
+                dirtyImageRect |= info->dirtyImageRect();
+            }
+        }
+
+        KisLatencyTracer::Span span(KisLatencyTracer::CanvasTextureUpdate, dirtyImageRect);
+
         QVector<QRect> viewportRects = m_d->canvasWidget->updateCanvasProjection(infoObjects);
         const QRect vRect = std::accumulate(viewportRects.constBegin(), viewportRects.constEnd(),
                                             QRect(), std::bit_or<QRect>());
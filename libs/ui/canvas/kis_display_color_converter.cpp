@@ -145,6 +145,7 @@ struct KisDisplayColorConverter::Private
     bool openGLCanvasIsActive = false;
 
     inline KoColor approximateFromQColor(const QColor &qcolor);
+    void approximateFromQColors(const QColor *colors, quint8 *dst, int nColors);
     inline QColor approximateToQColor(const KoColor &color);
 
     void slotCanvasResourceChanged(int key, const QVariant &v);
@@ -512,6 +513,11 @@ KoColor KisDisplayColorConverter::approximateFromRenderedQColor(const QColor &c)
     return m_d->approximateFromQColor(c);
 }
 
+void KisDisplayColorConverter::approximateFromRenderedQColors(const QColor *colors, quint8 *dst, int nColors) const
+{
+    m_d->approximateFromQColors(colors, dst, nColors);
+}
+
 QImage KisDisplayColorConverter::toQImage(KisPaintDeviceSP srcDevice) const
 {
     KisPaintDeviceSP device = srcDevice;
@@ -586,6 +592,22 @@ KoColor KisDisplayColorConverter::Private::approximateFromQColor(const QColor &q
     return KoColor();
 }
 
+void KisDisplayColorConverter::Private::approximateFromQColors(const QColor *colors, quint8 *dst, int nColors)
+{
+    if (!useOcio()) {
+        paintingColorSpace->fromQColors(colors, dst, nColors);
+    } else {
+        const KoColorSpace *cs = intermediateColorSpace();
+
+        QVector<quint8> buffer(nColors * cs->pixelSize());
+        cs->fromQColors(colors, buffer.data(), nColors);
+        displayFilter->approximateInverseTransformation(buffer.data(), nColors);
+        cs->convertPixelsTo(buffer.constData(), dst, paintingColorSpace, nColors,
+                            KoColorConversionTransformation::internalRenderingIntent(),
+                            KoColorConversionTransformation::internalConversionFlags());
+    }
+}
+
 QColor KisDisplayColorConverter::Private::approximateToQColor(const KoColor &srcColor)
 {
     KoColor color(srcColor);
@@ -613,11 +635,15 @@ void KisDisplayColorConverter::getHsv(const KoColor &srcColor, int *h, int *s, i
     color.getHsv(h, s, v, a);
 }
 
-KoColor KisDisplayColorConverter::fromHsvF(qreal h, qreal s, qreal v, qreal a)
+QColor KisDisplayColorConverter::hsvFToQColor(qreal h, qreal s, qreal v, qreal a)
 {
     // generate HSV from sRGB!
-    QColor qcolor(QColor::fromHsvF(h, s, v, a));
-    return m_d->approximateFromQColor(qcolor);
+    return QColor::fromHsvF(h, s, v, a);
+}
+
+KoColor KisDisplayColorConverter::fromHsvF(qreal h, qreal s, qreal v, qreal a)
+{
+    return m_d->approximateFromQColor(hsvFToQColor(h, s, v, a));
 }
 
 void KisDisplayColorConverter::getHsvF(const KoColor &srcColor, qreal *h, qreal *s, qreal *v, qreal *a)
@@ -627,7 +653,7 @@ void KisDisplayColorConverter::getHsvF(const KoColor &srcColor, qreal *h, qreal
     color.getHsvF(h, s, v, a);
 }
 
-KoColor KisDisplayColorConverter::fromHslF(qreal h, qreal s, qreal l, qreal a)
+QColor KisDisplayColorConverter::hslFToQColor(qreal h, qreal s, qreal l, qreal a)
 {
     // generate HSL from sRGB!
     QColor qcolor(QColor::fromHslF(h, s, l, a));
@@ -635,8 +661,12 @@ KoColor KisDisplayColorConverter::fromHslF(qreal h, qreal s, qreal l, qreal a)
         warnKrita << "Could not construct valid color from h" << h << "s" << s << "l" << l << "a" << a;
         qcolor = Qt::black;
     }
-    return m_d->approximateFromQColor(qcolor);
+    return qcolor;
+}
 
+KoColor KisDisplayColorConverter::fromHslF(qreal h, qreal s, qreal l, qreal a)
+{
+    return m_d->approximateFromQColor(hslFToQColor(h, s, l, a));
 }
 
 void KisDisplayColorConverter::getHslF(const KoColor &srcColor, qreal *h, qreal *s, qreal *l, qreal *a)
@@ -646,7 +676,7 @@ void KisDisplayColorConverter::getHslF(const KoColor &srcColor, qreal *h, qreal
     color.getHslF(h, s, l, a);
 }
 
-KoColor KisDisplayColorConverter::fromHsiF(qreal h, qreal s, qreal i)
+QColor KisDisplayColorConverter::hsiFToQColor(qreal h, qreal s, qreal i)
 {
     // generate HSI from sRGB!
     qreal r=0.0;
@@ -656,7 +686,12 @@ KoColor KisDisplayColorConverter::fromHsiF(qreal h, qreal s, qreal i)
     HSIToRGB(h, s, i, &r, &g, &b);
     QColor qcolor;
     qcolor.setRgbF(qBound(0.0,r,1.0), qBound(0.0,g,1.0), qBound(0.0,b,1.0), a);
-    return m_d->approximateFromQColor(qcolor);
+    return qcolor;
+}
+
+KoColor KisDisplayColorConverter::fromHsiF(qreal h, qreal s, qreal i)
+{
+    return m_d->approximateFromQColor(hsiFToQColor(h, s, i));
 }
 
 void KisDisplayColorConverter::getHsiF(const KoColor &srcColor, qreal *h, qreal *s, qreal *i)
@@ -669,7 +704,7 @@ void KisDisplayColorConverter::getHsiF(const KoColor &srcColor, qreal *h, qreal
     RGBToHSI(r, g, b, h, s, i);
 }
 
-KoColor KisDisplayColorConverter::fromHsyF(qreal h, qreal s, qreal y, qreal R, qreal G, qreal B, qreal gamma)
+QColor KisDisplayColorConverter::hsyFToQColor(qreal h, qreal s, qreal y, qreal R, qreal G, qreal B, qreal gamma)
 {
     // generate HSL from sRGB!
     QVector <qreal> channelValues(3);
@@ -678,7 +713,12 @@ KoColor KisDisplayColorConverter::fromHsyF(qreal h, qreal s, qreal y, qreal R, q
     KoColorSpaceRegistry::instance()->rgb8()->profile()->delinearizeFloatValueFast(channelValues);
     QColor qcolor;
     qcolor.setRgbF(qBound(0.0,channelValues[0],1.0), qBound(0.0,channelValues[1],1.0), qBound(0.0,channelValues[2],1.0), 1.0);
-    return m_d->approximateFromQColor(qcolor);
+    return qcolor;
+}
+
+KoColor KisDisplayColorConverter::fromHsyF(qreal h, qreal s, qreal y, qreal R, qreal G, qreal B, qreal gamma)
+{
+    return m_d->approximateFromQColor(hsyFToQColor(h, s, y, R, G, B, gamma));
 }
 
 void KisDisplayColorConverter::getHsyF(const KoColor &srcColor, qreal *h, qreal *s, qreal *y, qreal R, qreal G, qreal B, qreal gamma)
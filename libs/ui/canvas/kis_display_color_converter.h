@@ -67,6 +67,16 @@ public:
     QColor toQColor(const KoColor &c) const;
     KoColor approximateFromRenderedQColor(const QColor &c) const;
 
+    /**
+     * Converts \p nColors rendered QColors into the pixels of
+     * paintingColorSpace() at once. It is equivalent to calling
+     * approximateFromRenderedQColor() for every color, but converts
+     * the whole array in one pass.
+     *
+     * @param dst a pointer to at least nColors * paintingColorSpace()->pixelSize() bytes
+     */
+    void approximateFromRenderedQColors(const QColor *colors, quint8 *dst, int nColors) const;
+
     bool canSkipDisplayConversion(const KoColorSpace *cs) const;
     KoColor applyDisplayFiltering(const KoColor &srcColor, const KoID &bitDepthId) const;
     void applyDisplayFilteringF32(KisFixedPaintDeviceSP device, const KoID &bitDepthId) const;
@@ -86,6 +96,16 @@ public:
     KoColor fromHsiF(qreal h, qreal s, qreal i);
     KoColor fromHsyF(qreal h, qreal s, qreal y, qreal R=0.2126, qreal G=0.7152, qreal B=0.0722, qreal gamma=2.2);
 
+    /**
+     * The sRGB colors the fromHsvF() family of methods generate before
+     * converting them into the painting color space. Use them together
+     * with approximateFromRenderedQColors() to convert many colors at once.
+     */
+    static QColor hsvFToQColor(qreal h, qreal s, qreal v, qreal a = 1.0);
+    static QColor hslFToQColor(qreal h, qreal s, qreal l, qreal a = 1.0);
+    static QColor hsiFToQColor(qreal h, qreal s, qreal i);
+    static QColor hsyFToQColor(qreal h, qreal s, qreal y, qreal R=0.2126, qreal G=0.7152, qreal B=0.0722, qreal gamma=2.2);
+
     void getHsv(const KoColor &srcColor, int *h, int *s, int *v, int *a = 0) const;
     void getHsvF(const KoColor &srcColor, qreal *h, qreal *s, qreal *v, qreal *a = 0);
     void getHslF(const KoColor &srcColor, qreal *h, qreal *s, qreal *l, qreal *a = 0);
@@ -18,6 +18,7 @@
 #include "kis_image_pyramid.h"
 
 #include <QBitArray>
+#include <QtConcurrent>
 #include <KoChannelInfo.h>
 #include <KoCompositeOp.h>
 #include <KoColorSpaceRegistry.h>
@@ -32,6 +33,7 @@
 #include "kis_debug.h"
 #include "kis_config.h"
 #include "kis_image_config.h"
+#include "krita_utils.h"
 
 //#define DEBUG_PYRAMID
 
@@ -54,7 +56,6 @@
 #endif
 
 #define ceiledSize(sz) QSize(ceil((sz).width()), ceil((sz).height()))
-#define isOdd(x) ((x) & 0x01)
 
 /**
  * Aligns @p value to the lowest integer not smaller than @p value and
@@ -87,16 +88,94 @@ inline void alignByPow2Lo(qint32 &value, qint32 alignment)
     value &= ~mask;
 }
 
-inline void alignRectBy2(qint32 &x, qint32 &y, qint32 &w, qint32 &h)
+/**
+ * Extends @p rect to the closest rect with even coordinates and size
+ */
+inline QRect alignRectBy2(const QRect &rect)
 {
-    x -= isOdd(x);
-    y -= isOdd(y);
-    w += isOdd(x);
-    w += isOdd(w);
-    h += isOdd(y);
-    h += isOdd(h);
+    qint32 x1, y1, x2, y2;
+    rect.getCoords(&x1, &y1, &x2, &y2);
+
+    alignByPow2Lo(x1, 2);
+    alignByPow2Lo(y1, 2);
+    alignByPow2ButOneHi(x2, 2);
+    alignByPow2ButOneHi(y2, 2);
+
+    QRect result;
+    result.setCoords(x1, y1, x2, y2);
+    return result;
 }
 
+/**
+ * Averages 2x2 blocks of the preview BGRA8 pixels. Every pixel is
+ * handled as a single 32-bit word: the even and the odd channels are
+ * masked into 16-bit lanes, so four of them can be summed up without
+ * an overflow. The loop has no dependencies between the iterations,
+ * so the compiler is free to vectorize it.
+ */
+inline void downsampleRow(const quint32 *srcRow0, const quint32 *srcRow1,
+                          quint32 *dstRow, qint32 numDstPixels)
+{
+    const quint32 mask = 0x00FF00FF;
+
+    for (qint32 i = 0; i < numDstPixels; i++) {
+        const quint32 p0 = srcRow0[2 * i];
+        const quint32 p1 = srcRow0[2 * i + 1];
+        const quint32 p2 = srcRow1[2 * i];
+        const quint32 p3 = srcRow1[2 * i + 1];
+
+        const quint32 evenSum =
+            (p0 & mask) + (p1 & mask) + (p2 & mask) + (p3 & mask);
+        const quint32 oddSum =
+            ((p0 >> 8) & mask) + ((p1 >> 8) & mask) +
+            ((p2 >> 8) & mask) + ((p3 >> 8) & mask);
+
+        dstRow[i] = ((evenSum >> 2) & mask) | (((oddSum >> 2) & mask) << 8);
+    }
+}
+
+/**
+ * Downsamples one patch of the source plane. The patch must have
+ * even coordinates and size. Different patches write into
+ * non-overlapping areas of the destination plane, so they can
+ * be processed concurrently.
+ */
+struct DownsamplePatch
+{
+    DownsamplePatch(KisPaintDevice *src, KisPaintDevice *dst)
+        : m_src(src), m_dst(dst)
+    {
+    }
+
+    void operator()(const QRect &srcRect) {
+        // This is preview argb8 mode
+        Q_ASSERT(m_src->pixelSize() == 4);
+
+        const QRect dstRect(srcRect.x() / 2, srcRect.y() / 2,
+                            srcRect.width() / 2, srcRect.height() / 2);
+
+        QVector<quint32> srcPixels(srcRect.width() * srcRect.height());
+        QVector<quint32> dstPixels(dstRect.width() * dstRect.height());
+
+        m_src->readBytes(reinterpret_cast<quint8*>(srcPixels.data()), srcRect);
+
+        const quint32 *srcRow = srcPixels.constData();
+        quint32 *dstRow = dstPixels.data();
+
+        for (qint32 row = 0; row < dstRect.height(); row++) {
+            downsampleRow(srcRow, srcRow + srcRect.width(), dstRow, dstRect.width());
+
+            srcRow += 2 * srcRect.width();
+            dstRow += dstRect.width();
+        }
+
+        m_dst->writeBytes(reinterpret_cast<const quint8*>(dstPixels.constData()), dstRect);
+    }
+
+    KisPaintDevice *m_src;
+    KisPaintDevice *m_dst;
+};
+
 
 /************* class KisImagePyramid ********************************/
 
@@ -162,6 +241,8 @@ void KisImagePyramid::rebuildPyramid()
     for (qint32 i = 0; i < m_pyramidHeight; i++) {
         m_pyramid.append(new KisPaintDevice(m_monitorColorSpace));
     }
+
+    m_dirtyRegions.fill(QRegion(), m_pyramidHeight);
 }
 
 void KisImagePyramid::clearPyramid()
@@ -169,6 +250,8 @@ void KisImagePyramid::clearPyramid()
     for (qint32 i = 0; i < m_pyramidHeight; i++) {
         m_pyramid[i]->clear();
     }
+
+    m_dirtyRegions.fill(QRegion(), m_pyramidHeight);
 }
 
 void KisImagePyramid::setImage(KisImageWSP newImage)
@@ -208,7 +291,10 @@ void KisImagePyramid::setImage(KisImageWSP newImage)
             }
 
         }
-        //TODO: check whether there is needed recalculateCache()
+
+        if (m_pyramidHeight > FIRST_NOT_ORIGINAL_INDEX) {
+            m_dirtyRegions[FIRST_NOT_ORIGINAL_INDEX] += rc;
+        }
     }
 }
 
@@ -304,19 +390,20 @@ void KisImagePyramid::retrieveImageData(const QRect &rect)
 
 void KisImagePyramid::recalculateCache(KisPPUpdateInfoSP info)
 {
-    KisPaintDevice *src;
-    KisPaintDevice *dst;
-    QRect currentSrcRect = info->dirtyImageRectVar;
-
-    for (int i = FIRST_NOT_ORIGINAL_INDEX; i < m_pyramidHeight; i++) {
-        src = m_pyramid[i-1].data();
-        dst = m_pyramid[i].data();
-        if (!currentSrcRect.isEmpty()) {
-            currentSrcRect = downsampleByFactor2(currentSrcRect, src, dst);
-        }
+    /**
+     * The planes are not downsampled here: on most of the updates only
+     * one of them is actually displayed. We just remember the dirty area
+     * and let updatePlanes() bring the needed planes up to date on request.
+     */
+    if (m_pyramidHeight > FIRST_NOT_ORIGINAL_INDEX &&
+        !info->dirtyImageRectVar.isEmpty()) {
+
+        m_dirtyRegions[FIRST_NOT_ORIGINAL_INDEX] += info->dirtyImageRectVar;
     }
 
 #ifdef DEBUG_PYRAMID
+    updatePlanes(m_pyramidHeight - 1);
+
     QImage image = m_pyramid[ORIGINAL_INDEX]->convertToQImage(m_monitorProfile, m_renderingIntent, m_conversionFlags);
     image.save("./PYRAMID_BASE.png");
 
@@ -330,83 +417,51 @@ void KisImagePyramid::recalculateCache(KisPPUpdateInfoSP info)
 #endif
 }
 
-QRect KisImagePyramid::downsampleByFactor2(const QRect& srcRect,
-        KisPaintDevice* src,
-        KisPaintDevice* dst)
+void KisImagePyramid::updatePlanes(int index)
 {
-    qint32 srcX, srcY, srcWidth, srcHeight;
-    srcRect.getRect(&srcX, &srcY, &srcWidth, &srcHeight);
-    alignRectBy2(srcX, srcY, srcWidth, srcHeight);
+    for (int i = FIRST_NOT_ORIGINAL_INDEX; i <= index && i < m_pyramidHeight; i++) {
+        if (m_dirtyRegions[i].isEmpty()) continue;
 
-    // Nothing to do
-    if (srcWidth < 1) return QRect();
-    if (srcHeight < 1) return QRect();
-
-    qint32 dstX = srcX / 2;
-    qint32 dstY = srcY / 2;
-    qint32 dstWidth = srcWidth / 2;
-    qint32 dstHeight = srcHeight / 2;
-
-    KisHLineConstIteratorSP srcIt0 = src->createHLineConstIteratorNG(srcX, srcY, srcWidth);
-    KisHLineConstIteratorSP srcIt1 = src->createHLineConstIteratorNG(srcX, srcY + 1, srcWidth);
-    KisHLineIteratorSP dstIt = dst->createHLineIteratorNG(dstX, dstY, dstWidth);
-
-    int conseqPixels = 0;
-    for (int row = 0; row < dstHeight; ++row) {
-        do {
-            int srcItConseq = srcIt0->nConseqPixels();
-            int dstItConseq = dstIt->nConseqPixels();
-            conseqPixels = qMin(srcItConseq, dstItConseq * 2);
-
-            Q_ASSERT(!isOdd(conseqPixels));
-
-            downsamplePixels(srcIt0->oldRawData(), srcIt1->oldRawData(),
-                             dstIt->rawData(), conseqPixels);
-
-
-            srcIt1->nextPixels(conseqPixels);
-            dstIt->nextPixels(conseqPixels / 2);
-        } while (srcIt0->nextPixels(conseqPixels));
-        srcIt0->nextRow();
-        srcIt0->nextRow();
-        srcIt1->nextRow();
-        srcIt1->nextRow();
-        dstIt->nextRow();
+        const QRegion dstRegion =
+            downsampleByFactor2(m_dirtyRegions[i], m_pyramid[i-1].data(), m_pyramid[i].data());
+
+        m_dirtyRegions[i] = QRegion();
+
+        if (i + 1 < m_pyramidHeight) {
+            m_dirtyRegions[i + 1] += dstRegion;
+        }
     }
-    return QRect(dstX, dstY, dstWidth, dstHeight);
 }
 
-void  KisImagePyramid::downsamplePixels(const quint8 *srcRow0,
-                                        const quint8 *srcRow1,
-                                        quint8 *dstRow,
-                                        qint32 numSrcPixels)
+QRegion KisImagePyramid::downsampleByFactor2(const QRegion& srcRegion,
+        KisPaintDevice* src,
+        KisPaintDevice* dst)
 {
     /**
-     * FIXME (mandatory): Use SSE and friends here.
+     * The union of the aligned rects consists of the rects with even
+     * coordinates only, so the patches never write into the same pixel
+     * of the destination plane
      */
+    QRegion alignedRegion;
+    Q_FOREACH (const QRect &rc, srcRegion.rects()) {
+        alignedRegion += alignRectBy2(rc);
+    }
 
-    qint16 b = 0;
-    qint16 g = 0;
-    qint16 r = 0;
-    qint16 a = 0;
+    // Nothing to do
+    if (alignedRegion.isEmpty()) return QRegion();
 
-    static const qint32 pixelSize = 4; // This is preview argb8 mode
+    const int patchSize = 512;
+    QVector<QRect> patches;
+    QRegion dstRegion;
 
-    for (qint32 i = 0; i < numSrcPixels / 2; i++) {
-        b = srcRow0[0] + srcRow1[0] + srcRow0[4] + srcRow1[4];
-        g = srcRow0[1] + srcRow1[1] + srcRow0[5] + srcRow1[5];
-        r = srcRow0[2] + srcRow1[2] + srcRow0[6] + srcRow1[6];
-        a = srcRow0[3] + srcRow1[3] + srcRow0[7] + srcRow1[7];
+    Q_FOREACH (const QRect &rc, alignedRegion.rects()) {
+        patches << KritaUtils::splitRectIntoPatches(rc, QSize(patchSize, patchSize));
+        dstRegion += QRect(rc.x() / 2, rc.y() / 2, rc.width() / 2, rc.height() / 2);
+    }
 
-        dstRow[0] = b / 4;
-        dstRow[1] = g / 4;
-        dstRow[2] = r / 4;
-        dstRow[3] = a / 4;
+    QtConcurrent::blockingMap(patches, DownsamplePatch(src, dst));
 
-        dstRow += pixelSize;
-        srcRow0 += 2 * pixelSize;
-        srcRow1 += 2 * pixelSize;
-    }
+    return dstRegion;
 }
 
 int KisImagePyramid::findFirstGoodPlaneIndex(qreal scale,
@@ -472,6 +527,8 @@ KisImagePatch KisImagePyramid::getNearestPatch(KisPPUpdateInfoSP info)
 
     alignByPow2Hi(info->borderWidth, alignment);
 
+    updatePlanes(index);
+
     KisImagePatch patch(info->imageRect, info->borderWidth,
                         planeScale, planeScale);
 
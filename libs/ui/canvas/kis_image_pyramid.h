@@ -20,6 +20,7 @@
 #define __KIS_IMAGE_PYRAMID
 
 #include <QImage>
+#include <QRegion>
 #include <QVector>
 #include <QThreadStorage>
 
@@ -80,20 +81,20 @@ private:
     void clearPyramid();
 
     /**
-     * Downsamples @srcRect from @src paint device and writes
-     * result into proper place of @dst paint device
-     * Returns modified rect of @dst paintDevice
+     * Downsamples @srcRegion from @src paint device and writes
+     * result into proper place of @dst paint device. The patches
+     * of the region are processed concurrently.
+     * Returns modified region of @dst paintDevice
      */
-    QRect downsampleByFactor2(const QRect& srcRect,
-                              KisPaintDevice* src, KisPaintDevice* dst);
+    QRegion downsampleByFactor2(const QRegion& srcRegion,
+                                KisPaintDevice* src, KisPaintDevice* dst);
 
     /**
-     * Auxiliary function. Downsamples two lines in @srcRow0
-     * and @srcRow1 into one line @dstRow
-     * Note: @numSrcPixels must be EVEN
+     * Brings the planes up to @index up to date with the original
+     * plane. The planes are downsampled lazily, only when some
+     * patch is requested from them.
      */
-    void downsamplePixels(const quint8 *srcRow0, const quint8 *srcRow1,
-                          quint8 *dstRow, qint32 numSrcPixels);
+    void updatePlanes(int index);
 
     /**
      * Searches for the last pyramid plane that can cover
@@ -116,6 +117,12 @@ private Q_SLOTS:
 private:
 
     QVector<KisPaintDeviceSP> m_pyramid;
+
+    /**
+     * m_dirtyRegions[i] is the area of the plane (i - 1) that has
+     * not yet been downsampled into the plane i
+     */
+    QVector<QRegion> m_dirtyRegions;
     KisImageWSP  m_originalImage;
 
     const KoColorProfile* m_monitorProfile;
@@ -59,22 +59,6 @@ struct RendererPair {
     }
 };
 
-int calculateNumberMemoryAllowedClones(KisImageSP image)
-{
-    KisMemoryStatisticsServer::Statistics stats =
-        KisMemoryStatisticsServer::instance()
-        ->fetchMemoryStatistics(image);
-
-    const qint64 allowedMemory = 0.8 * stats.tilesHardLimit - stats.realMemorySize;
-    const qint64 cloneSize = stats.projectionsSize;
-
-    if (cloneSize > 0 && allowedMemory > 0) {
-        return allowedMemory / cloneSize;
-    }
-
-    return 0; // will become 1; either when the cloneSize = 0 or the allowedMemory is 0 or below
-}
-
 }
 
 
@@ -233,6 +217,22 @@ KisAsyncAnimationRenderDialogBase::regenerateRange(KisViewManager *viewManager)
     return m_d->result;
 }
 
+int KisAsyncAnimationRenderDialogBase::calculateNumberMemoryAllowedClones(KisImageSP image)
+{
+    KisMemoryStatisticsServer::Statistics stats =
+        KisMemoryStatisticsServer::instance()
+        ->fetchMemoryStatistics(image);
+
+    const qint64 allowedMemory = 0.8 * stats.tilesHardLimit - stats.realMemorySize;
+    const qint64 cloneSize = stats.projectionsSize;
+
+    if (cloneSize > 0 && allowedMemory > 0) {
+        return allowedMemory / cloneSize;
+    }
+
+    return 0; // will become 1; either when the cloneSize = 0 or the allowedMemory is 0 or below
+}
+
 void KisAsyncAnimationRenderDialogBase::setRegionOfInterest(const KisRegion &roi)
 {
     m_d->regionOfInterest = roi;
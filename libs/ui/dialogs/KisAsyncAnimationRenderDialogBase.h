@@ -112,6 +112,12 @@ public:
      */
     bool batchMode() const;
 
+    /**
+     * @return the number of clones of \p image that can be created without
+     *         exceeding the memory limits (the image itself is not counted)
+     */
+    static int calculateNumberMemoryAllowedClones(KisImageSP image);
+
 private Q_SLOTS:
     void slotFrameCompleted(int frame);
     void slotFrameCancelled(int frame);
@@ -62,6 +62,7 @@
 #include "kis_extended_modifiers_mapper.h"
 #include "kis_input_manager_p.h"
 #include "kis_algebra_2d.h"
+#include "KisLatencyTracer.h"
 
 template <typename T>
 uint qHash(QPointer<T> value) {
@@ -564,6 +565,11 @@ bool KisInputManager::eventFilterImpl(QEvent * event)
         d->debugEvent<QTabletEvent, false>(event);
 
         QTabletEvent *tabletEvent = static_cast<QTabletEvent*>(event);
+
+        if (KisLatencyTracer::isEnabled()) {
+            KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::TabletEvent);
+        }
+
         retval = compressMoveEventCommon(tabletEvent);
 
         if (d->tabletLatencyTracker) {
@@ -19,12 +19,17 @@
 #include "kis_animation_cache_populator.h"
 
 #include <functional>
+#include <vector>
+#include <memory>
+#include <algorithm>
 
 #include <QTimer>
 #include <QMutex>
 #include <QtConcurrent>
+#include <QtMath>
 
 #include "kis_config.h"
+#include "kis_image_config.h"
 #include "kis_config_notifier.h"
 #include "KisPart.h"
 #include "KisDocument.h"
@@ -43,6 +48,18 @@
 #include "KisAsyncAnimationCacheRenderer.h"
 #include "dialogs/KisAsyncAnimationCacheRenderDialog.h"
 
+namespace {
+struct Worker {
+    std::unique_ptr<KisAsyncAnimationCacheRenderer> renderer;
+    KisImageSP image;
+
+    /**
+     * The frames that will be cached when the renderer completes
+     * its current request
+     */
+    KisTimeSpan frames;
+};
+}
 
 struct KisAnimationCachePopulator::Private
 {
@@ -67,7 +84,16 @@ struct KisAnimationCachePopulator::Private
 
     QFutureWatcher<void> infoConversionWatcher;
 
-    KisAsyncAnimationCacheRenderer regenerator;
+    /**
+     * The first worker renders the frames on the image of the cache itself,
+     * the others on its clones. The clones are valid until the cache
+     * is invalidated.
+     */
+    std::vector<Worker> workers;
+    KisAnimationFrameCacheSP workersCache;
+    int workersCacheSeqNo = -1;
+    KisTimeSpan workersSkipRange;
+
     bool calculateAnimationCacheInBackground = true;
 
 
@@ -113,6 +139,8 @@ struct KisAnimationCachePopulator::Private
 
             if (idleCounter >= IDLE_COUNT_THRESHOLD) {
                 if (!tryRequestGeneration()) {
+                    // everything is cached, the clones are not needed anymore
+                    destroyWorkers();
                     enterState(NotWaitingForAnything);
                 }
                 return;
@@ -190,16 +218,183 @@ struct KisAnimationCachePopulator::Private
         KisImageSP image = cache->image();
         if (!image) return false;
 
-        KisImageAnimationInterface *animation = image->animationInterface();
-        KisTimeSpan currentRange = animation->fullClipRange();
+        if (!hasActiveWorkers()) {
+            KisImageConfig cfg(true);
+
+            const QVector<FrameRequest> requests =
+                calcFrameRequests(cache, skipRange, priorityFrame, cfg.frameRenderingClones());
+
+            if (requests.isEmpty()) return false;
+
+            if (!createWorkers(cache, requests.size())) {
+                // the image is busy, try again when it gets idle
+                if (priorityFrame >= 0) {
+                    priorityFrames.push(qMakePair(image, priorityFrame));
+                }
+
+                enterState(WaitingForIdle);
+                return true;
+            }
+
+            workersSkipRange = skipRange;
 
-        const int frame = priorityFrame >= 0 ? priorityFrame : KisAsyncAnimationCacheRenderDialog::calcFirstDirtyFrame(cache, currentRange, skipRange);
+            return startWorkers(requests, true);
+        }
 
-        if (frame >= 0) {
-            return regenerate(cache, frame);
+        if (!workersAreValid(cache)) {
+            // the clones are outdated, wait until all the workers are done
+            return false;
         }
 
-        return false;
+        const int numIdleWorkers =
+            std::count_if(workers.begin(), workers.end(),
+                          [] (const Worker &worker) { return !worker.renderer->isActive(); });
+
+        const QVector<FrameRequest> requests =
+            calcFrameRequests(cache, skipRange, priorityFrame, numIdleWorkers);
+
+        // the user might be working on the image, so only the clones
+        // are loaded until the image becomes idle again
+        return startWorkers(requests, part->idleWatcher()->isIdle());
+    }
+
+    /**
+     * Same as KisAnimationCachePopulator::calcFrameRequests(), but skips
+     * the frames the active workers are busy with
+     */
+    QVector<FrameRequest> calcFrameRequests(KisAnimationFrameCacheSP cache, const KisTimeSpan &skipRange, int priorityFrame, int maxFrames)
+    {
+        QVector<KisTimeSpan> busyRanges;
+
+        for (auto it = workers.begin(); it != workers.end(); ++it) {
+            if (it->renderer->isActive()) {
+                busyRanges << it->frames;
+            }
+        }
+
+        return KisAnimationCachePopulator::calcFrameRequests(cache, skipRange, busyRanges, priorityFrame, maxFrames);
+    }
+
+    bool hasActiveWorkers() const
+    {
+        return std::any_of(workers.begin(), workers.end(),
+                           [] (const Worker &worker) { return worker.renderer->isActive(); });
+    }
+
+    bool workersAreValid(KisAnimationFrameCacheSP cache) const
+    {
+        return !workers.empty() &&
+            workersCache == cache &&
+            workersCacheSeqNo == cache->invalidationSeqNo();
+    }
+
+    /**
+     * Creates the workers for \p cache, unless the existing ones are still
+     * valid. Returns false if the image is busy and cannot be cloned now.
+     */
+    bool createWorkers(KisAnimationFrameCacheSP cache, int numDirtyFrames)
+    {
+        KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(!hasActiveWorkers(), false);
+
+        if (workersAreValid(cache)) return true;
+
+        destroyWorkers();
+
+        KisImageSP image = cache->image();
+        KisImageConfig cfg(true);
+
+        const int numAllowedWorkers = 1 + KisAsyncAnimationRenderDialogBase::calculateNumberMemoryAllowedClones(image);
+        const int proposedNumWorkers = qMin(numDirtyFrames, cfg.frameRenderingClones());
+        const int numWorkers = qMax(1, qMin(proposedNumWorkers, numAllowedWorkers));
+        const int numThreadsPerWorker = qMax(1, qCeil(qreal(cfg.maxNumberOfThreads()) / numWorkers));
+
+        /**
+         * The clones should be taken from a consistent state of the image,
+         * not in the middle of a stroke. We don't want to wait for the user's
+         * strokes in the GUI thread, so the cycle is just skipped instead.
+         */
+        if (numWorkers > 1 && !image->tryBarrierLock(true)) {
+            return false;
+        }
+
+        for (int i = 0; i < numWorkers; i++) {
+            Worker worker;
+            worker.renderer.reset(new KisAsyncAnimationCacheRenderer());
+
+            /**
+             * The image itself keeps its threads limit, so that the
+             * user's actions are not slowed down by the background
+             * regeneration
+             */
+            if (i == 0) {
+                worker.image = image;
+            } else {
+                worker.image = image->clone(true);
+                worker.image->setWorkingThreadsLimit(numThreadsPerWorker);
+            }
+
+            q->connect(worker.renderer.get(), SIGNAL(sigFrameCancelled(int)), SLOT(slotRegeneratorFrameCancelled()));
+            q->connect(worker.renderer.get(), SIGNAL(sigFrameCompleted(int)), SLOT(slotRegeneratorFrameReady()));
+
+            workers.push_back(std::move(worker));
+        }
+
+        if (numWorkers > 1) {
+            image->unlock();
+        }
+
+        workersCache = cache;
+        workersCacheSeqNo = cache->invalidationSeqNo();
+
+        return true;
+    }
+
+    void destroyWorkers()
+    {
+        KIS_SAFE_ASSERT_RECOVER_RETURN(!hasActiveWorkers());
+
+        for (auto it = workers.begin(); it != workers.end(); ++it) {
+            if (it != workers.begin()) {
+                it->image->barrierLock(true);
+                it->image->unlock();
+            }
+
+            // we might be called from the renderer's own signal
+            it->renderer.release()->deleteLater();
+        }
+
+        workers.clear();
+        workersCache.clear();
+        workersCacheSeqNo = -1;
+        workersSkipRange = KisTimeSpan();
+    }
+
+    bool startWorkers(const QVector<FrameRequest> &requests, bool useCacheImage)
+    {
+        auto request = requests.begin();
+
+        for (auto it = workers.begin(); it != workers.end() && request != requests.end(); ++it) {
+            if (it->renderer->isActive()) continue;
+            if (it == workers.begin() && !useCacheImage) continue;
+
+            /**
+             * We should enter the state before the frame is
+             * requested. Otherwise the signal may come earlier than we
+             * enter it.
+             */
+            enterState(WaitingForFrame);
+
+            it->frames = request->identicalFrames;
+            it->renderer->setFrameCache(workersCache);
+
+            // if we ever decide to add ROI to background cache
+            // regeneration, it should be added here :)
+            it->renderer->startFrameRegeneration(it->image, request->frame);
+
+            ++request;
+        }
+
+        return request != requests.begin();
     }
 
     bool regenerate(KisAnimationFrameCacheSP cache, int frame)
@@ -209,20 +404,29 @@ struct KisAnimationCachePopulator::Private
             return false;
         }
 
-        /**
-         * We should enter the state before the frame is
-         * requested. Otherwise the signal may come earlier than we
-         * enter it.
-         */
-        enterState(WaitingForFrame);
+        // the infinite skip range makes only the requested frame regenerated
+        return tryRequestGeneration(cache, KisTimeSpan::infinite(0), frame);
+    }
 
-        regenerator.setFrameCache(cache);
+    void handleWorkerFinished(bool isCancelled)
+    {
+        if (hasActiveWorkers()) {
+            /**
+             * Keep the other workers busy while the clones are still valid.
+             * The priority frames are handled when all the workers are done.
+             */
+            if (!isCancelled && priorityFrames.isEmpty() && workersCache) {
+                tryRequestGeneration(workersCache, workersSkipRange, -1);
+            }
+            return;
+        }
 
-        // if we ever decide to add ROI to background cache
-        // regeneration, it should be added here :)
-        regenerator.startFrameRegeneration(cache->image(), frame);
+        if (workersCache && !workersAreValid(workersCache)) {
+            // release the memory occupied by the outdated clones
+            destroyWorkers();
+        }
 
-        return true;
+        enterState(isCancelled ? NotWaitingForAnything : BetweenFrames);
     }
 
     QString debugStateToString(State newState) {
@@ -284,9 +488,6 @@ KisAnimationCachePopulator::KisAnimationCachePopulator(KisPart *part)
 {
     connect(&m_d->timer, SIGNAL(timeout()), this, SLOT(slotTimer()));
 
-    connect(&m_d->regenerator, SIGNAL(sigFrameCancelled(int)), SLOT(slotRegeneratorFrameCancelled()));
-    connect(&m_d->regenerator, SIGNAL(sigFrameCompleted(int)), SLOT(slotRegeneratorFrameReady()));
-
     connect(KisConfigNotifier::instance(), SIGNAL(configChanged()), SLOT(slotConfigChanged()));
     slotConfigChanged();
 }
@@ -296,6 +497,63 @@ KisAnimationCachePopulator::~KisAnimationCachePopulator()
     m_d->priorityFrames.clear();
 }
 
+QVector<KisAnimationCachePopulator::FrameRequest>
+KisAnimationCachePopulator::calcFrameRequests(KisAnimationFrameCacheSP cache, const KisTimeSpan &skipRange, const QVector<KisTimeSpan> &busyRanges, int priorityFrame, int maxFrames)
+{
+    QVector<FrameRequest> requests;
+
+    KisImageSP image = cache->image();
+    if (!image) return requests;
+
+    QVector<KisTimeSpan> skippedRanges = busyRanges;
+
+    auto tryAddRequest = [&] (int frame) {
+        Q_FOREACH (const KisTimeSpan &range, skippedRanges) {
+            if (range.contains(frame)) return;
+        }
+
+        FrameRequest request;
+        request.frame = frame;
+        request.identicalFrames = KisTimeSpan::calculateIdenticalFramesRecursive(image->root(), frame);
+
+        requests << request;
+        skippedRanges << request.identicalFrames;
+    };
+
+    if (priorityFrame >= 0 && maxFrames > 0) {
+        tryAddRequest(priorityFrame);
+    }
+
+    KisImageAnimationInterface *animation = image->animationInterface();
+    if (!animation->hasAnimation()) return requests;
+
+    const KisTimeSpan range = animation->fullClipRange();
+    if (!range.isValid() || range.isInfinite()) return requests;
+
+    const int playheadTime = qBound(range.start(), animation->currentUITime(), range.end());
+
+    for (int distance = 0; requests.size() < maxFrames; distance++) {
+        const int laterFrame = playheadTime + distance;
+        const int earlierFrame = playheadTime - distance;
+
+        if (laterFrame > range.end() && earlierFrame < range.start()) break;
+
+        // the frames after the playhead go first, since they will be played first
+        const int candidates[] = {laterFrame, earlierFrame};
+
+        for (int i = 0; i < (distance ? 2 : 1) && requests.size() < maxFrames; i++) {
+            const int frame = candidates[i];
+
+            if (!range.contains(frame) || skipRange.contains(frame)) continue;
+            if (cache->frameStatus(frame) == KisAnimationFrameCache::Cached) continue;
+
+            tryAddRequest(frame);
+        }
+    }
+
+    return requests;
+}
+
 bool KisAnimationCachePopulator::regenerate(KisAnimationFrameCacheSP cache, int frame)
 {
     return m_d->regenerate(cache, frame);
@@ -328,12 +586,12 @@ void KisAnimationCachePopulator::slotRequestRegeneration()
 void KisAnimationCachePopulator::slotRegeneratorFrameCancelled()
 {
     KIS_ASSERT_RECOVER_RETURN(m_d->state == Private::WaitingForFrame);
-    m_d->enterState(Private::NotWaitingForAnything);
+    m_d->handleWorkerFinished(true);
 }
 
 void KisAnimationCachePopulator::slotRegeneratorFrameReady()
 {
-    m_d->enterState(Private::BetweenFrames);
+    m_d->handleWorkerFinished(false);
 }
 
 void KisAnimationCachePopulator::slotConfigChanged()
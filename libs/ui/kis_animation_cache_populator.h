@@ -20,11 +20,14 @@
 #define KIS_ANIMATION_CACHE_POPULATOR_H
 
 #include <QObject>
+#include <QVector>
 #include "kis_types.h"
+#include "kis_time_span.h"
+#include "kritaui_export.h"
 
 class KisPart;
 
-class KisAnimationCachePopulator : public QObject
+class KRITAUI_EXPORT KisAnimationCachePopulator : public QObject
 {
     Q_OBJECT
 
@@ -40,6 +43,25 @@ public:
     bool regenerate(KisAnimationFrameCacheSP cache, int frame);
     void requestRegenerationWithPriorityFrame(KisImageSP image, int frameIndex);
 
+    struct FrameRequest {
+        int frame;
+        KisTimeSpan identicalFrames;
+    };
+
+    /**
+     * Collects up to \p maxFrames uncached frames of \p cache starting from
+     * the frames nearest to the playhead, the later frames go first. The
+     * frames in \p skipRange and in \p busyRanges (i.e. already being
+     * regenerated) are skipped, as well as the frames identical to the
+     * already collected ones. \p priorityFrame, if non-negative, is put
+     * in front of the others.
+     */
+    static QVector<FrameRequest> calcFrameRequests(KisAnimationFrameCacheSP cache,
+                                                   const KisTimeSpan &skipRange,
+                                                   const QVector<KisTimeSpan> &busyRanges,
+                                                   int priorityFrame,
+                                                   int maxFrames);
+
 public Q_SLOTS:
     void slotRequestRegeneration();
 
@@ -18,7 +18,10 @@
 
 #include "kis_animation_frame_cache.h"
 
+#include <QList>
 #include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
 
 #include "kis_debug.h"
 
@@ -56,9 +59,61 @@ struct KisAnimationFrameCache::Private
     KisOpenGLImageTexturesSP textures;
     KisImageWSP image;
 
-    QScopedPointer<KisAbstractFrameCacheSwapper> swapper;
+    QSharedPointer<KisAbstractFrameCacheSwapper> swapper;
     int frameSizeLimit = 777;
 
+    /**
+     * The pending frames are registered in the context of the image
+     * worker threads, so every access to the swapper should be guarded.
+     * The only exception is KisAbstractFrameCacheSwapper::prepareFrame(),
+     * which is thread-safe and is called without the lock, so the workers
+     * would not stall on each other's compression.
+     */
+    QMutex swapperLock;
+
+    /**
+     * The pending frames are saved under negative ids, so they never
+     * clash with the cached frames. -1 means "no frame" for the swappers.
+     */
+    int nextPendingFrameId = -2;
+
+    int invalidationSeqNo = 0;
+
+    /**
+     * The ranges invalidated recently, paired with the sequence numbers
+     * they were invalidated with. A pending frame is dropped only if one
+     * of the ranges invalidated after it was requested overlaps it.
+     */
+    QList<QPair<int, KisTimeSpan>> invalidatedRanges;
+    static const int MAX_INVALIDATED_RANGES = 64;
+
+    void registerInvalidation(const KisTimeSpan &range)
+    {
+        invalidationSeqNo++;
+        invalidatedRanges.append(qMakePair(invalidationSeqNo, range));
+
+        while (invalidatedRanges.size() > MAX_INVALIDATED_RANGES) {
+            invalidatedRanges.removeFirst();
+        }
+    }
+
+    bool rangeInvalidatedSince(int seqNo, const KisTimeSpan &range) const
+    {
+        if (seqNo == invalidationSeqNo) return false;
+
+        // the history doesn't go that far, so we cannot tell
+        if (invalidatedRanges.isEmpty() || invalidatedRanges.first().first > seqNo + 1) return true;
+
+        typedef QPair<int, KisTimeSpan> InvalidatedRange;
+        Q_FOREACH (const InvalidatedRange &invalidated, invalidatedRanges) {
+            if (invalidated.first > seqNo && (invalidated.second & range).isValid()) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     KisOpenGLUpdateInfoSP fetchFrameDataImpl(KisImageSP image, const QRect &requestedRect, int lod);
 
     struct Frame
@@ -108,7 +163,10 @@ struct KisAnimationFrameCache::Private
     KisOpenGLUpdateInfoSP getFrame(int time)
     {
         const int frameId = getFrameIdAtTime(time);
-        return frameId >= 0 ? swapper->loadFrame(frameId) : 0;
+        if (frameId < 0) return 0;
+
+        QMutexLocker l(&swapperLock);
+        return swapper->loadFrame(frameId);
     }
 
     void addFrame(KisOpenGLUpdateInfoSP info, const KisTimeSpan& range)
@@ -117,9 +175,22 @@ struct KisAnimationFrameCache::Private
 
         const int length = range.isInfinite() ? -1 : range.end() - range.start() + 1;
         newFrames.insert(range.start(), length);
+
+        QMutexLocker l(&swapperLock);
         swapper->saveFrame(range.start(), info, image->bounds());
     }
 
+    void addPendingFrame(int pendingFrameId, const KisTimeSpan& range)
+    {
+        invalidate(range);
+
+        const int length = range.isInfinite() ? -1 : range.end() - range.start() + 1;
+        newFrames.insert(range.start(), length);
+
+        QMutexLocker l(&swapperLock);
+        swapper->moveFrame(pendingFrameId, range.start());
+    }
+
     /**
      * Invalidate any cached frames within the given time range.
      * @param range
@@ -129,6 +200,7 @@ struct KisAnimationFrameCache::Private
     {
         if (newFrames.isEmpty()) return false;
 
+        QMutexLocker l(&swapperLock);
         bool cacheChanged = false;
 
         auto it = newFrames.lowerBound(range.start());
@@ -278,6 +350,8 @@ void KisAnimationFrameCache::framesChanged(const KisTimeSpan &range, const QRect
 
     if (!range.isValid()) return;
 
+    m_d->registerInvalidation(range);
+
     bool cacheChanged = m_d->invalidate(range);
 
     if (cacheChanged) {
@@ -288,13 +362,18 @@ void KisAnimationFrameCache::framesChanged(const KisTimeSpan &range, const QRect
 void KisAnimationFrameCache::slotConfigChanged()
 {
     m_d->newFrames.clear();
+    m_d->registerInvalidation(KisTimeSpan::infinite(0));
 
     KisImageConfig cfg(true);
 
-    if (cfg.useOnDiskAnimationCacheSwapping()) {
-        m_d->swapper.reset(new KisFrameCacheSwapper(m_d->textures->updateInfoBuilder(), cfg.swapDir()));
-    } else {
-        m_d->swapper.reset(new KisInMemoryFrameCacheSwapper());
+    {
+        QMutexLocker l(&m_d->swapperLock);
+
+        if (cfg.useOnDiskAnimationCacheSwapping()) {
+            m_d->swapper.reset(new KisFrameCacheSwapper(m_d->textures->updateInfoBuilder(), cfg.swapDir()));
+        } else {
+            m_d->swapper.reset(new KisInMemoryFrameCacheSwapper());
+        }
     }
 
     m_d->frameSizeLimit = cfg.useAnimationCacheFrameSizeLimit() ? cfg.animationCacheFrameSizeLimit() : 0;
@@ -352,11 +431,81 @@ void KisAnimationFrameCache::addConvertedFrameData(KisOpenGLUpdateInfoSP info, i
     emit changed();
 }
 
+int KisAnimationFrameCache::invalidationSeqNo() const
+{
+    return m_d->invalidationSeqNo;
+}
+
+int KisAnimationFrameCache::saveConvertedFrameData(KisOpenGLUpdateInfoSP info, KisImageSP image)
+{
+    QSharedPointer<KisAbstractFrameCacheSwapper> swapper;
+    int pendingFrameId = -1;
+
+    {
+        QMutexLocker l(&m_d->swapperLock);
+        swapper = m_d->swapper;
+        pendingFrameId = m_d->nextPendingFrameId--;
+    }
+
+    KisAbstractFrameCacheSwapper::PreparedFrameSP frame =
+        swapper->prepareFrame(info, image->bounds());
+
+    if (frame) {
+        QMutexLocker l(&m_d->swapperLock);
+
+        // if the swapper has been recreated in the meantime, the frame
+        // is just dropped, commitConvertedFrameData() will not find it
+        if (m_d->swapper == swapper) {
+            m_d->swapper->savePreparedFrame(pendingFrameId, frame);
+        }
+    }
+
+    return pendingFrameId;
+}
+
+bool KisAnimationFrameCache::commitConvertedFrameData(int pendingFrameId, int time, int invalidationSeqNo)
+{
+    const KisTimeSpan identicalRange =
+        KisTimeSpan::calculateIdenticalFramesRecursive(m_d->image->root(), time);
+
+    if (m_d->rangeInvalidatedSince(invalidationSeqNo, identicalRange)) {
+        discardConvertedFrameData(pendingFrameId);
+        return false;
+    }
+
+    {
+        QMutexLocker l(&m_d->swapperLock);
+
+        // the swapper might have been recreated after the frame was saved
+        if (!m_d->swapper->hasFrame(pendingFrameId)) {
+            return false;
+        }
+    }
+
+    m_d->addPendingFrame(pendingFrameId, identicalRange);
+
+    emit changed();
+
+    return true;
+}
+
+void KisAnimationFrameCache::discardConvertedFrameData(int pendingFrameId)
+{
+    QMutexLocker l(&m_d->swapperLock);
+
+    // the swapper might have been recreated after the frame was saved
+    if (m_d->swapper->hasFrame(pendingFrameId)) {
+        m_d->swapper->forgetFrame(pendingFrameId);
+    }
+}
+
 void KisAnimationFrameCache::dropLowQualityFrames(const KisTimeSpan &range, const QRect &regionOfInterest, const QRect &minimalRect)
 {
     KIS_SAFE_ASSERT_RECOVER_RETURN(!range.isInfinite());
     if (m_d->newFrames.isEmpty()) return;
 
+    QMutexLocker l(&m_d->swapperLock);
+
     auto it = m_d->newFrames.upperBound(range.start());
 
     // the vector is guaranteed to be non-empty,
@@ -389,6 +538,8 @@ bool KisAnimationFrameCache::framesHaveValidRoi(const KisTimeSpan &range, const
     KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(!range.isInfinite(), false);
     if (m_d->newFrames.isEmpty()) return false;
 
+    QMutexLocker l(&m_d->swapperLock);
+
     auto it = m_d->newFrames.upperBound(range.start());
 
     if (it != m_d->newFrames.begin()) it--;
@@ -420,3 +571,8 @@ bool KisAnimationFrameCache::framesHaveValidRoi(const KisTimeSpan &range, const
 
     return true;
 }
+
+KisOpenGLUpdateInfoSP KisAnimationFrameCache::testingLoadFrame(int time)
+{
+    return m_d->getFrame(time);
+}
@@ -67,6 +67,44 @@ public:
     KisOpenGLUpdateInfoSP fetchFrameData(int time, KisImageSP image, const KisRegion &requestedRegion) const;
     void addConvertedFrameData(KisOpenGLUpdateInfoSP info, int time);
 
+    /**
+     * The sequence number is incremented every time the cached frames
+     * are invalidated. It lets the caller detect that a frame that was
+     * rendered asynchronously (e.g. on a clone of the image) might be
+     * outdated already. Any edit of the image changes the number,
+     * commitConvertedFrameData() checks the invalidated ranges themselves.
+     */
+    int invalidationSeqNo() const;
+
+    /**
+     * Compresses \p info, fetched from \p image, into the frames storage
+     * without making it visible to the users of the cache. Unlike
+     * addConvertedFrameData(), this method can be called from any thread,
+     * so the frames can be compressed in the context of the image worker
+     * threads. The compression itself doesn't block the cache, only the
+     * final registration of the frame does.
+     *
+     * @return the id of the pending frame that should be passed to either
+     *         commitConvertedFrameData() or discardConvertedFrameData()
+     */
+    int saveConvertedFrameData(KisOpenGLUpdateInfoSP info, KisImageSP image);
+
+    /**
+     * Adds the pending frame \p pendingFrameId at \p time. The frame is
+     * discarded if any range invalidated after \p invalidationSeqNo has been
+     * fetched overlaps the frames identical to \p time, or if the frames storage has been recreated since the
+     * frame was saved. Should be called from the GUI thread.
+     *
+     * @return true if the frame has been added into the cache
+     */
+    bool commitConvertedFrameData(int pendingFrameId, int time, int invalidationSeqNo);
+
+    /**
+     * Drops the pending frame \p pendingFrameId without adding it
+     * into the cache
+     */
+    void discardConvertedFrameData(int pendingFrameId);
+
     /**
      * Drops all the frames with worse level of detail values than the current
      * desired level of detail.
@@ -75,6 +113,12 @@ public:
 
     bool framesHaveValidRoi(const KisTimeSpan &range, const QRect &regionOfInterest);
 
+    /**
+     * Loads the frame cached at \p time, returns null if the frame is
+     * not cached. Used in unit tests only.
+     */
+    KisOpenGLUpdateInfoSP testingLoadFrame(int time);
+
 Q_SIGNALS:
     void changed();
 
@@ -30,6 +30,7 @@
 #include "kis_paint_layer.h"
 #include "kis_group_layer.h"
 #include "kis_raster_keyframe_channel.h"
+#include "kis_paint_device_frames_interface.h"
 #include "commands/kis_image_layer_add_command.h"
 
 struct KisAnimationImporter::Private
@@ -117,6 +118,14 @@ KisImportExportErrorCode KisAnimationImporter::import(QStringList files, int fir
         filesProcessed++;
     }
 
+    if (contentChannel) {
+        KisPaintDeviceSP device = contentChannel->paintDevice();
+        if (device) {
+            // held frames come as separate images, let them share the equal tiles
+            device->framesInterface()->shareEqualFrameTiles();
+        }
+    }
+
     undo->endMacro();
 
     return status;
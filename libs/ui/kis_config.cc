@@ -1847,6 +1847,16 @@ void KisConfig::setCompressKra(bool compress)
     m_cfg.writeEntry("compressLayersInKra", compress);
 }
 
+int KisConfig::mergedImageCompressionInKra(bool defaultValue) const
+{
+    return (defaultValue ? 3 : qBound(0, m_cfg.readEntry("mergedImageCompressionInKra", 3), 9));
+}
+
+void KisConfig::setMergedImageCompressionInKra(int level)
+{
+    m_cfg.writeEntry("mergedImageCompressionInKra", level);
+}
+
 bool KisConfig::trimKra(bool defaultValue) const
 {
     return (defaultValue ? false : m_cfg.readEntry("TrimKra", false));
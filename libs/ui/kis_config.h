@@ -530,6 +530,13 @@ public:
     bool compressKra(bool defaultValue = false) const;
     void setCompressKra(bool compress);
 
+    /**
+     * zlib level used for mergedimage.png inside .kra files, lower levels
+     * make saving of big images faster at the cost of a bigger file
+     */
+    int mergedImageCompressionInKra(bool defaultValue = false) const;
+    void setMergedImageCompressionInKra(int level);
+
     bool trimKra(bool defaultValue = false) const;
     void setTrimKra(bool trim);
 
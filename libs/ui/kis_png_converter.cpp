@@ -66,6 +66,7 @@
 #include "kis_clipboard.h"
 #include <kis_cursor_override_hijacker.h>
 #include "kis_undo_stores.h"
+#include "KisPNGParallelDeflate.h"
 
 #include <kis_assert.h>
 
@@ -857,7 +858,7 @@ KisImageSP KisPNGConverter::image()
     return m_image;
 }
 
-bool KisPNGConverter::saveDeviceToStore(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KoStore *store, KisMetaData::Store* metaData)
+bool KisPNGConverter::saveDeviceToStore(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KoStore *store, KisMetaData::Store* metaData, int compressionLevel)
 {
     if (store->open(filename)) {
         KoStoreDevice io(store);
@@ -872,7 +873,8 @@ bool KisPNGConverter::saveDeviceToStore(const QString &filename, const QRect &im
             metaDataStore = new KisMetaData::Store(*metaData);
         }
         KisPNGOptions options;
-        options.compression = 3;
+        options.compression = compressionLevel;
+        options.parallelCompression = true;
         options.interlace = false;
         options.tryToSaveAsIndexed = false;
         options.alpha = true;
@@ -1386,6 +1388,21 @@ KisImportExportErrorCode KisPNGConverter::buildFile(QIODevice* iodevice, const Q
         }
     }
 
+    if (options.parallelCompression && !options.interlace) {
+        bool swapBytes = false;
+#ifndef WORDS_BIGENDIAN
+        swapBytes = color_nb_bits > 8;
+#endif
+        KisPNGParallelDeflate deflate(color_nb_bits, png_get_channels(png_ptr, info_ptr),
+                                      options.compression, color_type != PNG_COLOR_TYPE_PALETTE);
+
+        const bool result = deflate.writeImageData(iodevice, rowPointers.rows, rowPointers.numRows,
+                                                   png_get_rowbytes(png_ptr, info_ptr), swapBytes);
+
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        return result ? ImportExportCodes::OK : ImportExportCodes::ErrorWhileWriting;
+    }
+
     png_write_image(png_ptr, rowPointers.rows);
 
     // Writing is over
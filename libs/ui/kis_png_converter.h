@@ -56,6 +56,7 @@ struct KisPNGOptions {
         , storeMetaData(false)
         , storeAuthor(false)
         , saveAsHDR(false)
+        , parallelCompression(false)
         , transparencyFillColor(Qt::white)
     {}
 
@@ -71,6 +72,7 @@ struct KisPNGOptions {
     bool storeMetaData;
     bool storeAuthor;
     bool saveAsHDR;
+    bool parallelCompression; ///< compress non-interlaced images on all the cores
     QList<const KisMetaData::Filter*> filters;
     QColor transparencyFillColor;
 
@@ -124,9 +126,11 @@ public:
 
     /**
      * @brief saveDeviceToStore saves the given paint device to the KoStore. If the device is not 8 bits sRGB, it will be converted to 8 bits sRGB.
+     * The image data is compressed on all the available cores.
+     * @param compressionLevel zlib compression level, 0...9
      * @return true if the saving succeeds
      */
-    static bool saveDeviceToStore(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KoStore *store, KisMetaData::Store* metaData = 0);
+    static bool saveDeviceToStore(const QString &filename, const QRect &imageRect, const qreal xRes, const qreal yRes, KisPaintDeviceSP dev, KoStore *store, KisMetaData::Store* metaData = 0, int compressionLevel = 3);
 
     static bool isColorSpaceSupported(const KoColorSpace *cs);
 
@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisAnimationCachePopulatorBenchmark.h"
+
+#include <QElapsedTimer>
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kistest.h"
+#include "KisPart.h"
+#include "kis_animation_cache_populator.h"
+#include "kis_animation_frame_cache.h"
+#include "kis_image.h"
+#include "kis_image_animation_interface.h"
+#include "kis_paint_layer.h"
+#include "kis_paint_device_frames_interface.h"
+#include "kis_raster_keyframe_channel.h"
+#include "kis_time_span.h"
+#include "opengl/kis_opengl_image_textures.h"
+#include "animation_cache_testing_utils.h"
+
+
+namespace {
+
+const int numFrames = 48;
+
+KisImageSP createAnimatedImage()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisImageSP image = new KisImage(0, 2000, 2000, cs, "populator benchmark");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8);
+    image->addNode(layer, image->root());
+
+    KisKeyframeChannel *channel = layer->getKeyframeChannel(KisKeyframeChannel::Raster.id(), true);
+
+    for (int time = 0; time < numFrames; time++) {
+        if (!channel->keyframeAt(time)) {
+            channel->addKeyframe(time);
+        }
+
+        // every frame is unique, so the frames cannot be merged by the cache
+        KisPaintDeviceSP frameDevice = new KisPaintDevice(cs);
+        frameDevice->fill(QRect(20 * time, 10 * time, 1000, 1000),
+                          KoColor(QColor::fromHsv(7 * time, 255, 255), cs));
+
+        KisRasterKeyframeSP keyframe = channel->keyframeAt<KisRasterKeyframe>(time);
+        layer->paintDevice()->framesInterface()->uploadFrame(keyframe->frameID(), frameDevice);
+    }
+
+    image->animationInterface()->setFullClipRange(KisTimeSpan::fromTimeToTime(0, numFrames - 1));
+    image->waitForDone();
+
+    return image;
+}
+
+int numCachedFrames(KisAnimationFrameCacheSP cache)
+{
+    return TestUtil::numCachedFrames(cache, KisTimeSpan::fromTimeToTime(0, numFrames - 1));
+}
+
+}
+
+void KisAnimationCachePopulatorBenchmark::benchmarkFillCache_data()
+{
+    // the number of workers includes the image itself
+    QTest::addColumn<int>("numWorkers");
+
+    QTest::newRow("1 worker") << 1;
+    QTest::newRow("2 workers") << 2;
+    QTest::newRow("4 workers") << 4;
+    QTest::newRow("8 workers") << 8;
+}
+
+void KisAnimationCachePopulatorBenchmark::benchmarkFillCache()
+{
+    QFETCH(int, numWorkers);
+
+    TestUtil::FrameRenderingClonesOverride clonesOverride(numWorkers);
+
+    KisImageSP image = createAnimatedImage();
+
+    KisOpenGLImageTexturesSP textures =
+        KisOpenGLImageTextures::getImageTextures(image, 0,
+                                                 KoColorConversionTransformation::IntentPerceptual,
+                                                 KoColorConversionTransformation::Empty);
+    textures->testingForceInitialized();
+
+    KisAnimationFrameCacheSP cache = KisAnimationFrameCache::getFrameCache(textures);
+    KisPart::instance()->cachePopulator()->slotRequestRegeneration();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // the populator starts only after Krita has been idle for some time
+    while (!numCachedFrames(cache) && timer.elapsed() < 60000) {
+        QTest::qWait(1);
+    }
+
+    const int numInitialFrames = numCachedFrames(cache);
+    QVERIFY(numInitialFrames > 0);
+
+    timer.restart();
+
+    while (numCachedFrames(cache) < numFrames && timer.elapsed() < 600000) {
+        QTest::qWait(1);
+    }
+
+    const qint64 elapsed = qMax(qint64(1), timer.elapsed());
+    const int numFramesCached = numCachedFrames(cache) - numInitialFrames;
+
+    qDebug() << "workers:" << numWorkers
+             << "frames:" << numFramesCached
+             << "time:" << elapsed << "ms"
+             << "frames per second:" << 1000.0 * numFramesCached / elapsed;
+
+    QCOMPARE(numCachedFrames(cache), numFrames);
+}
+
+KISTEST_MAIN(KisAnimationCachePopulatorBenchmark)
@@ -0,0 +1,274 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisAnimationCachePopulatorTest.h"
+
+#include <QElapsedTimer>
+#include <QTest>
+#include <testutil.h>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kistest.h"
+#include "KisPart.h"
+#include "kis_animation_cache_populator.h"
+#include "kis_animation_frame_cache.h"
+#include "kis_image.h"
+#include "kis_image_animation_interface.h"
+#include "kis_paint_layer.h"
+#include "kis_paint_device_frames_interface.h"
+#include "kis_raster_keyframe_channel.h"
+#include "kis_time_span.h"
+#include "kis_update_info.h"
+#include "opengl/kis_texture_tile_update_info.h"
+#include "opengl/kis_opengl_image_textures.h"
+#include "animation_cache_testing_utils.h"
+
+
+namespace {
+
+struct AnimatedImage
+{
+    /**
+     * Only the caches registered with \p visibleToPopulator are regenerated
+     * by the background cache populator
+     */
+    AnimatedImage(const QSize &size, const QVector<int> &keyframes, const KisTimeSpan &clipRange, bool visibleToPopulator)
+    {
+        const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+        image = new KisImage(0, size.width(), size.height(), cs, "populator test");
+        layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8);
+        image->addNode(layer, image->root());
+
+        channel = layer->getKeyframeChannel(KisKeyframeChannel::Raster.id(), true);
+
+        Q_FOREACH (int time, keyframes) {
+            if (!channel->keyframeAt(time)) {
+                channel->addKeyframe(time);
+            }
+
+            fillKeyframe(time, QColor::fromHsv(7 * time, 255, 255));
+        }
+
+        image->animationInterface()->setFullClipRange(clipRange);
+        image->waitForDone();
+
+        textures = KisOpenGLImageTextures::getImageTextures(image, 0,
+                                                           KoColorConversionTransformation::IntentPerceptual,
+                                                           KoColorConversionTransformation::Empty);
+        textures->testingForceInitialized();
+
+        cache = visibleToPopulator ?
+            KisAnimationFrameCache::getFrameCache(textures) :
+            KisAnimationFrameCacheSP(new KisAnimationFrameCache(textures));
+    }
+
+    void fillKeyframe(int time, const QColor &color)
+    {
+        KisPaintDeviceSP frameDevice = new KisPaintDevice(image->colorSpace());
+        frameDevice->fill(image->bounds(), KoColor(color, image->colorSpace()));
+
+        KisRasterKeyframeSP keyframe = channel->keyframeAt<KisRasterKeyframe>(time);
+        layer->paintDevice()->framesInterface()->uploadFrame(keyframe->frameID(), frameDevice);
+    }
+
+    void switchTime(int time)
+    {
+        image->animationInterface()->switchCurrentTimeAsync(time);
+        image->waitForDone();
+    }
+
+    void cacheFrame(int time)
+    {
+        switchTime(time);
+        cache->addConvertedFrameData(cache->fetchFrameData(time, image, KisRegion(image->bounds())), time);
+    }
+
+    bool waitForCachedFrames(const QVector<int> &frames, int timeout)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        auto allFramesCached = [this, &frames] () {
+            Q_FOREACH (int time, frames) {
+                if (cache->frameStatus(time) != KisAnimationFrameCache::Cached) return false;
+            }
+            return true;
+        };
+
+        while (!allFramesCached() && timer.elapsed() < timeout) {
+            QTest::qWait(10);
+        }
+
+        return allFramesCached();
+    }
+
+    KisImageSP image;
+    KisPaintLayerSP layer;
+    KisKeyframeChannel *channel = 0;
+    KisOpenGLImageTexturesSP textures;
+    KisAnimationFrameCacheSP cache;
+};
+
+QVector<int> requestedFrames(const QVector<KisAnimationCachePopulator::FrameRequest> &requests)
+{
+    QVector<int> result;
+
+    Q_FOREACH (const KisAnimationCachePopulator::FrameRequest &request, requests) {
+        result << request.frame;
+    }
+
+    return result;
+}
+
+bool cachedFrameIsUpToDate(AnimatedImage &animated, int time)
+{
+    KisOpenGLUpdateInfoSP cachedInfo = animated.cache->testingLoadFrame(time);
+    KIS_COMPARE_RF(bool(cachedInfo), true);
+
+    animated.switchTime(time);
+    KisOpenGLUpdateInfoSP freshInfo =
+        animated.cache->fetchFrameData(time, animated.image, KisRegion(animated.image->bounds()));
+
+    KIS_COMPARE_RF(cachedInfo->levelOfDetail(), freshInfo->levelOfDetail());
+    KIS_COMPARE_RF(cachedInfo->tileList.size(), freshInfo->tileList.size());
+
+    for (int i = 0; i < cachedInfo->tileList.size(); i++) {
+        KisTextureTileUpdateInfoSP cachedTile = cachedInfo->tileList[i];
+        KisTextureTileUpdateInfoSP freshTile = freshInfo->tileList[i];
+
+        KIS_COMPARE_RF(cachedTile->realPatchRect(), freshTile->realPatchRect());
+        KIS_COMPARE_RF(cachedTile->pixelSize(), freshTile->pixelSize());
+
+        const QRect rc = cachedTile->realPatchRect();
+        const int numBytes = rc.width() * rc.height() * cachedTile->pixelSize();
+
+        if (memcmp(cachedTile->data(), freshTile->data(), numBytes) != 0) {
+            qWarning() << "Cached frame is outdated:" << ppVar(time) << ppVar(i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+void KisAnimationCachePopulatorTest::testFrameRequestsOrder()
+{
+    AnimatedImage animated(QSize(64, 64), {0, 5, 10, 15}, KisTimeSpan::fromTimeToTime(0, 19), false);
+    animated.switchTime(7);
+
+    const QVector<KisTimeSpan> busyRanges = {KisTimeSpan::fromTimeToTime(10, 14)};
+    QVector<KisAnimationCachePopulator::FrameRequest> requests;
+
+    // the playhead goes first, then the frames by distance, later first;
+    // the frames identical to the busy or already requested ones are skipped
+    requests = KisAnimationCachePopulator::calcFrameRequests(animated.cache, KisTimeSpan(), busyRanges, -1, 10);
+    QCOMPARE(requestedFrames(requests), QVector<int>({7, 4, 15}));
+    QCOMPARE(requests[0].identicalFrames, KisTimeSpan::fromTimeToTime(5, 9));
+    QCOMPARE(requests[1].identicalFrames, KisTimeSpan::fromTimeToTime(0, 4));
+    QCOMPARE(requests[2].identicalFrames, KisTimeSpan::infinite(15));
+
+    requests = KisAnimationCachePopulator::calcFrameRequests(animated.cache, KisTimeSpan(), busyRanges, -1, 2);
+    QCOMPARE(requestedFrames(requests), QVector<int>({7, 4}));
+
+    // the priority frame is put in front, unless it is busy already
+    requests = KisAnimationCachePopulator::calcFrameRequests(animated.cache, KisTimeSpan(), busyRanges, 2, 10);
+    QCOMPARE(requestedFrames(requests), QVector<int>({2, 7, 15}));
+
+    requests = KisAnimationCachePopulator::calcFrameRequests(animated.cache, KisTimeSpan(), busyRanges, 12, 10);
+    QCOMPARE(requestedFrames(requests), QVector<int>({7, 4, 15}));
+
+    requests = KisAnimationCachePopulator::calcFrameRequests(animated.cache, KisTimeSpan::fromTimeToTime(0, 9), busyRanges, -1, 10);
+    QCOMPARE(requestedFrames(requests), QVector<int>({15}));
+
+    // the cached frames are skipped
+    animated.cacheFrame(15);
+    animated.switchTime(7);
+
+    requests = KisAnimationCachePopulator::calcFrameRequests(animated.cache, KisTimeSpan(), busyRanges, -1, 10);
+    QCOMPARE(requestedFrames(requests), QVector<int>({7, 4}));
+}
+
+void KisAnimationCachePopulatorTest::testPriorityFramesDrain()
+{
+    TestUtil::FrameRenderingClonesOverride clonesOverride(2);
+
+    // the priority frames lie outside the clip range, so they can only
+    // be cached via the priority requests
+    AnimatedImage animated(QSize(64, 64), {0, 10, 20, 30, 40}, KisTimeSpan::fromTimeToTime(0, 3), true);
+
+    KisAnimationCachePopulator *populator = KisPart::instance()->cachePopulator();
+    populator->requestRegenerationWithPriorityFrame(animated.image, 10);
+    populator->requestRegenerationWithPriorityFrame(animated.image, 20);
+    populator->requestRegenerationWithPriorityFrame(animated.image, 30);
+    populator->slotRequestRegeneration();
+
+    QVERIFY(animated.waitForCachedFrames({0, 10, 20, 30}, 60000));
+    QCOMPARE(animated.cache->frameStatus(40), KisAnimationFrameCache::Uncached);
+}
+
+void KisAnimationCachePopulatorTest::testCloneInvalidation()
+{
+    TestUtil::FrameRenderingClonesOverride clonesOverride(3);
+
+    const int numFrames = 24;
+    const KisTimeSpan clipRange = KisTimeSpan::fromTimeToTime(0, numFrames - 1);
+
+    QVector<int> frames;
+    for (int time = 0; time < numFrames; time++) {
+        frames << time;
+    }
+
+    AnimatedImage animated(QSize(1000, 1000), frames, clipRange, true);
+
+    KisPart::instance()->cachePopulator()->slotRequestRegeneration();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!TestUtil::numCachedFrames(animated.cache, clipRange) && timer.elapsed() < 60000) {
+        QTest::qWait(1);
+    }
+
+    QVERIFY(TestUtil::numCachedFrames(animated.cache, clipRange) > 0);
+
+    /**
+     * Change all the frames while the workers are (most probably) still
+     * busy on their clones. Whatever the timing is, no frame rendered on
+     * an outdated clone should reach the cache.
+     */
+    animated.image->barrierLock();
+    Q_FOREACH (int time, frames) {
+        animated.fillKeyframe(time, QColor::fromHsv(7 * time, 128, 128));
+    }
+    animated.image->unlock();
+    animated.image->invalidateFrames(KisTimeSpan::infinite(0), animated.image->bounds());
+
+    QVERIFY(animated.waitForCachedFrames(frames, 600000));
+
+    Q_FOREACH (int time, frames) {
+        QVERIFY(cachedFrameIsUpToDate(animated, time));
+    }
+}
+
+KISTEST_MAIN(KisAnimationCachePopulatorTest)
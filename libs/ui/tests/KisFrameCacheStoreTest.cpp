@@ -147,6 +147,17 @@ public:
 
         KIS_SAFE_ASSERT_RECOVER_NOOP(compareUpdateInfo(info, loadedInfo));
 
+        KisOpenGLUpdateInfoSP infoForPrepare = m_updateInfoBuilder.buildUpdateInfo(image->bounds(), image, true);
+        KisFrameCacheStore::PreparedFrameSP preparedFrame = m_store.prepareFrame(infoForPrepare, image->bounds());
+        KIS_SAFE_ASSERT_RECOVER_NOOP(preparedFrame);
+        KIS_SAFE_ASSERT_RECOVER_NOOP(!m_store.hasFrame(12));
+
+        m_store.savePreparedFrame(12, preparedFrame);
+        KIS_SAFE_ASSERT_RECOVER_NOOP(m_store.hasFrame(12));
+
+        KisOpenGLUpdateInfoSP loadedPreparedInfo = m_store.loadFrame(12, m_updateInfoBuilder);
+        KIS_SAFE_ASSERT_RECOVER_NOOP(compareUpdateInfo(info, loadedPreparedInfo));
+
 
         emit sigCompleteRegenerationInternal(frame);
     }
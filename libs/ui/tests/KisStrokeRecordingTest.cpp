@@ -0,0 +1,386 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeRecordingTest.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtMath>
+
+#include <sdk/tests/testui.h>
+#include <KoCanvasResourceProvider.h>
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoResourcePaths.h>
+#include <KisGlobalResourcesInterface.h>
+#include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_paintop_preset.h>
+
+#include "KisStrokeRecorder.h"
+#include "KisStrokeRecording.h"
+#include "KisStrokeReplayer.h"
+#include "KisViewManager.h"
+#include "kis_image.h"
+#include "kis_paint_device.h"
+#include "kis_paint_layer.h"
+#include "kis_painting_information_builder.h"
+#include "kis_smoothing_options.h"
+#include "kis_tool_freehand_helper.h"
+
+
+namespace {
+
+const int numStrokeSegments = 100;
+
+/**
+ * Basic_tip_default with scattering enabled, so that the dabs depend
+ * on the random source of the stroke
+ */
+QByteArray scatteredPresetData()
+{
+    KisPaintOpPresetSP preset(new KisPaintOpPreset(QString(FILES_DATA_DIR) + "/Basic_tip_default.kpp"));
+    if (!preset->load(KisGlobalResourcesInterface::instance())) return QByteArray();
+
+    preset->settings()->setProperty("PressureScatter", true);
+    preset->settings()->setProperty("ScatterValue", 2.0);
+    preset->settings()->setProperty("ScatterSensor", "<!DOCTYPE params><params id=\"pressure\"/>");
+    preset->settings()->setProperty("Scattering/AxisX", true);
+    preset->settings()->setProperty("Scattering/AxisY", true);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (!preset->saveToDevice(&buffer)) return QByteArray();
+
+    return buffer.data();
+}
+
+KisPaintInformation strokePoint(qreal y, int index)
+{
+    const qreal t = qreal(index) / numStrokeSegments;
+    const QPointF pos(50 + 900 * t, y + 50 * qSin(6 * M_PI * t));
+
+    return KisPaintInformation(pos, 0.1 + 0.9 * t, 0.0, 0.0, 0.0, 0.0, 1.0, index * 5.0, 0.0);
+}
+
+KisStrokeRecording createSyntheticRecording(const QByteArray &presetData)
+{
+    KisStrokeRecording recording;
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisStrokeRecording::ImageState state;
+    state.imageSize = QSize(1000, 1000);
+    state.imageColorModelId = cs->colorModelId().id();
+    state.imageColorDepthId = cs->colorDepthId().id();
+    state.imageProfileName = cs->profile()->name();
+    state.colorModelId = state.imageColorModelId;
+    state.colorDepthId = state.imageColorDepthId;
+    state.profileName = state.imageProfileName;
+    state.defaultPixel = QByteArray(cs->pixelSize(), 0);
+    state.pixels = qCompress(QByteArray());
+    recording.imageStates << state;
+
+    if (!presetData.isEmpty()) {
+        recording.presets << presetData;
+    }
+
+    const KoColor black(Qt::black, cs);
+    const KoColor white(Qt::white, cs);
+
+    for (int i = 0; i < 5; i++) {
+        KisStrokeRecording::Stroke stroke;
+        stroke.imageStateIndex = 0;
+        stroke.presetIndex = 0;
+        stroke.fgColor = QByteArray(reinterpret_cast<const char*>(black.data()), cs->pixelSize());
+        stroke.bgColor = QByteArray(reinterpret_cast<const char*>(white.data()), cs->pixelSize());
+        stroke.randomSeed = 1000 + i;
+
+        const qreal y = 100 + 200 * i;
+
+        KisStrokeRecording::StrokeInfo info;
+        info.lastPosition = QPointF(50, y);
+        info.spacingUpdateInterval = 50.0;
+        info.timingUpdateInterval = 50.0;
+        stroke.strokeInfos << info;
+
+        KisPaintInformation lastPi(info.lastPosition, 0.1);
+
+        for (int j = 1; j <= numStrokeSegments; j++) {
+            const KisPaintInformation pi = strokePoint(y, j);
+
+            KisStrokeRecording::Job job;
+            job.time = j * 5000;
+            job.type = FreehandStrokeStrategy::Data::LINE;
+            job.pi1 = lastPi;
+            job.pi2 = pi;
+            stroke.jobs << job;
+
+            lastPi = pi;
+        }
+
+        recording.strokes << stroke;
+    }
+
+    return recording;
+}
+
+QByteArray deviceHash(KisPaintDeviceSP device)
+{
+    const QRect rc = device->exactBounds();
+
+    QByteArray pixels(rc.width() * rc.height() * device->pixelSize(), 0);
+    device->readBytes(reinterpret_cast<quint8*>(pixels.data()), rc);
+
+    return QCryptographicHash::hash(pixels, QCryptographicHash::Md5);
+}
+
+KisSmoothingOptions* createNoSmoothingOptions()
+{
+    KisSmoothingOptions *options = new KisSmoothingOptions(false);
+    options->setSmoothingType(KisSmoothingOptions::NO_SMOOTHING);
+    return options;
+}
+
+/**
+ * Paints the lines directly, without any smoothing, so that every
+ * segment produces exactly one recorded job
+ */
+class TestingFreehandHelper : public KisToolFreehandHelper
+{
+public:
+    TestingFreehandHelper(KisPaintingInformationBuilder *infoBuilder,
+                          KoCanvasResourceProvider *resourceManager)
+        : KisToolFreehandHelper(infoBuilder, resourceManager,
+                                kundo2_noi18n("Recorded Stroke"),
+                                createNoSmoothingOptions())
+    {
+    }
+
+    void paintStroke(KisImageSP image, KisNodeSP node, qreal y) {
+        KisPaintInformation lastPi = strokePoint(y, 0);
+
+        initPaintImpl(0.0, lastPi, resourceManager(), image, node, image.data());
+
+        for (int j = 1; j <= numStrokeSegments; j++) {
+            const KisPaintInformation pi = strokePoint(y, j);
+            paintLine(lastPi, pi);
+            lastPi = pi;
+        }
+
+        endPaint();
+    }
+};
+
+}
+
+void KisStrokeRecordingTest::initTestCase()
+{
+    KoResourcePaths::addResourceType(ResourceType::Brushes, "data", FILES_DATA_DIR);
+}
+
+void KisStrokeRecordingTest::testRecordingRoundTrip()
+{
+    QFile presetFile(QString(FILES_DATA_DIR) + "/Basic_tip_default.kpp");
+    QVERIFY(presetFile.open(QIODevice::ReadOnly));
+
+    KisStrokeRecording recording = createSyntheticRecording(presetFile.readAll());
+    QCOMPARE(recording.presets.size(), 1);
+
+    KisStrokeRecording::ImageState incrementalState = recording.imageStates[0];
+    incrementalState.baseStateIndex = 0;
+    incrementalState.changedRects << QRect(0, 0, 64, 64) << QRect(64, 0, 64, 64);
+    recording.imageStates << incrementalState;
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(recording.save(&buffer));
+    buffer.close();
+
+    KisStrokeRecording loaded;
+    buffer.open(QIODevice::ReadOnly);
+    QVERIFY(loaded.load(&buffer));
+
+    QCOMPARE(loaded.imageStates.size(), 2);
+    QCOMPARE(loaded.imageStates[0].baseStateIndex, -1);
+    QCOMPARE(loaded.imageStates[1].baseStateIndex, 0);
+    QCOMPARE(loaded.imageStates[1].changedRects, incrementalState.changedRects);
+    QCOMPARE(loaded.presets, recording.presets);
+    QCOMPARE(loaded.strokes.size(), recording.strokes.size());
+
+    for (int i = 0; i < loaded.strokes.size(); i++) {
+        const KisStrokeRecording::Stroke &lhs = loaded.strokes[i];
+        const KisStrokeRecording::Stroke &rhs = recording.strokes[i];
+
+        QCOMPARE(lhs.randomSeed, rhs.randomSeed);
+        QCOMPARE(lhs.fgColor, rhs.fgColor);
+        QCOMPARE(lhs.strokeInfos.size(), rhs.strokeInfos.size());
+        QCOMPARE(lhs.jobs.size(), rhs.jobs.size());
+
+        for (int j = 0; j < lhs.jobs.size(); j++) {
+            QCOMPARE(lhs.jobs[j].time, rhs.jobs[j].time);
+            QCOMPARE(lhs.jobs[j].type, rhs.jobs[j].type);
+            QCOMPARE(lhs.jobs[j].pi2.pos(), rhs.jobs[j].pi2.pos());
+            QCOMPARE(lhs.jobs[j].pi2.pressure(), rhs.jobs[j].pi2.pressure());
+        }
+    }
+
+    // a recording of a crashed session ends with a partial chunk
+    QByteArray truncatedData = buffer.data();
+    truncatedData.chop(100);
+
+    QBuffer truncatedBuffer(&truncatedData);
+    truncatedBuffer.open(QIODevice::ReadOnly);
+
+    KisStrokeRecording truncated;
+    QVERIFY(truncated.load(&truncatedBuffer));
+    QCOMPARE(truncated.strokes.size(), recording.strokes.size() - 1);
+}
+
+void KisStrokeRecordingTest::testDeterministicReplay()
+{
+    const QByteArray presetData = scatteredPresetData();
+    QVERIFY(!presetData.isEmpty());
+
+    KisStrokeRecording recording = createSyntheticRecording(presetData);
+
+    KisStrokeReplayer replayer1(recording);
+    KisStrokeReplayer::Statistics stats1 = replayer1.replay();
+
+    QCOMPARE(stats1.numStrokes, 5);
+    QCOMPARE(stats1.numJobs, 5 * numStrokeSegments);
+    QCOMPARE(stats1.jobLatencies.size(), 5 * numStrokeSegments);
+    QVERIFY(stats1.numDabs > 0);
+    QVERIFY(!replayer1.layer()->paintDevice()->exactBounds().isEmpty());
+
+    KisStrokeReplayer replayer2(recording);
+    KisStrokeReplayer::Statistics stats2 = replayer2.replay();
+
+    QCOMPARE(stats2.numDabs, stats1.numDabs);
+    QCOMPARE(deviceHash(replayer2.layer()->paintDevice()),
+             deviceHash(replayer1.layer()->paintDevice()));
+}
+
+void KisStrokeRecordingTest::testReplayDependsOnRandomSeed()
+{
+    const QByteArray presetData = scatteredPresetData();
+    QVERIFY(!presetData.isEmpty());
+
+    KisStrokeRecording recording = createSyntheticRecording(presetData);
+
+    KisStrokeReplayer replayer1(recording);
+    replayer1.replay();
+
+    // otherwise testDeterministicReplay() proves nothing
+    for (int i = 0; i < recording.strokes.size(); i++) {
+        recording.strokes[i].randomSeed += 100;
+    }
+
+    KisStrokeReplayer replayer2(recording);
+    replayer2.replay();
+
+    QVERIFY(deviceHash(replayer2.layer()->paintDevice()) !=
+            deviceHash(replayer1.layer()->paintDevice()));
+}
+
+void KisStrokeRecordingTest::testRecordFreehandHelper()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/strokes.krec";
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisImageSP image = new KisImage(0, 1000, 500, cs, "recorded image");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8, cs);
+    image->addNode(layer, image->root());
+    image->initialRefreshGraph();
+
+    const QRect firstRect(10, 10, 20, 20);
+    const QRect secondRect(10, 450, 20, 20);
+
+    layer->paintDevice()->fill(firstRect, KoColor(Qt::red, cs));
+
+    KisPaintOpPresetSP preset(new KisPaintOpPreset());
+    {
+        const QByteArray presetData = scatteredPresetData();
+        QBuffer buffer;
+        buffer.setData(presetData);
+        buffer.open(QIODevice::ReadOnly);
+        QVERIFY(preset->loadFromDevice(&buffer, KisGlobalResourcesInterface::instance()));
+    }
+
+    KoCanvasResourceProvider resourceManager;
+    KisViewManager::initializeResourceManager(&resourceManager);
+    resourceManager.setResource(KoCanvasResource::CurrentPaintOpPreset, QVariant::fromValue(preset));
+    resourceManager.setResource(KoCanvasResource::ForegroundColor, QVariant::fromValue(KoColor(Qt::black, cs)));
+
+    KisPaintingInformationBuilder infoBuilder;
+    TestingFreehandHelper helper(&infoBuilder, &resourceManager);
+
+    QVERIFY(KisStrokeRecorder::instance()->start(fileName));
+
+    helper.paintStroke(image, layer, 150);
+    image->waitForDone();
+
+    // a change of the layer that is not recorded as a stroke
+    layer->paintDevice()->fill(secondRect, KoColor(Qt::green, cs));
+
+    helper.paintStroke(image, layer, 300);
+    image->waitForDone();
+
+    KisStrokeRecorder::instance()->stop();
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    KisStrokeRecording recording;
+    QVERIFY(recording.load(&file));
+
+    QCOMPARE(recording.presets.size(), 1);
+    QCOMPARE(recording.strokes.size(), 2);
+    QCOMPARE(recording.imageStates.size(), 2);
+
+    for (int i = 0; i < recording.strokes.size(); i++) {
+        QCOMPARE(recording.strokes[i].imageStateIndex, i);
+        QCOMPARE(recording.strokes[i].strokeInfos.size(), 1);
+        QCOMPARE(recording.strokes[i].jobs.size(), numStrokeSegments);
+    }
+
+    // the states are read before the first dab of the stroke
+    QCOMPARE(recording.imageStates[0].baseStateIndex, -1);
+    QCOMPARE(recording.imageStates[0].bounds, firstRect);
+
+    // the second state has only the tiles changed since the first one
+    QCOMPARE(recording.imageStates[1].baseStateIndex, 0);
+
+    QRect changedArea;
+    Q_FOREACH (const QRect &rc, recording.imageStates[1].changedRects) {
+        changedArea |= rc;
+    }
+    QVERIFY(changedArea.contains(secondRect));
+
+    KisStrokeReplayer replayer(recording);
+    replayer.replay();
+
+    QCOMPARE(deviceHash(replayer.layer()->paintDevice()), deviceHash(layer->paintDevice()));
+}
+
+KISTEST_MAIN(KisStrokeRecordingTest)
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeReplayBenchmark.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTest>
+
+#include <sdk/tests/testui.h>
+#include <KoResourcePaths.h>
+
+#include "KisStrokeRecording.h"
+#include "KisStrokeReplayer.h"
+
+
+void KisStrokeReplayBenchmark::initTestCase()
+{
+    KoResourcePaths::addResourceType(ResourceType::Brushes, "data", FILES_DATA_DIR);
+}
+
+void KisStrokeReplayBenchmark::benchmarkRecordings()
+{
+    const QString path = qgetenv("KRITA_STROKE_RECORDINGS");
+    if (path.isEmpty()) {
+        QSKIP("Set KRITA_STROKE_RECORDINGS to a directory with the stroke recordings");
+    }
+
+    QDir dir(path);
+    Q_FOREACH (const QString &fileName, dir.entryList(QDir::Files, QDir::Name)) {
+        QFile file(dir.filePath(fileName));
+        QVERIFY(file.open(QIODevice::ReadOnly));
+
+        KisStrokeRecording recording;
+        QVERIFY(recording.load(&file));
+
+        {
+            KisStrokeReplayer replayer(recording);
+            replayer.setPacing(KisStrokeReplayer::AsFastAsPossible);
+            qDebug() << qPrintable(QString("%1 (throughput): %2").arg(fileName).arg(replayer.replay().toString()));
+        }
+
+        {
+            KisStrokeReplayer replayer(recording);
+            replayer.setPacing(KisStrokeReplayer::RealTime);
+            qDebug() << qPrintable(QString("%1 (real time): %2").arg(fileName).arg(replayer.replay().toString()));
+        }
+    }
+}
+
+KISTEST_MAIN(KisStrokeReplayBenchmark)
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __ANIMATION_CACHE_TESTING_UTILS_H
+#define __ANIMATION_CACHE_TESTING_UTILS_H
+
+#include "kis_image_config.h"
+#include "kis_animation_frame_cache.h"
+#include "kis_time_span.h"
+
+
+namespace TestUtil {
+
+/**
+ * Overrides the number of the frame rendering clones in the persistent
+ * config and restores the original value on destruction, so that a failed
+ * test doesn't change the user's settings
+ */
+class FrameRenderingClonesOverride
+{
+public:
+    explicit FrameRenderingClonesOverride(int numClones)
+        : m_oldNumClones(KisImageConfig(true).frameRenderingClones())
+    {
+        KisImageConfig(false).setFrameRenderingClones(numClones);
+    }
+
+    ~FrameRenderingClonesOverride() {
+        KisImageConfig(false).setFrameRenderingClones(m_oldNumClones);
+    }
+
+private:
+    Q_DISABLE_COPY(FrameRenderingClonesOverride)
+
+    int m_oldNumClones;
+};
+
+inline int numCachedFrames(KisAnimationFrameCacheSP cache, const KisTimeSpan &range)
+{
+    int result = 0;
+
+    for (int time = range.start(); time <= range.end(); time++) {
+        if (cache->frameStatus(time) == KisAnimationFrameCache::Cached) {
+            result++;
+        }
+    }
+
+    return result;
+}
+
+}
+
+#endif /* __ANIMATION_CACHE_TESTING_UTILS_H */
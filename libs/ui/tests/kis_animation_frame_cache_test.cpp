@@ -105,6 +105,65 @@ void KisAnimationFrameCacheTest::testCache()
 
 }
 
+void KisAnimationFrameCacheTest::testPendingFrames()
+{
+    TestUtil::MaskParent p;
+    KisImageSP image = p.image;
+    KisPaintLayerSP layer2 = new KisPaintLayer(p.image, "", OPACITY_OPAQUE_U8);
+    image->addNode(layer2);
+
+    KUndo2Command parentCommand;
+
+    KisKeyframeChannel *rasterChannel2 = layer2->getKeyframeChannel(KisKeyframeChannel::Raster.id(), true);
+    rasterChannel2->addKeyframe(10, &parentCommand);
+    rasterChannel2->addKeyframe(20, &parentCommand);
+
+    KisOpenGLImageTexturesSP glTex = KisOpenGLImageTextures::getImageTextures(image, 0, KoColorConversionTransformation::IntentPerceptual, KoColorConversionTransformation::Empty);
+    KisAnimationFrameCacheSP cache = new KisAnimationFrameCache(glTex);
+    glTex->testingForceInitialized();
+
+    KisImageAnimationInterface *animation = image->animationInterface();
+    const KisRegion region(image->bounds());
+    int t;
+
+    // the pending frame is not visible until it is committed
+    animation->saveAndResetCurrentTime(11, &t);
+    int seqNo = cache->invalidationSeqNo();
+    int pendingFrameId = cache->saveConvertedFrameData(cache->fetchFrameData(11, image, region), image);
+
+    verifyRangeIsCachedStatus(cache, 10, 19, KisAnimationFrameCache::Uncached);
+    QVERIFY(cache->commitConvertedFrameData(pendingFrameId, 11, seqNo));
+    verifyRangeIsCachedStatus(cache, 10, 19, KisAnimationFrameCache::Cached);
+
+    // the frame rendered before the invalidation is dropped
+    animation->saveAndResetCurrentTime(20, &t);
+    seqNo = cache->invalidationSeqNo();
+    pendingFrameId = cache->saveConvertedFrameData(cache->fetchFrameData(20, image, region), image);
+
+    image->invalidateFrames(KisTimeSpan::infinite(20), QRect());
+    QVERIFY(cache->invalidationSeqNo() != seqNo);
+
+    QVERIFY(!cache->commitConvertedFrameData(pendingFrameId, 20, seqNo));
+    verifyRangeIsCachedStatus(cache, 20, 30, KisAnimationFrameCache::Uncached);
+    verifyRangeIsCachedStatus(cache, 10, 19, KisAnimationFrameCache::Cached);
+
+    // the edits of the other frames don't affect the pending frame
+    image->invalidateFrames(KisTimeSpan::fromTimeToTime(10, 19), QRect());
+    verifyRangeIsCachedStatus(cache, 10, 19, KisAnimationFrameCache::Uncached);
+
+    animation->saveAndResetCurrentTime(11, &t);
+    seqNo = cache->invalidationSeqNo();
+    pendingFrameId = cache->saveConvertedFrameData(cache->fetchFrameData(11, image, region), image);
+
+    image->invalidateFrames(KisTimeSpan::infinite(20), QRect());
+    image->invalidateFrames(KisTimeSpan::fromTimeToTime(0, 9), QRect());
+    QVERIFY(cache->invalidationSeqNo() != seqNo);
+
+    QVERIFY(cache->commitConvertedFrameData(pendingFrameId, 11, seqNo));
+    verifyRangeIsCachedStatus(cache, 10, 19, KisAnimationFrameCache::Cached);
+    verifyRangeIsCachedStatus(cache, 20, 30, KisAnimationFrameCache::Uncached);
+}
+
 void KisAnimationFrameCacheTest::slotFrameGerenationFinished(int time)
 {
     KisImageSP image = m_globalAnimationCache->image();
@@ -29,6 +29,7 @@ class KisAnimationFrameCacheTest : public QObject
 
 private Q_SLOTS:
     void testCache();
+    void testPendingFrames();
 
     void slotFrameGerenationFinished(int time);
 
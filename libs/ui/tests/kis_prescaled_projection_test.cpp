@@ -278,6 +278,66 @@ void KisPrescaledProjectionTest::benchmarkUpdate()
 
 }
 
+void KisPrescaledProjectionTest::benchmarkUpdateZoomedOut_data()
+{
+    QTest::addColumn<qreal>("zoom");
+
+    QTest::newRow("zoom-50") << 0.5;
+    QTest::newRow("zoom-25") << 0.25;
+    QTest::newRow("zoom-12") << 0.125;
+}
+
+void KisPrescaledProjectionTest::benchmarkUpdateZoomedOut()
+{
+    QFETCH(qreal, zoom);
+
+    const QRect imageRect(0, 0, 4096, 4096);
+
+    QImage sourceImage(imageRect.size(), QImage::Format_ARGB32);
+    for (int y = 0; y < sourceImage.height(); y++) {
+        QRgb *line = reinterpret_cast<QRgb*>(sourceImage.scanLine(y));
+        for (int x = 0; x < sourceImage.width(); x++) {
+            line[x] = qRgba(x & 0xff, y & 0xff, (x ^ y) & 0xff, 255);
+        }
+    }
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "projection test");
+
+    KisPaintLayerSP layer = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8, cs);
+    layer->paintDevice()->convertFromQImage(sourceImage, 0);
+    image->addNode(layer, image->rootLayer(), 0);
+    image->refreshGraph();
+
+    KisCoordinatesConverter converter;
+    converter.setResolution(72, 72);
+    converter.setZoom(zoom);
+    converter.setImage(image);
+    converter.setCanvasWidgetSize(QSize(1024, 768));
+    converter.setDocumentOffset(QPoint(0, 0));
+
+    KisPrescaledProjection projection;
+    projection.setCoordinatesConverter(&converter);
+    projection.setMonitorProfile(0,
+                                 KoColorConversionTransformation::internalRenderingIntent(),
+                                 KoColorConversionTransformation::internalConversionFlags());
+    projection.setImage(image);
+    projection.notifyCanvasSizeChanged(QSize(1024, 768));
+    projection.notifyZoomChanged();
+
+    // emulate a brush stroke going diagonally through the visible area
+    const int numDabs = 100;
+    const QSize dabSize(64, 64);
+
+    QBENCHMARK {
+        for (int i = 0; i < numDabs; i++) {
+            const QRect dirtyRect(QPoint(i * 30, i * 25), dabSize);
+
+            KisUpdateInfoSP info = projection.updateCache(dirtyRect);
+            projection.recalculateCache(info);
+        }
+    }
+}
 
 class PrescaledProjectionTester
 {
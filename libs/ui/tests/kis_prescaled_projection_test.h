@@ -52,6 +52,9 @@ private Q_SLOTS:
 
     void benchmarkUpdate();
 
+    void benchmarkUpdateZoomedOut_data();
+    void benchmarkUpdateZoomedOut();
+
     void testScrollingZoom100();
     void testScrollingZoom50();
     void testUpdates();
@@ -0,0 +1,369 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeRecorder.h"
+
+#include <atomic>
+
+#include <QBuffer>
+#include <QFile>
+#include <QGlobalStatic>
+#include <QGradient>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <KoCanvasResourceProvider.h>
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorProfile.h>
+#include <resources/KoAbstractGradient.h>
+#include <brushengine/kis_paintop_preset.h>
+
+#include "kis_debug.h"
+#include "kis_datamanager.h"
+#include "kis_image.h"
+#include "kis_node.h"
+#include "kis_paint_device.h"
+#include "KisRunnableStrokeJobData.h"
+
+Q_GLOBAL_STATIC(KisStrokeRecorder, s_instance)
+
+namespace {
+
+/**
+ * The painting code checks the flag before touching the instance, so
+ * the environment variable should be read before the instance is created
+ */
+std::atomic<bool> s_enabled(!qgetenv("KRITA_STROKE_RECORDING").isEmpty());
+
+QByteArray colorData(KoColor color, const KoColorSpace *colorSpace)
+{
+    color.convertTo(colorSpace);
+    return QByteArray(reinterpret_cast<const char*>(color.data()), colorSpace->pixelSize());
+}
+
+/**
+ * An incremental state is applied on top of all its base states on
+ * replay, so the chain is restarted with a full state from time to time
+ */
+const int maxIncrementalStates = 16;
+
+/**
+ * Fills everything but the pixels
+ */
+KisStrokeRecording::ImageState createImageStateHeader(KisImageSP image, KisPaintDeviceSP device)
+{
+    KisStrokeRecording::ImageState state;
+
+    const KoColorSpace *imageColorSpace = image->colorSpace();
+
+    state.imageSize = image->size();
+    state.xRes = image->xRes();
+    state.yRes = image->yRes();
+    state.imageColorModelId = imageColorSpace->colorModelId().id();
+    state.imageColorDepthId = imageColorSpace->colorDepthId().id();
+    state.imageProfileName = imageColorSpace->profile() ? imageColorSpace->profile()->name() : QString();
+
+    const KoColorSpace *colorSpace = device->colorSpace();
+
+    state.colorModelId = colorSpace->colorModelId().id();
+    state.colorDepthId = colorSpace->colorDepthId().id();
+    state.profileName = colorSpace->profile() ? colorSpace->profile()->name() : QString();
+    state.defaultPixel = colorData(device->defaultPixel(), colorSpace);
+
+    return state;
+}
+
+bool sameImageStateHeader(const KisStrokeRecording::ImageState &lhs, const KisStrokeRecording::ImageState &rhs)
+{
+    return lhs.imageSize == rhs.imageSize &&
+        lhs.xRes == rhs.xRes &&
+        lhs.yRes == rhs.yRes &&
+        lhs.imageColorModelId == rhs.imageColorModelId &&
+        lhs.imageColorDepthId == rhs.imageColorDepthId &&
+        lhs.imageProfileName == rhs.imageProfileName &&
+        lhs.colorModelId == rhs.colorModelId &&
+        lhs.colorDepthId == rhs.colorDepthId &&
+        lhs.profileName == rhs.profileName &&
+        lhs.defaultPixel == rhs.defaultPixel;
+}
+
+QByteArray readCompressedPixels(KisPaintDeviceSP device, const QVector<QRect> &rects)
+{
+    const int pixelSize = device->pixelSize();
+
+    int totalSize = 0;
+    Q_FOREACH (const QRect &rc, rects) {
+        totalSize += rc.width() * rc.height() * pixelSize;
+    }
+
+    QByteArray pixels(totalSize, 0);
+    quint8 *data = reinterpret_cast<quint8*>(pixels.data());
+
+    Q_FOREACH (const QRect &rc, rects) {
+        device->readBytes(data, rc);
+        data += rc.width() * rc.height() * pixelSize;
+    }
+
+    return qCompress(pixels);
+}
+
+/**
+ * A barrier job of the recorded stroke. The recording is done by the
+ * stroke of the full resolution, the level-of-detail stroke gets a
+ * no-op clone of the job.
+ */
+class RecorderJobData : public KisRunnableStrokeJobData
+{
+public:
+    RecorderJobData(std::function<void()> func)
+        : KisRunnableStrokeJobData(func, KisStrokeJobData::BARRIER)
+    {
+    }
+
+    KisStrokeJobData* createLodClone(int levelOfDetail) override {
+        Q_UNUSED(levelOfDetail);
+        return new KisRunnableStrokeJobData(std::function<void()>(), KisStrokeJobData::BARRIER);
+    }
+};
+
+}
+
+struct KisStrokeRecorder::Private
+{
+    QMutex mutex;
+
+    QString fileName;
+    QScopedPointer<QFile> file;
+    QScopedPointer<KisStrokeRecording::Writer> writer;
+
+    /**
+     * The last state written into the recording. If the next stroke
+     * paints on the same layer, only the tiles that have changed since
+     * then are written. The snapshot is a copy-on-write copy of the
+     * data manager, so it costs only the tiles changed after it.
+     */
+    struct LastImageState {
+        KisPaintDeviceWSP device;
+        KisDataManagerSP snapshot;
+        QPoint offset;
+        KisStrokeRecording::ImageState header;
+        int index = -1;
+        int numIncrementalStates = 0;
+    };
+
+    LastImageState lastImageState;
+
+    int addImageState(KisImageSP image, KisPaintDeviceSP device);
+};
+
+int KisStrokeRecorder::Private::addImageState(KisImageSP image, KisPaintDeviceSP device)
+{
+    KisStrokeRecording::ImageState state = createImageStateHeader(image, device);
+    const QPoint offset(device->x(), device->y());
+
+    /**
+     * Called from a barrier job of the recorded stroke, so no other
+     * stroke may change the device while it is being read
+     */
+    KisDataManagerSP snapshot = new KisDataManager(*device->dataManager());
+
+    LastImageState &last = lastImageState;
+    QVector<QRect> changedTiles;
+
+    const bool canBeIncremental =
+        last.device.isValid() &&
+        last.device == device.data() &&
+        last.offset == offset &&
+        last.numIncrementalStates < maxIncrementalStates &&
+        sameImageStateHeader(last.header, state) &&
+        snapshot->collectChangedTiles(last.snapshot.data(), &changedTiles);
+
+    if (canBeIncremental && changedTiles.isEmpty()) {
+        return last.index;
+    }
+
+    if (canBeIncremental) {
+        state.baseStateIndex = last.index;
+        Q_FOREACH (const QRect &rc, changedTiles) {
+            state.changedRects << rc.translated(offset);
+        }
+        state.pixels = readCompressedPixels(device, state.changedRects);
+    } else {
+        state.bounds = device->exactBounds();
+        state.pixels = readCompressedPixels(device, {state.bounds});
+    }
+
+    const int index = writer->addImageState(state);
+
+    last.numIncrementalStates = canBeIncremental ? last.numIncrementalStates + 1 : 0;
+    last.device = device;
+    last.snapshot = snapshot;
+    last.offset = offset;
+    last.index = index;
+
+    state.pixels.clear();
+    last.header = state;
+
+    return index;
+}
+
+KisStrokeRecorder::KisStrokeRecorder()
+    : m_d(new Private)
+{
+    const QString fileName = qgetenv("KRITA_STROKE_RECORDING");
+    if (!fileName.isEmpty()) {
+        start(fileName);
+    }
+}
+
+KisStrokeRecorder::~KisStrokeRecorder()
+{
+    stop();
+}
+
+KisStrokeRecorder *KisStrokeRecorder::instance()
+{
+    return s_instance;
+}
+
+bool KisStrokeRecorder::isEnabled()
+{
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+bool KisStrokeRecorder::start(const QString &fileName)
+{
+    QMutexLocker l(&m_d->mutex);
+
+    m_d->writer.reset();
+    m_d->file.reset(new QFile(fileName));
+
+    if (!m_d->file->open(QIODevice::WriteOnly)) {
+        warnKrita << "Failed to open the stroke recording file" << fileName;
+        m_d->file.reset();
+        s_enabled.store(false);
+        return false;
+    }
+
+    m_d->writer.reset(new KisStrokeRecording::Writer(m_d->file.data()));
+    m_d->lastImageState = Private::LastImageState();
+    s_enabled.store(true);
+
+    return true;
+}
+
+void KisStrokeRecorder::stop()
+{
+    QMutexLocker l(&m_d->mutex);
+
+    s_enabled.store(false);
+
+    m_d->writer.reset();
+    m_d->file.reset();
+    m_d->lastImageState = Private::LastImageState();
+}
+
+bool KisStrokeRecorder::beginStroke(KisResourcesSnapshotSP resources,
+                                    KoCanvasResourceProvider *resourceManager,
+                                    KisStrokeRecording::Stroke *stroke)
+{
+    QMutexLocker l(&m_d->mutex);
+
+    if (!m_d->writer) return false;
+
+    KisImageSP image = resources->image();
+    KisNodeSP node = resources->currentNode();
+    KisPaintDeviceSP device = node ? node->paintDevice() : KisPaintDeviceSP();
+    KisPaintOpPresetSP preset = resources->currentPaintOpPreset();
+
+    if (!image || !device || !preset) return false;
+
+    QBuffer presetBuffer;
+    presetBuffer.open(QIODevice::WriteOnly);
+    if (!preset->saveToDevice(&presetBuffer)) return false;
+
+    stroke->presetIndex = m_d->writer->addPreset(presetBuffer.data());
+
+    stroke->fgColor = colorData(resources->currentFgColor(), device->colorSpace());
+    stroke->bgColor = colorData(resources->currentBgColor(), device->colorSpace());
+
+    KoAbstractGradientSP gradient = resources->currentGradient();
+    if (gradient) {
+        QScopedPointer<QGradient> qGradient(gradient->toQGradient());
+        if (qGradient) {
+            stroke->gradientStops = qGradient->stops();
+        }
+    }
+
+    if (resourceManager) {
+        stroke->mirrorHorizontal = resourceManager->resource(KoCanvasResource::MirrorHorizontal).toBool();
+        stroke->mirrorVertical = resourceManager->resource(KoCanvasResource::MirrorVertical).toBool();
+        stroke->globalAlphaLock = resourceManager->resource(KoCanvasResource::GlobalAlphaLock).toBool();
+        stroke->hdrExposure = resourceManager->resource(KoCanvasResource::HdrExposure).toDouble();
+    }
+
+    stroke->effectiveZoom = resources->effectiveZoom();
+
+    return true;
+}
+
+KisStrokeJobData *KisStrokeRecorder::createImageStateJob(KisResourcesSnapshotSP resources,
+                                                        QSharedPointer<KisStrokeRecording::Stroke> stroke)
+{
+    // the job is owned by the image, so it shouldn't keep a strong link to it
+    KisImageWSP image = resources->image();
+    KisNodeSP node = resources->currentNode();
+
+    return new RecorderJobData(
+        [this, image, node, stroke] () {
+            KisImageSP strongImage = image;
+            KisPaintDeviceSP device = node->paintDevice();
+            KIS_SAFE_ASSERT_RECOVER_RETURN(strongImage && device);
+
+            /**
+             * The state is computed under the lock, because an incremental
+             * state depends on the previous one written into the same file
+             */
+            QMutexLocker l(&m_d->mutex);
+            if (!m_d->writer) return;
+
+            stroke->imageStateIndex = m_d->addImageState(strongImage, device);
+        });
+}
+
+KisStrokeJobData *KisStrokeRecorder::createEndStrokeJob(QSharedPointer<KisStrokeRecording::Stroke> stroke)
+{
+    return new RecorderJobData(
+        [this, stroke] () {
+            QMutexLocker l(&m_d->mutex);
+
+            if (!m_d->writer || stroke->imageStateIndex < 0 || stroke->jobs.isEmpty()) return;
+
+            m_d->writer->addStroke(*stroke);
+            m_d->file->flush();
+
+            if (m_d->writer->hasErrors()) {
+                warnKrita << "Failed to write the stroke recording, stopping";
+
+                s_enabled.store(false);
+                m_d->writer.reset();
+                m_d->file.reset();
+            }
+        });
+}
@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKERECORDER_H
+#define KISSTROKERECORDER_H
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+
+#include "kis_types.h"
+#include "kis_resources_snapshot.h"
+#include "KisStrokeRecording.h"
+#include "kritaui_export.h"
+
+class KoCanvasResourceProvider;
+class KisStrokeJobData;
+
+/**
+ * Records the freehand strokes of KisToolFreehandHelper into a
+ * KisStrokeRecording file, so that they could be replayed later by
+ * KisStrokeReplayer, e.g. to benchmark the brush engines on the real
+ * input of the artists.
+ *
+ * Setting the KRITA_STROKE_RECORDING environment variable to a file
+ * name starts the recording into this file on startup.
+ */
+class KRITAUI_EXPORT KisStrokeRecorder
+{
+public:
+    KisStrokeRecorder();
+    ~KisStrokeRecorder();
+
+    static KisStrokeRecorder* instance();
+
+    /**
+     * A cheap check the painting code does before preparing
+     * anything for the recorder
+     */
+    static bool isEnabled();
+
+    bool start(const QString &fileName);
+    void stop();
+
+    /**
+     * Fills the resources of \p stroke from \p resources. Should be
+     * called before the stroke is started.
+     *
+     * \return false if the stroke cannot be recorded
+     */
+    bool beginStroke(KisResourcesSnapshotSP resources,
+                     KoCanvasResourceProvider *resourceManager,
+                     KisStrokeRecording::Stroke *stroke);
+
+    /**
+     * Creates a job that records the state of the painted layer and
+     * writes its index into \p stroke. The job should be added to the
+     * stroke right after it has been started, so the pixels are read in
+     * the context of the stroke, before any dab is painted.
+     *
+     * The state is recorded for every stroke, because the layer may be
+     * changed by any other action between the recorded strokes. When
+     * the strokes follow each other on the same layer, only the tiles
+     * changed since the previous state are written, and an unchanged
+     * layer reuses the previous state.
+     */
+    KisStrokeJobData* createImageStateJob(KisResourcesSnapshotSP resources,
+                                          QSharedPointer<KisStrokeRecording::Stroke> stroke);
+
+    /**
+     * Creates a job that appends the finished \p stroke to the recording.
+     * It should be the last job added to the stroke. The cancelled strokes
+     * just don't get this job.
+     */
+    KisStrokeJobData* createEndStrokeJob(QSharedPointer<KisStrokeRecording::Stroke> stroke);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISSTROKERECORDER_H
@@ -0,0 +1,334 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeRecording.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QHash>
+#include <QIODevice>
+
+#include "kis_debug.h"
+
+namespace {
+
+const quint32 recordingMagic = 0x4b535452; // "KSTR"
+const quint32 recordingVersion = 2;
+
+enum ChunkType {
+    ImageStateChunk = 1,
+    PresetChunk,
+    StrokeChunk
+};
+
+void writeImageState(QDataStream &stream, const KisStrokeRecording::ImageState &state)
+{
+    stream << state.imageSize
+           << state.xRes
+           << state.yRes
+           << state.imageColorModelId
+           << state.imageColorDepthId
+           << state.imageProfileName
+           << state.colorModelId
+           << state.colorDepthId
+           << state.profileName
+           << state.defaultPixel
+           << state.bounds
+           << qint32(state.baseStateIndex)
+           << state.changedRects
+           << state.pixels;
+}
+
+void readImageState(QDataStream &stream, KisStrokeRecording::ImageState &state)
+{
+    qint32 baseStateIndex = -1;
+
+    stream >> state.imageSize
+           >> state.xRes
+           >> state.yRes
+           >> state.imageColorModelId
+           >> state.imageColorDepthId
+           >> state.imageProfileName
+           >> state.colorModelId
+           >> state.colorDepthId
+           >> state.profileName
+           >> state.defaultPixel
+           >> state.bounds
+           >> baseStateIndex
+           >> state.changedRects
+           >> state.pixels;
+
+    state.baseStateIndex = baseStateIndex;
+}
+
+void writeStroke(QDataStream &stream, const KisStrokeRecording::Stroke &stroke)
+{
+    stream << qint32(stroke.imageStateIndex)
+           << qint32(stroke.presetIndex)
+           << stroke.fgColor
+           << stroke.bgColor
+           << stroke.gradientStops
+           << stroke.mirrorHorizontal
+           << stroke.mirrorVertical
+           << stroke.globalAlphaLock
+           << stroke.effectiveZoom
+           << stroke.hdrExposure
+           << stroke.randomSeed;
+
+    stream << quint32(stroke.strokeInfos.size());
+    Q_FOREACH (const KisStrokeRecording::StrokeInfo &info, stroke.strokeInfos) {
+        stream << info.lastPosition
+               << info.lastDrawingAngle
+               << info.spacingUpdateInterval
+               << info.timingUpdateInterval;
+    }
+
+    stream << quint32(stroke.jobs.size());
+    Q_FOREACH (const KisStrokeRecording::Job &job, stroke.jobs) {
+        stream << job.time << qint32(job.strokeInfoId) << quint8(job.type);
+
+        job.pi1.toDataStream(stream);
+
+        if (job.type != FreehandStrokeStrategy::Data::POINT) {
+            job.pi2.toDataStream(stream);
+        }
+
+        if (job.type == FreehandStrokeStrategy::Data::CURVE) {
+            stream << job.control1 << job.control2;
+        }
+    }
+}
+
+bool readStroke(QDataStream &stream, KisStrokeRecording::Stroke &stroke)
+{
+    qint32 imageStateIndex = -1;
+    qint32 presetIndex = -1;
+
+    stream >> imageStateIndex
+           >> presetIndex
+           >> stroke.fgColor
+           >> stroke.bgColor
+           >> stroke.gradientStops
+           >> stroke.mirrorHorizontal
+           >> stroke.mirrorVertical
+           >> stroke.globalAlphaLock
+           >> stroke.effectiveZoom
+           >> stroke.hdrExposure
+           >> stroke.randomSeed;
+
+    stroke.imageStateIndex = imageStateIndex;
+    stroke.presetIndex = presetIndex;
+
+    quint32 numStrokeInfos = 0;
+    stream >> numStrokeInfos;
+
+    for (quint32 i = 0; i < numStrokeInfos && stream.status() == QDataStream::Ok; i++) {
+        KisStrokeRecording::StrokeInfo info;
+        stream >> info.lastPosition
+               >> info.lastDrawingAngle
+               >> info.spacingUpdateInterval
+               >> info.timingUpdateInterval;
+        stroke.strokeInfos.append(info);
+    }
+
+    quint32 numJobs = 0;
+    stream >> numJobs;
+
+    for (quint32 i = 0; i < numJobs && stream.status() == QDataStream::Ok; i++) {
+        KisStrokeRecording::Job job;
+        qint32 strokeInfoId = 0;
+        quint8 type = 0;
+
+        stream >> job.time >> strokeInfoId >> type;
+
+        job.strokeInfoId = strokeInfoId;
+        job.type = FreehandStrokeStrategy::Data::DabType(type);
+
+        if (job.type != FreehandStrokeStrategy::Data::POINT &&
+            job.type != FreehandStrokeStrategy::Data::LINE &&
+            job.type != FreehandStrokeStrategy::Data::CURVE) {
+
+            return false;
+        }
+
+        job.pi1 = KisPaintInformation::fromDataStream(stream);
+
+        if (job.type != FreehandStrokeStrategy::Data::POINT) {
+            job.pi2 = KisPaintInformation::fromDataStream(stream);
+        }
+
+        if (job.type == FreehandStrokeStrategy::Data::CURVE) {
+            stream >> job.control1 >> job.control2;
+        }
+
+        stroke.jobs.append(job);
+    }
+
+    return stream.status() == QDataStream::Ok &&
+        stroke.strokeInfos.size() > 0;
+}
+
+}
+
+struct KisStrokeRecording::Writer::Private
+{
+    QDataStream stream;
+    QHash<QByteArray, int> presetIndexes;
+    int numImageStates = 0;
+};
+
+KisStrokeRecording::Writer::Writer(QIODevice *device)
+    : m_d(new Private)
+{
+    m_d->stream.setDevice(device);
+    m_d->stream.setVersion(QDataStream::Qt_5_0);
+    m_d->stream << recordingMagic << recordingVersion;
+}
+
+KisStrokeRecording::Writer::~Writer()
+{
+}
+
+int KisStrokeRecording::Writer::addImageState(const ImageState &state)
+{
+    m_d->stream << quint8(ImageStateChunk);
+    writeImageState(m_d->stream, state);
+
+    return m_d->numImageStates++;
+}
+
+int KisStrokeRecording::Writer::addPreset(const QByteArray &presetData)
+{
+    const QByteArray hash = QCryptographicHash::hash(presetData, QCryptographicHash::Md5);
+
+    auto it = m_d->presetIndexes.constFind(hash);
+    if (it != m_d->presetIndexes.constEnd()) {
+        return *it;
+    }
+
+    m_d->stream << quint8(PresetChunk) << presetData;
+
+    const int index = m_d->presetIndexes.size();
+    m_d->presetIndexes.insert(hash, index);
+    return index;
+}
+
+void KisStrokeRecording::Writer::addStroke(const Stroke &stroke)
+{
+    m_d->stream << quint8(StrokeChunk);
+    writeStroke(m_d->stream, stroke);
+}
+
+bool KisStrokeRecording::Writer::hasErrors() const
+{
+    return m_d->stream.status() != QDataStream::Ok;
+}
+
+bool KisStrokeRecording::load(QIODevice *device)
+{
+    imageStates.clear();
+    presets.clear();
+    strokes.clear();
+
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+
+    if (magic != recordingMagic || version != recordingVersion) {
+        warnKrita << "Unsupported stroke recording format" << ppVar(magic) << ppVar(version);
+        return false;
+    }
+
+    while (!stream.atEnd()) {
+        quint8 type = 0;
+        stream >> type;
+
+        if (type == ImageStateChunk) {
+            ImageState state;
+            readImageState(stream, state);
+
+            if (stream.status() != QDataStream::Ok) break;
+
+            if (state.baseStateIndex >= imageStates.size()) {
+                warnKrita << "Stroke recording refers to a missing chunk";
+                return false;
+            }
+
+            imageStates.append(state);
+
+        } else if (type == PresetChunk) {
+            QByteArray presetData;
+            stream >> presetData;
+
+            if (stream.status() != QDataStream::Ok) break;
+            presets.append(presetData);
+
+        } else if (type == StrokeChunk) {
+            Stroke stroke;
+            if (!readStroke(stream, stroke)) break;
+
+            if (stroke.imageStateIndex < 0 || stroke.imageStateIndex >= imageStates.size() ||
+                stroke.presetIndex < 0 || stroke.presetIndex >= presets.size()) {
+
+                warnKrita << "Stroke recording refers to a missing chunk";
+                return false;
+            }
+
+            strokes.append(stroke);
+        } else {
+            warnKrita << "Unknown chunk in the stroke recording" << ppVar(type);
+            return false;
+        }
+    }
+
+    /**
+     * The recorder appends the strokes as they are finished, so the
+     * recording of a session that crashed may end with a partial
+     * chunk. Everything before it is still valid.
+     */
+    if (stream.status() != QDataStream::Ok || !stream.atEnd()) {
+        warnKrita << "Stroke recording is truncated, loaded" << strokes.size() << "strokes";
+    }
+
+    return true;
+}
+
+bool KisStrokeRecording::save(QIODevice *device) const
+{
+    Writer writer(device);
+
+    Q_FOREACH (const ImageState &state, imageStates) {
+        writer.addImageState(state);
+    }
+
+    // the writer merges equal presets, so the indexes may change
+    QVector<int> presetIndexes;
+    Q_FOREACH (const QByteArray &presetData, presets) {
+        presetIndexes.append(writer.addPreset(presetData));
+    }
+
+    Q_FOREACH (Stroke stroke, strokes) {
+        stroke.presetIndex = presetIndexes.value(stroke.presetIndex, -1);
+        writer.addStroke(stroke);
+    }
+
+    return !writer.hasErrors();
+}
@@ -0,0 +1,175 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKERECORDING_H
+#define KISSTROKERECORDING_H
+
+#include <QBrush>
+#include <QByteArray>
+#include <QPointF>
+#include <QRect>
+#include <QScopedPointer>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+#include <brushengine/kis_paint_information.h>
+#include "strokes/freehand_stroke.h"
+#include "kritaui_export.h"
+
+class QIODevice;
+
+/**
+ * A recording of the freehand strokes made by KisToolFreehandHelper
+ * while KisStrokeRecorder is active. The recording keeps everything
+ * that is needed to replay the strokes without the GUI: the state of
+ * the painted layer before every stroke, the presets, the
+ * resources and the paint jobs in the order they were added to the
+ * stroke, with their timestamps.
+ *
+ * On disk the recording is a sequence of chunks, so the recorder can
+ * append every stroke as soon as it is finished. The presets are
+ * stored only once, the strokes refer to them by index.
+ */
+class KRITAUI_EXPORT KisStrokeRecording
+{
+public:
+    /**
+     * The painted layer and the image it belongs to. Only the layer
+     * the stroke paints on is recorded, so the replay paints on an
+     * image that has a single layer.
+     *
+     * A state is either full, that is, it has all the pixels of the
+     * layer in \p bounds, or incremental. An incremental state has
+     * only the pixels of \p changedRects, the rest of the layer is the
+     * same as in the state \p baseStateIndex, which is always an
+     * earlier one.
+     */
+    struct ImageState {
+        QSize imageSize;
+        double xRes = 1.0;
+        double yRes = 1.0;
+
+        QString imageColorModelId;
+        QString imageColorDepthId;
+        QString imageProfileName;
+
+        QString colorModelId;
+        QString colorDepthId;
+        QString profileName;
+
+        QByteArray defaultPixel;
+        QRect bounds;
+
+        int baseStateIndex = -1;
+        QVector<QRect> changedRects;
+
+        /**
+         * qCompress'ed pixels of the layer in \p bounds, or of all the
+         * \p changedRects one after another for an incremental state
+         */
+        QByteArray pixels;
+    };
+
+    /**
+     * The starting point of every KisFreehandStrokeInfo of the stroke.
+     * The multihand tool paints with several of them at once.
+     */
+    struct StrokeInfo {
+        QPointF lastPosition;
+        double lastDrawingAngle = 0.0;
+        double spacingUpdateInterval = 0.0;
+        double timingUpdateInterval = 0.0;
+    };
+
+    /**
+     * One FreehandStrokeStrategy::Data job. Only the point, line and
+     * curve jobs are created by the freehand tools.
+     */
+    struct Job {
+        /// microseconds since the start of the stroke
+        qint64 time = 0;
+        int strokeInfoId = 0;
+        FreehandStrokeStrategy::Data::DabType type = FreehandStrokeStrategy::Data::POINT;
+        KisPaintInformation pi1;
+        KisPaintInformation pi2;
+        QPointF control1;
+        QPointF control2;
+    };
+
+    struct Stroke {
+        int imageStateIndex = -1;
+        int presetIndex = -1;
+
+        /// the colors in the color space of the layer
+        QByteArray fgColor;
+        QByteArray bgColor;
+        QGradientStops gradientStops;
+
+        bool mirrorHorizontal = false;
+        bool mirrorVertical = false;
+        bool globalAlphaLock = false;
+        double effectiveZoom = 1.0;
+        double hdrExposure = 0.0;
+
+        /**
+         * The random sources of FreehandStrokeStrategy are seeded with
+         * qrand(), so qsrand(randomSeed) before creating the strategy
+         * gives the same random numbers to the paintops on replay.
+         */
+        quint32 randomSeed = 0;
+
+        QVector<StrokeInfo> strokeInfos;
+        QVector<Job> jobs;
+    };
+
+    /**
+     * Writes a recording chunk by chunk
+     */
+    class KRITAUI_EXPORT Writer
+    {
+    public:
+        Writer(QIODevice *device);
+        ~Writer();
+
+        /// \return the index the strokes should use to refer to the image state
+        int addImageState(const ImageState &state);
+
+        /// \return the index of the preset, the same data is written only once
+        int addPreset(const QByteArray &presetData);
+
+        void addStroke(const Stroke &stroke);
+
+        bool hasErrors() const;
+
+    private:
+        struct Private;
+        const QScopedPointer<Private> m_d;
+    };
+
+public:
+    bool load(QIODevice *device);
+    bool save(QIODevice *device) const;
+
+public:
+    QVector<ImageState> imageStates;
+    QVector<QByteArray> presets;
+    QVector<Stroke> strokes;
+};
+
+#endif // KISSTROKERECORDING_H
@@ -0,0 +1,481 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeReplayer.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLinearGradient>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QtMath>
+
+#include <KoCanvasResourceProvider.h>
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <resources/KoPattern.h>
+#include <resources/KoStopGradient.h>
+#include <brushengine/kis_paintop_preset.h>
+#include <KisGlobalResourcesInterface.h>
+
+#include "kis_debug.h"
+#include "kis_distance_information.h"
+#include "kis_image.h"
+#include "kis_paint_device.h"
+#include "kis_paint_layer.h"
+#include "kis_resources_snapshot.h"
+#include "KisViewManager.h"
+#include "KisAsyncronousStrokeUpdateHelper.h"
+#include "strokes/freehand_stroke.h"
+#include "strokes/KisFreehandStrokeInfo.h"
+
+namespace {
+
+struct ReplayCollector {
+    QElapsedTimer timer;
+
+    QMutex mutex;
+    QVector<qint64> jobLatencies;
+    std::atomic<int> numDabs {0};
+
+    qint64 now() const {
+        return timer.nsecsElapsed() / 1000;
+    }
+};
+
+class ReplayJobData : public FreehandStrokeStrategy::Data
+{
+public:
+    ReplayJobData(const KisStrokeRecording::Job &job, qint64 _queuedTime)
+        : FreehandStrokeStrategy::Data(job.strokeInfoId, job.pi1),
+          queuedTime(_queuedTime)
+    {
+        type = job.type;
+        pi2 = job.pi2;
+        control1 = job.control1;
+        control2 = job.control2;
+    }
+
+    const qint64 queuedTime;
+};
+
+class ReplayStrokeStrategy : public FreehandStrokeStrategy
+{
+public:
+    ReplayStrokeStrategy(KisResourcesSnapshotSP resources,
+                         QVector<KisFreehandStrokeInfo*> strokeInfos,
+                         ReplayCollector *collector)
+        : FreehandStrokeStrategy(resources, strokeInfos, kundo2_noi18n("Replayed Stroke")),
+          m_strokeInfos(strokeInfos),
+          m_collector(collector)
+    {
+    }
+
+    void doStrokeCallback(KisStrokeJobData *data) override {
+        FreehandStrokeStrategy::doStrokeCallback(data);
+
+        ReplayJobData *d = dynamic_cast<ReplayJobData*>(data);
+        if (d) {
+            const qint64 latency = m_collector->now() - d->queuedTime;
+
+            QMutexLocker l(&m_collector->mutex);
+            m_collector->jobLatencies.append(latency);
+        }
+    }
+
+    void finishStrokeCallback() override {
+        // the stroke infos are destroyed by the base class
+        Q_FOREACH (KisFreehandStrokeInfo *info, m_strokeInfos) {
+            m_collector->numDabs += info->dragDistance->currentDabSeqNo();
+        }
+
+        FreehandStrokeStrategy::finishStrokeCallback();
+    }
+
+    KisStrokeStrategy* createLodClone(int levelOfDetail) override {
+        Q_UNUSED(levelOfDetail);
+
+        // the replay should measure painting in full resolution only
+        return 0;
+    }
+
+private:
+    QVector<KisFreehandStrokeInfo*> m_strokeInfos;
+    ReplayCollector *m_collector;
+};
+
+const KoColorSpace* findColorSpace(const QString &colorModelId,
+                                   const QString &colorDepthId,
+                                   const QString &profileName)
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    const KoColorSpace *colorSpace = registry->colorSpace(colorModelId, colorDepthId, profileName);
+    if (!colorSpace) {
+        warnKrita << "Profile of the recorded stroke is not available, using the default one" << ppVar(profileName);
+        colorSpace = registry->colorSpace(colorModelId, colorDepthId, QString());
+    }
+
+    return colorSpace;
+}
+
+KoColor colorFromData(const QByteArray &data, const KoColorSpace *colorSpace)
+{
+    if (data.size() != int(colorSpace->pixelSize())) {
+        return KoColor(Qt::black, colorSpace);
+    }
+
+    return KoColor(reinterpret_cast<const quint8*>(data.constData()), colorSpace);
+}
+
+}
+
+struct KisStrokeReplayer::Private
+{
+    Private(const KisStrokeRecording &_recording)
+        : recording(_recording)
+    {
+    }
+
+    const KisStrokeRecording &recording;
+
+    Pacing pacing = AsFastAsPossible;
+    int workingThreadsLimit = -1;
+
+    KisImageSP image;
+    KisPaintLayerSP layer;
+
+    QVector<KisPaintOpPresetSP> presets;
+
+    /**
+     * The resources snapshot keeps a link to the canvas resources,
+     * so the provider should live while the strokes are running
+     */
+    QScopedPointer<KoCanvasResourceProvider> resourceManager;
+
+    bool createImage(int stateIndex);
+    bool writeStatePixels(KisPaintDeviceSP device, int stateIndex);
+    void loadPresets();
+    void setupResources(const KisStrokeRecording::Stroke &stroke, KisPaintOpPresetSP preset);
+    void waitUntil(const QElapsedTimer &strokeTime, qint64 time);
+};
+
+bool KisStrokeReplayer::Private::createImage(int stateIndex)
+{
+    const KisStrokeRecording::ImageState &state = recording.imageStates[stateIndex];
+
+    const KoColorSpace *imageColorSpace =
+        findColorSpace(state.imageColorModelId, state.imageColorDepthId, state.imageProfileName);
+    const KoColorSpace *colorSpace =
+        findColorSpace(state.colorModelId, state.colorDepthId, state.profileName);
+
+    if (!imageColorSpace || !colorSpace || state.imageSize.isEmpty()) {
+        warnKrita << "Cannot create an image for the recorded strokes"
+                  << ppVar(state.imageColorModelId) << ppVar(state.colorModelId) << ppVar(state.imageSize);
+        return false;
+    }
+
+    image = new KisImage(0, state.imageSize.width(), state.imageSize.height(),
+                         imageColorSpace, "stroke replay");
+    image->setResolution(state.xRes, state.yRes);
+
+    if (workingThreadsLimit > 0) {
+        image->setWorkingThreadsLimit(workingThreadsLimit);
+    }
+
+    layer = new KisPaintLayer(image, "recorded layer", OPACITY_OPAQUE_U8, colorSpace);
+
+    KisPaintDeviceSP device = layer->paintDevice();
+    device->setDefaultPixel(colorFromData(state.defaultPixel, colorSpace));
+
+    if (!writeStatePixels(device, stateIndex)) {
+        warnKrita << "Pixels of the recorded layer are corrupted, replaying on an empty layer";
+        device->clear();
+    }
+
+    image->addNode(layer, image->root());
+    image->initialRefreshGraph();
+
+    return true;
+}
+
+bool KisStrokeReplayer::Private::writeStatePixels(KisPaintDeviceSP device, int stateIndex)
+{
+    const KisStrokeRecording::ImageState &state = recording.imageStates[stateIndex];
+
+    /**
+     * The recording loader guarantees that the base state is an
+     * earlier one, so the chain always ends
+     */
+    if (state.baseStateIndex >= 0 && !writeStatePixels(device, state.baseStateIndex)) {
+        return false;
+    }
+
+    QVector<QRect> rects = state.changedRects;
+    if (state.baseStateIndex < 0 && !state.bounds.isEmpty()) {
+        rects = {state.bounds};
+    }
+
+    const int pixelSize = device->pixelSize();
+
+    qint64 expectedSize = 0;
+    Q_FOREACH (const QRect &rc, rects) {
+        expectedSize += qint64(rc.width()) * rc.height() * pixelSize;
+    }
+
+    const QByteArray pixels = qUncompress(state.pixels);
+    if (pixels.size() != expectedSize) return false;
+
+    const quint8 *data = reinterpret_cast<const quint8*>(pixels.constData());
+
+    Q_FOREACH (const QRect &rc, rects) {
+        device->writeBytes(data, rc);
+        data += rc.width() * rc.height() * pixelSize;
+    }
+
+    return true;
+}
+
+void KisStrokeReplayer::Private::loadPresets()
+{
+    presets.clear();
+
+    Q_FOREACH (const QByteArray &presetData, recording.presets) {
+        KisPaintOpPresetSP preset(new KisPaintOpPreset());
+
+        QBuffer buffer;
+        buffer.setData(presetData);
+        buffer.open(QIODevice::ReadOnly);
+
+        if (!preset->loadFromDevice(&buffer, KisGlobalResourcesInterface::instance())) {
+            warnKrita << "Failed to load the recorded preset, its strokes will be skipped";
+            preset.clear();
+        }
+
+        presets.append(preset);
+    }
+}
+
+void KisStrokeReplayer::Private::setupResources(const KisStrokeRecording::Stroke &stroke, KisPaintOpPresetSP preset)
+{
+    if (!resourceManager) {
+        resourceManager.reset(new KoCanvasResourceProvider());
+        KisViewManager::initializeResourceManager(resourceManager.data());
+    }
+
+    const KoColorSpace *colorSpace = layer->paintDevice()->colorSpace();
+
+    resourceManager->setResource(KoCanvasResource::ForegroundColor,
+                                 QVariant::fromValue(colorFromData(stroke.fgColor, colorSpace)));
+    resourceManager->setResource(KoCanvasResource::BackgroundColor,
+                                 QVariant::fromValue(colorFromData(stroke.bgColor, colorSpace)));
+
+    QLinearGradient qGradient;
+    if (!stroke.gradientStops.isEmpty()) {
+        qGradient.setStops(stroke.gradientStops);
+    }
+
+    QVariant gradient;
+    gradient.setValue<KoAbstractGradientSP>(KoStopGradient::fromQGradient(&qGradient));
+    resourceManager->setResource(KoCanvasResource::CurrentGradient, gradient);
+    resourceManager->setResource(KoCanvasResource::CurrentPattern, QVariant::fromValue(KoPatternSP()));
+
+    resourceManager->setResource(KoCanvasResource::CurrentPaintOpPreset, QVariant::fromValue(preset));
+    resourceManager->setResource(KoCanvasResource::MirrorHorizontal, stroke.mirrorHorizontal);
+    resourceManager->setResource(KoCanvasResource::MirrorVertical, stroke.mirrorVertical);
+    resourceManager->setResource(KoCanvasResource::GlobalAlphaLock, stroke.globalAlphaLock);
+    resourceManager->setResource(KoCanvasResource::HdrExposure, stroke.hdrExposure);
+    resourceManager->setResource(KoCanvasResource::EffectiveZoom, stroke.effectiveZoom);
+}
+
+void KisStrokeReplayer::Private::waitUntil(const QElapsedTimer &strokeTime, qint64 time)
+{
+    const qint64 delay = (time - strokeTime.nsecsElapsed() / 1000) / 1000;
+    if (delay <= 0) return;
+
+    // the asynchronous updates of the stroke are issued by a timer
+    QEventLoop loop;
+    QTimer::singleShot(int(delay), &loop, SLOT(quit()));
+    loop.exec();
+}
+
+KisStrokeReplayer::KisStrokeReplayer(const KisStrokeRecording &recording)
+    : m_d(new Private(recording))
+{
+}
+
+KisStrokeReplayer::~KisStrokeReplayer()
+{
+    if (m_d->image) {
+        m_d->image->waitForDone();
+    }
+}
+
+void KisStrokeReplayer::setPacing(Pacing value)
+{
+    m_d->pacing = value;
+}
+
+void KisStrokeReplayer::setWorkingThreadsLimit(int value)
+{
+    m_d->workingThreadsLimit = value;
+}
+
+KisStrokeReplayer::Statistics KisStrokeReplayer::replay()
+{
+    Statistics stats;
+    ReplayCollector collector;
+
+    m_d->loadPresets();
+
+    int currentImageStateIndex = -1;
+
+    /**
+     * Every stroke usually has its own recorded state of the layer, so
+     * the time spent on recreating the image is excluded from the total
+     */
+    qint64 setupTime = 0;
+
+    collector.timer.start();
+
+    Q_FOREACH (const KisStrokeRecording::Stroke &stroke, m_d->recording.strokes) {
+        KisPaintOpPresetSP preset = m_d->presets.value(stroke.presetIndex);
+        if (!preset) continue;
+
+        if (stroke.imageStateIndex != currentImageStateIndex) {
+            if (m_d->image) {
+                m_d->image->waitForDone();
+            }
+
+            const qint64 setupStart = collector.now();
+
+            m_d->image.clear();
+            m_d->layer.clear();
+            currentImageStateIndex = stroke.imageStateIndex;
+
+            const bool imageCreated = m_d->createImage(currentImageStateIndex);
+            setupTime += collector.now() - setupStart;
+
+            if (!imageCreated) continue;
+        }
+
+        if (!m_d->image) continue;
+
+        m_d->setupResources(stroke, preset);
+
+        KisResourcesSnapshotSP resources =
+            new KisResourcesSnapshot(m_d->image, m_d->layer, m_d->resourceManager.data());
+
+        QVector<KisFreehandStrokeInfo*> strokeInfos;
+        Q_FOREACH (const KisStrokeRecording::StrokeInfo &info, stroke.strokeInfos) {
+            KisDistanceInitInfo startDistInfo(info.lastPosition,
+                                              info.lastDrawingAngle,
+                                              info.spacingUpdateInterval,
+                                              info.timingUpdateInterval,
+                                              0);
+            strokeInfos << new KisFreehandStrokeInfo(startDistInfo.makeDistInfo());
+        }
+
+        // see a comment in KisToolFreehandHelper::initPaintImpl()
+        qsrand(stroke.randomSeed);
+
+        KisStrokeId strokeId =
+            m_d->image->startStroke(new ReplayStrokeStrategy(resources, strokeInfos, &collector));
+
+        KisAsyncronousStrokeUpdateHelper asyncUpdateHelper;
+        if (resources->presetNeedsAsynchronousUpdates()) {
+            asyncUpdateHelper.startUpdateStream(m_d->image.data(), strokeId);
+        }
+
+        QElapsedTimer strokeTime;
+        strokeTime.start();
+
+        Q_FOREACH (const KisStrokeRecording::Job &job, stroke.jobs) {
+            if (job.strokeInfoId < 0 || job.strokeInfoId >= strokeInfos.size()) continue;
+
+            if (m_d->pacing == RealTime) {
+                m_d->waitUntil(strokeTime, job.time);
+            }
+
+            m_d->image->addJob(strokeId, new ReplayJobData(job, collector.now()));
+            stats.numJobs++;
+        }
+
+        if (asyncUpdateHelper.isActive()) {
+            asyncUpdateHelper.endUpdateStream();
+        }
+
+        m_d->image->endStroke(strokeId);
+        stats.numStrokes++;
+    }
+
+    if (m_d->image) {
+        m_d->image->waitForDone();
+    }
+
+    stats.totalTime = collector.now() - setupTime;
+    stats.numDabs = collector.numDabs;
+    stats.jobLatencies = collector.jobLatencies;
+    std::sort(stats.jobLatencies.begin(), stats.jobLatencies.end());
+
+    return stats;
+}
+
+KisImageSP KisStrokeReplayer::image() const
+{
+    return m_d->image;
+}
+
+KisNodeSP KisStrokeReplayer::layer() const
+{
+    return m_d->layer;
+}
+
+qreal KisStrokeReplayer::Statistics::dabsPerSecond() const
+{
+    return totalTime > 0 ? qreal(numDabs) * 1000000.0 / totalTime : 0.0;
+}
+
+qint64 KisStrokeReplayer::Statistics::latencyPercentile(qreal portion) const
+{
+    if (jobLatencies.isEmpty()) return 0;
+
+    const int index = qBound(0, qCeil(portion * jobLatencies.size()) - 1, jobLatencies.size() - 1);
+    return jobLatencies[index];
+}
+
+QString KisStrokeReplayer::Statistics::toString() const
+{
+    return QString("strokes %1, jobs %2, dabs %3, time %4 ms, %5 dabs/s, "
+                   "job latency p50 %6 ms, p90 %7 ms, p99 %8 ms, max %9 ms")
+            .arg(numStrokes)
+            .arg(numJobs)
+            .arg(numDabs)
+            .arg(totalTime / 1000.0, 0, 'f', 1)
+            .arg(dabsPerSecond(), 0, 'f', 0)
+            .arg(latencyPercentile(0.5) / 1000.0, 0, 'f', 2)
+            .arg(latencyPercentile(0.9) / 1000.0, 0, 'f', 2)
+            .arg(latencyPercentile(0.99) / 1000.0, 0, 'f', 2)
+            .arg(latencyPercentile(1.0) / 1000.0, 0, 'f', 2);
+}
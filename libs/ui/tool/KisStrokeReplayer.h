@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKEREPLAYER_H
+#define KISSTROKEREPLAYER_H
+
+#include <QScopedPointer>
+#include <QString>
+#include <QVector>
+
+#include "kis_types.h"
+#include "KisStrokeRecording.h"
+#include "kritaui_export.h"
+
+/**
+ * Replays the strokes of a KisStrokeRecording on a KisImage without
+ * any GUI and measures how fast the image processes them.
+ *
+ * The strokes are executed by the usual FreehandStrokeStrategy with
+ * the recorded preset, resources and random seed, so the result does
+ * not depend on the speed of the machine, unless the paintop itself
+ * depends on timing (e.g. airbrushing or asynchronous updates).
+ */
+class KRITAUI_EXPORT KisStrokeReplayer
+{
+public:
+    enum Pacing {
+        /// all the jobs of a stroke are added at once, measures throughput
+        AsFastAsPossible,
+
+        /// the jobs are added with the same delays as they were recorded
+        RealTime
+    };
+
+    struct KRITAUI_EXPORT Statistics {
+        int numStrokes = 0;
+        int numJobs = 0;
+        int numDabs = 0;
+
+        /// the time of the whole replay in microseconds, including the projection
+        /// updates, but not the recreation of the recorded layers
+        qint64 totalTime = 0;
+
+        /**
+         * The time between adding a job to the stroke and the end of
+         * its painting, in microseconds, sorted ascending. Every job
+         * paints a point, a line or a curve of the recorded stroke.
+         */
+        QVector<qint64> jobLatencies;
+
+        qreal dabsPerSecond() const;
+        qint64 latencyPercentile(qreal portion) const;
+
+        QString toString() const;
+    };
+
+public:
+    KisStrokeReplayer(const KisStrokeRecording &recording);
+    ~KisStrokeReplayer();
+
+    void setPacing(Pacing value);
+    void setWorkingThreadsLimit(int value);
+
+    Statistics replay();
+
+    /**
+     * The image of the last replayed stroke. Every recorded image
+     * state is replayed on a separate image.
+     */
+    KisImageSP image() const;
+
+    /// the layer the last stroke has been painted on
+    KisNodeSP layer() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISSTROKEREPLAYER_H
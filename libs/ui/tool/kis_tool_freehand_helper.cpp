@@ -36,6 +36,8 @@
 #include <brushengine/kis_paintop_utils.h>
 
 #include "kis_update_time_monitor.h"
+#include "KisLatencyTracer.h"
+#include "KisStrokeRecorder.h"
 #include "kis_stabilized_events_sampler.h"
 #include "KisStabilizerDelayedPaintHelper.h"
 #include "kis_config.h"
@@ -114,9 +116,40 @@ struct KisToolFreehandHelper::Private
     KisStabilizedEventsSampler stabilizedSampler;
     KisStabilizerDelayedPaintHelper stabilizerDelayedPaintHelper;
 
+    // Recording of the current stroke, exists only when KisStrokeRecorder is enabled.
+    // It is shared with the recording jobs of the stroke.
+    QSharedPointer<KisStrokeRecording::Stroke> recordedStroke;
+    QElapsedTimer recordedStrokeTime;
+
     qreal effectiveSmoothnessDistance() const;
+
+    void recordJob(int strokeInfoId,
+                   FreehandStrokeStrategy::Data::DabType type,
+                   const KisPaintInformation &pi1,
+                   const KisPaintInformation &pi2 = KisPaintInformation(),
+                   const QPointF &control1 = QPointF(),
+                   const QPointF &control2 = QPointF());
 };
 
+void KisToolFreehandHelper::Private::recordJob(int strokeInfoId,
+                                               FreehandStrokeStrategy::Data::DabType type,
+                                               const KisPaintInformation &pi1,
+                                               const KisPaintInformation &pi2,
+                                               const QPointF &control1,
+                                               const QPointF &control2)
+{
+    KisStrokeRecording::Job job;
+    job.time = recordedStrokeTime.nsecsElapsed() / 1000;
+    job.strokeInfoId = strokeInfoId;
+    job.type = type;
+    job.pi1 = pi1;
+    job.pi2 = pi2;
+    job.control1 = control1;
+    job.control2 = control2;
+
+    recordedStroke->jobs.append(job);
+}
+
 
 KisToolFreehandHelper::KisToolFreehandHelper(KisPaintingInformationBuilder *infoBuilder,
                                              KoCanvasResourceProvider *resourceManager,
@@ -304,11 +337,47 @@ void KisToolFreehandHelper::initPaintImpl(qreal startAngle,
     createPainters(m_d->strokeInfos,
                    startDist);
 
+    m_d->recordedStroke.reset();
+
+    if (KisStrokeRecorder::isEnabled()) {
+        m_d->recordedStroke.reset(new KisStrokeRecording::Stroke());
+
+        if (KisStrokeRecorder::instance()->beginStroke(m_d->resources, resourceManager,
+                                                       m_d->recordedStroke.data())) {
+
+            Q_FOREACH (KisFreehandStrokeInfo *info, m_d->strokeInfos) {
+                KisStrokeRecording::StrokeInfo recordedInfo;
+                recordedInfo.lastPosition = info->dragDistance->lastPosition();
+                recordedInfo.lastDrawingAngle = info->dragDistance->lastDrawingAngle();
+                recordedInfo.spacingUpdateInterval = info->dragDistance->getSpacingInterval();
+                recordedInfo.timingUpdateInterval = info->dragDistance->getTimingUpdateInterval();
+                m_d->recordedStroke->strokeInfos.append(recordedInfo);
+            }
+
+            /**
+             * The random sources of the stroke are seeded with qrand(),
+             * so reseeding it lets the replay get the same random numbers
+             */
+            m_d->recordedStroke->randomSeed = quint32(qrand());
+            qsrand(m_d->recordedStroke->randomSeed);
+
+            m_d->recordedStrokeTime.start();
+        } else {
+            m_d->recordedStroke.reset();
+        }
+    }
+
     KisStrokeStrategy *stroke =
         new FreehandStrokeStrategy(m_d->resources, m_d->strokeInfos, m_d->transactionText);
 
     m_d->strokeId = m_d->strokesFacade->startStroke(stroke);
 
+    if (m_d->recordedStroke) {
+        m_d->strokesFacade->addJob(m_d->strokeId,
+                                   KisStrokeRecorder::instance()->createImageStateJob(m_d->resources,
+                                                                                      m_d->recordedStroke));
+    }
+
     m_d->history.clear();
     m_d->distanceHistory.clear();
 
@@ -449,6 +518,10 @@ void KisToolFreehandHelper::paintEvent(KoPointerEvent *event)
                                              elapsedStrokeTime());
     KisUpdateTimeMonitor::instance()->reportMouseMove(info.pos());
 
+    if (KisLatencyTracer::isEnabled()) {
+        KisLatencyTracer::instance()->recordInstant(KisLatencyTracer::PaintInfoCreated, info.pos());
+    }
+
     paint(info);
 }
 
@@ -644,6 +717,12 @@ void KisToolFreehandHelper::endPaint()
      */
     m_d->strokeInfos.clear();
 
+    if (m_d->recordedStroke) {
+        m_d->strokesFacade->addJob(m_d->strokeId,
+                                   KisStrokeRecorder::instance()->createEndStrokeJob(m_d->recordedStroke));
+        m_d->recordedStroke.reset();
+    }
+
     m_d->strokesFacade->endStroke(m_d->strokeId);
     m_d->strokeId.clear();
 }
@@ -672,6 +751,7 @@ void KisToolFreehandHelper::cancelPaint()
 
     // see a comment in endPaint()
     m_d->strokeInfos.clear();
+    m_d->recordedStroke.reset();
 
     m_d->strokesFacade->cancelStroke(m_d->strokeId);
     m_d->strokeId.clear();
@@ -909,6 +989,10 @@ void KisToolFreehandHelper::paintAt(int strokeInfoId,
     m_d->strokesFacade->addJob(m_d->strokeId,
                                new FreehandStrokeStrategy::Data(strokeInfoId, pi));
 
+    if (m_d->recordedStroke) {
+        m_d->recordJob(strokeInfoId, FreehandStrokeStrategy::Data::POINT, pi);
+    }
+
 }
 
 void KisToolFreehandHelper::paintLine(int strokeInfoId,
@@ -919,6 +1003,10 @@ void KisToolFreehandHelper::paintLine(int strokeInfoId,
     m_d->strokesFacade->addJob(m_d->strokeId,
                                new FreehandStrokeStrategy::Data(strokeInfoId, pi1, pi2));
 
+    if (m_d->recordedStroke) {
+        m_d->recordJob(strokeInfoId, FreehandStrokeStrategy::Data::LINE, pi1, pi2);
+    }
+
 }
 
 void KisToolFreehandHelper::paintBezierCurve(int strokeInfoId,
@@ -956,6 +1044,10 @@ void KisToolFreehandHelper::paintBezierCurve(int strokeInfoId,
                                new FreehandStrokeStrategy::Data(strokeInfoId,
                                                                 pi1, control1, control2, pi2));
 
+    if (m_d->recordedStroke) {
+        m_d->recordJob(strokeInfoId, FreehandStrokeStrategy::Data::CURVE, pi1, pi2, control1, control2);
+    }
+
 }
 
 void KisToolFreehandHelper::createPainters(QVector<KisFreehandStrokeInfo*> &strokeInfos,
@@ -24,8 +24,8 @@
 
 #include <colorprofiles/LcmsColorProfileContainer.h>
 #include <KoColorSpaceAbstract.h>
-#include <QMutex>
-#include <QMutexLocker>
+#include <QThreadStorage>
+#include <QVector>
 
 #include "kis_assert.h"
 
@@ -74,6 +74,39 @@ struct KoLcmsDefaultTransformations {
     static QMap< QString, QMap< LcmsColorProfileContainer *, KoLcmsDefaultTransformations * > > s_transformations;
 };
 
+/**
+ * The transformations from and to QColor's RGB for a non-default
+ * profile, together with a buffer for packing the QColors. Every thread
+ * keeps its own copy, so the transformations can be reused without any
+ * locking: cmsDoTransform() itself is reentrant.
+ */
+struct KoLcmsQColorTransformations {
+    KoLcmsQColorTransformations()
+        : toRGBProfile(0),
+          toRGB(0),
+          fromRGBProfile(0),
+          fromRGB(0)
+    {
+    }
+
+    ~KoLcmsQColorTransformations()
+    {
+        if (toRGB) {
+            cmsDeleteTransform(toRGB);
+        }
+        if (fromRGB) {
+            cmsDeleteTransform(fromRGB);
+        }
+    }
+
+    cmsHPROFILE   toRGBProfile;    // Last used profile to transform to RGB
+    cmsHTRANSFORM toRGB;           // Last used transform to transform to RGB
+    cmsHPROFILE   fromRGBProfile;  // Last used profile to transform from RGB
+    cmsHTRANSFORM fromRGB;         // Last used transform to transform from RGB
+
+    QVector<quint8> rgbBuffer;     // A buffer for batched conversion from and to QColor
+};
+
 /**
  * This is the base class for all colorspaces that are based on the lcms library, for instance
  * RGB 8bits and 16bits, CMYK 8bits and 16bits, LAB...
@@ -157,15 +190,11 @@ class LcmsColorSpace : public KoColorSpaceAbstract<_CSTraits>, public KoLcmsInfo
     };
 
     struct Private {
-        mutable quint8 *qcolordata; // A small buffer for conversion from and to qcolor.
         KoLcmsDefaultTransformations *defaultTransformations;
 
-        mutable cmsHPROFILE   lastRGBProfile;  // Last used profile to transform to/from RGB
-        mutable cmsHTRANSFORM lastToRGB;       // Last used transform to transform to RGB
-        mutable cmsHTRANSFORM lastFromRGB;     // Last used transform to transform from RGB
+        QThreadStorage<KoLcmsQColorTransformations*> qcolorTransformations;
         LcmsColorProfileContainer *profile;
         KoColorProfile *colorProfile;
-        QMutex mutex;
     };
 
 protected:
@@ -184,27 +213,18 @@ protected:
         d->profile = asLcmsProfile(p);
         Q_ASSERT(d->profile);
         d->colorProfile = p;
-        d->qcolordata = 0;
-        d->lastRGBProfile = 0;
-        d->lastToRGB = 0;
-        d->lastFromRGB = 0;
         d->defaultTransformations = 0;
     }
 
     ~LcmsColorSpace() override
     {
         delete d->colorProfile;
-        delete[] d->qcolordata;
         delete d->defaultTransformations;
         delete d;
     }
 
     void init()
     {
-        // Default pixel buffer for QColor conversion
-        d->qcolordata = new quint8[3];
-        Q_CHECK_PTR(d->qcolordata);
-
         KIS_ASSERT(d->profile);
 
         if (KoLcmsDefaultTransformations::s_RGBProfile == 0) {
@@ -247,62 +267,77 @@ public:
     bool profileIsCompatible(const KoColorProfile *profile) const override
     {
         const IccColorProfile *p = dynamic_cast<const IccColorProfile *>(profile);
-        return (p && p->asLcms()->colorSpaceSignature() == colorSpaceSignature());
+        return (p && p->colorSpaceSignature() == quint32(colorSpaceSignature()));
     }
 
     void fromQColor(const QColor &color, quint8 *dst, const KoColorProfile *koprofile = 0) const override
     {
-        QMutexLocker locker(&d->mutex);
-        d->qcolordata[2] = color.red();
-        d->qcolordata[1] = color.green();
-        d->qcolordata[0] = color.blue();
+        quint8 rgb[3];
+        rgb[2] = color.red();
+        rgb[1] = color.green();
+        rgb[0] = color.blue();
 
-        LcmsColorProfileContainer *profile = asLcmsProfile(koprofile);
-        if (profile == 0) {
-            // Default sRGB
-            KIS_ASSERT(d->defaultTransformations && d->defaultTransformations->fromRGB);
+        cmsDoTransform(fromRGBTransformation(koprofile), rgb, dst, 1);
 
-            cmsDoTransform(d->defaultTransformations->fromRGB, d->qcolordata, dst, 1);
-        } else {
-            if (d->lastFromRGB == 0 || (d->lastFromRGB != 0 && d->lastRGBProfile != profile->lcmsProfile())) {
-                d->lastFromRGB = cmsCreateTransform(profile->lcmsProfile(),
-                                                    TYPE_BGR_8,
-                                                    d->profile->lcmsProfile(),
-                                                    this->colorSpaceType(),
-                                                    KoColorConversionTransformation::internalRenderingIntent(),
-                                                    KoColorConversionTransformation::internalConversionFlags());
-                d->lastRGBProfile = profile->lcmsProfile();
+        this->setOpacity(dst, (quint8)(color.alpha()), 1);
+    }
 
-            }
-            KIS_ASSERT(d->lastFromRGB);
-            cmsDoTransform(d->lastFromRGB, d->qcolordata, dst, 1);
+    void fromQColors(const QColor *colors, quint8 *dst, qint32 nColors, const KoColorProfile *koprofile = 0) const override
+    {
+        if (nColors <= 0) return;
+
+        cmsHTRANSFORM transform = fromRGBTransformation(koprofile);
+
+        QVector<quint8> &rgbBuffer = qcolorTransformations()->rgbBuffer;
+        rgbBuffer.resize(3 * nColors);
+
+        quint8 *rgb = rgbBuffer.data();
+        for (qint32 i = 0; i < nColors; i++) {
+            rgb[2] = colors[i].red();
+            rgb[1] = colors[i].green();
+            rgb[0] = colors[i].blue();
+            rgb += 3;
         }
 
-        this->setOpacity(dst, (quint8)(color.alpha()), 1);
+        cmsDoTransform(transform, rgbBuffer.data(), dst, nColors);
+
+        const qint32 pixelSize = this->pixelSize();
+        for (qint32 i = 0; i < nColors; i++) {
+            this->setOpacity(dst, (quint8)(colors[i].alpha()), 1);
+            dst += pixelSize;
+        }
     }
 
     void toQColor(const quint8 *src, QColor *c, const KoColorProfile *koprofile = 0) const override
     {
-        QMutexLocker locker(&d->mutex);
-        LcmsColorProfileContainer *profile = asLcmsProfile(koprofile);
-        if (profile == 0) {
-            // Default sRGB transform
-            Q_ASSERT(d->defaultTransformations && d->defaultTransformations->toRGB);
-            cmsDoTransform(d->defaultTransformations->toRGB, const_cast <quint8 *>(src), d->qcolordata, 1);
-        } else {
-            if (d->lastToRGB == 0 || (d->lastToRGB != 0 && d->lastRGBProfile != profile->lcmsProfile())) {
-                d->lastToRGB = cmsCreateTransform(d->profile->lcmsProfile(), this->colorSpaceType(),
-                                                  profile->lcmsProfile(), TYPE_BGR_8,
-                                                  KoColorConversionTransformation::internalRenderingIntent(),
-                                                  KoColorConversionTransformation::internalConversionFlags());
-                d->lastRGBProfile = profile->lcmsProfile();
-            }
-            cmsDoTransform(d->lastToRGB, const_cast <quint8 *>(src), d->qcolordata, 1);
-        }
-        c->setRgb(d->qcolordata[2], d->qcolordata[1], d->qcolordata[0]);
+        quint8 rgb[3];
+
+        cmsDoTransform(toRGBTransformation(koprofile), const_cast <quint8 *>(src), rgb, 1);
+
+        c->setRgb(rgb[2], rgb[1], rgb[0]);
         c->setAlpha(this->opacityU8(src));
     }
 
+    void toQColors(const quint8 *src, QColor *colors, qint32 nColors, const KoColorProfile *koprofile = 0) const override
+    {
+        if (nColors <= 0) return;
+
+        cmsHTRANSFORM transform = toRGBTransformation(koprofile);
+
+        QVector<quint8> &rgbBuffer = qcolorTransformations()->rgbBuffer;
+        rgbBuffer.resize(3 * nColors);
+
+        cmsDoTransform(transform, const_cast <quint8 *>(src), rgbBuffer.data(), nColors);
+
+        const qint32 pixelSize = this->pixelSize();
+        const quint8 *rgb = rgbBuffer.constData();
+        for (qint32 i = 0; i < nColors; i++) {
+            colors[i].setRgb(rgb[2], rgb[1], rgb[0], this->opacityU8(src));
+            rgb += 3;
+            src += pixelSize;
+        }
+    }
+
     KoColorTransformation *createBrightnessContrastAdjustment(const quint16 *transferValues) const override
     {
         if (!d->profile) {
@@ -455,6 +490,80 @@ private:
         return iccp->asLcms();
     }
 
+    inline KoLcmsQColorTransformations *qcolorTransformations() const
+    {
+        if (!d->qcolorTransformations.hasLocalData()) {
+            d->qcolorTransformations.setLocalData(new KoLcmsQColorTransformations());
+        }
+        return d->qcolorTransformations.localData();
+    }
+
+    /**
+     * Returns the transformation from 8-bit BGR in \p koprofile into this
+     * color space. Null profile means sRGB, which has a shared transformation.
+     * For all the other profiles the last used transformation is cached
+     * per thread.
+     */
+    cmsHTRANSFORM fromRGBTransformation(const KoColorProfile *koprofile) const
+    {
+        LcmsColorProfileContainer *profile = asLcmsProfile(koprofile);
+        if (profile == 0) {
+            // Default sRGB
+            KIS_ASSERT(d->defaultTransformations && d->defaultTransformations->fromRGB);
+            return d->defaultTransformations->fromRGB;
+        }
+
+        KoLcmsQColorTransformations *cache = qcolorTransformations();
+
+        if (!cache->fromRGB || cache->fromRGBProfile != profile->lcmsProfile()) {
+            if (cache->fromRGB) {
+                cmsDeleteTransform(cache->fromRGB);
+            }
+
+            cache->fromRGB = cmsCreateTransform(profile->lcmsProfile(),
+                                                TYPE_BGR_8,
+                                                d->profile->lcmsProfile(),
+                                                this->colorSpaceType(),
+                                                KoColorConversionTransformation::internalRenderingIntent(),
+                                                KoColorConversionTransformation::internalConversionFlags());
+            cache->fromRGBProfile = profile->lcmsProfile();
+        }
+
+        KIS_ASSERT(cache->fromRGB);
+        return cache->fromRGB;
+    }
+
+    /**
+     * Returns the transformation from this color space into 8-bit BGR
+     * in \p koprofile. \see fromRGBTransformation()
+     */
+    cmsHTRANSFORM toRGBTransformation(const KoColorProfile *koprofile) const
+    {
+        LcmsColorProfileContainer *profile = asLcmsProfile(koprofile);
+        if (profile == 0) {
+            // Default sRGB transform
+            KIS_ASSERT(d->defaultTransformations && d->defaultTransformations->toRGB);
+            return d->defaultTransformations->toRGB;
+        }
+
+        KoLcmsQColorTransformations *cache = qcolorTransformations();
+
+        if (!cache->toRGB || cache->toRGBProfile != profile->lcmsProfile()) {
+            if (cache->toRGB) {
+                cmsDeleteTransform(cache->toRGB);
+            }
+
+            cache->toRGB = cmsCreateTransform(d->profile->lcmsProfile(), this->colorSpaceType(),
+                                              profile->lcmsProfile(), TYPE_BGR_8,
+                                              KoColorConversionTransformation::internalRenderingIntent(),
+                                              KoColorConversionTransformation::internalConversionFlags());
+            cache->toRGBProfile = profile->lcmsProfile();
+        }
+
+        KIS_ASSERT(cache->toRGB);
+        return cache->toRGB;
+    }
+
     Private *const d;
 };
 
@@ -472,7 +581,7 @@ public:
     bool profileIsCompatible(const KoColorProfile *profile) const override
     {
         const IccColorProfile *p = dynamic_cast<const IccColorProfile *>(profile);
-        return (p && p->asLcms()->colorSpaceSignature() == colorSpaceSignature());
+        return (p && p->colorSpaceSignature() == quint32(colorSpaceSignature()));
     }
 
     QString colorSpaceEngine() const override
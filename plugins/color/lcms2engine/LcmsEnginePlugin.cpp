@@ -40,6 +40,7 @@
 
 #include "IccColorSpaceEngine.h"
 #include "colorprofiles/LcmsColorProfileContainer.h"
+#include "colorprofiles/IccColorProfileIndex.h"
 
 #include "colorspaces/cmyk_u8/CmykU8ColorSpace.h"
 #include "colorspaces/cmyk_u16/CmykU16ColorSpace.h"
@@ -131,19 +132,26 @@ LcmsEnginePlugin::LcmsEnginePlugin(QObject *parent, const QVariantList &)
     }
     // Load the profiles
     if (!profileFilenames.empty()) {
+        /**
+         * Only the profiles that are not present in the index or have
+         * changed since the last start are parsed by lcms here, the rest
+         * are loaded when some color space uses them.
+         */
+        IccColorProfileIndex index(KoResourcePaths::saveLocation("cache") + "/iccprofiles.index");
+        index.load();
+
         for (QStringList::Iterator it = profileFilenames.begin(); it != profileFilenames.end(); ++it) {
-            KoColorProfile *profile = new IccColorProfile(*it);
-            Q_CHECK_PTR(profile);
+            KoColorProfile *profile = index.createProfile(*it);
 
-            profile->load();
-            if (profile->valid()) {
+            if (profile) {
                 //qDebug() << "Valid profile : " << profile->fileName() << profile->name();
                 registry->addProfileToMap(profile);
             } else {
-                qDebug() << "Invalid profile : " << profile->fileName() << profile->name();
-                delete profile;
+                qDebug() << "Invalid profile : " << *it;
             }
         }
+
+        index.save();
     }
 
     // ------------------- LAB ---------------------------------
@@ -23,6 +23,7 @@
 #include <limits.h>
 
 #include <QFile>
+#include <QMutex>
 #include <QSharedPointer>
 
 #include "QDebug"
@@ -75,6 +76,25 @@ struct IccColorProfile::Private {
         QScopedPointer<LcmsColorProfileContainer> lcmsProfile;
         QVector<KoChannelInfo::DoubleRange> uiMinMaxes;
         bool canCreateCyclicTransform = false;
+
+        /**
+         * The profiles created from the profile index have their
+         * metadata set and are loaded on the first access to the data
+         * that is not part of the metadata.
+         */
+        QScopedPointer<const IccColorProfile::Metadata> metadata;
+        QAtomicInt needsLazyLoading;
+        QAtomicInt metadataIsActual;
+        QMutex lazyLoadingMutex;
+
+        /**
+         * Returns the metadata from the profile index, unless the file
+         * turned out to be missing or changed on loading. In that case
+         * the properties of the actually loaded profile are reported.
+         */
+        const IccColorProfile::Metadata* indexMetadata() const {
+            return metadataIsActual.loadAcquire() ? metadata.data() : 0;
+        }
     };
     QSharedPointer<Shared> shared;
 };
@@ -97,6 +117,21 @@ IccColorProfile::IccColorProfile(const QByteArray &rawData)
     init();
 }
 
+IccColorProfile::IccColorProfile(const QString &fileName, const Metadata &metadata)
+    : KoColorProfile(fileName), d(new Private)
+{
+    d->shared = QSharedPointer<Private::Shared>(new Private::Shared());
+    d->shared->data.reset(new Data());
+    d->shared->metadata.reset(new Metadata(metadata));
+    d->shared->needsLazyLoading = 1;
+    d->shared->metadataIsActual = 1;
+
+    setName(metadata.name);
+    setInfo(metadata.info);
+    setManufacturer(metadata.manufacturer);
+    setCopyright(metadata.copyright);
+}
+
 IccColorProfile::IccColorProfile(const IccColorProfile &rhs)
     : KoColorProfile(rhs)
     , d(new Private(*rhs.d))
@@ -116,6 +151,7 @@ KoColorProfile *IccColorProfile::clone() const
 
 QByteArray IccColorProfile::rawData() const
 {
+    ensureLoaded();
     return d->shared->data->rawData();
 }
 
@@ -126,6 +162,9 @@ void IccColorProfile::setRawData(const QByteArray &rawData)
 
 bool IccColorProfile::valid() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->valid;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->valid();
     }
@@ -133,6 +172,9 @@ bool IccColorProfile::valid() const
 }
 float IccColorProfile::version() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->version;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->version();
     }
@@ -140,6 +182,9 @@ float IccColorProfile::version() const
 }
 bool IccColorProfile::isSuitableForOutput() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->isSuitableForOutput;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->isSuitableForOutput() && d->shared->canCreateCyclicTransform;
     }
@@ -148,6 +193,9 @@ bool IccColorProfile::isSuitableForOutput() const
 
 bool IccColorProfile::isSuitableForPrinting() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->isSuitableForPrinting;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->isSuitableForPrinting();
     }
@@ -156,6 +204,9 @@ bool IccColorProfile::isSuitableForPrinting() const
 
 bool IccColorProfile::isSuitableForDisplay() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->isSuitableForDisplay;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->isSuitableForDisplay();
     }
@@ -164,6 +215,9 @@ bool IccColorProfile::isSuitableForDisplay() const
 
 bool IccColorProfile::supportsPerceptual() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->supportsPerceptual;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->supportsPerceptual();
     }
@@ -171,6 +225,9 @@ bool IccColorProfile::supportsPerceptual() const
 }
 bool IccColorProfile::supportsSaturation() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->supportsSaturation;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->supportsSaturation();
     }
@@ -178,6 +235,9 @@ bool IccColorProfile::supportsSaturation() const
 }
 bool IccColorProfile::supportsAbsolute() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->supportsAbsolute;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->supportsAbsolute();
     }
@@ -185,6 +245,9 @@ bool IccColorProfile::supportsAbsolute() const
 }
 bool IccColorProfile::supportsRelative() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->supportsRelative;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->supportsRelative();
     }
@@ -192,6 +255,9 @@ bool IccColorProfile::supportsRelative() const
 }
 bool IccColorProfile::hasColorants() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->hasColorants;
+    }
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->hasColorants();
     }
@@ -199,18 +265,25 @@ bool IccColorProfile::hasColorants() const
 }
 bool IccColorProfile::hasTRC() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->hasTRC;
+    }
     if (d->shared->lcmsProfile)
         return d->shared->lcmsProfile->hasTRC();
     return false;
 }
 bool IccColorProfile::isLinear() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->isLinear;
+    }
     if (d->shared->lcmsProfile)
         return d->shared->lcmsProfile->isLinear();
     return false;
 }
 QVector <qreal> IccColorProfile::getColorantsXYZ() const
 {
+    ensureLoaded();
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->getColorantsXYZ();
     }
@@ -218,6 +291,7 @@ QVector <qreal> IccColorProfile::getColorantsXYZ() const
 }
 QVector <qreal> IccColorProfile::getColorantsxyY() const
 {
+    ensureLoaded();
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->getColorantsxyY();
     }
@@ -227,6 +301,7 @@ QVector <qreal> IccColorProfile::getWhitePointXYZ() const
 {
     QVector <qreal> d50Dummy(3);
     d50Dummy << 0.9642 << 1.0000 << 0.8249;
+    ensureLoaded();
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->getWhitePointXYZ();
     }
@@ -236,6 +311,7 @@ QVector <qreal> IccColorProfile::getWhitePointxyY() const
 {
     QVector <qreal> d50Dummy(3);
     d50Dummy << 0.34773 << 0.35952 << 1.0;
+    ensureLoaded();
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->getWhitePointxyY();
     }
@@ -245,6 +321,7 @@ QVector <qreal> IccColorProfile::getEstimatedTRC() const
 {
     QVector <qreal> dummy(3);
     dummy.fill(2.2);//estimated sRGB trc.
+    ensureLoaded();
     if (d->shared->lcmsProfile) {
         return d->shared->lcmsProfile->getEstimatedTRC();
     }
@@ -253,27 +330,35 @@ QVector <qreal> IccColorProfile::getEstimatedTRC() const
 
 void IccColorProfile::linearizeFloatValue(QVector <qreal> & Value) const
 {
+    ensureLoaded();
     if (d->shared->lcmsProfile)
         d->shared->lcmsProfile->LinearizeFloatValue(Value);
 }
 void IccColorProfile::delinearizeFloatValue(QVector <qreal> & Value) const
 {
+    ensureLoaded();
     if (d->shared->lcmsProfile)
         d->shared->lcmsProfile->DelinearizeFloatValue(Value);
 }
 void IccColorProfile::linearizeFloatValueFast(QVector <qreal> & Value) const
 {
+    ensureLoaded();
     if (d->shared->lcmsProfile)
         d->shared->lcmsProfile->LinearizeFloatValueFast(Value);
 }
 void IccColorProfile::delinearizeFloatValueFast(QVector<qreal> &Value) const
 {
+    ensureLoaded();
     if (d->shared->lcmsProfile)
         d->shared->lcmsProfile->DelinearizeFloatValueFast(Value);
 }
 
 QByteArray IccColorProfile::uniqueId() const
 {
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->uniqueId;
+    }
+
     QByteArray dummy;
     if (d->shared->lcmsProfile) {
         dummy = d->shared->lcmsProfile->getProfileUniqueId();
@@ -283,6 +368,11 @@ QByteArray IccColorProfile::uniqueId() const
 
 bool IccColorProfile::load()
 {
+    if (d->shared->needsLazyLoading.load()) {
+        ensureLoaded();
+        return d->shared->lcmsProfile && d->shared->lcmsProfile->valid();
+    }
+
     QFile file(fileName());
     file.open(QIODevice::ReadOnly);
     QByteArray rawData = file.readAll();
@@ -302,14 +392,23 @@ bool IccColorProfile::save()
 
 bool IccColorProfile::init()
 {
-    if (!d->shared->lcmsProfile) {
-        d->shared->lcmsProfile.reset(new LcmsColorProfileContainer(d->shared->data.data()));
-    }
-    if (d->shared->lcmsProfile->init()) {
+    if (initLcmsProfile()) {
         setName(d->shared->lcmsProfile->name());
         setInfo(d->shared->lcmsProfile->info());
         setManufacturer(d->shared->lcmsProfile->manufacturer());
         setCopyright(d->shared->lcmsProfile->copyright());
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool IccColorProfile::initLcmsProfile() const
+{
+    if (!d->shared->lcmsProfile) {
+        d->shared->lcmsProfile.reset(new LcmsColorProfileContainer(d->shared->data.data()));
+    }
+    if (d->shared->lcmsProfile->init()) {
         if (d->shared->lcmsProfile->valid()) {
             calculateFloatUIMinMax();
         }
@@ -319,8 +418,82 @@ bool IccColorProfile::init()
     }
 }
 
+void IccColorProfile::ensureLoaded() const
+{
+    if (!d->shared->needsLazyLoading.loadAcquire()) return;
+
+    QMutexLocker l(&d->shared->lazyLoadingMutex);
+    if (!d->shared->needsLazyLoading.load()) return;
+
+    /**
+     * The name and other strings are already set from the metadata,
+     * so we should only initialize the shared lcms part here. The
+     * profile is shared between all the clones, so the loading is
+     * done only once.
+     */
+    QFile file(fileName());
+    if (file.open(QIODevice::ReadOnly)) {
+        d->shared->data->setRawData(file.readAll());
+        file.close();
+    }
+
+    if (!initLcmsProfile() || !d->shared->lcmsProfile->valid()) {
+        qWarning() << "Failed to lazily load profile from" << fileName();
+        d->shared->metadataIsActual.storeRelease(0);
+    } else if (d->shared->lcmsProfile->getProfileUniqueId() != d->shared->metadata->uniqueId) {
+        qWarning() << "Profile" << fileName() << "has changed since it was indexed";
+        d->shared->metadataIsActual.storeRelease(0);
+    }
+
+    d->shared->needsLazyLoading.storeRelease(0);
+}
+
+quint32 IccColorProfile::colorSpaceSignature() const
+{
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return indexed->colorSpaceSignature;
+    }
+    if (d->shared->lcmsProfile) {
+        return d->shared->lcmsProfile->colorSpaceSignature();
+    }
+    return 0;
+}
+
+IccColorProfile::Metadata IccColorProfile::metadata() const
+{
+    if (const Metadata *indexed = d->shared->indexMetadata()) {
+        return *indexed;
+    }
+
+    Metadata metadata;
+    metadata.name = name();
+    metadata.info = info();
+    metadata.manufacturer = manufacturer();
+    metadata.copyright = copyright();
+
+    if (d->shared->lcmsProfile) {
+        metadata.uniqueId = uniqueId();
+        metadata.colorSpaceSignature = colorSpaceSignature();
+        metadata.version = version();
+        metadata.valid = valid();
+        metadata.isSuitableForOutput = isSuitableForOutput();
+        metadata.isSuitableForPrinting = isSuitableForPrinting();
+        metadata.isSuitableForDisplay = isSuitableForDisplay();
+        metadata.supportsPerceptual = supportsPerceptual();
+        metadata.supportsSaturation = supportsSaturation();
+        metadata.supportsAbsolute = supportsAbsolute();
+        metadata.supportsRelative = supportsRelative();
+        metadata.hasColorants = hasColorants();
+        metadata.hasTRC = hasTRC();
+        metadata.isLinear = isLinear();
+    }
+
+    return metadata;
+}
+
 LcmsColorProfileContainer *IccColorProfile::asLcms() const
 {
+    ensureLoaded();
     Q_ASSERT(d->shared->lcmsProfile);
     return d->shared->lcmsProfile.data();
 }
@@ -336,11 +509,12 @@ bool IccColorProfile::operator==(const KoColorProfile &rhs) const
 
 const QVector<KoChannelInfo::DoubleRange> &IccColorProfile::getFloatUIMinMax(void) const
 {
+    ensureLoaded();
     Q_ASSERT(!d->shared->uiMinMaxes.isEmpty());
     return d->shared->uiMinMaxes;
 }
 
-void IccColorProfile::calculateFloatUIMinMax(void)
+void IccColorProfile::calculateFloatUIMinMax(void) const
 {
     QVector<KoChannelInfo::DoubleRange> &ret = d->shared->uiMinMaxes;
 
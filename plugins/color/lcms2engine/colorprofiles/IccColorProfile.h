@@ -76,10 +76,46 @@ public:
         virtual QVector <double> getEstimatedTRC() const = 0;
         virtual QByteArray getProfileUniqueId() const = 0;
     };
+
+    /**
+     * The properties of the profile needed to register it in the color
+     * space registry and to list it in the UI. They are stored in the
+     * profile index (see IccColorProfileIndex), so that the profile is
+     * parsed by lcms only when some color space actually uses it.
+     */
+    struct Metadata {
+        QString name;
+        QString info;
+        QString manufacturer;
+        QString copyright;
+        QByteArray uniqueId;
+        quint32 colorSpaceSignature = 0;
+        float version = 0.0;
+        bool valid = false;
+        bool isSuitableForOutput = false;
+        bool isSuitableForPrinting = false;
+        bool isSuitableForDisplay = false;
+        bool supportsPerceptual = false;
+        bool supportsSaturation = false;
+        bool supportsAbsolute = false;
+        bool supportsRelative = false;
+        bool hasColorants = false;
+        bool hasTRC = false;
+        bool isLinear = false;
+    };
+
 public:
 
     explicit IccColorProfile(const QString &fileName = QString());
     explicit IccColorProfile(const QByteArray &rawData);
+
+    /**
+     * Creates a profile that is loaded from \p fileName lazily, when
+     * its data is accessed for the first time. All the properties
+     * stored in \p metadata are available without loading the file.
+     */
+    IccColorProfile(const QString &fileName, const Metadata &metadata);
+
     IccColorProfile(const IccColorProfile &rhs);
     ~IccColorProfile() override;
 
@@ -114,6 +150,18 @@ public:
     void linearizeFloatValueFast(QVector <qreal> & Value) const override;
     void delinearizeFloatValueFast(QVector <qreal> & Value) const override;
     QByteArray uniqueId() const override;
+
+    /**
+     * @return the ICC color space signature of the profile
+     */
+    quint32 colorSpaceSignature() const;
+
+    /**
+     * @return the properties of the profile that are stored in the
+     * profile index
+     */
+    Metadata metadata() const;
+
     bool operator==(const KoColorProfile &) const override;
     QString type() const override
     {
@@ -135,7 +183,10 @@ public:
     LcmsColorProfileContainer *asLcms() const;
 protected:
     bool init();
-    void calculateFloatUIMinMax(void);
+    void calculateFloatUIMinMax(void) const;
+private:
+    bool initLcmsProfile() const;
+    void ensureLoaded() const;
 private:
     struct Private;
     QScopedPointer<Private> d;
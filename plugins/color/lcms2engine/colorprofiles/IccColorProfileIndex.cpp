@@ -0,0 +1,234 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "IccColorProfileIndex.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+
+#include <QDebug>
+
+#include "IccColorProfile.h"
+
+namespace {
+
+const quint32 indexMagic = 0x4b494349; // "KICI"
+const quint32 indexVersion = 1;
+
+struct IndexEntry {
+    qint64 lastModified = 0;
+    qint64 size = 0;
+    IccColorProfile::Metadata metadata;
+};
+
+QDataStream &operator<<(QDataStream &stream, const IccColorProfile::Metadata &metadata)
+{
+    stream << metadata.name
+           << metadata.info
+           << metadata.manufacturer
+           << metadata.copyright
+           << metadata.uniqueId
+           << metadata.colorSpaceSignature
+           << metadata.version
+           << metadata.valid
+           << metadata.isSuitableForOutput
+           << metadata.isSuitableForPrinting
+           << metadata.isSuitableForDisplay
+           << metadata.supportsPerceptual
+           << metadata.supportsSaturation
+           << metadata.supportsAbsolute
+           << metadata.supportsRelative
+           << metadata.hasColorants
+           << metadata.hasTRC
+           << metadata.isLinear;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, IccColorProfile::Metadata &metadata)
+{
+    stream >> metadata.name
+           >> metadata.info
+           >> metadata.manufacturer
+           >> metadata.copyright
+           >> metadata.uniqueId
+           >> metadata.colorSpaceSignature
+           >> metadata.version
+           >> metadata.valid
+           >> metadata.isSuitableForOutput
+           >> metadata.isSuitableForPrinting
+           >> metadata.isSuitableForDisplay
+           >> metadata.supportsPerceptual
+           >> metadata.supportsSaturation
+           >> metadata.supportsAbsolute
+           >> metadata.supportsRelative
+           >> metadata.hasColorants
+           >> metadata.hasTRC
+           >> metadata.isLinear;
+    return stream;
+}
+
+}
+
+struct IccColorProfileIndex::Private
+{
+    QString indexFileName;
+    QHash<QString, IndexEntry> entries;
+    QSet<QString> usedFileNames;
+    bool isDirty = false;
+    int numParsedProfiles = 0;
+};
+
+IccColorProfileIndex::IccColorProfileIndex(const QString &indexFileName)
+    : d(new Private)
+{
+    d->indexFileName = indexFileName;
+}
+
+IccColorProfileIndex::~IccColorProfileIndex()
+{
+}
+
+void IccColorProfileIndex::load()
+{
+    d->entries.clear();
+    d->usedFileNames.clear();
+    d->isDirty = true;
+
+    QFile file(d->indexFileName);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != indexMagic || version != indexVersion) return;
+
+    quint32 numEntries = 0;
+    stream >> numEntries;
+
+    QHash<QString, IndexEntry> entries;
+
+    for (quint32 i = 0; i < numEntries && stream.status() == QDataStream::Ok; i++) {
+        QString fileName;
+        IndexEntry entry;
+        stream >> fileName >> entry.lastModified >> entry.size >> entry.metadata;
+        entries.insert(fileName, entry);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Failed to read the color profile index" << d->indexFileName;
+        return;
+    }
+
+    d->entries = entries;
+    d->isDirty = false;
+}
+
+bool IccColorProfileIndex::save()
+{
+    /**
+     * The profiles that were not requested after loading the index
+     * are not installed anymore, so their entries should be dropped
+     */
+    for (auto it = d->entries.begin(); it != d->entries.end();) {
+        if (!d->usedFileNames.contains(it.key())) {
+            it = d->entries.erase(it);
+            d->isDirty = true;
+        } else {
+            ++it;
+        }
+    }
+
+    if (!d->isDirty) return true;
+
+    QSaveFile file(d->indexFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open the color profile index for writing" << d->indexFileName;
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << indexMagic << indexVersion << quint32(d->entries.size());
+
+    for (auto it = d->entries.constBegin(); it != d->entries.constEnd(); ++it) {
+        stream << it.key() << it->lastModified << it->size << it->metadata;
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Failed to write the color profile index" << d->indexFileName;
+        return false;
+    }
+
+    d->isDirty = false;
+    return true;
+}
+
+IccColorProfile *IccColorProfileIndex::createProfile(const QString &fileName)
+{
+    const QFileInfo info(fileName);
+    const qint64 lastModified = info.lastModified().toMSecsSinceEpoch();
+    const qint64 size = info.size();
+
+    d->usedFileNames.insert(fileName);
+
+    auto it = d->entries.constFind(fileName);
+    if (it != d->entries.constEnd() &&
+        it->lastModified == lastModified &&
+        it->size == size) {
+
+        return it->metadata.valid ? new IccColorProfile(fileName, it->metadata) : 0;
+    }
+
+    d->numParsedProfiles++;
+
+    IccColorProfile *profile = new IccColorProfile(fileName);
+    profile->load();
+
+    IndexEntry entry;
+    entry.lastModified = lastModified;
+    entry.size = size;
+    entry.metadata = profile->metadata();
+
+    /**
+     * Invalid profiles are stored in the index as well, so that we
+     * would not try to parse them on every start
+     */
+    d->entries.insert(fileName, entry);
+    d->isDirty = true;
+
+    if (!entry.metadata.valid) {
+        delete profile;
+        profile = 0;
+    }
+
+    return profile;
+}
+
+int IccColorProfileIndex::numParsedProfiles() const
+{
+    return d->numParsedProfiles;
+}
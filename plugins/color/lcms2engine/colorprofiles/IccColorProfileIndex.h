@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef ICCCOLORPROFILEINDEX_H
+#define ICCCOLORPROFILEINDEX_H
+
+#include <QScopedPointer>
+#include <QString>
+
+class IccColorProfile;
+
+/**
+ * A persistent index of the ICC profiles installed in the system. For
+ * every profile file it stores its modification time, size and the
+ * metadata needed to register the profile in the color space registry.
+ *
+ * The profiles whose files have not changed since the index was saved
+ * are created in lazy mode, that is, they are parsed by lcms only when
+ * some color space actually uses them. New and changed files are parsed
+ * right away and their entries are updated, so the index is rebuilt
+ * incrementally.
+ */
+class IccColorProfileIndex
+{
+public:
+    explicit IccColorProfileIndex(const QString &indexFileName);
+    ~IccColorProfileIndex();
+
+    /**
+     * Reads the index from the disk. A missing or incompatible index
+     * file is not an error, the index is just rebuilt from scratch.
+     */
+    void load();
+
+    /**
+     * Writes the index back to the disk, if it has been changed. The
+     * entries for the files that have not been requested with
+     * createProfile() since load() are dropped.
+     */
+    bool save();
+
+    /**
+     * Creates a profile for \p fileName. The returned profile is lazy
+     * if the file is present in the index and has not changed.
+     *
+     * @return the new profile or null if the file doesn't contain
+     *         a valid profile
+     */
+    IccColorProfile *createProfile(const QString &fileName);
+
+    /**
+     * @return the number of profiles that have been parsed by
+     *         createProfile() because they were not found in the index
+     */
+    int numParsedProfiles() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> d;
+};
+
+#endif // ICCCOLORPROFILEINDEX_H
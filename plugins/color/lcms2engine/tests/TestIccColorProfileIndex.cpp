@@ -0,0 +1,182 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "TestIccColorProfileIndex.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <IccColorProfile.h>
+#include <IccColorProfileIndex.h>
+#include <LcmsColorProfileContainer.h>
+
+
+void TestIccColorProfileIndex::testLazyProfile()
+{
+    QTemporaryDir dir;
+    const QString indexFileName = dir.path() + "/profiles.index";
+    const QString profileFileName = dir.path() + "/profile.icc";
+    QVERIFY(QFile::copy(QString(FILES_DATA_DIR) + "ACES-elle-V4-g10.icc", profileFileName));
+
+    IccColorProfile::Metadata referenceMetadata;
+
+    {
+        IccColorProfileIndex index(indexFileName);
+        index.load();
+
+        QScopedPointer<IccColorProfile> profile(index.createProfile(profileFileName));
+        QVERIFY(profile);
+        QCOMPARE(index.numParsedProfiles(), 1);
+        QVERIFY(index.save());
+
+        referenceMetadata = profile->metadata();
+        QVERIFY(referenceMetadata.valid);
+        QVERIFY(!referenceMetadata.name.isEmpty());
+    }
+
+    IccColorProfileIndex index(indexFileName);
+    index.load();
+
+    QScopedPointer<IccColorProfile> profile(index.createProfile(profileFileName));
+    QVERIFY(profile);
+    QCOMPARE(index.numParsedProfiles(), 0);
+
+    QVERIFY(profile->valid());
+    QCOMPARE(profile->name(), referenceMetadata.name);
+    QCOMPARE(profile->uniqueId(), referenceMetadata.uniqueId);
+    QCOMPARE(profile->colorSpaceSignature(), referenceMetadata.colorSpaceSignature);
+    QCOMPARE(profile->isSuitableForOutput(), referenceMetadata.isSuitableForOutput);
+
+    // the data that is not in the index is loaded on the first access
+    QCOMPARE(profile->rawData().size(), 1072);
+    QVERIFY(profile->asLcms()->valid());
+    QCOMPARE(profile->asLcms()->getProfileUniqueId(), referenceMetadata.uniqueId);
+
+    // the clones share the lazily loaded data
+    QScopedPointer<KoColorProfile> clone(profile->clone());
+    QCOMPARE(clone->rawData(), profile->rawData());
+}
+
+void TestIccColorProfileIndex::testChangedFile()
+{
+    QTemporaryDir dir;
+    const QString indexFileName = dir.path() + "/profiles.index";
+    const QString profileFileName = dir.path() + "/profile.icc";
+    QVERIFY(QFile::copy(QString(FILES_DATA_DIR) + "ACES-elle-V4-g10.icc", profileFileName));
+
+    QString oldName;
+
+    {
+        IccColorProfileIndex index(indexFileName);
+        index.load();
+
+        QScopedPointer<IccColorProfile> profile(index.createProfile(profileFileName));
+        QVERIFY(profile);
+        QVERIFY(index.save());
+
+        oldName = profile->name();
+    }
+
+    QVERIFY(QFile::remove(profileFileName));
+    QVERIFY(QFile::copy(QString(FILES_DATA_DIR) + "ClayRGB-elle-V2-g10.icc", profileFileName));
+
+    IccColorProfileIndex index(indexFileName);
+    index.load();
+
+    QScopedPointer<IccColorProfile> profile(index.createProfile(profileFileName));
+    QVERIFY(profile);
+    QCOMPARE(index.numParsedProfiles(), 1);
+    QVERIFY(profile->name() != oldName);
+}
+
+void TestIccColorProfileIndex::testFileChangedBeforeLoading()
+{
+    QTemporaryDir dir;
+    const QString indexFileName = dir.path() + "/profiles.index";
+    const QString removedFileName = dir.path() + "/removed.icc";
+    const QString changedFileName = dir.path() + "/changed.icc";
+    QVERIFY(QFile::copy(QString(FILES_DATA_DIR) + "ACES-elle-V4-g10.icc", removedFileName));
+    QVERIFY(QFile::copy(QString(FILES_DATA_DIR) + "ACES-elle-V4-g10.icc", changedFileName));
+
+    {
+        IccColorProfileIndex index(indexFileName);
+        index.load();
+
+        QVERIFY(index.createProfile(removedFileName));
+        QVERIFY(index.createProfile(changedFileName));
+        QVERIFY(index.save());
+    }
+
+    IccColorProfileIndex index(indexFileName);
+    index.load();
+
+    QScopedPointer<IccColorProfile> removedProfile(index.createProfile(removedFileName));
+    QScopedPointer<IccColorProfile> changedProfile(index.createProfile(changedFileName));
+    QVERIFY(removedProfile);
+    QVERIFY(changedProfile);
+    QCOMPARE(index.numParsedProfiles(), 0);
+
+    // the files are modified after the profiles have been registered
+    QVERIFY(QFile::remove(removedFileName));
+    QVERIFY(QFile::remove(changedFileName));
+    QVERIFY(QFile::copy(QString(FILES_DATA_DIR) + "ClayRGB-elle-V2-g10.icc", changedFileName));
+
+    // the metadata from the index is not trusted after a failed loading
+    QVERIFY(removedProfile->valid());
+    QVERIFY(removedProfile->rawData().isEmpty());
+    QVERIFY(!removedProfile->valid());
+    QVERIFY(!removedProfile->metadata().valid);
+
+    // ... and after loading of a different profile
+    QCOMPARE(changedProfile->rawData().size(), 892);
+    QVERIFY(changedProfile->valid());
+    QCOMPARE(changedProfile->uniqueId(), changedProfile->asLcms()->getProfileUniqueId());
+    QCOMPARE(changedProfile->colorSpaceSignature(), quint32(changedProfile->asLcms()->colorSpaceSignature()));
+}
+
+void TestIccColorProfileIndex::testInvalidFile()
+{
+    QTemporaryDir dir;
+    const QString indexFileName = dir.path() + "/profiles.index";
+    const QString profileFileName = dir.path() + "/broken.icc";
+
+    {
+        QFile file(profileFileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("not a profile");
+    }
+
+    {
+        IccColorProfileIndex index(indexFileName);
+        index.load();
+
+        QVERIFY(!index.createProfile(profileFileName));
+        QCOMPARE(index.numParsedProfiles(), 1);
+        QVERIFY(index.save());
+    }
+
+    // the invalid files are remembered and are not parsed again
+    IccColorProfileIndex index(indexFileName);
+    index.load();
+
+    QVERIFY(!index.createProfile(profileFileName));
+    QCOMPARE(index.numParsedProfiles(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestIccColorProfileIndex)
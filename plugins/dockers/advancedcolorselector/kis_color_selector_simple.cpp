@@ -328,6 +328,11 @@ void KisColorSelectorSimple::paint(QPainter* painter)
 }
 
 KoColor KisColorSelectorSimple::colorAt(int x, int y)
+{
+    return m_parent->converter()->approximateFromRenderedQColor(renderedColorAt(x, y));
+}
+
+QColor KisColorSelectorSimple::renderedColorAt(int x, int y)
 {
     qreal xRel = x/qreal(width());
     qreal yRel = 1.-y/qreal(height());
@@ -337,74 +342,74 @@ KoColor KisColorSelectorSimple::colorAt(int x, int y)
     else
         relPos = x/qreal(width());
 
-    KoColor color(Qt::transparent, m_parent->colorSpace());
+    QColor color(Qt::transparent);
 
     switch(m_parameter) {
     case KisColorSelectorConfiguration::SL:
-        color = m_parent->converter()->fromHslF(m_hue, xRel, yRel);
+        color = KisDisplayColorConverter::hslFToQColor(m_hue, xRel, yRel);
         break;
     case KisColorSelectorConfiguration::SV:
-        color = m_parent->converter()->fromHsvF(m_hue, xRel, yRel);
+        color = KisDisplayColorConverter::hsvFToQColor(m_hue, xRel, yRel);
         break;
     case KisColorSelectorConfiguration::SV2:
-        color = m_parent->converter()->fromHsvF(m_hue, xRel, xRel + (1.0-xRel)*yRel);
+        color = KisDisplayColorConverter::hsvFToQColor(m_hue, xRel, xRel + (1.0-xRel)*yRel);
         break;
     case KisColorSelectorConfiguration::SI:
-        color = m_parent->converter()->fromHsiF(m_hue, xRel, yRel);
+        color = KisDisplayColorConverter::hsiFToQColor(m_hue, xRel, yRel);
         break;
     case KisColorSelectorConfiguration::SY:
-        color = m_parent->converter()->fromHsyF(m_hue, xRel, yRel, R, G, B, Gamma);
+        color = KisDisplayColorConverter::hsyFToQColor(m_hue, xRel, yRel, R, G, B, Gamma);
         break;
     case KisColorSelectorConfiguration::hsvSH:
-        color = m_parent->converter()->fromHsvF(xRel, yRel, m_value);
+        color = KisDisplayColorConverter::hsvFToQColor(xRel, yRel, m_value);
         break;
     case KisColorSelectorConfiguration::hslSH:
-        color = m_parent->converter()->fromHslF(xRel, yRel, m_lightness);
+        color = KisDisplayColorConverter::hslFToQColor(xRel, yRel, m_lightness);
         break;
     case KisColorSelectorConfiguration::hsiSH:
-        color = m_parent->converter()->fromHsiF(xRel, yRel, m_intensity);
+        color = KisDisplayColorConverter::hsiFToQColor(xRel, yRel, m_intensity);
         break;
     case KisColorSelectorConfiguration::hsySH:
-        color = m_parent->converter()->fromHsyF(xRel, yRel, m_luma, R, G, B, Gamma);
+        color = KisDisplayColorConverter::hsyFToQColor(xRel, yRel, m_luma, R, G, B, Gamma);
         break;
     case KisColorSelectorConfiguration::VH:
-        color = m_parent->converter()->fromHsvF(xRel, m_hsvSaturation, yRel);
+        color = KisDisplayColorConverter::hsvFToQColor(xRel, m_hsvSaturation, yRel);
         break;
     case KisColorSelectorConfiguration::LH:
-        color = m_parent->converter()->fromHslF(xRel, m_hslSaturation, yRel);
+        color = KisDisplayColorConverter::hslFToQColor(xRel, m_hslSaturation, yRel);
         break;
     case KisColorSelectorConfiguration::IH:
-        color = m_parent->converter()->fromHsiF(xRel, m_hsiSaturation, yRel);
+        color = KisDisplayColorConverter::hsiFToQColor(xRel, m_hsiSaturation, yRel);
         break;
     case KisColorSelectorConfiguration::YH:
-        color = m_parent->converter()->fromHsyF(xRel, m_hsySaturation, yRel, R, G, B, Gamma);
+        color = KisDisplayColorConverter::hsyFToQColor(xRel, m_hsySaturation, yRel, R, G, B, Gamma);
         break;
     case KisColorSelectorConfiguration::H:
-        color = m_parent->converter()->fromHsvF(relPos, 1, 1);
+        color = KisDisplayColorConverter::hsvFToQColor(relPos, 1, 1);
         break;
     case KisColorSelectorConfiguration::hsvS:
-        color = m_parent->converter()->fromHsvF(m_hue, relPos, m_value);
+        color = KisDisplayColorConverter::hsvFToQColor(m_hue, relPos, m_value);
         break;
     case KisColorSelectorConfiguration::hslS:
-        color = m_parent->converter()->fromHslF(m_hue, relPos, m_lightness);
+        color = KisDisplayColorConverter::hslFToQColor(m_hue, relPos, m_lightness);
         break;
     case KisColorSelectorConfiguration::V:
-        color = m_parent->converter()->fromHsvF(m_hue, m_hsvSaturation, relPos);
+        color = KisDisplayColorConverter::hsvFToQColor(m_hue, m_hsvSaturation, relPos);
         break;
     case KisColorSelectorConfiguration::L:
-        color = m_parent->converter()->fromHslF(m_hue, m_hslSaturation, relPos);
+        color = KisDisplayColorConverter::hslFToQColor(m_hue, m_hslSaturation, relPos);
         break;
     case KisColorSelectorConfiguration::hsiS:
-        color = m_parent->converter()->fromHsiF(m_hue, relPos, m_intensity);
+        color = KisDisplayColorConverter::hsiFToQColor(m_hue, relPos, m_intensity);
         break;
     case KisColorSelectorConfiguration::I:
-        color = m_parent->converter()->fromHsiF(m_hue, m_hsiSaturation, relPos);
+        color = KisDisplayColorConverter::hsiFToQColor(m_hue, m_hsiSaturation, relPos);
         break;
     case KisColorSelectorConfiguration::hsyS:
-        color = m_parent->converter()->fromHsyF(m_hue, relPos, m_luma, R, G, B, Gamma);
+        color = KisDisplayColorConverter::hsyFToQColor(m_hue, relPos, m_luma, R, G, B, Gamma);
         break;
     case KisColorSelectorConfiguration::Y:
-        color = m_parent->converter()->fromHsyF(m_hue, m_hsySaturation, relPos, R, G, B, Gamma);
+        color = KisDisplayColorConverter::hsyFToQColor(m_hue, m_hsySaturation, relPos, R, G, B, Gamma);
         break;
     default:
         Q_ASSERT(false);
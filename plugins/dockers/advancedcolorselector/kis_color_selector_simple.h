@@ -45,6 +45,7 @@ protected:
 private:
     friend class Acs::PixelCacheRenderer;
     KoColor colorAt(int x, int y);
+    QColor renderedColorAt(int x, int y);
 
 private:
     QPointF m_lastClickPos;
@@ -150,6 +150,11 @@ int KisColorSelectorTriangle::triangleHeight() const
 }
 
 KoColor KisColorSelectorTriangle::colorAt(int x, int y) const
+{
+    return m_parent->converter()->approximateFromRenderedQColor(renderedColorAt(x, y));
+}
+
+QColor KisColorSelectorTriangle::renderedColorAt(int x, int y) const
 {
     Q_ASSERT(x>=0 && x<=triangleWidth());
     Q_ASSERT(y>=0 && y<=triangleHeight());
@@ -160,14 +165,14 @@ KoColor KisColorSelectorTriangle::colorAt(int x, int y) const
     int horizontalLineEnd = horizontalLineStart+horizontalLineLength;
 
     if(x<horizontalLineStart || x>horizontalLineEnd || y>triangleHeight)
-        return KoColor(Qt::transparent, colorSpace());
+        return QColor(Qt::transparent);
 
     qreal relativeX = x-horizontalLineStart;
 
     qreal value = (y)/qreal(triangleHeight);
     qreal saturation = relativeX/qreal(horizontalLineLength);
 
-    return m_parent->converter()->fromHsvF(m_hue, saturation, value);
+    return KisDisplayColorConverter::hsvFToQColor(m_hue, saturation, value);
 }
 
 QPoint KisColorSelectorTriangle::widgetToTriangleCoordinates(const QPoint &point) const
@@ -42,6 +42,7 @@ protected:
 private:
     friend class Acs::PixelCacheRenderer;
     KoColor colorAt(int x, int y) const;
+    QColor renderedColorAt(int x, int y) const;
 
 private:
     int triangleWidth() const;
@@ -254,7 +254,12 @@ void KisColorSelectorWheel::paint(QPainter* painter)
 
 KoColor KisColorSelectorWheel::colorAt(int x, int y, bool forceValid)
 {
-    KoColor color(Qt::transparent, m_parent->colorSpace());
+    return m_parent->converter()->approximateFromRenderedQColor(renderedColorAt(x, y, forceValid));
+}
+
+QColor KisColorSelectorWheel::renderedColorAt(int x, int y, bool forceValid)
+{
+    QColor color(Qt::transparent);
 
     Q_ASSERT(x>=0 && x<=width());
     Q_ASSERT(y>=0 && y<=height());
@@ -279,28 +284,28 @@ KoColor KisColorSelectorWheel::colorAt(int x, int y, bool forceValid)
 
     switch(m_parameter) {
     case KisColorSelectorConfiguration::hsvSH:
-        color = m_parent->converter()->fromHsvF(angle, radius, m_value);
+        color = KisDisplayColorConverter::hsvFToQColor(angle, radius, m_value);
         break;
     case KisColorSelectorConfiguration::hslSH:
-        color = m_parent->converter()->fromHslF(angle, radius, m_lightness);
+        color = KisDisplayColorConverter::hslFToQColor(angle, radius, m_lightness);
         break;
     case KisColorSelectorConfiguration::hsiSH:
-        color = m_parent->converter()->fromHsiF(angle, radius, m_intensity);
+        color = KisDisplayColorConverter::hsiFToQColor(angle, radius, m_intensity);
         break;
     case KisColorSelectorConfiguration::hsySH:
-        color = m_parent->converter()->fromHsyF(angle, radius, m_luma, R, G, B, Gamma);
+        color = KisDisplayColorConverter::hsyFToQColor(angle, radius, m_luma, R, G, B, Gamma);
         break;
     case KisColorSelectorConfiguration::VH:
-        color = m_parent->converter()->fromHsvF(angle, m_hsvSaturation, radius);
+        color = KisDisplayColorConverter::hsvFToQColor(angle, m_hsvSaturation, radius);
         break;
     case KisColorSelectorConfiguration::LH:
-        color = m_parent->converter()->fromHslF(angle, m_hslSaturation, radius);
+        color = KisDisplayColorConverter::hslFToQColor(angle, m_hslSaturation, radius);
         break;
     case KisColorSelectorConfiguration::IH:
-        color = m_parent->converter()->fromHsiF(angle, m_hsiSaturation, radius);
+        color = KisDisplayColorConverter::hsiFToQColor(angle, m_hsiSaturation, radius);
         break;
     case KisColorSelectorConfiguration::YH:
-        color = m_parent->converter()->fromHsyF(angle, m_hsySaturation, radius, R, G, B, Gamma);
+        color = KisDisplayColorConverter::hsyFToQColor(angle, m_hsySaturation, radius, R, G, B, Gamma);
         break;
     default:
         Q_ASSERT(false);
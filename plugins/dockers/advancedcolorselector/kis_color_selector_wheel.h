@@ -45,6 +45,7 @@ protected:
 private:
     friend class Acs::PixelCacheRenderer;
     KoColor colorAt(int x, int y, bool forceValid = false);
+    QColor renderedColorAt(int x, int y, bool forceValid = false);
 
 private:
     bool allowsColorSelectionAtPoint(const QPoint &pt) const override;
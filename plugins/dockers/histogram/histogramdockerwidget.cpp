@@ -20,7 +20,6 @@
 
 #include <QThread>
 #include <QVector>
-#include <limits>
 #include <algorithm>
 #include <QTime>
 #include <QPainter>
@@ -30,11 +29,14 @@
 #include "KoChannelInfo.h"
 #include "kis_paint_device.h"
 #include "KoColorSpace.h"
-#include "kis_iterator_ng.h"
 #include "kis_canvas2.h"
+#include "KisTileHistogramCache.h"
 
 HistogramDockerWidget::HistogramDockerWidget(QWidget *parent, const char *name, Qt::WindowFlags f)
-    : QLabel(parent, f), m_colorSpace(0), m_smoothHistogram(true)
+    : QLabel(parent, f),
+      m_histogramCache(new KisTileHistogramCache()),
+      m_colorSpace(0),
+      m_smoothHistogram(true)
 {
     setObjectName(name);
 }
@@ -53,11 +55,12 @@ void HistogramDockerWidget::updateHistogram(KisCanvas2* canvas)
         // remember to save the color space to paint the histogram data!
         m_colorSpace = paintDevice->colorSpace();
 
-        KisPaintDeviceSP m_devClone = new KisPaintDevice(paintDevice->colorSpace());
-
-        m_devClone->makeCloneFrom(paintDevice, bounds);
-
-        HistogramComputationThread *workerThread = new HistogramComputationThread(m_devClone, bounds);
+        /**
+         * The projection is not cloned: the update happens when the
+         * image is idle, and the tiles changed meanwhile are marked
+         * dirty and recounted on the next update anyway
+         */
+        HistogramComputationThread *workerThread = new HistogramComputationThread(m_histogramCache, paintDevice, bounds);
         connect(workerThread, &HistogramComputationThread::resultReady, this, &HistogramDockerWidget::receiveNewHistogram);
         connect(workerThread, &HistogramComputationThread::finished, workerThread, &QObject::deleteLater);
         workerThread->start();
@@ -67,6 +70,11 @@ void HistogramDockerWidget::updateHistogram(KisCanvas2* canvas)
     }
 }
 
+void HistogramDockerWidget::setDirty(const QRect &rc)
+{
+    m_histogramCache->setDirty(rc);
+}
+
 void HistogramDockerWidget::receiveNewHistogram(HistVector *histogramData)
 {
     m_histogramData = *histogramData;
@@ -153,41 +161,17 @@ void HistogramDockerWidget::paintEvent(QPaintEvent *event)
 
 void HistogramComputationThread::run()
 {
-    const KoColorSpace *cs = m_dev->colorSpace();
-    quint32 channelCount = m_dev->channelCount();
-    quint32 pixelSize = m_dev->pixelSize();
-
-    quint32 imageSize = m_bounds.width() * m_bounds.height();
-    quint32 nSkip = 1 + (imageSize >> 20); //for speed use about 1M pixels for computing histograms
-
-    //allocate space for the histogram data
-    bins.resize((int)channelCount);
-    for (auto &bin : bins) {
-        bin.resize(std::numeric_limits<quint8>::max() + 1);
-    }
-
-    QRect bounds = m_dev->exactBounds();
-    if (bounds.isEmpty())
+    if (m_bounds.isEmpty())
         return;
 
-    quint32 toSkip = nSkip;
-
-    KisSequentialConstIterator it(m_dev, m_dev->exactBounds());
+    m_cache->update(m_dev, m_bounds);
 
-    int numConseqPixels = it.nConseqPixels();
-    while (it.nextPixels(numConseqPixels)) {
+    const int channelCount = m_cache->channelCount();
 
-        numConseqPixels = it.nConseqPixels();
-        const quint8* pixel = it.rawDataConst();
-        for (int k = 0; k < numConseqPixels; ++k) {
-            if (--toSkip == 0) {
-                for (int chan = 0; chan < (int)channelCount; ++chan) {
-                    bins[chan][cs->scaleToU8(pixel, chan)]++;
-                }
-                toSkip = nSkip;
-            }
-            pixel += pixelSize;
-        }
+    bins.resize(channelCount);
+    for (int chan = 0; chan < channelCount; ++chan) {
+        const QVector<quint32> channelBins = m_cache->channelBins(chan);
+        bins[chan].assign(channelBins.constBegin(), channelBins.constEnd());
     }
 
     emit resultReady(&bins);
@@ -24,11 +24,13 @@
 #include <QWidget>
 #include <QLabel>
 #include <QThread>
+#include <QSharedPointer>
 #include "kis_types.h"
 #include <vector>
 
 class KisCanvas2;
 class KoColorSpace;
+class KisTileHistogramCache;
 
 typedef std::vector<std::vector<quint32> > HistVector; //Don't use QVector here - it's too slow for this purpose
 
@@ -37,7 +39,8 @@ class HistogramComputationThread : public QThread
 {
     Q_OBJECT
 public:
-    HistogramComputationThread(KisPaintDeviceSP _dev, const QRect& _bounds) : m_dev(_dev), m_bounds(_bounds)
+    HistogramComputationThread(QSharedPointer<KisTileHistogramCache> _cache, KisPaintDeviceSP _dev, const QRect& _bounds)
+        : m_cache(_cache), m_dev(_dev), m_bounds(_bounds)
     {}
 
     void run() override;
@@ -46,6 +49,7 @@ Q_SIGNALS:
     void resultReady(HistVector*);
 
 private:
+    QSharedPointer<KisTileHistogramCache> m_cache;
     KisPaintDeviceSP m_dev;
     QRect m_bounds;
     HistVector bins;
@@ -73,7 +77,14 @@ public Q_SLOTS:
     void updateHistogram(KisCanvas2* canvas);
     void receiveNewHistogram(HistVector*);
 
+    /**
+     * @brief setDirty marks the area of the image that should be
+     * recounted on the next update of the histogram
+     */
+    void setDirty(const QRect &rc);
+
 private:
+    QSharedPointer<KisTileHistogramCache> m_histogramCache;
     HistVector m_histogramData;
     const KoColorSpace* m_colorSpace;
     bool m_smoothHistogram;
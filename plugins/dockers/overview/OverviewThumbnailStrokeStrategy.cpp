@@ -19,6 +19,9 @@
 
 #include "OverviewThumbnailStrokeStrategy.h"
 
+#include <QMutexLocker>
+#include <QPainter>
+
 #include <kis_paint_device.h>
 #include <kis_painter.h>
 #include "krita_utils.h"
@@ -30,11 +33,46 @@
 const qreal oversample = 2.;
 const int thumbnailTileDim = 128;
 
+/**
+ * The margin of the oversampled pixels around a patch that is taken
+ * into account when the patch is scaled down, it should be bigger than
+ * the support of the scaling filter
+ */
+const int scaleMargin = 8;
+
+const int maxDirtyRects = 4096;
+
+
+void OverviewThumbnailCache::setDirty(const QRect &rc)
+{
+    QMutexLocker l(&m_dirtyLock);
+    if (m_allDirty) return;
+
+    /**
+     * When the overview is hidden, the rects are never consumed, so
+     * don't let them grow infinitely
+     */
+    if (m_dirtyRects.size() >= maxDirtyRects) {
+        m_allDirty = true;
+        m_dirtyRects.clear();
+        return;
+    }
+
+    m_dirtyRects.append(rc);
+}
+
+void OverviewThumbnailCache::reset()
+{
+    QMutexLocker l(&m_dirtyLock);
+    m_allDirty = true;
+    m_dirtyRects.clear();
+}
+
 
-class OverviewThumbnailStrokeStrategy::ProcessData : public KisStrokeJobData
+class OverviewThumbnailStrokeStrategy::SampleData : public KisStrokeJobData
 {
 public:
-    ProcessData(const QRect &_rect)
+    SampleData(const QRect &_rect)
         : KisStrokeJobData(CONCURRENT),
           tileRect(_rect)
     {}
@@ -42,8 +80,20 @@ public:
     QRect tileRect;
 };
 
-OverviewThumbnailStrokeStrategy::OverviewThumbnailStrokeStrategy(KisPaintDeviceSP device, const QRect& rect, const QSize& thumbnailSize, bool isPixelArt)
+class OverviewThumbnailStrokeStrategy::ScaleData : public KisStrokeJobData
+{
+public:
+    ScaleData(const QRect &_rect, bool isFirst)
+        : KisStrokeJobData(isFirst ? BARRIER : CONCURRENT),
+          tileRect(_rect)
+    {}
+
+    QRect tileRect;
+};
+
+OverviewThumbnailStrokeStrategy::OverviewThumbnailStrokeStrategy(OverviewThumbnailCacheSP cache, KisPaintDeviceSP device, const QRect& rect, const QSize& thumbnailSize, bool isPixelArt)
     : KisSimpleStrokeStrategy(QLatin1String("OverviewThumbnail")),
+      m_cache(cache),
       m_device(device),
       m_rect(rect),
       m_thumbnailSize(thumbnailSize),
@@ -90,13 +140,87 @@ void OverviewThumbnailStrokeStrategy::initStrokeCallback()
         m_thumbnailOversampledSize.scale(imageRect.size(), Qt::KeepAspectRatio);
     }
 
-    m_thumbnailDevice = new KisPaintDevice(m_device->colorSpace());
+    QVector<QRect> dirtyRects;
+    bool allDirty = false;
 
-    QVector<KisStrokeJobData*> jobsData;
+    {
+        QMutexLocker l(&m_cache->m_dirtyLock);
+        dirtyRects.swap(m_cache->m_dirtyRects);
+        allDirty = m_cache->m_allDirty;
+        m_cache->m_allDirty = false;
+    }
+
+    if (allDirty ||
+        !m_cache->m_device.isValid() ||
+        m_cache->m_device != m_device.data() ||
+        m_cache->m_colorSpace != m_device->colorSpace() ||
+        m_cache->m_imageRect != imageRect ||
+        m_cache->m_thumbnailSize != m_thumbnailSize ||
+        m_cache->m_thumbnailOversampledSize != m_thumbnailOversampledSize ||
+        m_cache->m_isPixelArt != m_isPixelArt ||
+        !m_cache->m_oversampledDevice) {
+
+        m_cache->m_device = m_device;
+        m_cache->m_colorSpace = m_device->colorSpace();
+        m_cache->m_imageRect = imageRect;
+        m_cache->m_thumbnailSize = m_thumbnailSize;
+        m_cache->m_thumbnailOversampledSize = m_thumbnailOversampledSize;
+        m_cache->m_isPixelArt = m_isPixelArt;
 
-    QVector<QRect> tileRects = KritaUtils::splitRectIntoPatches(QRect(QPoint(0, 0), m_thumbnailOversampledSize), QSize(thumbnailTileDim, thumbnailTileDim));
+        m_cache->m_oversampledDevice = new KisPaintDevice(m_device->colorSpace());
+        m_cache->m_image = QImage(m_thumbnailSize, QImage::Format_ARGB32);
+        m_cache->m_image.fill(Qt::transparent);
+
+        allDirty = true;
+    }
+
+    if (imageRect.isEmpty() || m_thumbnailOversampledSize.isEmpty()) return;
+
+    const QRect oversampledRect(QPoint(0, 0), m_thumbnailOversampledSize);
+    const qreal xscale = qreal(m_thumbnailOversampledSize.width()) / imageRect.width();
+    const qreal yscale = qreal(m_thumbnailOversampledSize.height()) / imageRect.height();
+
+    QVector<QRect> dirtyOversampledRects;
+    Q_FOREACH (const QRect &rc, dirtyRects) {
+        const QRectF mappedRect((rc.x() - imageRect.x()) * xscale, (rc.y() - imageRect.y()) * yscale,
+                                rc.width() * xscale, rc.height() * yscale);
+        dirtyOversampledRects << (mappedRect.toAlignedRect().adjusted(-1, -1, 1, 1) & oversampledRect);
+    }
+
+    QVector<QRect> dirtyTileRects;
+
+    QVector<QRect> tileRects = KritaUtils::splitRectIntoPatches(oversampledRect, QSize(thumbnailTileDim, thumbnailTileDim));
     Q_FOREACH (const QRect &tileRect, tileRects) {
-        jobsData << new OverviewThumbnailStrokeStrategy::ProcessData(tileRect);
+        bool isDirty = allDirty;
+
+        for (auto it = dirtyOversampledRects.constBegin(); !isDirty && it != dirtyOversampledRects.constEnd(); ++it) {
+            isDirty = it->intersects(tileRect);
+        }
+
+        if (isDirty) {
+            dirtyTileRects << tileRect;
+        }
+    }
+
+    if (dirtyTileRects.isEmpty()) return;
+
+    m_thumbnailChanged = true;
+
+    /**
+     * First resample the dirty patches of the oversampled copy of the
+     * projection, then, after a barrier, scale the patches down. Scaling
+     * reads the neighbouring patches, so it should not start earlier.
+     */
+    QVector<KisStrokeJobData*> jobsData;
+
+    Q_FOREACH (const QRect &tileRect, dirtyTileRects) {
+        jobsData << new OverviewThumbnailStrokeStrategy::SampleData(tileRect);
+    }
+
+    bool isFirst = true;
+    Q_FOREACH (const QRect &tileRect, dirtyTileRects) {
+        jobsData << new OverviewThumbnailStrokeStrategy::ScaleData(tileRect, isFirst);
+        isFirst = false;
     }
 
     addMutatedJobs(jobsData);
@@ -104,32 +228,53 @@ void OverviewThumbnailStrokeStrategy::initStrokeCallback()
 
 void OverviewThumbnailStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
 {
-    ProcessData *d_pd = dynamic_cast<ProcessData*>(data);
-    if (d_pd) {
+    SampleData *d_sd = dynamic_cast<SampleData*>(data);
+    ScaleData *d_scd = dynamic_cast<ScaleData*>(data);
+
+    if (d_sd) {
         //we aren't going to use oversample capability of createThumbnailDevice because it recomputes exact bounds for each small patch, which is
         //slow. We'll handle scaling separately.
-        KisPaintDeviceSP thumbnailTile = m_device->createThumbnailDeviceOversampled(m_thumbnailOversampledSize.width(), m_thumbnailOversampledSize.height(), 1, m_device->defaultBounds()->bounds(), d_pd->tileRect);
-        KisPainter::copyAreaOptimized(d_pd->tileRect.topLeft(), thumbnailTile, m_thumbnailDevice, d_pd->tileRect);
+        KisPaintDeviceSP thumbnailTile = m_device->createThumbnailDeviceOversampled(m_thumbnailOversampledSize.width(), m_thumbnailOversampledSize.height(), 1, m_device->defaultBounds()->bounds(), d_sd->tileRect);
+        KisPainter::copyAreaOptimized(d_sd->tileRect.topLeft(), thumbnailTile, m_cache->m_oversampledDevice, d_sd->tileRect);
+
+    } else if (d_scd) {
+        const QRect oversampledRect(QPoint(0, 0), m_thumbnailOversampledSize);
+        const QRect srcRect = d_scd->tileRect.adjusted(-scaleMargin, -scaleMargin, scaleMargin, scaleMargin) & oversampledRect;
+
+        KisPaintDeviceSP scaledTile = new KisPaintDevice(m_device->colorSpace());
+        KisPainter::copyAreaOptimized(srcRect.topLeft(), m_cache->m_oversampledDevice, scaledTile, srcRect);
+
+        KoDummyUpdater updater;
+        const qreal xscale = m_thumbnailSize.width() / (qreal)m_thumbnailOversampledSize.width();
+        const qreal yscale = m_thumbnailSize.height() / (qreal)m_thumbnailOversampledSize.height();
+        QString algorithm = m_isPixelArt ? "Box" : "Bilinear";
+        KisTransformWorker worker(scaledTile, xscale, yscale, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                                  &updater, KisFilterStrategyRegistry::instance()->value(algorithm));
+        worker.run();
+
+        const QRectF mappedRect(d_scd->tileRect.x() * xscale, d_scd->tileRect.y() * yscale,
+                                d_scd->tileRect.width() * xscale, d_scd->tileRect.height() * yscale);
+        const QRect dstRect = mappedRect.toAlignedRect() & QRect(QPoint(0, 0), m_thumbnailSize);
+        if (dstRect.isEmpty()) return;
+
+        QImage tileImage = scaledTile->convertToQImage(KoColorSpaceRegistry::instance()->rgb8()->profile(), dstRect);
+
+        QMutexLocker l(&m_imageLock);
+        QPainter gc(&m_cache->m_image);
+        gc.setCompositionMode(QPainter::CompositionMode_Source);
+        gc.drawImage(dstRect.topLeft(), tileImage);
     }
 }
 
 void OverviewThumbnailStrokeStrategy::finishStrokeCallback()
 {
-    QImage overviewImage;
-
-    KoDummyUpdater updater;
-    qreal xscale = m_thumbnailSize.width() / (qreal)m_thumbnailOversampledSize.width();
-    qreal yscale = m_thumbnailSize.height() / (qreal)m_thumbnailOversampledSize.height();
-    QString algorithm = m_isPixelArt ? "Box" : "Bilinear";
-    KisTransformWorker worker(m_thumbnailDevice, yscale, xscale, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
-                              &updater, KisFilterStrategyRegistry::instance()->value(algorithm));
-    worker.run();
-
-    overviewImage = m_thumbnailDevice->convertToQImage(KoColorSpaceRegistry::instance()->rgb8()->profile(),
-                                                       QRect(QPoint(0,0), m_thumbnailSize));
-    emit thumbnailUpdated(overviewImage);
+    if (!m_thumbnailChanged) return;
+
+    emit thumbnailUpdated(m_cache->m_image);
 }
 
 void OverviewThumbnailStrokeStrategy::cancelStrokeCallback()
 {
+    // the patches that were not regenerated should be regenerated next time
+    m_cache->reset();
 }
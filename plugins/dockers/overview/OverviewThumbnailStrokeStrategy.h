@@ -24,16 +24,63 @@
 #include <QRect>
 #include <QSize>
 #include <QImage>
+#include <QMutex>
+#include <QVector>
+#include <QSharedPointer>
 
 #include "kis_types.h"
 #include "kis_simple_stroke_strategy.h"
 
+class KoColorSpace;
+
+/**
+ * The state of the overview kept between the thumbnail strokes: the
+ * oversampled low-resolution copy of the projection and the final
+ * thumbnail. The overview widget reports the updated areas of the
+ * image with setDirty(), and the next stroke resamples and rescales
+ * only the patches of the thumbnail that cover them.
+ */
+class OverviewThumbnailCache
+{
+public:
+    /**
+     * Marks \p rc (in image coordinates) for regeneration. Can be
+     * called from any thread.
+     */
+    void setDirty(const QRect &rc);
+
+    /**
+     * Marks the whole thumbnail for regeneration
+     */
+    void reset();
+
+private:
+    friend class OverviewThumbnailStrokeStrategy;
+
+    QMutex m_dirtyLock;
+    QVector<QRect> m_dirtyRects;
+    bool m_allDirty {true};
+
+    // accessed by the thumbnail stroke only
+    KisPaintDeviceWSP m_device;
+    const KoColorSpace *m_colorSpace {0};
+    QRect m_imageRect;
+    QSize m_thumbnailSize;
+    QSize m_thumbnailOversampledSize;
+    bool m_isPixelArt {false};
+
+    KisPaintDeviceSP m_oversampledDevice;
+    QImage m_image;
+};
+
+typedef QSharedPointer<OverviewThumbnailCache> OverviewThumbnailCacheSP;
+
 
 class OverviewThumbnailStrokeStrategy : public QObject, public KisSimpleStrokeStrategy
 {
     Q_OBJECT
 public:
-    OverviewThumbnailStrokeStrategy(KisPaintDeviceSP device, const QRect& rect, const QSize& thumbnailSize, bool isPixelArt = false);
+    OverviewThumbnailStrokeStrategy(OverviewThumbnailCacheSP cache, KisPaintDeviceSP device, const QRect& rect, const QSize& thumbnailSize, bool isPixelArt = false);
     ~OverviewThumbnailStrokeStrategy() override;
 
     KisStrokeStrategy* createLodClone(int levelOfDetail) override;
@@ -50,14 +97,17 @@ Q_SIGNALS:
 
 
 private:
-    class ProcessData;
+    class SampleData;
+    class ScaleData;
 
+    OverviewThumbnailCacheSP m_cache;
     KisPaintDeviceSP m_device;
     QRect m_rect;
     QSize m_thumbnailSize;
     QSize m_thumbnailOversampledSize;
     bool m_isPixelArt {false};
-    KisPaintDeviceSP m_thumbnailDevice;
+    bool m_thumbnailChanged {false};
+    QMutex m_imageLock;
 };
 
 #endif // OVERVIEWTHUMBNAILSTROKESTRATEGY_H
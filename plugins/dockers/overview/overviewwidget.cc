@@ -42,6 +42,7 @@ OverviewWidget::OverviewWidget(QWidget * parent)
     , m_canvas(0)
     , m_dragging(false)
     , m_imageIdleWatcher(250)
+    , m_thumbnailCache(new OverviewThumbnailCache())
 {
     setMouseTracking(true);
     KisConfig cfg(true);
@@ -66,7 +67,7 @@ void OverviewWidget::setCanvas(KoCanvasBase * canvas)
 
         connect(&m_imageIdleWatcher, &KisIdleWatcher::startedIdleMode, this, &OverviewWidget::generateThumbnail);
 
-        connect(m_canvas->image(), SIGNAL(sigImageUpdated(QRect)),SLOT(startUpdateCanvasProjection()));
+        connect(m_canvas->image(), SIGNAL(sigImageUpdated(QRect)),SLOT(slotImageUpdated(QRect)));
         connect(m_canvas->image(), SIGNAL(sigSizeChanged(QPointF,QPointF)),SLOT(startUpdateCanvasProjection()));
 
         connect(m_canvas->canvasController()->proxyObject, SIGNAL(canvasOffsetXChanged(int)), this, SLOT(update()), Qt::UniqueConnection);
@@ -131,6 +132,12 @@ void OverviewWidget::startUpdateCanvasProjection()
     m_imageIdleWatcher.startCountdown();
 }
 
+void OverviewWidget::slotImageUpdated(const QRect &rc)
+{
+    m_thumbnailCache->setDirty(rc);
+    m_imageIdleWatcher.startCountdown();
+}
+
 void OverviewWidget::showEvent(QShowEvent *event)
 {
     Q_UNUSED(event);
@@ -220,7 +227,7 @@ void OverviewWidget::generateThumbnail()
                     return;
                 }
                 OverviewThumbnailStrokeStrategy* stroke;
-                stroke = new OverviewThumbnailStrokeStrategy(image->projection(), image->bounds(), m_previewSize, isPixelArt());
+                stroke = new OverviewThumbnailStrokeStrategy(m_thumbnailCache, image->projection(), image->bounds(), m_previewSize, isPixelArt());
 
                 connect(stroke, SIGNAL(thumbnailUpdated(QImage)), this, SLOT(updateThumbnail(QImage)));
 
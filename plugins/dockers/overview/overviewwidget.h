@@ -30,6 +30,8 @@
 
 #include <kis_canvas2.h>
 
+#include "OverviewThumbnailStrokeStrategy.h"
+
 class KisSignalCompressor;
 class KoCanvasBase;
 
@@ -50,6 +52,7 @@ public:
 
 public Q_SLOTS:
     void startUpdateCanvasProjection();
+    void slotImageUpdated(const QRect &rc);
     void generateThumbnail();
     void updateThumbnail(QImage pixmap);
     void slotThemeChanged();
@@ -100,6 +103,7 @@ private:
 
     QColor m_outlineColor;
     KisIdleWatcher m_imageIdleWatcher;
+    OverviewThumbnailCacheSP m_thumbnailCache;
     KisStrokeId strokeId;
     QMutex mutex;
 };
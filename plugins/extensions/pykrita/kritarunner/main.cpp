@@ -64,6 +64,7 @@ extern "C" int main(int argc, char **argv)
     qDebug() << "running:" << parser.value(scriptOption) << parser.value(functionOption);
     qDebug() << parser.positionalArguments();
 
+    app.setLeanStartup(true);
     app.addResourceTypes();
     app.registerResources();
     app.loadPlugins();
@@ -27,10 +27,14 @@
 
 #include <stdlib.h>
 #include <vector>
+#include <algorithm>
 
 #include <QPoint>
 #include <QSpinBox>
 #include <QDateTime>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtConcurrent>
 
 #include <klocalizedstring.h>
 #include <kis_debug.h>
@@ -40,7 +44,7 @@
 
 #include <KisDocument.h>
 #include <kis_image.h>
-#include <KisSequentialIteratorProgress.h>
+#include <kis_sequential_iterator.h>
 #include <kis_layer.h>
 #include <filter/kis_filter_registry.h>
 #include <kis_global.h>
@@ -72,123 +76,244 @@ void KisOilPaintFilter::processImpl(KisPaintDeviceSP device,
     const quint32 brushSize = config ? config->getInt("brushSize", 1) : 1;
     const quint32 smooth = config ? config->getInt("smooth", 30) : 30;
 
-    OilPaint(device, device, applyRect, brushSize, smooth, progressUpdater);
+    /**
+     * The rows are processed in parallel, so we should read from a copy
+     * of the device, otherwise the neighbourhood of a pixel could
+     * contain the pixels already written by another band
+     */
+    KisPaintDeviceSP src = new KisPaintDevice(*device);
+
+    OilPaint(src, device, applyRect, brushSize, smooth, progressUpdater);
 }
 
-// This method have been ported from Pieter Z. Voloshyn algorithm code.
+namespace {
 
-/* Function to apply the OilPaint effect.
- *
- * data             => The image data in RGBA mode.
- * w                => Width of image.
- * h                => Height of image.
- * BrushSize        => Brush size.
- * Smoothness       => Smooth value.
- *
- * Theory           => Using MostFrequentColor function we take the main color in
- *                     a matrix and simply write at the original position.
+/**
+ * The neighbourhood of a pixel is the square of (2 * radius + 1)
+ * pixels around it, cropped by the bounds of the processed area.
+ * Near the left and top borders the square is shifted to stay
+ * inside the area, near the right and bottom ones it is cut.
  */
+inline int windowStart(int pos, int radius, int lowBound)
+{
+    return qMax(pos - radius, lowBound);
+}
 
-void KisOilPaintFilter::OilPaint(const KisPaintDeviceSP src, KisPaintDeviceSP dst, const QRect &applyRect,
-                                 int BrushSize, int Smoothness, KoUpdater* progressUpdater) const
+inline int windowEnd(int pos, int radius, int lowBound, int highBound)
 {
-    KisSequentialConstIteratorProgress it(src, applyRect, progressUpdater);
-    KisSequentialIterator dstIt(dst, applyRect);
+    return qMin(windowStart(pos, radius, lowBound) + 2 * radius, highBound);
+}
 
-    while (it.nextPixel() && dstIt.nextPixel()) {
-        MostFrequentColor(src, dstIt.rawData(), applyRect, it.x(), it.y(), BrushSize, Smoothness);
+class OilPaintBandProcessor
+{
+public:
+    OilPaintBandProcessor(KisPaintDeviceSP src, KisPaintDeviceSP dst, const QRect &bounds,
+                          int radius, int intensity, int numBands, KoUpdater *progressUpdater)
+        : m_src(src),
+          m_dst(dst),
+          m_bounds(bounds),
+          m_radius(radius),
+          m_intensity(intensity),
+          m_numBands(numBands),
+          m_numBandsDone(0),
+          m_progressUpdater(progressUpdater)
+    {
     }
-}
 
-// This method has been ported from Pieter Z. Voloshyn's algorithm code in Digikam.
+    void processBand(const QRect &band)
+    {
+        if (m_progressUpdater && m_progressUpdater->interrupted()) return;
 
-/* Function to determine the most frequent color in a matrix
- *
- * Bits             => Bits array
- * Width            => Image width
- * Height           => Image height
- * X                => Position horizontal
- * Y                => Position vertical
- * Radius           => Is the radius of the matrix to be analyzed
- * Intensity        => Intensity to calculate
- *
- * Theory           => This function creates a matrix with the analyzed pixel in
- *                     the center of this matrix and find the most frequenty color
- */
+        const KoColorSpace *cs = m_src->colorSpace();
+        const int numChannels = cs->channelCount();
+        const double scale = m_intensity / 255.0;
 
-void KisOilPaintFilter::MostFrequentColor(KisPaintDeviceSP src, quint8* dst, const QRect& bounds, int X, int Y, int Radius, int Intensity) const
-{
-    uint I;
+        /**
+         * Convert all the source pixels the band depends on into the
+         * intensity bins and normalized channel values once
+         */
+        const int srcTop = windowStart(band.top(), m_radius, m_bounds.top());
+        const int srcBottom = windowEnd(band.bottom(), m_radius, m_bounds.top(), m_bounds.bottom());
+        const QRect srcRect(m_bounds.left(), srcTop, m_bounds.width(), srcBottom - srcTop + 1);
+        const int srcWidth = srcRect.width();
 
-    double Scale = Intensity / 255.0;
+        QVector<quint16> bins(srcRect.width() * srcRect.height());
+        QVector<float> channels(bins.size() * numChannels);
+        QVector<float> channel(numChannels);
 
-    // Alloc some arrays to be used
-    uchar *IntensityCount = new uchar[(Intensity + 1) * sizeof(uchar)];
+        {
+            KisSequentialConstIterator srcIt(m_src, srcRect);
+            quint16 *binPtr = bins.data();
+            float *channelsPtr = channels.data();
 
-    const KoColorSpace* cs = src->colorSpace();
+            while (srcIt.nextPixel()) {
+                cs->normalisedChannelsValue(srcIt.rawDataConst(), channel);
+                std::copy(channel.constBegin(), channel.constEnd(), channelsPtr);
 
-    QVector<float> channel(cs->channelCount());
-    QVector<float>* AverageChannels = new QVector<float>[(Intensity + 1)];
+                *binPtr = (uint)(cs->intensity8(srcIt.rawDataConst()) * scale);
 
-    // Erase the array
-    memset(IntensityCount, 0, (Intensity + 1) * sizeof(uchar));
+                binPtr++;
+                channelsPtr += numChannels;
+            }
+        }
 
-    int startx = qMax(X - Radius, bounds.left());
-    int starty = qMax(Y - Radius, bounds.top());
-    int width = (2 * Radius) + 1;
-    if ((startx + width - 1) > bounds.right()) width = bounds.right() - startx + 1;
-    Q_ASSERT((startx + width - 1) <= bounds.right());
-    int height = (2 * Radius) + 1;
-    if ((starty + height) > bounds.bottom()) height = bounds.bottom() - starty + 1;
-    Q_ASSERT((starty + height - 1) <= bounds.bottom());
-    KisSequentialConstIterator srcIt(src, QRect(startx, starty, width, height));
-    while (srcIt.nextPixel()) {
+        QVector<int> counts(m_intensity + 1);
+        QVector<double> sums((m_intensity + 1) * numChannels);
 
-        cs->normalisedChannelsValue(srcIt.rawDataConst(), channel);
+        int windowLeft = 0;
+        int windowRight = -1;
+        int windowTop = 0;
+        int windowBottom = -1;
 
-        I = (uint)(cs->intensity8(srcIt.rawDataConst()) * Scale);
-        IntensityCount[I]++;
+        auto updateColumn = [&] (int x, int delta) {
+            int index = (windowTop - srcTop) * srcWidth + x - m_bounds.left();
 
-        if (IntensityCount[I] == 1) {
-            AverageChannels[I] = channel;
-        } else {
-            for (int i = 0; i < channel.size(); i++) {
-                AverageChannels[I][i] += channel[i];
+            for (int y = windowTop; y <= windowBottom; y++, index += srcWidth) {
+                const int bin = bins[index];
+                const float *channelsPtr = channels.constData() + index * numChannels;
+                double *sumsPtr = sums.data() + bin * numChannels;
+
+                counts[bin] += delta;
+                for (int i = 0; i < numChannels; i++) {
+                    sumsPtr[i] += delta * channelsPtr[i];
+                }
             }
-        }
-    }
+        };
+
+        KisSequentialIterator dstIt(m_dst, band);
+
+        while (dstIt.nextPixel()) {
+            const int x = dstIt.x();
+            const int y = dstIt.y();
+
+            if (x == band.left()) {
+                std::fill(counts.begin(), counts.end(), 0);
+                std::fill(sums.begin(), sums.end(), 0.0);
+
+                windowTop = windowStart(y, m_radius, m_bounds.top());
+                windowBottom = windowEnd(y, m_radius, m_bounds.top(), m_bounds.bottom());
+                windowLeft = windowStart(x, m_radius, m_bounds.left());
+                windowRight = windowLeft - 1;
+            }
+
+            // slide the window: both its edges can only move to the right
+            const int newLeft = windowStart(x, m_radius, m_bounds.left());
+            const int newRight = windowEnd(x, m_radius, m_bounds.left(), m_bounds.right());
 
-    I = 0;
-    int MaxInstance = 0;
+            for (int col = windowLeft; col < newLeft && col <= windowRight; col++) {
+                updateColumn(col, -1);
+            }
+            for (int col = qMax(windowRight + 1, newLeft); col <= newRight; col++) {
+                updateColumn(col, 1);
+            }
+            windowLeft = newLeft;
+            windowRight = newRight;
+
+            int maxBin = 0;
+            int maxCount = 0;
+
+            for (int i = 0; i <= m_intensity; i++) {
+                if (counts[i] > maxCount) {
+                    maxBin = i;
+                    maxCount = counts[i];
+                }
+            }
 
-    for (int i = 0 ; i <= Intensity ; ++i) {
-        if (IntensityCount[i] > MaxInstance) {
-            I = i;
-            MaxInstance = IntensityCount[i];
+            quint8 *dst = dstIt.rawData();
+
+            if (maxCount != 0) {
+                const double *sumsPtr = sums.constData() + maxBin * numChannels;
+                for (int i = 0; i < numChannels; i++) {
+                    channel[i] = sumsPtr[i] / maxCount;
+                }
+                cs->fromNormalisedChannelsValue(dst, channel);
+            } else {
+                memset(dst, 0, cs->pixelSize());
+                cs->setOpacity(dst, OPACITY_OPAQUE_U8, 1);
+            }
         }
-    }
 
-    if (MaxInstance != 0) {
-        channel = AverageChannels[I];
-        for (int i = 0; i < channel.size(); i++) {
-            channel[i] /= MaxInstance;
+        if (m_progressUpdater) {
+            QMutexLocker l(&m_mutex);
+            m_numBandsDone++;
+            m_progressUpdater->setProgress(100 * m_numBandsDone / m_numBands);
         }
-        cs->fromNormalisedChannelsValue(dst, channel);
-    } else {
-        memset(dst, 0, cs->pixelSize());
-        cs->setOpacity(dst, OPACITY_OPAQUE_U8, 1);
     }
 
+private:
+    KisPaintDeviceSP m_src;
+    KisPaintDeviceSP m_dst;
+    QRect m_bounds;
+    int m_radius;
+    int m_intensity;
+
+    int m_numBands;
+    int m_numBandsDone;
+    KoUpdater *m_progressUpdater;
+    QMutex m_mutex;
+};
+
+struct ProcessOilPaintBand {
+    ProcessOilPaintBand(OilPaintBandProcessor *processor)
+        : m_processor(processor)
+    {
+    }
+
+    void operator()(const QRect &rc)
+    {
+        m_processor->processBand(rc);
+    }
+
+    OilPaintBandProcessor *m_processor;
+};
+
+} // namespace
+
+// This method have been ported from Pieter Z. Voloshyn algorithm code.
+
+/* Function to apply the OilPaint effect.
+ *
+ * src              => The source device.
+ * dst              => The destination device.
+ * applyRect        => The area to process, the pixels outside it are not read.
+ * BrushSize        => Brush size.
+ * Smoothness       => Smooth value.
+ *
+ * Theory           => Using the most frequent color we take the main color in
+ *                     a matrix and simply write at the original position.
+ *                     The most frequent color is the average color of the
+ *                     pixels in the most populated intensity bin of the
+ *                     matrix around the pixel.
+ *
+ * Implementation   => The histogram of the matrix is not rebuilt for every
+ *                     pixel, but updated while the matrix slides along the
+ *                     row: the incoming column is added and the outgoing one
+ *                     is removed, so the cost per pixel is linear in the
+ *                     brush size. The rows are processed in parallel bands.
+ */
+
+void KisOilPaintFilter::OilPaint(const KisPaintDeviceSP src, KisPaintDeviceSP dst, const QRect &applyRect,
+                                 int BrushSize, int Smoothness, KoUpdater* progressUpdater) const
+{
+    if (applyRect.isEmpty()) return;
+
+    const int bandHeight = 64;
+
+    QVector<QRect> bands;
+    for (int y = applyRect.top(); y <= applyRect.bottom(); y += bandHeight) {
+        bands << QRect(applyRect.left(), y,
+                       applyRect.width(), qMin(bandHeight, applyRect.bottom() - y + 1));
+    }
 
-    delete [] IntensityCount;        // free all the arrays
-    delete [] AverageChannels;
+    OilPaintBandProcessor processor(src, dst, applyRect, BrushSize, Smoothness, bands.size(), progressUpdater);
+    QtConcurrent::blockingMap(bands, ProcessOilPaintBand(&processor));
 }
 
 
 KisConfigWidget * KisOilPaintFilter::createConfigurationWidget(QWidget* parent, const KisPaintDeviceSP, bool) const
 {
     vKisIntegerWidgetParam param;
-    param.push_back(KisIntegerWidgetParam(1, 5, 1, i18n("Brush size"), "brushSize"));
+    param.push_back(KisIntegerWidgetParam(1, 30, 1, i18n("Brush size"), "brushSize"));
     param.push_back(KisIntegerWidgetParam(10, 255, 30, i18nc("smooth out the painting strokes the filter creates", "Smooth"), "smooth"));
     KisMultiIntegerFilterWidget * w = new KisMultiIntegerFilterWidget(id().id(),  parent,  id().id(),  param);
     w->setConfiguration(defaultConfiguration(KisGlobalResourcesInterface::instance()));
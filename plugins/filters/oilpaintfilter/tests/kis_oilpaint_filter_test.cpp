@@ -0,0 +1,162 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_oilpaint_filter_test.h"
+
+#include <QTest>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColor.h>
+
+#include "filter/kis_filter.h"
+#include "filter/kis_filter_configuration.h"
+#include "filter/kis_filter_registry.h"
+#include "kis_paint_device.h"
+#include <kis_sequential_iterator.h>
+#include <KisGlobalResourcesInterface.h>
+
+namespace {
+
+/**
+ * A straightforward implementation of the oil paint filter that builds
+ * the histogram of every pixel's neighbourhood from scratch
+ */
+void oilPaintReference(KisPaintDeviceSP src, KisPaintDeviceSP dst, const QRect &bounds,
+                       int radius, int intensity)
+{
+    const KoColorSpace *cs = src->colorSpace();
+    const int numChannels = cs->channelCount();
+    const double scale = intensity / 255.0;
+
+    QVector<float> channel(numChannels);
+
+    for (int y = bounds.top(); y <= bounds.bottom(); y++) {
+        for (int x = bounds.left(); x <= bounds.right(); x++) {
+            const int top = qMax(y - radius, bounds.top());
+            const int bottom = qMin(top + 2 * radius, bounds.bottom());
+            const int left = qMax(x - radius, bounds.left());
+            const int right = qMin(left + 2 * radius, bounds.right());
+
+            QVector<int> counts(intensity + 1);
+            QVector<double> sums((intensity + 1) * numChannels);
+
+            KisSequentialConstIterator srcIt(src, QRect(QPoint(left, top), QPoint(right, bottom)));
+            while (srcIt.nextPixel()) {
+                const int bin = (uint)(cs->intensity8(srcIt.rawDataConst()) * scale);
+                cs->normalisedChannelsValue(srcIt.rawDataConst(), channel);
+
+                counts[bin]++;
+                for (int i = 0; i < numChannels; i++) {
+                    sums[bin * numChannels + i] += channel[i];
+                }
+            }
+
+            int maxBin = 0;
+            for (int i = 0; i <= intensity; i++) {
+                if (counts[i] > counts[maxBin]) {
+                    maxBin = i;
+                }
+            }
+
+            for (int i = 0; i < numChannels; i++) {
+                channel[i] = sums[maxBin * numChannels + i] / counts[maxBin];
+            }
+
+            KoColor color(cs);
+            cs->fromNormalisedChannelsValue(color.data(), channel);
+            dst->setPixel(x, y, color);
+        }
+    }
+}
+
+}
+
+void KisOilPaintFilterTest::testSlidingHistogram_data()
+{
+    QTest::addColumn<int>("brushSize");
+    QTest::addColumn<int>("smooth");
+
+    QTest::newRow("1-30") << 1 << 30;
+    QTest::newRow("3-10") << 3 << 10;
+    QTest::newRow("7-255") << 7 << 255;
+    QTest::newRow("30-30") << 30 << 30;
+}
+
+void KisOilPaintFilterTest::testSlidingHistogram()
+{
+    QFETCH(int, brushSize);
+    QFETCH(int, smooth);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    /**
+     * The processed rect is not aligned to the tiles and has more than
+     * one band of rows. The brush of size 30 is bigger than the rect
+     * in one direction, so all the pixels are near the edges.
+     */
+    const QRect deviceRect(0, 0, 160, 200);
+    const QRect applyRect(3, 7, 150, 50);
+
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+
+    // few distinct values, so that the bins have competitors
+    srand(4151);
+    KoColor color(cs);
+    KisSequentialIterator it(src, deviceRect);
+    while (it.nextPixel()) {
+        color.fromQColor(QColor(rand() % 4 * 80, rand() % 4 * 80, rand() % 256));
+        memcpy(it.rawData(), color.data(), cs->pixelSize());
+    }
+
+    KisFilterSP filter = KisFilterRegistry::instance()->value("oilpaint");
+    QVERIFY(filter);
+
+    KisFilterConfigurationSP config = filter->defaultConfiguration(KisGlobalResourcesInterface::instance());
+    config->setProperty("brushSize", brushSize);
+    config->setProperty("smooth", smooth);
+
+    KisPaintDeviceSP result = new KisPaintDevice(*src);
+    filter->process(result, applyRect, config);
+
+    KisPaintDeviceSP reference = new KisPaintDevice(*src);
+    oilPaintReference(src, reference, applyRect, brushSize, smooth);
+
+    const int pixelSize = cs->pixelSize();
+
+    KisSequentialConstIterator resultIt(result, deviceRect);
+    KisSequentialConstIterator referenceIt(reference, deviceRect);
+
+    while (resultIt.nextPixel() && referenceIt.nextPixel()) {
+        const quint8 *resultPtr = resultIt.rawDataConst();
+        const quint8 *referencePtr = referenceIt.rawDataConst();
+
+        // the sums are accumulated in a different order, so allow
+        // the rounding to go in a different direction
+        for (int i = 0; i < pixelSize; i++) {
+            if (qAbs(resultPtr[i] - referencePtr[i]) > 1) {
+                QFAIL(QString("Pixel (%1, %2) differs from the reference: channel %3, %4 vs %5")
+                      .arg(resultIt.x()).arg(resultIt.y())
+                      .arg(i).arg(resultPtr[i]).arg(referencePtr[i])
+                      .toLatin1());
+            }
+        }
+    }
+}
+
+QTEST_MAIN(KisOilPaintFilterTest)
@@ -18,8 +18,8 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
-#include <KisSequentialIteratorProgress.h>
 #include <KoUpdater.h>
+#include <QMutex>
 #include <cstring>
 #include <filter/kis_filter_configuration.h>
 #include <generator/kis_generator_registry.h>
@@ -27,6 +27,7 @@
 #include <kis_fill_painter.h>
 #include <kis_global.h>
 #include <kis_image.h>
+#include <kis_iterator_ng.h>
 #include <kis_layer.h>
 #include <kis_paint_device.h>
 #include <kis_processing_information.h>
@@ -80,13 +81,118 @@ KritaSeExprGenerator::~KritaSeExprGenerator()
 {
 }
 
+namespace
+{
+
+/**
+ * SeExpr keeps the state of the evaluation inside the expression
+ * object, so every worker thread needs an instance of its own. The
+ * color converter is not shared for the same reason.
+ */
+struct SeExprWorkerContext {
+    SeExprWorkerContext(const QString &script)
+        : expression(script)
+    {
+        expression.m_vars["u"] = &u;
+        expression.m_vars["v"] = &v;
+        expression.m_vars["w"] = &w;
+        expression.m_vars["h"] = &h;
+    }
+
+    SeExprVariable u;
+    SeExprVariable v;
+    SeExprVariable w;
+    SeExprVariable h;
+
+    SeExprExpressionContext expression;
+    QScopedPointer<KoColorConversionTransformation> converter;
+    const KoColorSpace *converterDstCS = 0;
+};
+
+} // namespace
+
+/**
+ * KisGeneratorStrokeStrategy already splits the generated area into
+ * patches and runs them as concurrent jobs, so generate() renders its
+ * rect on the calling thread. To avoid parsing the script for every
+ * patch of a stroke, the parsed expressions are kept in a pool: a job
+ * borrows one for the duration of generate() and returns it afterwards.
+ * Hence the script is parsed and checked once per stroke, plus once
+ * for every extra worker thread that runs a patch concurrently.
+ */
+struct KisSeExprGenerator::Private
+{
+    ~Private() {
+        qDeleteAll(freeContexts);
+    }
+
+    /**
+     * @return a context with the parsed \p script or null if the
+     *         script is not valid
+     */
+    SeExprWorkerContext *acquireContext(const QString &script)
+    {
+        QMutexLocker l(&mutex);
+
+        if (script != currentScript) {
+            qDeleteAll(freeContexts);
+            freeContexts.clear();
+            currentScript = script;
+            currentScriptIsValid = true;
+        }
+
+        if (!currentScriptIsValid) return 0;
+
+        if (!freeContexts.isEmpty()) {
+            return freeContexts.takeLast();
+        }
+
+        l.unlock();
+
+        SeExprWorkerContext *context = new SeExprWorkerContext(script);
+        if (!context->expression.isValid() || !context->expression.returnType().isFP(3)) {
+            delete context;
+            context = 0;
+
+            l.relock();
+            if (script == currentScript) {
+                currentScriptIsValid = false;
+            }
+        }
+
+        return context;
+    }
+
+    void releaseContext(const QString &script, SeExprWorkerContext *context)
+    {
+        QMutexLocker l(&mutex);
+
+        if (script == currentScript) {
+            freeContexts.append(context);
+        } else {
+            l.unlock();
+            delete context;
+        }
+    }
+
+    QMutex mutex;
+    QString currentScript;
+    bool currentScriptIsValid = true;
+    QVector<SeExprWorkerContext *> freeContexts;
+};
+
 KisSeExprGenerator::KisSeExprGenerator()
     : KisGenerator(id(), KoID("basic"), i18n("&SeExpr..."))
+    , m_d(new Private)
 {
     setColorSpaceIndependence(FULLY_INDEPENDENT);
     setSupportsPainting(true);
 }
 
+KisSeExprGenerator::~KisSeExprGenerator()
+{
+}
+
 KisFilterConfigurationSP KisSeExprGenerator::factoryConfiguration(KisResourcesInterfaceSP resourcesInterface) const
 {
     return new KisSeExprGeneratorConfiguration(id().id(), 1, resourcesInterface);
@@ -121,41 +227,76 @@ void KisSeExprGenerator::generate(KisProcessingInformation dstInfo, const QSize
         QRect bounds = QRect(dstInfo.topLeft(), size);
         QRect whole_image_bounds = device->defaultBounds()->bounds();
 
-        SeExprExpressionContext expression(script);
+        if (bounds.isEmpty()) return;
 
-        expression.m_vars["u"] = new SeExprVariable();
-        expression.m_vars["v"] = new SeExprVariable();
-        expression.m_vars["w"] = new SeExprVariable(whole_image_bounds.width());
-        expression.m_vars["h"] = new SeExprVariable(whole_image_bounds.height());
+        SeExprWorkerContext *context = m_d->acquireContext(script);
+        if (!context) return;
 
-        if (expression.isValid() && expression.returnType().isFP(3)) {
-            double pixel_stride_x = 1. / whole_image_bounds.width();
-            double pixel_stride_y = 1. / whole_image_bounds.height();
-            double &u = expression.m_vars["u"]->m_value;
-            double &v = expression.m_vars["v"]->m_value;
+        // SeExpr already outputs floating-point RGB
+        const KoColorSpace *src = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), KoColorSpaceRegistry::instance()->p709SRGBProfile());
+        const KoColorSpace *dst = device->colorSpace();
 
-            // SeExpr already outputs floating-point RGB
-            const KoColorSpace *dst = device->colorSpace();
-            const KoColorSpace *src = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), KoColorSpaceRegistry::instance()->p709SRGBProfile());
-            auto conv = KoColorSpaceRegistry::instance()->createColorConverter(src, dst, KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags());
+        if (!context->converter || context->converterDstCS != dst) {
+            context->converter.reset(KoColorSpaceRegistry::instance()->createColorConverter(src, dst, KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags()));
+            context->converterDstCS = dst;
+        }
 
-            KisSequentialIteratorProgress it(device, bounds, progressUpdater);
+        context->w.m_value = whole_image_bounds.width();
+        context->h.m_value = whole_image_bounds.height();
 
-            while (it.nextPixel()) {
-                u = pixel_stride_x * (it.x() + .5);
-                v = pixel_stride_y * (it.y() + .5);
+        const double pixel_stride_x = 1. / whole_image_bounds.width();
+        const double pixel_stride_y = 1. / whole_image_bounds.height();
+        double &u = context->u.m_value;
+        double &v = context->v.m_value;
 
-                const double *value = expression.evalFP();
+        /**
+         * Every consecutive span of a row is evaluated into a
+         * floating-point buffer and converted into the color space of
+         * the device with a single transform() call.
+         */
+        const int pixelSize = src->pixelSize();
+        QVector<float> buffer(bounds.width() * pixelSize / sizeof(float));
 
-                KoColor c(src);
-                reinterpret_cast<float *>(c.data())[0] = value[0];
-                reinterpret_cast<float *>(c.data())[1] = value[1];
-                reinterpret_cast<float *>(c.data())[2] = value[2];
-                c.setOpacity(OPACITY_OPAQUE_F);
+        KisHLineIteratorSP it = device->createHLineIteratorNG(bounds.x(), bounds.y(), bounds.width());
 
-                conv->transform(c.data(), it.rawData(), 1);
+        for (int y = bounds.y(); y <= bounds.bottom(); y++) {
+            if (progressUpdater && progressUpdater->interrupted()) break;
+
+            v = pixel_stride_y * (y + .5);
+
+            int x = bounds.x();
+            int pixelsLeft = bounds.width();
+
+            while (pixelsLeft > 0) {
+                const int numPixels = qMin(pixelsLeft, it->nConseqPixels());
+
+                float *dstPixel = buffer.data();
+                for (int i = 0; i < numPixels; i++, dstPixel += 4) {
+                    u = pixel_stride_x * (x + i + .5);
+
+                    const double *value = context->expression.evalFP();
+
+                    dstPixel[0] = value[0];
+                    dstPixel[1] = value[1];
+                    dstPixel[2] = value[2];
+                    dstPixel[3] = OPACITY_OPAQUE_F;
+                }
+
+                context->converter->transform(reinterpret_cast<const quint8 *>(buffer.constData()), it->rawData(), numPixels);
+
+                it->nextPixels(numPixels);
+                x += numPixels;
+                pixelsLeft -= numPixels;
+            }
+
+            it->nextRow();
+
+            if (progressUpdater) {
+                progressUpdater->setProgress(100 * (y - bounds.y() + 1) / bounds.height());
             }
         }
+
+        m_d->releaseContext(script, context);
     }
 }
 
@@ -22,6 +22,7 @@
 #define SEEXPR_GENERATOR_H
 
 #include <QObject>
+#include <QScopedPointer>
 #include <QVariant>
 
 #include "generator/kis_generator.h"
@@ -50,6 +51,7 @@ class KisSeExprGenerator : public KisGenerator
 {
 public:
     KisSeExprGenerator();
+    ~KisSeExprGenerator() override;
 
     using KisGenerator::generate;
 
@@ -66,6 +68,10 @@ public:
     KisFilterConfigurationSP factoryConfiguration(KisResourcesInterfaceSP resourcesInterface) const override;
     KisFilterConfigurationSP defaultConfiguration(KisResourcesInterfaceSP resourcesInterface) const override;
     KisConfigWidget *createConfigurationWidget(QWidget *parent, const KisPaintDeviceSP dev, bool useForMasks) const override;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
 };
 
 #endif
@@ -114,4 +114,84 @@ void KisSeExprGeneratorTest::testGenerationFromKoResource()
     }
 }
 
+void KisSeExprGeneratorTest::testGenerationInPatches()
+{
+    KisGeneratorSP generator = KisGeneratorRegistry::instance()->get("seexpr");
+    QVERIFY(generator);
+
+    KisFilterConfigurationSP config = generator->defaultConfiguration(KisGlobalResourcesInterface::instance());
+    QVERIFY(config);
+
+    config->setProperty("script", BASE_SCRIPT);
+
+    const QRect rc(0, 0, 256, 256);
+
+    KisDefaultBoundsBaseSP bounds(new KisWrapAroundBoundsWrapper(new KisDefaultBounds(), rc));
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisPaintDeviceSP refDev = new KisPaintDevice(cs);
+    refDev->setDefaultBounds(bounds);
+    generator->generate(KisProcessingInformation(refDev, rc.topLeft(), KisSelectionSP()), rc.size(), config);
+
+    /**
+     * The patches reuse the expression parsed for the first one, the
+     * variables of the reused expression must not leak between them
+     */
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->setDefaultBounds(bounds);
+
+    const QSize patchSize(100, 70);
+    for (int y = rc.y(); y <= rc.bottom(); y += patchSize.height()) {
+        for (int x = rc.x(); x <= rc.right(); x += patchSize.width()) {
+            const QRect patch = QRect(QPoint(x, y), patchSize) & rc;
+            generator->generate(KisProcessingInformation(dev, patch.topLeft(), KisSelectionSP()), patch.size(), config);
+        }
+    }
+
+    QPoint errpoint;
+    if (!TestUtil::comparePaintDevices(errpoint, refDev, dev)) {
+        QFAIL(QString("Patches differ from the whole image, first different pixel: %1,%2 ").arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+}
+
+void KisSeExprGeneratorTest::benchmarkGeneration_data()
+{
+    QTest::addColumn<QString>("script");
+
+    auto resource = new KisSeExprScript(TestUtil::fetchDataFileLazy("Disney_noisecolor2.kse"));
+    resource->load(KisGlobalResourcesInterface::instance());
+    Q_ASSERT(resource->valid());
+
+    QTest::newRow("gradient") << QString("[$u, $v, 0.5]");
+    QTest::newRow("voronoi") << QString(BASE_SCRIPT);
+    QTest::newRow("Disney_noisecolor2") << resource->script();
+
+    delete resource;
+}
+
+void KisSeExprGeneratorTest::benchmarkGeneration()
+{
+    QFETCH(QString, script);
+
+    KisGeneratorSP generator = KisGeneratorRegistry::instance()->get("seexpr");
+    QVERIFY(generator);
+
+    KisFilterConfigurationSP config = generator->defaultConfiguration(KisGlobalResourcesInterface::instance());
+    QVERIFY(config);
+
+    config->setProperty("script", script);
+
+    const QRect rc(0, 0, 2048, 2048);
+
+    KisDefaultBoundsBaseSP bounds(new KisWrapAroundBoundsWrapper(new KisDefaultBounds(), rc));
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->setDefaultBounds(bounds);
+
+    QBENCHMARK_ONCE {
+        KisFillPainter fillPainter(dev);
+        fillPainter.fillRect(rc.x(), rc.y(), rc.width(), rc.height(), config);
+    }
+}
+
 KISTEST_MAIN(KisSeExprGeneratorTest)
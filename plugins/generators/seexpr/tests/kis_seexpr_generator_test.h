@@ -31,6 +31,10 @@ private Q_SLOTS:
     void initTestCase();
     void testGenerationFromScript();
     void testGenerationFromKoResource();
+    void testGenerationInPatches();
+
+    void benchmarkGeneration_data();
+    void benchmarkGeneration();
 };
 
 #endif
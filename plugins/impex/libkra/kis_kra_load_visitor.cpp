@@ -576,6 +576,13 @@ bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString&
                 }
             }
         }
+
+        /**
+         * Every frame is stored in a separate file, so the held and
+         * cycled frames come as separate copies. Let them share the
+         * equal tiles again.
+         */
+        frameInterface->shareEqualFrameTiles();
     }
 
     return true;
@@ -347,7 +347,8 @@ bool KisKraSaver::saveBinaryData(KoStore* store, KisImageSP image, const QString
     if (!autosave) {
         KisPaintDeviceSP dev = image->projection();
         store->setCompressionEnabled(false);
-        KisPNGConverter::saveDeviceToStore("mergedimage.png", image->bounds(), image->xRes(), image->yRes(), dev, store);
+        KisPNGConverter::saveDeviceToStore("mergedimage.png", image->bounds(), image->xRes(), image->yRes(), dev, store,
+                                           0, KisConfig(true).mergedImageCompressionInKra());
         store->setCompressionEnabled(KisConfig(true).compressKra());
     }
 
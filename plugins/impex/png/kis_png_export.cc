@@ -75,6 +75,7 @@ KisImportExportErrorCode KisPNGExport::convert(KisDocument *document, QIODevice
     options.storeAuthor = configuration->getBool("storeAuthor", false);
     options.storeMetaData = configuration->getBool("storeMetaData", false);
     options.saveAsHDR = configuration->getBool("saveAsHDR", false);
+    options.parallelCompression = configuration->getBool("parallelCompression", true);
 
     vKisAnnotationSP_it beginIt = image->beginAnnotations();
     vKisAnnotationSP_it endIt = image->endAnnotations();
@@ -118,6 +119,7 @@ KisPropertiesConfigurationSP KisPNGExport::defaultConfiguration(const QByteArray
     cfg->setProperty("saveAsHDR", false);
     cfg->setProperty("storeMetaData", false);
     cfg->setProperty("storeAuthor", false);
+    cfg->setProperty("parallelCompression", true);
 
     return cfg;
 }
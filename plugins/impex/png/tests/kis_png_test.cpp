@@ -26,6 +26,10 @@
 
 #include  <sdk/tests/testui.h>
 
+#include <QBuffer>
+#include <kis_png_converter.h>
+#include <kis_paint_device.h>
+
 #ifndef FILES_DATA_DIR
 #error "FILES_DATA_DIR not set. A directory with the data used for testing the importing of files in krita"
 #endif
@@ -175,5 +179,92 @@ void KisPngTest::testSaveHDR()
                     KoColorSpaceRegistry::instance()->p2020PQProfile()));
 }
 
+KisPaintDeviceSP createCompressionTestDevice(const KoColorSpace *cs, const QRect &rc, bool fewColors)
+{
+    QImage image(rc.size(), QImage::Format_ARGB32);
+
+    qsrand(1);
+    for (int y = 0; y < image.height(); y++) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); x++) {
+            if (fewColors) {
+                const int value = ((x / 64) ^ (y / 64)) & 0x0f;
+                line[x] = qRgb(value * 16, 255 - value * 16, value * 8);
+            } else {
+                // smooth gradients with some noise, similar to a painting
+                const int noise = qrand() % 8;
+                line[x] = qRgba((x / 16 + noise) & 0xff, (y / 12 + noise) & 0xff, ((x + y) / 32) & 0xff, 255 - noise);
+            }
+        }
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->convertFromQImage(image, 0, rc.x(), rc.y());
+    return dev;
+}
+
+void KisPngTest::testParallelCompression_data()
+{
+    QTest::addColumn<QString>("colorDepthId");
+    QTest::addColumn<bool>("indexed");
+    QTest::addColumn<bool>("parallel");
+
+    QTest::newRow("rgba8-sequential") << Integer8BitsColorDepthID.id() << false << false;
+    QTest::newRow("rgba8-parallel") << Integer8BitsColorDepthID.id() << false << true;
+    QTest::newRow("rgba16-sequential") << Integer16BitsColorDepthID.id() << false << false;
+    QTest::newRow("rgba16-parallel") << Integer16BitsColorDepthID.id() << false << true;
+    QTest::newRow("indexed-sequential") << Integer8BitsColorDepthID.id() << true << false;
+    QTest::newRow("indexed-parallel") << Integer8BitsColorDepthID.id() << true << true;
+}
+
+void KisPngTest::testParallelCompression()
+{
+    QFETCH(QString, colorDepthId);
+    QFETCH(bool, indexed);
+    QFETCH(bool, parallel);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), colorDepthId, 0);
+
+    const QRect rc(0, 0, 4000, 3000);
+    KisPaintDeviceSP dev = createCompressionTestDevice(cs, rc, indexed);
+
+    KisPNGOptions options;
+    options.compression = 3;
+    options.alpha = !indexed;
+    options.tryToSaveAsIndexed = indexed;
+    options.parallelCompression = parallel;
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    vKisAnnotationSP_it annotIt = 0;
+
+    QBENCHMARK_ONCE {
+        KisPNGConverter converter(0, true);
+        KisImportExportErrorCode result =
+            converter.buildFile(&buffer, rc, 72.0, 72.0, dev, annotIt, annotIt, options, 0);
+        QVERIFY(result.isOk());
+    }
+    buffer.close();
+
+    qDebug() << "Compressed size:" << buffer.data().size();
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    doc->setFileBatchMode(true);
+
+    buffer.open(QIODevice::ReadOnly);
+    KisPNGConverter loader(doc.data(), true);
+    QVERIFY(loader.buildImage(&buffer).isOk());
+
+    KisImageSP image = loader.image();
+    QVERIFY(image);
+    image->initialRefreshGraph();
+
+    QPoint pt;
+    QVERIFY(TestUtil::compareQImages(pt,
+                                     dev->convertToQImage(0, rc),
+                                     image->projection()->convertToQImage(0, rc), 1, 1));
+}
+
 KISTEST_MAIN(KisPngTest)
 
@@ -28,6 +28,9 @@ private Q_SLOTS:
     void testFiles();
     void testWriteonly();
     void testSaveHDR();
+
+    void testParallelCompression_data();
+    void testParallelCompression();
 };
 
 #endif
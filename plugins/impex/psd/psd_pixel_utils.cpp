@@ -18,26 +18,29 @@
 
 #include "psd_pixel_utils.h"
 
+#include <algorithm>
+
 #include <QtGlobal>
-#include <QMap>
 #include <QIODevice>
-
+#include <QtConcurrent>
 
 #include <KoColorSpace.h>
 #include <KoColorSpaceMaths.h>
 #include <KoColorSpaceTraits.h>
 #include <KoCmykColorSpaceTraits.h>
+#include <KoRgbColorSpaceTraits.h>
 #include <colorspaces/KoAlphaColorSpace.h>
 
 #include <QtEndian>
 
 #include "kis_global.h"
+#include "kis_algebra_2d.h"
+#include "kis_paint_device.h"
 #include <asl/kis_asl_writer_utils.h>
 #include <asl/kis_asl_reader_utils.h>
 
 #include "psd_layer_record.h"
 #include <asl/kis_offset_keeper.h>
-#include "kis_iterator_ng.h"
 
 #include "config_psd.h"
 #ifdef HAVE_ZLIB
@@ -46,256 +49,227 @@
 
 namespace PsdPixelUtils {
 
-template <class Traits>
-typename Traits::channels_type convertByteOrder(typename Traits::channels_type value);
-// default implementation is undefined for every color space should be added manually
-
-template <>
-inline quint8 convertByteOrder<AlphaU8Traits>(quint8 value) {
-    return value;
-}
-
-template <>
-inline quint16 convertByteOrder<AlphaU16Traits>(quint16 value) {
-    return qFromBigEndian((quint16)value);
-}
-
-template <>
-inline float convertByteOrder<AlphaF32Traits>(float value) {
-    return qFromBigEndian((quint32)value);
-}
+/**
+ * PSD stores every channel as a separate plane, so the pixels are
+ * assembled row-by-row: first every channel span of the row is
+ * converted into native byte order (and inverted, if needed) into
+ * a contiguous scratch buffer, and then the spans are interleaved
+ * into Krita's pixel layout. Both passes are simple loops with
+ * compile-time strides, which compilers can vectorize easily.
+ */
 
+template <typename channels_type>
+inline channels_type fromBigEndianChannel(channels_type value);
 
 template <>
-inline quint8 convertByteOrder<KoGrayU8Traits>(quint8 value) {
+inline quint8 fromBigEndianChannel<quint8>(quint8 value) {
     return value;
 }
 
 template <>
-inline quint16 convertByteOrder<KoGrayU16Traits>(quint16 value) {
-    return qFromBigEndian((quint16)value);
+inline quint16 fromBigEndianChannel<quint16>(quint16 value) {
+    return qFromBigEndian(value);
 }
 
 template <>
-inline quint32 convertByteOrder<KoGrayU32Traits>(quint32 value) {
-    return qFromBigEndian((quint32)value);
-}
-
-template <>
-inline quint8 convertByteOrder<KoBgrU8Traits>(quint8 value) {
+inline float fromBigEndianChannel<float>(float value) {
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = qFromBigEndian(bits);
+    memcpy(&value, &bits, sizeof(bits));
     return value;
 }
 
-template <>
-inline quint16 convertByteOrder<KoBgrU16Traits>(quint16 value) {
-    return qFromBigEndian((quint16)value);
-}
-
-template <>
-inline quint32 convertByteOrder<KoBgrU32Traits>(quint32 value) {
-    return qFromBigEndian((quint32)value);
-}
+/**
+ * Describes the position of a PSD channel inside Krita's pixel
+ */
+struct ChannelMapping {
+    qint16 channelId;
+    int pixelChannel;
+    bool inverted;
+};
+
+/**
+ * A row of a single PSD channel as it is stored in the file (only
+ * decompressed). If \p data is null, or the row is shorter than
+ * expected, the missing values are filled with the default one.
+ */
+struct ChannelRowSpan {
+    const quint8 *data;
+    int numPixels;
+    int pixelChannel;
+    bool inverted;
+};
+
+QVector<ChannelMapping> channelMappingForColorMode(psd_color_mode colorMode, int channelSize)
+{
+    QVector<ChannelMapping> mapping;
 
-template <>
-inline quint8 convertByteOrder<KoCmykU8Traits>(quint8 value) {
-    return value;
-}
+    switch (colorMode) {
+    case Grayscale:
+        mapping << ChannelMapping{0, 0, false}
+                << ChannelMapping{-1, KoGrayU8Traits::alpha_pos, false};
+        break;
+    case RGB:
+        // integer RGB spaces are stored as BGR, but the float ones are real RGB
+        if (channelSize == 4) {
+            mapping << ChannelMapping{0, KoRgbF32Traits::red_pos, false}
+                    << ChannelMapping{1, KoRgbF32Traits::green_pos, false}
+                    << ChannelMapping{2, KoRgbF32Traits::blue_pos, false}
+                    << ChannelMapping{-1, KoRgbF32Traits::alpha_pos, false};
+        } else {
+            mapping << ChannelMapping{0, KoBgrU8Traits::red_pos, false}
+                    << ChannelMapping{1, KoBgrU8Traits::green_pos, false}
+                    << ChannelMapping{2, KoBgrU8Traits::blue_pos, false}
+                    << ChannelMapping{-1, KoBgrU8Traits::alpha_pos, false};
+        }
+        break;
+    case CMYK:
+        mapping << ChannelMapping{0, KoCmykU8Traits::c_pos, true}
+                << ChannelMapping{1, KoCmykU8Traits::m_pos, true}
+                << ChannelMapping{2, KoCmykU8Traits::y_pos, true}
+                << ChannelMapping{3, KoCmykU8Traits::k_pos, true}
+                << ChannelMapping{-1, KoCmykU8Traits::alpha_pos, false};
+        break;
+    case Lab:
+        mapping << ChannelMapping{0, KoLabU8Traits::L_pos, false}
+                << ChannelMapping{1, KoLabU8Traits::a_pos, false}
+                << ChannelMapping{2, KoLabU8Traits::b_pos, false}
+                << ChannelMapping{-1, KoLabU8Traits::alpha_pos, false};
+        break;
+    case Bitmap:
+    case Indexed:
+    case MultiChannel:
+    case DuoTone:
+    case COLORMODE_UNKNOWN:
+    default:
+        QString error = QString("Unsupported color mode: %1").arg(colorMode);
+        throw KisAslReaderUtils::ASLParseException(error);
+    }
 
-template <>
-inline quint16 convertByteOrder<KoCmykU16Traits>(quint16 value) {
-    return qFromBigEndian((quint16)value);
+    return mapping;
 }
 
-template <>
-inline float convertByteOrder<KoCmykF32Traits>(float value) {
-    return qFromBigEndian((quint32)value);
-}
+template <typename channels_type>
+inline void normalizeChannelSpan(const ChannelRowSpan &span, int width, channels_type *dst)
+{
+    const channels_type unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
+    const channels_type zeroValue = KoColorSpaceMathsTraits<channels_type>::zeroValue;
 
-template <>
-inline quint8 convertByteOrder<KoLabU8Traits>(quint8 value) {
-    return value;
-}
+    const channels_type *src = reinterpret_cast<const channels_type*>(span.data);
+    const int numPixels = span.data ? qBound(0, span.numPixels, width) : 0;
 
-template <>
-inline quint16 convertByteOrder<KoLabU16Traits>(quint16 value) {
-    return qFromBigEndian((quint16)value);
-}
+    if (span.inverted) {
+        for (int i = 0; i < numPixels; i++) {
+            dst[i] = unitValue - fromBigEndianChannel(src[i]);
+        }
+    } else {
+        for (int i = 0; i < numPixels; i++) {
+            dst[i] = fromBigEndianChannel(src[i]);
+        }
+    }
 
-template <>
-inline float convertByteOrder<KoLabF32Traits>(float value) {
-    return qFromBigEndian((quint32)value);
+    const channels_type defaultValue = span.inverted ? zeroValue : unitValue;
+    std::fill(dst + numPixels, dst + width, defaultValue);
 }
 
-template <class Traits>
-void readAlphaMaskPixel(const QMap<quint16, QByteArray> &channelBytes,
-                        int col, quint8 *dstPtr);
-
-template <>
-void readAlphaMaskPixel<AlphaU8Traits>(const QMap<quint16, QByteArray> &channelBytes,
-                                       int col, quint8 *dstPtr)
+template <typename channels_type, int channels_nb>
+struct PlanarRowConverter
 {
-    *dstPtr = reinterpret_cast<const quint8*>(channelBytes.first().constData())[col];
-}
+    static void convert(const QVector<ChannelRowSpan> &spans, int width,
+                        quint8 *scratch, quint8 *dstRow)
+    {
+        KIS_SAFE_ASSERT_RECOVER_RETURN(spans.size() == channels_nb);
 
-template <>
-void readAlphaMaskPixel<AlphaU16Traits>(const QMap<quint16, QByteArray> &channelBytes,
-                                       int col, quint8 *dstPtr)
-{
-    *dstPtr = reinterpret_cast<const quint16*>(channelBytes.first().constData())[col] >> 8;
-}
+        const channels_type *planes[channels_nb];
 
-template <>
-void readAlphaMaskPixel<AlphaF32Traits>(const QMap<quint16, QByteArray> &channelBytes,
-                                        int col, quint8 *dstPtr)
-{
-    *dstPtr = reinterpret_cast<const float*>(channelBytes.first().constData())[col] * 255;
-}
+        for (int i = 0; i < channels_nb; i++) {
+            const ChannelRowSpan &span = spans[i];
+            channels_type *plane = reinterpret_cast<channels_type*>(scratch) + span.pixelChannel * width;
+            normalizeChannelSpan(span, width, plane);
+            planes[span.pixelChannel] = plane;
+        }
 
-template <class Traits>
-inline typename Traits::channels_type readChannelValue(const QMap<quint16, QByteArray> &channelBytes,
-                                       quint16 channelId, int col, typename Traits::channels_type defaultValue)
-{
-    typedef typename Traits::channels_type channels_type;
+        channels_type *dst = reinterpret_cast<channels_type*>(dstRow);
 
-    if (channelBytes.contains(channelId)) {
-        const QByteArray &bytes = channelBytes[channelId];
-        if (col < bytes.size()) {
-            return convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(bytes.constData())[col]);
+        for (int x = 0; x < width; x++) {
+            for (int ch = 0; ch < channels_nb; ch++) {
+                dst[ch] = planes[ch][x];
+            }
+            dst += channels_nb;
         }
-
-        dbgFile << "col index out of range channelId: "<< channelId << " col:" << col;
     }
+};
 
-    return defaultValue;
-}
-
-template <class Traits>
-void readGrayPixel(const QMap<quint16, QByteArray> &channelBytes,
-                  int col, quint8 *dstPtr)
+template <typename channels_type>
+struct AlphaMaskRowConverter
 {
-    typedef typename Traits::Pixel Pixel;
-    typedef typename Traits::channels_type channels_type;
-
-    const channels_type unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
-    Pixel *pixelPtr = reinterpret_cast<Pixel*>(dstPtr);
-
-    pixelPtr->gray  = readChannelValue<Traits>(channelBytes, 0, col, unitValue);
-    pixelPtr->alpha = readChannelValue<Traits>(channelBytes, -1, col, unitValue);
-}
-
-template <class Traits>
-void readRgbPixel(const QMap<quint16, QByteArray> &channelBytes,
-                  int col, quint8 *dstPtr)
-{
-    typedef typename Traits::Pixel Pixel;
-    typedef typename Traits::channels_type channels_type;
+    static void convert(const QVector<ChannelRowSpan> &spans, int width,
+                        quint8 *scratch, quint8 *dstRow)
+    {
+        KIS_SAFE_ASSERT_RECOVER_RETURN(spans.size() == 1);
 
-    const channels_type unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
-    Pixel *pixelPtr = reinterpret_cast<Pixel*>(dstPtr);
+        channels_type *plane = reinterpret_cast<channels_type*>(scratch);
+        normalizeChannelSpan(spans.first(), width, plane);
 
-    pixelPtr->blue  = readChannelValue<Traits>(channelBytes, 2, col, unitValue);
-    pixelPtr->green = readChannelValue<Traits>(channelBytes, 1, col, unitValue);
-    pixelPtr->red   = readChannelValue<Traits>(channelBytes, 0, col, unitValue);
-    pixelPtr->alpha = readChannelValue<Traits>(channelBytes, -1, col, unitValue);
+        for (int x = 0; x < width; x++) {
+            dstRow[x] = KoColorSpaceMaths<channels_type, quint8>::scaleToA(plane[x]);
+        }
+    }
+};
 
-}
+typedef void (*RowConverterFunc)(const QVector<ChannelRowSpan>&, int, quint8*, quint8*);
 
-template <class Traits>
-void readCmykPixel(const QMap<quint16, QByteArray> &channelBytes,
-                       int col, quint8 *dstPtr)
+template <typename channels_type>
+RowConverterFunc pixelRowConverter(int channelsCount)
 {
-    typedef typename Traits::Pixel Pixel;
-    typedef typename Traits::channels_type channels_type;
+    RowConverterFunc func = 0;
 
-    const channels_type unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
-    Pixel *pixelPtr = reinterpret_cast<Pixel*>(dstPtr);
+    switch (channelsCount) {
+    case 2:
+        func = &PlanarRowConverter<channels_type, 2>::convert;
+        break;
+    case 4:
+        func = &PlanarRowConverter<channels_type, 4>::convert;
+        break;
+    case 5:
+        func = &PlanarRowConverter<channels_type, 5>::convert;
+        break;
+    default:
+        KIS_SAFE_ASSERT_RECOVER_NOOP(0 && "unsupported number of channels");
+    }
 
-    pixelPtr->cyan    = unitValue - readChannelValue<Traits>(channelBytes, 0, col, unitValue);
-    pixelPtr->magenta = unitValue - readChannelValue<Traits>(channelBytes, 1, col, unitValue);
-    pixelPtr->yellow  = unitValue - readChannelValue<Traits>(channelBytes, 2, col, unitValue);
-    pixelPtr->black   = unitValue - readChannelValue<Traits>(channelBytes, 3, col, unitValue);
-    pixelPtr->alpha   = readChannelValue<Traits>(channelBytes, -1, col, unitValue);
+    return func;
 }
 
-template <class Traits>
-void readLabPixel(const QMap<quint16, QByteArray> &channelBytes,
-                  int col, quint8 *dstPtr)
+RowConverterFunc pixelRowConverter(int channelSize, int channelsCount)
 {
-    typedef typename Traits::Pixel Pixel;
-    typedef typename Traits::channels_type channels_type;
+    RowConverterFunc func = 0;
 
-    const channels_type unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
-    Pixel *pixelPtr = reinterpret_cast<Pixel*>(dstPtr);
-
-    pixelPtr->L = readChannelValue<Traits>(channelBytes, 0, col, unitValue);
-    pixelPtr->a = readChannelValue<Traits>(channelBytes, 1, col, unitValue);
-    pixelPtr->b = readChannelValue<Traits>(channelBytes, 2, col, unitValue);
-    pixelPtr->alpha = readChannelValue<Traits>(channelBytes, -1, col, unitValue);
-}
-
-void readRgbPixelCommon(int channelSize,
-                               const QMap<quint16, QByteArray> &channelBytes,
-                               int col, quint8 *dstPtr)
-{
     if (channelSize == 1) {
-        readRgbPixel<KoBgrU8Traits>(channelBytes, col, dstPtr);
+        func = pixelRowConverter<quint8>(channelsCount);
     } else if (channelSize == 2) {
-        readRgbPixel<KoBgrU16Traits>(channelBytes, col, dstPtr);
+        func = pixelRowConverter<quint16>(channelsCount);
     } else if (channelSize == 4) {
-        readRgbPixel<KoBgrU16Traits>(channelBytes, col, dstPtr);
+        func = pixelRowConverter<float>(channelsCount);
     }
-}
 
-void readGrayPixelCommon(int channelSize,
-                                const QMap<quint16, QByteArray> &channelBytes,
-                                int col, quint8 *dstPtr)
-{
-    if (channelSize == 1) {
-        readGrayPixel<KoGrayU8Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 2) {
-        readGrayPixel<KoGrayU16Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 4) {
-        readGrayPixel<KoGrayU32Traits>(channelBytes, col, dstPtr);
-    }
+    return func;
 }
 
-void readCmykPixelCommon(int channelSize,
-                                const QMap<quint16, QByteArray> &channelBytes,
-                                int col, quint8 *dstPtr)
+RowConverterFunc alphaMaskRowConverter(int channelSize)
 {
-    if (channelSize == 1) {
-        readCmykPixel<KoCmykU8Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 2) {
-        readCmykPixel<KoCmykU16Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 4) {
-        readCmykPixel<KoCmykF32Traits>(channelBytes, col, dstPtr);
-    }
-}
+    RowConverterFunc func = 0;
 
-void readLabPixelCommon(int channelSize,
-                                const QMap<quint16, QByteArray> &channelBytes,
-                                int col, quint8 *dstPtr)
-{
     if (channelSize == 1) {
-        readLabPixel<KoLabU8Traits>(channelBytes, col, dstPtr);
+        func = &AlphaMaskRowConverter<quint8>::convert;
     } else if (channelSize == 2) {
-        readLabPixel<KoLabU16Traits>(channelBytes, col, dstPtr);
+        func = &AlphaMaskRowConverter<quint16>::convert;
     } else if (channelSize == 4) {
-        readLabPixel<KoLabF32Traits>(channelBytes, col, dstPtr);
+        func = &AlphaMaskRowConverter<float>::convert;
     }
-}
 
-void readAlphaMaskPixelCommon(int channelSize,
-                                const QMap<quint16, QByteArray> &channelBytes,
-                                int col, quint8 *dstPtr)
-{
-    if (channelSize == 1) {
-        readAlphaMaskPixel<AlphaU8Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 2) {
-        readAlphaMaskPixel<AlphaU16Traits>(channelBytes, col, dstPtr);
-    } else if (channelSize == 4) {
-        readAlphaMaskPixel<AlphaF32Traits>(channelBytes, col, dstPtr);
-    }
+    return func;
 }
 
 /**********************************************************************/
@@ -391,48 +365,246 @@ psd_status psd_unzip_with_prediction(psd_uchar *src_buf, psd_int src_len,
 /* End of third party block                                           */
 /**********************************************************************/
 
-QMap<quint16, QByteArray> fetchChannelsBytes(QIODevice *io, QVector<ChannelInfo*> channelInfoRecords,
-                                            int row, int width, int channelSize, bool processMasks)
+/**
+ * Raw data of a single channel fetched from the file. The data is
+ * fetched sequentially, because QIODevice cannot be shared between
+ * threads, and then decompressed and converted in parallel.
+ */
+struct ChannelSource {
+    ChannelSource()
+        : channelId(0),
+          compressionType(Compression::Unknown),
+          failed(false)
+    {}
+
+    qint16 channelId;
+    Compression::CompressionType compressionType;
+
+    /**
+     * RLE: packed rows as they are stored in the file
+     * Uncompressed, ZIP: the whole plane (ZIP is inflated in-place)
+     */
+    QByteArray bytes;
+
+    /// RLE only: offsets and lengths of each packed row in \p bytes
+    QVector<int> rowOffsets;
+    QVector<int> rowLengths;
+
+    bool failed;
+};
+
+QVector<ChannelSource> fetchChannelSources(QIODevice *io, QVector<ChannelInfo*> channelInfoRecords,
+                                           const QRect &layerRect, int channelSize, bool processMasks)
 {
-    const int uncompressedLength = width * channelSize;
+    const int height = layerRect.height();
+    const int uncompressedLength = layerRect.width() * channelSize;
 
-    QMap<quint16, QByteArray> channelBytes;
+    QVector<ChannelSource> sources;
 
     Q_FOREACH (ChannelInfo *channelInfo, channelInfoRecords) {
         // user supplied masks are ignored here
         if (!processMasks && channelInfo->channelId < -1) continue;
 
-        io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
+        ChannelSource source;
+        source.channelId = channelInfo->channelId;
+        source.compressionType = channelInfo->compressionType;
 
         if (channelInfo->compressionType == Compression::Uncompressed) {
-            channelBytes[channelInfo->channelId] = io->read(uncompressedLength);
-            channelInfo->channelOffset += uncompressedLength;
+            const int planeLength = uncompressedLength * height;
+
+            io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
+            source.bytes = io->read(planeLength);
+            channelInfo->channelOffset += planeLength;
         }
         else if (channelInfo->compressionType == Compression::RLE) {
-            int rleLength = channelInfo->rleRowLengths[row];
-            QByteArray compressedBytes = io->read(rleLength);
-            QByteArray uncompressedBytes = Compression::uncompress(uncompressedLength, compressedBytes, channelInfo->compressionType);
-            channelBytes.insert(channelInfo->channelId, uncompressedBytes);
-            channelInfo->channelOffset += rleLength;
+            if (channelInfo->rleRowLengths.size() < height) {
+                QString error = QString("Not enough RLE rows for channel: id = %1, rows = %2, height = %3")
+                        .arg(channelInfo->channelId)
+                        .arg(channelInfo->rleRowLengths.size())
+                        .arg(height);
+                dbgFile << "ERROR: fetchChannelSources:" << error;
+                throw KisAslReaderUtils::ASLParseException(error);
+            }
+
+            source.rowOffsets.reserve(height);
+            source.rowLengths.reserve(height);
+
+            int totalLength = 0;
+            for (int row = 0; row < height; row++) {
+                const int rleLength = channelInfo->rleRowLengths[row];
+                source.rowOffsets.append(totalLength);
+                source.rowLengths.append(rleLength);
+                totalLength += rleLength;
+            }
+
+            io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
+            source.bytes = io->read(totalLength);
+            channelInfo->channelOffset += totalLength;
+        }
+        else if (channelInfo->compressionType == Compression::ZIP ||
+                 channelInfo->compressionType == Compression::ZIPWithPrediction) {
+
+            io->seek(channelInfo->channelDataStart);
+            source.bytes = io->read(channelInfo->channelDataLength);
         }
         else {
             QString error = QString("Unsupported Compression mode: %1").arg(channelInfo->compressionType);
-            dbgFile << "ERROR: fetchChannelsBytes:" << error;
+            dbgFile << "ERROR: fetchChannelSources:" << error;
             throw KisAslReaderUtils::ASLParseException(error);
         }
+
+        sources.append(source);
     }
 
-    return channelBytes;
+    return sources;
 }
 
-typedef boost::function<void(int, const QMap<quint16, QByteArray>&, int, quint8*)> PixelFunc;
+struct InflateChannel {
+    InflateChannel(const QRect &layerRect, int channelSize)
+        : m_layerRect(layerRect),
+          m_channelSize(channelSize)
+    {}
+
+    void operator() (ChannelSource &source) {
+        if (source.compressionType != Compression::ZIP &&
+            source.compressionType != Compression::ZIPWithPrediction) {
+
+            return;
+        }
+
+        const int numPixels = m_channelSize * m_layerRect.width() * m_layerRect.height();
+
+        QByteArray compressedBytes = source.bytes;
+        QByteArray uncompressedBytes(numPixels, 0);
+
+        bool status = false;
+        if (source.compressionType == Compression::ZIP) {
+            status = psd_unzip_without_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
+                                                  (quint8*)uncompressedBytes.data(), uncompressedBytes.size());
+        } else {
+            status = psd_unzip_with_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
+                                               (quint8*)uncompressedBytes.data(), uncompressedBytes.size(),
+                                               m_layerRect.width(), m_channelSize * 8);
+        }
+
+        source.failed = !status;
+        source.bytes = uncompressedBytes;
+    }
+
+    QRect m_layerRect;
+    int m_channelSize;
+};
+
+/**
+ * Decompresses and converts a horizontal band of the layer. The band
+ * never crosses the tile grid, so different bands never touch the
+ * same tile of the destination device.
+ */
+struct ConvertBand {
+    ConvertBand(KisPaintDeviceSP dev,
+                const QRect &layerRect,
+                int channelSize,
+                const QVector<ChannelSource> &sources,
+                const QVector<ChannelMapping> &mapping,
+                RowConverterFunc rowConverter)
+        : m_dev(dev),
+          m_layerRect(layerRect),
+          m_channelSize(channelSize),
+          m_sources(sources),
+          m_mapping(mapping),
+          m_rowConverter(rowConverter)
+    {}
+
+    void operator() (const QRect &bandRect) {
+        const int width = m_layerRect.width();
+        const int rowLength = width * m_channelSize;
+        const int dstRowLength = width * m_dev->pixelSize();
+
+        QVector<QByteArray> rleRows(m_mapping.size());
+        QVector<ChannelRowSpan> spans(m_mapping.size());
+        QByteArray scratch(m_mapping.size() * rowLength, 0);
+        QByteArray pixels(bandRect.height() * dstRowLength, 0);
+
+        for (int i = 0; i < bandRect.height(); i++) {
+            const int row = bandRect.y() - m_layerRect.y() + i;
+
+            for (int j = 0; j < m_mapping.size(); j++) {
+                const ChannelMapping &mapping = m_mapping[j];
+                const ChannelSource *source = sourceForChannel(mapping.channelId);
+
+                ChannelRowSpan &span = spans[j];
+                span.data = 0;
+                span.numPixels = 0;
+                span.pixelChannel = mapping.pixelChannel;
+                span.inverted = mapping.inverted;
+
+                if (!source) continue;
+
+                if (source->compressionType == Compression::RLE) {
+                    const QByteArray packedRow =
+                        QByteArray::fromRawData(source->bytes.constData() + source->rowOffsets[row],
+                                                qMax(0, qMin(source->rowLengths[row],
+                                                             source->bytes.size() - source->rowOffsets[row])));
+
+                    rleRows[j] = Compression::uncompress(rowLength, packedRow, Compression::RLE);
+                    span.data = reinterpret_cast<const quint8*>(rleRows[j].constData());
+                    span.numPixels = rleRows[j].size() / m_channelSize;
+                } else {
+                    const int offset = row * rowLength;
+                    span.data = reinterpret_cast<const quint8*>(source->bytes.constData()) + offset;
+                    span.numPixels = qBound(0, source->bytes.size() - offset, rowLength) / m_channelSize;
+                }
+            }
+
+            m_rowConverter(spans, width,
+                           reinterpret_cast<quint8*>(scratch.data()),
+                           reinterpret_cast<quint8*>(pixels.data()) + i * dstRowLength);
+        }
+
+        m_dev->writeBytes(reinterpret_cast<const quint8*>(pixels.constData()), bandRect);
+    }
+
+    const ChannelSource* sourceForChannel(qint16 channelId) const {
+        Q_FOREACH (const ChannelSource &source, m_sources) {
+            if (source.channelId == channelId) {
+                return &source;
+            }
+        }
+        return 0;
+    }
+
+    KisPaintDeviceSP m_dev;
+    QRect m_layerRect;
+    int m_channelSize;
+    const QVector<ChannelSource> &m_sources;
+    QVector<ChannelMapping> m_mapping;
+    RowConverterFunc m_rowConverter;
+};
+
+QVector<QRect> splitIntoTileBands(const QRect &rc)
+{
+    // the height of a tile of KisTiledDataManager
+    const int bandHeight = 64;
+
+    QVector<QRect> bands;
+
+    int y = rc.top();
+    while (y <= rc.bottom()) {
+        const int nextY = qMin((KisAlgebra2D::divideFloor(y, bandHeight) + 1) * bandHeight, rc.bottom() + 1);
+        bands << QRect(rc.left(), y, rc.width(), nextY - y);
+        y = nextY;
+    }
+
+    return bands;
+}
 
 void readCommon(KisPaintDeviceSP dev,
                 QIODevice *io,
                 const QRect &layerRect,
                 QVector<ChannelInfo*> infoRecords,
                 int channelSize,
-                PixelFunc pixelFunc,
+                const QVector<ChannelMapping> &mapping,
+                RowConverterFunc rowConverter,
                 bool processMasks)
 {
     KisOffsetKeeper keeper(io);
@@ -442,64 +614,28 @@ void readCommon(KisPaintDeviceSP dev,
         return;
     }
 
-    if (infoRecords.first()->compressionType == Compression::ZIP ||
-        infoRecords.first()->compressionType == Compression::ZIPWithPrediction) {
-
-        const int numPixels = channelSize * layerRect.width() * layerRect.height();
-
-        QMap<quint16, QByteArray> channelBytes;
-
-        Q_FOREACH (ChannelInfo *info, infoRecords) {
-            io->seek(info->channelDataStart);
-            QByteArray compressedBytes = io->read(info->channelDataLength);
-            QByteArray uncompressedBytes(numPixels, 0);
-
-            bool status = false;
-            if (infoRecords.first()->compressionType == Compression::ZIP) {
-                status = psd_unzip_without_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                      (quint8*)uncompressedBytes.data(), uncompressedBytes.size());
-            } else {
-                status = psd_unzip_with_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                   (quint8*)uncompressedBytes.data(), uncompressedBytes.size(),
-                                                   layerRect.width(), channelSize * 8);
-            }
-
-            if (!status) {
-                QString error = QString("Failed to unzip channel data: id = %1, compression = %2").arg(info->channelId).arg(info->compressionType);
-                dbgFile << "ERROR:" << error;
-                dbgFile << "      " << ppVar(info->channelId);
-                dbgFile << "      " << ppVar(info->channelDataStart);
-                dbgFile << "      " << ppVar(info->channelDataLength);
-                dbgFile << "      " << ppVar(info->compressionType);
-                throw KisAslReaderUtils::ASLParseException(error);
-            }
-
-            channelBytes.insert(info->channelId, uncompressedBytes);
-        }
-
-        KisSequentialIterator it(dev, layerRect);
-        int col = 0;
-        while (it.nextPixel()) {
-            pixelFunc(channelSize, channelBytes, col, it.rawData());
-            col++;
-        }
+    if (!rowConverter) {
+        QString error = QString("Unsupported channel size: %1").arg(channelSize);
+        throw KisAslReaderUtils::ASLParseException(error);
+    }
 
-    } else {
-        KisHLineIteratorSP it = dev->createHLineIteratorNG(layerRect.left(), layerRect.top(), layerRect.width());
-        for (int i = 0 ; i < layerRect.height(); i++) {
-            QMap<quint16, QByteArray> channelBytes;
+    QVector<ChannelSource> sources =
+        fetchChannelSources(io, infoRecords, layerRect, channelSize, processMasks);
 
-            channelBytes = fetchChannelsBytes(io, infoRecords,
-                                              i, layerRect.width(),
-                                              channelSize, processMasks);
+    QtConcurrent::blockingMap(sources, InflateChannel(layerRect, channelSize));
 
-            for (qint64 col = 0; col < layerRect.width(); col++){
-                pixelFunc(channelSize, channelBytes, col, it->rawData());
-                it->nextPixel();
-            }
-            it->nextRow();
+    Q_FOREACH (const ChannelSource &source, sources) {
+        if (source.failed) {
+            QString error = QString("Failed to unzip channel data: id = %1, compression = %2").arg(source.channelId).arg(source.compressionType);
+            dbgFile << "ERROR:" << error;
+            dbgFile << "      " << ppVar(source.channelId);
+            dbgFile << "      " << ppVar(source.compressionType);
+            throw KisAslReaderUtils::ASLParseException(error);
         }
     }
+
+    QVector<QRect> bands = splitIntoTileBands(layerRect);
+    QtConcurrent::blockingMap(bands, ConvertBand(dev, layerRect, channelSize, sources, mapping, rowConverter));
 }
 
 void readChannels(QIODevice *io,
@@ -509,28 +645,10 @@ void readChannels(QIODevice *io,
                   const QRect &layerRect,
                   QVector<ChannelInfo*> infoRecords)
 {
-    switch (colorMode) {
-    case Grayscale:
-        readCommon(device, io, layerRect, infoRecords, channelSize, &readGrayPixelCommon, false);
-        break;
-    case RGB:
-        readCommon(device, io, layerRect, infoRecords, channelSize, &readRgbPixelCommon, false);
-        break;
-    case CMYK:
-        readCommon(device, io, layerRect, infoRecords, channelSize, &readCmykPixelCommon, false);
-        break;
-    case Lab:
-        readCommon(device, io, layerRect, infoRecords, channelSize, &readLabPixelCommon, false);
-        break;
-    case Bitmap:
-    case Indexed:
-    case MultiChannel:
-    case DuoTone:
-    case COLORMODE_UNKNOWN:
-    default:
-        QString error = QString("Unsupported color mode: %1").arg(colorMode);
-        throw KisAslReaderUtils::ASLParseException(error);
-    }
+    const QVector<ChannelMapping> mapping = channelMappingForColorMode(colorMode, channelSize);
+    RowConverterFunc rowConverter = pixelRowConverter(channelSize, mapping.size());
+
+    readCommon(device, io, layerRect, infoRecords, channelSize, mapping, rowConverter, false);
 }
 
 void readAlphaMaskChannels(QIODevice *io,
@@ -540,7 +658,11 @@ void readAlphaMaskChannels(QIODevice *io,
                            QVector<ChannelInfo*> infoRecords)
 {
     KIS_SAFE_ASSERT_RECOVER_RETURN(infoRecords.size() == 1);
-    readCommon(device, io, layerRect, infoRecords, channelSize, &readAlphaMaskPixelCommon, true);
+
+    QVector<ChannelMapping> mapping;
+    mapping << ChannelMapping{infoRecords.first()->channelId, 0, false};
+
+    readCommon(device, io, layerRect, infoRecords, channelSize, mapping, alphaMaskRowConverter(channelSize), true);
 }
 
 void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSize, const QRect &rc, const qint64 sizeFieldOffset, const qint64 rleBlockOffset, const bool writeCompressionType)
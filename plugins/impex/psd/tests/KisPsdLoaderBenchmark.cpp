@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisPsdLoaderBenchmark.h"
+
+#include <QTest>
+
+#include <sdk/tests/testui.h>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <KisImportExportManager.h>
+#include <KisImportExportErrorCode.h>
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_paint_device.h>
+#include <kis_surrogate_undo_store.h>
+
+namespace {
+
+const QSize benchmarkImageSize(4000, 3000);
+const int benchmarkNumLayers = 8;
+
+/**
+ * Fills the device with a smooth pattern with a bit of noise, so
+ * that RLE compression doesn't collapse the rows to nothing
+ */
+void fillWithPattern(KisPaintDeviceSP dev, const QRect &rc, int seed)
+{
+    const int pixelSize = dev->pixelSize();
+    QByteArray row(rc.width() * pixelSize, 0);
+    quint32 noise = seed * 2654435761U;
+
+    for (int y = rc.top(); y <= rc.bottom(); y++) {
+        quint8 *ptr = reinterpret_cast<quint8*>(row.data());
+
+        for (int x = 0; x < rc.width(); x++) {
+            noise = noise * 1664525U + 1013904223U;
+
+            for (int i = 0; i < pixelSize; i++) {
+                *ptr++ = ((x + seed * 37) >> (i % 3)) ^ (y >> 2) ^ ((noise >> 28) & 0x3);
+            }
+        }
+
+        dev->writeBytes(reinterpret_cast<const quint8*>(row.constData()), QRect(rc.x(), y, rc.width(), 1));
+    }
+}
+
+}
+
+void KisPsdLoaderBenchmark::benchmarkLoading(const KoColorSpace *cs, const QString &fileName)
+{
+    const QRect imageRect(QPoint(), benchmarkImageSize);
+
+    {
+        // the document should be created before the image!
+        QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+
+        KisImageSP image = new KisImage(new KisSurrogateUndoStore(), imageRect.width(), imageRect.height(), cs, "psd benchmark");
+
+        for (int i = 0; i < benchmarkNumLayers; i++) {
+            KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer %1").arg(i), OPACITY_OPAQUE_U8);
+
+            // layers are intentionally not aligned to the tile grid
+            const QRect layerRect = imageRect.adjusted(13 * i, 7 * i, -11 * i, -5 * i);
+            fillWithPattern(layer->paintDevice(), layerRect, i + 1);
+
+            image->addNode(layer);
+        }
+
+        doc->setCurrentImage(image);
+        doc->setFileBatchMode(true);
+
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), "image/vnd.adobe.photoshop"));
+    }
+
+    QBENCHMARK_ONCE {
+        QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+        doc->setFileBatchMode(true);
+
+        KisImportExportManager manager(doc.data());
+        KisImportExportErrorCode status = manager.importDocument(fileName, QString());
+
+        QVERIFY(status.isOk());
+        QVERIFY(doc->image());
+        QCOMPARE(doc->image()->root()->childCount(), quint32(benchmarkNumLayers));
+    }
+}
+
+void KisPsdLoaderBenchmark::testLoadRgb8()
+{
+    benchmarkLoading(KoColorSpaceRegistry::instance()->rgb8(), "psd_benchmark_rgb8.psd");
+}
+
+void KisPsdLoaderBenchmark::testLoadRgb16()
+{
+    benchmarkLoading(KoColorSpaceRegistry::instance()->rgb16(), "psd_benchmark_rgb16.psd");
+}
+
+void KisPsdLoaderBenchmark::testLoadCmyk8()
+{
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(CMYKAColorModelID.id(), Integer8BitsColorDepthID.id(), 0);
+    benchmarkLoading(cs, "psd_benchmark_cmyk8.psd");
+}
+
+KISTEST_MAIN(KisPsdLoaderBenchmark)
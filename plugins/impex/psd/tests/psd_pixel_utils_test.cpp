@@ -0,0 +1,164 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "psd_pixel_utils_test.h"
+
+#include <QTest>
+#include <QBuffer>
+#include <QtEndian>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KoChannelInfo.h>
+
+#include "kistest.h"
+#include "kis_paint_device.h"
+#include "psd_pixel_utils.h"
+#include "psd_layer_record.h"
+
+
+namespace {
+
+/**
+ * The value of the channel \p channel (in display order, alpha is the
+ * last one) of the pixel at \p pt. The pattern is different for every
+ * channel, so swapped channels cannot go unnoticed.
+ */
+qreal patternValue(const QPoint &pt, int channel)
+{
+    return qreal((pt.x() * (3 + channel) + pt.y() * (7 - channel) + channel * 50) % 256) / 255.0;
+}
+
+void appendChannelValue(QByteArray &plane, qreal value, int channelSize)
+{
+    if (channelSize == 1) {
+        plane.append(char(qRound(value * 255.0)));
+    } else if (channelSize == 2) {
+        const quint16 channelValue = qToBigEndian(quint16(qRound(value * 65535.0)));
+        plane.append(reinterpret_cast<const char*>(&channelValue), sizeof(channelValue));
+    } else {
+        float channelValue = value;
+        quint32 bits;
+        memcpy(&bits, &channelValue, sizeof(bits));
+        bits = qToBigEndian(bits);
+        plane.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+    }
+}
+
+}
+
+void PsdPixelUtilsTest::testReadChannels(const KoColorSpace *cs, int channelSize)
+{
+    QVERIFY(cs);
+
+    const bool isCmyk = cs->colorModelId() == CMYKAColorModelID;
+    const psd_color_mode colorMode = isCmyk ? CMYK : RGB;
+    const int numColorChannels = isCmyk ? 4 : 3;
+
+    // the layer crosses the tile grid and its width is unaligned
+    const QRect layerRect(3, 5, 70, 90);
+
+    QByteArray data;
+    QVector<ChannelInfo> channels;
+
+    for (int channel = 0; channel <= numColorChannels; channel++) {
+        const bool isAlpha = channel == numColorChannels;
+
+        ChannelInfo info;
+        info.channelId = isAlpha ? -1 : channel;
+        info.compressionType = Compression::Uncompressed;
+        info.channelDataStart = data.size();
+
+        for (int y = layerRect.top(); y <= layerRect.bottom(); y++) {
+            for (int x = layerRect.left(); x <= layerRect.right(); x++) {
+                const qreal value = patternValue(QPoint(x, y), channel);
+
+                // PSD stores CMYK color channels inverted
+                appendChannelValue(data, isCmyk && !isAlpha ? 1.0 - value : value, channelSize);
+            }
+        }
+
+        channels.append(info);
+    }
+
+    QVector<ChannelInfo*> infoRecords;
+    for (int i = 0; i < channels.size(); i++) {
+        infoRecords.append(&channels[i]);
+    }
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    PsdPixelUtils::readChannels(&buffer, dev, colorMode, channelSize, layerRect, infoRecords);
+
+    QCOMPARE(dev->exactBounds(), layerRect);
+
+    const QList<KoChannelInfo*> csChannels = cs->channels();
+    const QList<KoChannelInfo*> displayChannels = KoChannelInfo::displayOrderSorted(csChannels);
+
+    QVector<float> normalisedValues(cs->channelCount());
+    QByteArray pixel(cs->pixelSize(), 0);
+
+    for (int y = layerRect.top(); y <= layerRect.bottom(); y++) {
+        for (int x = layerRect.left(); x <= layerRect.right(); x++) {
+            dev->readBytes(reinterpret_cast<quint8*>(pixel.data()), x, y, 1, 1);
+            cs->normalisedChannelsValue(reinterpret_cast<const quint8*>(pixel.constData()), normalisedValues);
+
+            for (int channel = 0; channel < displayChannels.size(); channel++) {
+                const int channelIndex =
+                    KoChannelInfo::displayPositionToChannelIndex(displayChannels[channel]->displayPosition(), csChannels);
+
+                const qreal expected = patternValue(QPoint(x, y), channel);
+                const qreal loaded = normalisedValues[channelIndex];
+
+                if (qAbs(loaded - expected) > 1e-4) {
+                    QFAIL(qPrintable(QString("Wrong channel value: pixel (%1, %2), channel %3, expected %4, loaded %5")
+                                     .arg(x).arg(y).arg(channel).arg(expected).arg(loaded)));
+                }
+            }
+        }
+    }
+}
+
+void PsdPixelUtilsTest::testReadRgb8()
+{
+    testReadChannels(KoColorSpaceRegistry::instance()->rgb8(), 1);
+}
+
+void PsdPixelUtilsTest::testReadRgb16()
+{
+    testReadChannels(KoColorSpaceRegistry::instance()->rgb16(), 2);
+}
+
+void PsdPixelUtilsTest::testReadRgbF32()
+{
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), 0);
+    testReadChannels(cs, 4);
+}
+
+void PsdPixelUtilsTest::testReadCmyk8()
+{
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(CMYKAColorModelID.id(), Integer8BitsColorDepthID.id(), 0);
+    testReadChannels(cs, 1);
+}
+
+KISTEST_MAIN(PsdPixelUtilsTest)
@@ -42,6 +42,7 @@
 #include <kis_transaction.h>
 
 #include "kis_tiff_reader.h"
+#include "kis_tiff_parallel_reader.h"
 #include "kis_tiff_ycbcr_reader.h"
 #include "kis_buffer_stream.h"
 #include "kis_tiff_writer_visitor.h"
@@ -283,7 +284,7 @@ KisImportExportErrorCode KisTIFFConverter::decode(const QString &filename)
     }
     do {
         dbgFile << "Read new sub-image";
-        KisImportExportErrorCode result = readTIFFDirectory(image);
+        KisImportExportErrorCode result = readTIFFDirectory(image, filename);
         if (!result.isOk()) {
             return result;
         }
@@ -293,7 +294,7 @@ KisImportExportErrorCode KisTIFFConverter::decode(const QString &filename)
     return ImportExportCodes::OK;
 }
 
-KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image)
+KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image, const QString &filename)
 {
     // Read information about the tiff
     uint32 width, height;
@@ -541,6 +542,41 @@ KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image)
         break;
     }
 
+    // Try to decode the common formats in parallel first
+    {
+        KisTIFFParallelReader::Configuration config;
+        config.filename = filename;
+        config.directory = TIFFCurrentDirectory(image);
+        config.width = width;
+        config.height = height;
+        config.depth = depth;
+        config.sampleFormat = sampletype;
+        config.colorType = color_type;
+        config.planarConfig = planarconfig;
+        config.nbChannels = nbchannels;
+        config.nbColorSamples = nbcolorsamples;
+        config.alphaPos = alphapos;
+        config.alphaValue =
+            depth == 8 ? quint8_MAX :
+            depth == 16 ? (sampletype == SAMPLEFORMAT_IEEEFP ? 15360 : quint16_MAX) : // 15360 is 1.0 in half
+            sampletype == SAMPLEFORMAT_IEEEFP ? 0x3f800000 : quint32_MAX; // 0x3f800000 is 1.0f
+        memcpy(config.poses, poses, sizeof(poses));
+
+        if (depth == dstDepth &&
+            KisTIFFParallelReader::canRead(config, cs, transform)) {
+
+            KisTIFFParallelReader reader(layer->paintDevice(), config);
+
+            if (reader.read()) {
+                delete postprocessor;
+                m_image->addNode(KisNodeSP(layer), m_image->rootLayer().data());
+                return ImportExportCodes::OK;
+            }
+
+            dbgFile << "Parallel decoding failed, falling back to the sequential reader";
+            layer->paintDevice()->clear();
+        }
+    }
 
     // Initisalize tiffReader
     uint16 * lineSizeCoeffs = new uint16[nbchannels];
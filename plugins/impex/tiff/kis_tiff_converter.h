@@ -61,7 +61,7 @@ public Q_SLOTS:
     virtual void cancel();
 private:
     KisImportExportErrorCode decode(const QString &filename);
-    KisImportExportErrorCode readTIFFDirectory(TIFF* image);
+    KisImportExportErrorCode readTIFFDirectory(TIFF* image, const QString &filename);
 private:
     KisImageSP m_image;
     KisDocument *m_doc;
@@ -0,0 +1,312 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tiff_parallel_reader.h"
+
+#include <QFile>
+#include <QRect>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QtConcurrent>
+
+#include <KoColorSpace.h>
+#include <kis_debug.h>
+#include <kis_paint_device.h>
+
+namespace {
+
+struct Block {
+    Block() : index(0) {}
+    Block(uint32 _index, const QRect &_rect) : index(_index), rect(_rect) {}
+
+    uint32 index;
+    QRect rect;
+};
+
+struct RowParams {
+    const quint8 *poses;
+    int srcSamples;
+    int alphaSample;
+    quint32 alphaValue;
+};
+
+typedef void (*RowConverterFunc)(const quint8 *src, quint8 *dst, int width, const RowParams &params);
+
+/**
+ * Converts a row of chunky TIFF samples into Krita's pixels. The sample
+ * type is only used for its size: all the supported formats are copied
+ * bit-exactly.
+ */
+template <typename T, int nbColorSamples, bool invert>
+void convertRow(const quint8 *src, quint8 *dst, int width, const RowParams &params)
+{
+    const T *s = reinterpret_cast<const T*>(src);
+    T *d = reinterpret_cast<T*>(dst);
+
+    const T maxValue = T(~T(0));
+    const T defaultAlpha = T(params.alphaValue);
+    const int dstChannels = nbColorSamples + 1;
+    const int alphaDstPos = params.poses[nbColorSamples];
+
+    for (int x = 0; x < width; x++) {
+        for (int i = 0; i < nbColorSamples; i++) {
+            d[params.poses[i]] = invert ? T(maxValue - s[i]) : s[i];
+        }
+
+        d[alphaDstPos] = params.alphaSample >= 0 ? s[nbColorSamples + params.alphaSample] : defaultAlpha;
+
+        s += params.srcSamples;
+        d += dstChannels;
+    }
+}
+
+template <typename T>
+RowConverterFunc rowConverter(int nbColorSamples, bool invert)
+{
+    RowConverterFunc func = 0;
+
+    if (invert) {
+        if (nbColorSamples == 1) {
+            func = &convertRow<T, 1, true>;
+        }
+    } else {
+        switch (nbColorSamples) {
+        case 1:
+            func = &convertRow<T, 1, false>;
+            break;
+        case 3:
+            func = &convertRow<T, 3, false>;
+            break;
+        case 4:
+            func = &convertRow<T, 4, false>;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return func;
+}
+
+RowConverterFunc rowConverter(const KisTIFFParallelReader::Configuration &config)
+{
+    const bool invert = config.colorType == PHOTOMETRIC_MINISWHITE;
+
+    RowConverterFunc func = 0;
+
+    switch (config.depth) {
+    case 8:
+        func = rowConverter<quint8>(config.nbColorSamples, invert);
+        break;
+    case 16:
+        func = rowConverter<quint16>(config.nbColorSamples, invert);
+        break;
+    case 32:
+        func = rowConverter<quint32>(config.nbColorSamples, invert);
+        break;
+    default:
+        break;
+    }
+
+    return func;
+}
+
+struct ReadBlocks {
+    ReadBlocks(KisPaintDeviceSP device,
+               const KisTIFFParallelReader::Configuration &config,
+               RowConverterFunc converter,
+               bool isTiled,
+               QAtomicInt *failed)
+        : m_device(device),
+          m_config(config),
+          m_converter(converter),
+          m_isTiled(isTiled),
+          m_failed(failed)
+    {}
+
+    void operator() (const QVector<Block> &blocks) {
+        TIFF *image = TIFFOpen(QFile::encodeName(m_config.filename), "r");
+
+        if (!image) {
+            m_failed->storeRelease(1);
+            return;
+        }
+
+        if (!TIFFSetDirectory(image, m_config.directory)) {
+            m_failed->storeRelease(1);
+            TIFFClose(image);
+            return;
+        }
+
+        const tmsize_t bufferSize = m_isTiled ? TIFFTileSize(image) : TIFFStripSize(image);
+        const tmsize_t rowStride = m_isTiled ? TIFFTileRowSize(image) : TIFFScanlineSize(image);
+        tdata_t buffer = _TIFFmalloc(bufferSize);
+
+        const int pixelSize = m_device->pixelSize();
+
+        RowParams params;
+        params.poses = m_config.poses;
+        params.srcSamples = m_config.nbChannels;
+        params.alphaSample = m_config.alphaPos;
+        params.alphaValue = m_config.alphaValue;
+
+        QByteArray pixels;
+
+        Q_FOREACH (const Block &block, blocks) {
+            if (m_failed->loadAcquire()) break;
+
+            const tmsize_t bytesRead = m_isTiled ?
+                TIFFReadEncodedTile(image, block.index, buffer, bufferSize) :
+                TIFFReadEncodedStrip(image, block.index, buffer, bufferSize);
+
+            if (bytesRead < rowStride * block.rect.height()) {
+                dbgFile << "Failed to decode block" << block.index << "of" << m_config.filename;
+                m_failed->storeRelease(1);
+                break;
+            }
+
+            const int dstRowStride = block.rect.width() * pixelSize;
+            pixels.resize(dstRowStride * block.rect.height());
+
+            const quint8 *srcPtr = static_cast<const quint8*>(buffer);
+            quint8 *dstPtr = reinterpret_cast<quint8*>(pixels.data());
+
+            for (int row = 0; row < block.rect.height(); row++) {
+                m_converter(srcPtr, dstPtr, block.rect.width(), params);
+                srcPtr += rowStride;
+                dstPtr += dstRowStride;
+            }
+
+            m_device->writeBytes(reinterpret_cast<const quint8*>(pixels.constData()), block.rect);
+        }
+
+        _TIFFfree(buffer);
+        TIFFClose(image);
+    }
+
+    KisPaintDeviceSP m_device;
+    KisTIFFParallelReader::Configuration m_config;
+    RowConverterFunc m_converter;
+    bool m_isTiled;
+    QAtomicInt *m_failed;
+};
+
+}
+
+KisTIFFParallelReader::KisTIFFParallelReader(KisPaintDeviceSP device, const Configuration &config)
+    : m_device(device),
+      m_config(config)
+{
+}
+
+bool KisTIFFParallelReader::canRead(const Configuration &config, const KoColorSpace *cs, bool hasTransform)
+{
+    if (hasTransform || config.filename.isEmpty()) return false;
+    if (config.planarConfig != PLANARCONFIG_CONTIG) return false;
+
+    if (config.colorType != PHOTOMETRIC_MINISBLACK &&
+        config.colorType != PHOTOMETRIC_MINISWHITE &&
+        config.colorType != PHOTOMETRIC_RGB &&
+        config.colorType != PHOTOMETRIC_SEPARATED &&
+        config.colorType != PHOTOMETRIC_ICCLAB) {
+
+        return false;
+    }
+
+    // inverting floating point samples needs a real conversion
+    if (config.colorType == PHOTOMETRIC_MINISWHITE &&
+        config.sampleFormat == SAMPLEFORMAT_IEEEFP) {
+
+        return false;
+    }
+
+    // only byte-aligned samples that are copied without rescaling
+    if (config.depth != 8 && config.depth != 16 && config.depth != 32) return false;
+    if (int(cs->pixelSize()) != (config.nbColorSamples + 1) * config.depth / 8) return false;
+    if (int(cs->channelCount()) != config.nbColorSamples + 1) return false;
+    if (config.nbChannels < config.nbColorSamples) return false;
+
+    return rowConverter(config) != 0;
+}
+
+bool KisTIFFParallelReader::read()
+{
+    RowConverterFunc converter = rowConverter(m_config);
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(converter, false);
+
+    TIFF *image = TIFFOpen(QFile::encodeName(m_config.filename), "r");
+    if (!image) return false;
+
+    if (!TIFFSetDirectory(image, m_config.directory)) {
+        TIFFClose(image);
+        return false;
+    }
+
+    QVector<Block> blocks;
+    const bool isTiled = TIFFIsTiled(image);
+
+    if (isTiled) {
+        uint32 tileWidth = 0;
+        uint32 tileHeight = 0;
+        TIFFGetField(image, TIFFTAG_TILEWIDTH, &tileWidth);
+        TIFFGetField(image, TIFFTAG_TILELENGTH, &tileHeight);
+
+        if (!tileWidth || !tileHeight) {
+            TIFFClose(image);
+            return false;
+        }
+
+        for (uint32 y = 0; y < m_config.height; y += tileHeight) {
+            for (uint32 x = 0; x < m_config.width; x += tileWidth) {
+                const QRect rc(x, y,
+                               qMin(tileWidth, m_config.width - x),
+                               qMin(tileHeight, m_config.height - y));
+                blocks << Block(TIFFComputeTile(image, x, y, 0, 0), rc);
+            }
+        }
+    } else {
+        uint32 rowsPerStrip = 0;
+        TIFFGetFieldDefaulted(image, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+        rowsPerStrip = qBound(1U, rowsPerStrip, m_config.height);
+
+        for (uint32 y = 0; y < m_config.height; y += rowsPerStrip) {
+            const QRect rc(0, y, m_config.width, qMin(rowsPerStrip, m_config.height - y));
+            blocks << Block(TIFFComputeStrip(image, y, 0), rc);
+        }
+    }
+
+    TIFFClose(image);
+
+    /**
+     * Every worker opens its own handle, so distribute the blocks
+     * between a limited number of workers in an interleaved manner
+     * to keep them equally loaded.
+     */
+    const int numWorkers = qBound(1, QThreadPool::globalInstance()->maxThreadCount(), blocks.size());
+    QVector<QVector<Block>> workerBlocks(numWorkers);
+
+    for (int i = 0; i < blocks.size(); i++) {
+        workerBlocks[i % numWorkers].append(blocks[i]);
+    }
+
+    QAtomicInt failed(0);
+    QtConcurrent::blockingMap(workerBlocks, ReadBlocks(m_device, m_config, converter, isTiled, &failed));
+
+    return !failed.loadAcquire();
+}
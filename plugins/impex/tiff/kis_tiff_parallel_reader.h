@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2020 Krita developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _KIS_TIFF_PARALLEL_READER_H_
+#define _KIS_TIFF_PARALLEL_READER_H_
+
+// On some platforms, tiffio.h #defines 0 in a bad
+// way for C++, as (void *)0 instead of using the correct
+// C++ value 0. Include stdio.h first to get the right one.
+#include <stdio.h>
+#include <tiffio.h>
+
+#include <QString>
+
+#include <kis_types.h>
+
+class KoColorSpace;
+
+/**
+ * A fast path for reading the most common kind of TIFF files:
+ * contiguous (chunky) samples of 8, 16 or 32 bits that map directly
+ * onto the channels of the destination color space without any
+ * color transformation.
+ *
+ * Tiles or strips of the directory are decoded on the global thread
+ * pool. libtiff handles cannot be shared between threads, so every
+ * worker opens its own handle to the file. Rows are converted by
+ * templated per-format kernels and written into the paint device
+ * block-by-block.
+ *
+ * If anything goes wrong, read() returns false and the caller is
+ * expected to fall back to the generic KisTIFFReaderBase path, which
+ * is more tolerant to broken files.
+ */
+class KisTIFFParallelReader
+{
+public:
+    struct Configuration {
+        Configuration()
+            : directory(0),
+              width(0),
+              height(0),
+              depth(0),
+              sampleFormat(SAMPLEFORMAT_UINT),
+              colorType(PHOTOMETRIC_MINISBLACK),
+              planarConfig(PLANARCONFIG_CONTIG),
+              nbChannels(0),
+              nbColorSamples(0),
+              alphaPos(-1),
+              alphaValue(0)
+        {
+            for (int i = 0; i < 5; i++) {
+                poses[i] = i;
+            }
+        }
+
+        QString filename;
+        tdir_t directory;
+
+        uint32 width;
+        uint32 height;
+        uint16 depth;
+        uint16 sampleFormat;
+        uint16 colorType;
+        uint16 planarConfig;
+
+        /// the total number of samples per pixel, including extra samples
+        uint16 nbChannels;
+        uint8 nbColorSamples;
+
+        /// the index of the alpha channel among extra samples, -1 if none
+        int8 alphaPos;
+
+        /// bit pattern of the alpha value used when there is no alpha sample
+        uint32 alphaValue;
+
+        quint8 poses[5];
+    };
+
+public:
+    KisTIFFParallelReader(KisPaintDeviceSP device, const Configuration &config);
+
+    /**
+     * @return true if the directory can be read by the fast path into a
+     *         device of \p cs color space
+     */
+    static bool canRead(const Configuration &config, const KoColorSpace *cs, bool hasTransform);
+
+    /**
+     * Reads the whole directory into the device
+     * @return false if the decoding failed
+     */
+    bool read();
+
+private:
+    KisPaintDeviceSP m_device;
+    Configuration m_config;
+};
+
+#endif
@@ -30,6 +30,12 @@
 #include "kisexiv2/kis_exiv2.h"
 #include  <sdk/tests/testui.h>
 #include <KoColorModelStandardIdsUtils.h>
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <KisImportExportManager.h>
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_surrogate_undo_store.h>
 
 #ifndef FILES_DATA_DIR
 #error "FILES_DATA_DIR not set. A directory with the data used for testing the importing of files in krita"
@@ -118,6 +124,64 @@ void KisTiffTest::testRoundTripRGBF16()
 #endif
 }
 
+void KisTiffTest::testRoundTripBenchmark()
+{
+    const QRect imageRect(0, 0, 6000, 4000);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QString fileName("tiff_roundtrip_benchmark.tif");
+
+    QImage refImage;
+
+    {
+        // the document should be created before the image!
+        QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+
+        KisImageSP image = new KisImage(new KisSurrogateUndoStore(), imageRect.width(), imageRect.height(), cs, "tiff benchmark");
+        KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8);
+        image->addNode(layer);
+
+        QByteArray row(imageRect.width() * cs->pixelSize(), 0);
+        for (int y = 0; y < imageRect.height(); y++) {
+            quint8 *ptr = reinterpret_cast<quint8*>(row.data());
+            for (int x = 0; x < imageRect.width(); x++) {
+                ptr[0] = x;
+                ptr[1] = y;
+                ptr[2] = x ^ y;
+                ptr[3] = 255 - ((x + y) >> 6);
+                ptr += 4;
+            }
+            layer->paintDevice()->writeBytes(reinterpret_cast<const quint8*>(row.constData()),
+                                             QRect(0, y, imageRect.width(), 1));
+        }
+
+        image->initialRefreshGraph();
+        refImage = image->projection()->convertToQImage(0, imageRect);
+
+        doc->setCurrentImage(image);
+        doc->setFileBatchMode(true);
+
+        QBENCHMARK_ONCE {
+            QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), TiffMimetype.toLatin1()));
+        }
+    }
+
+    QBENCHMARK_ONCE {
+        QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+        doc->setFileBatchMode(true);
+
+        KisImportExportManager manager(doc.data());
+        KisImportExportErrorCode status = manager.importDocument(fileName, QString());
+        QVERIFY(status.isOk());
+        QVERIFY(doc->image());
+
+        doc->image()->waitForDone();
+        QImage resultImage = doc->image()->projection()->convertToQImage(0, imageRect);
+
+        QPoint pt;
+        QVERIFY(TestUtil::compareQImages(pt, refImage, resultImage));
+    }
+}
+
 void KisTiffTest::testSaveTiffColorSpace(QString colorModel, QString colorDepth, QString colorProfile)
 {
     const KoColorSpace *space = KoColorSpaceRegistry::instance()->colorSpace(colorModel, colorDepth, colorProfile);
@@ -77,6 +77,21 @@ struct KisLiquifyTransformStrategy::Private
 
     QImage transformedImage;
 
+    /**
+     * The state of the last generated preview. If neither the thumbnail
+     * nor its transform have changed, the preview is updated incrementally,
+     * only in the area touched by the last dabs.
+     */
+    QImage scaledOriginalImage;
+    QTransform scaledOriginalTransform;
+    qint64 scaledOriginalSourceKey = 0;
+
+    const KisLiquifyTransformWorker *previewWorker = 0;
+    qint64 previewSourceKey = 0;
+    QTransform previewTransform;
+    QPointF previewSourceOffset;
+    QPointF previewOffset;
+
     // size-gesture-related
     QPointF lastMouseWidgetPos;
     QPointF startResizeImagePos;
@@ -281,11 +296,24 @@ void KisLiquifyTransformStrategy::Private::recalculateTransformations()
 
     paintingOffset = transaction.originalTopLeft();
     if (!q->originalImage().isNull()) {
+        const QImage originalImage = q->originalImage();
+        QImage srcImage;
+
         if (useFlakeOptimization) {
-            transformedImage = q->originalImage().transformed(resultThumbTransform);
+            if (scaledOriginalImage.isNull() ||
+                scaledOriginalSourceKey != originalImage.cacheKey() ||
+                scaledOriginalTransform != resultThumbTransform) {
+
+                scaledOriginalImage = originalImage.transformed(resultThumbTransform);
+                scaledOriginalSourceKey = originalImage.cacheKey();
+                scaledOriginalTransform = resultThumbTransform;
+            }
+
+            srcImage = scaledOriginalImage;
             paintingTransform = QTransform();
         } else {
-            transformedImage = q->originalImage();
+            scaledOriginalImage = QImage();
+            srcImage = originalImage;
             paintingTransform = resultThumbTransform;
         }
 
@@ -297,13 +325,39 @@ void KisLiquifyTransformStrategy::Private::recalculateTransformations()
         QPointF origTLInFlake =
             imageToRealThumbTransform.map(transaction.originalTopLeft());
 
-        transformedImage =
-            currentArgs.liquifyWorker()->runOnQImage(transformedImage,
-                                                     origTLInFlake,
-                                                     imageToRealThumbTransform,
-                                                     &paintingOffset);
+        KisLiquifyTransformWorker *worker = currentArgs.liquifyWorker();
+
+        const bool canUpdatePreview =
+            !transformedImage.isNull() &&
+            previewWorker == worker &&
+            previewSourceKey == srcImage.cacheKey() &&
+            previewTransform == imageToRealThumbTransform &&
+            previewSourceOffset == origTLInFlake;
+
+        if (canUpdatePreview &&
+            worker->updateQImage(srcImage,
+                                 origTLInFlake,
+                                 imageToRealThumbTransform,
+                                 &transformedImage,
+                                 previewOffset)) {
+
+            paintingOffset = previewOffset;
+        } else {
+            transformedImage =
+                worker->runOnQImage(srcImage,
+                                    origTLInFlake,
+                                    imageToRealThumbTransform,
+                                    &paintingOffset);
+
+            previewWorker = worker;
+            previewSourceKey = srcImage.cacheKey();
+            previewTransform = imageToRealThumbTransform;
+            previewSourceOffset = origTLInFlake;
+            previewOffset = paintingOffset;
+        }
     } else {
         transformedImage = q->originalImage();
+        previewWorker = 0;
         paintingOffset = imageToThumb(transaction.originalTopLeft(), false);
         paintingTransform = resultThumbTransform;
     }
@@ -330,6 +330,38 @@ void KisTransformUtils::transformDevice(const ToolTransformArgs &config,
     }
 }
 
+bool KisTransformUtils::createTransformDeviceJobs(const ToolTransformArgs &config,
+                                                  KisPaintDeviceSP device,
+                                                  QVector<KisRunnableStrokeJobDataBase*> &jobs)
+{
+    bool result = true;
+
+    if (config.mode() == ToolTransformArgs::WARP) {
+        KisWarpTransformWorker worker(config.warpType(),
+                                      device,
+                                      config.origPoints(),
+                                      config.transfPoints(),
+                                      config.alpha(),
+                                      0);
+        worker.createRunJobs(jobs);
+    } else if (config.mode() == ToolTransformArgs::CAGE) {
+        KisCageTransformWorker worker(device,
+                                      config.origPoints(),
+                                      0,
+                                      config.pixelPrecision());
+
+        worker.prepareTransform();
+        worker.setTransformedCage(config.transfPoints());
+        worker.createRunJobs(jobs);
+    } else if (config.mode() == ToolTransformArgs::LIQUIFY && config.liquifyWorker()) {
+        config.liquifyWorker()->createRunJobs(device, jobs);
+    } else {
+        result = false;
+    }
+
+    return result;
+}
+
 QRect KisTransformUtils::needRect(const ToolTransformArgs &config,
                                   const QRect &rc,
                                   const QRect &srcBounds)
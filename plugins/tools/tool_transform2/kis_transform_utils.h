@@ -36,6 +36,7 @@
 class ToolTransformArgs;
 class KisTransformWorker;
 class TransformTransactionProperties;
+class KisRunnableStrokeJobDataBase;
 
 class KisTransformUtils
 {
@@ -99,6 +100,19 @@ public:
                                 KisPaintDeviceSP device,
                                 KisProcessingVisitor::ProgressHelper *helper);
 
+    /**
+     * Appends to \p jobs the jobs that apply a grid-based transformation
+     * (warp, cage or liquify) to \p device concurrently, patch by patch.
+     * The device is fully transformed only after all the jobs have been
+     * executed.
+     *
+     * \return false if the transformation is not grid-based, then
+     *         transformDevice() should be used instead
+     */
+    static bool createTransformDeviceJobs(const ToolTransformArgs &config,
+                                          KisPaintDeviceSP device,
+                                          QVector<KisRunnableStrokeJobDataBase*> &jobs);
+
     static QRect needRect(const ToolTransformArgs &config,
                           const QRect &rc,
                           const QRect &srcBounds);
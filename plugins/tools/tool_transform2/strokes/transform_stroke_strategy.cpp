@@ -280,17 +280,48 @@ void TransformStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
                 KisPaintDeviceSP cachedPortion = getDeviceCache(device);
                 Q_ASSERT(cachedPortion);
 
-                KisTransaction transaction(device);
+                QVector<KisRunnableStrokeJobDataBase*> jobs;
+
+                if (KisTransformUtils::createTransformDeviceJobs(td->config, cachedPortion, jobs)) {
+                    /**
+                     * Grid-based transformations are applied by concurrent
+                     * jobs, one per patch of the device, so the result is
+                     * merged into the device in a sequential job after them.
+                     */
+                    QSharedPointer<KisTransaction> transaction(new KisTransaction(device));
+                    KisNodeSP node = td->node;
+
+                    KritaUtils::addJobSequential(jobs, [this, transaction, cachedPortion, device, node, oldExtent] () {
+                        QRect mergeRect = cachedPortion->extent();
+                        KisPainter painter(device);
+                        painter.bitBlt(mergeRect.topLeft(), cachedPortion, mergeRect);
+                        painter.end();
+
+                        runAndSaveCommand(KUndo2CommandSP(transaction->endAndTake()),
+                                          KisStrokeJobData::CONCURRENT,
+                                          KisStrokeJobData::NORMAL);
+
+                        node->setDirty(oldExtent | node->extent());
+                    });
+
+                    Q_FOREACH (KisRunnableStrokeJobDataBase *job, jobs) {
+                        job->setCancellable(false);
+                    }
 
-                KisProcessingVisitor::ProgressHelper helper(td->node);
-                transformAndMergeDevice(td->config, cachedPortion,
-                                        device, &helper);
+                    runnableJobsInterface()->addRunnableJobs(jobs);
+                } else {
+                    KisTransaction transaction(device);
 
-                runAndSaveCommand(KUndo2CommandSP(transaction.endAndTake()),
-                                  KisStrokeJobData::CONCURRENT,
-                                  KisStrokeJobData::NORMAL);
+                    KisProcessingVisitor::ProgressHelper helper(td->node);
+                    transformAndMergeDevice(td->config, cachedPortion,
+                                            device, &helper);
 
-                td->node->setDirty(oldExtent | td->node->extent());
+                    runAndSaveCommand(KUndo2CommandSP(transaction.endAndTake()),
+                                      KisStrokeJobData::CONCURRENT,
+                                      KisStrokeJobData::NORMAL);
+
+                    td->node->setDirty(oldExtent | td->node->extent());
+                }
             } else if (KisExternalLayer *extLayer =
                   dynamic_cast<KisExternalLayer*>(td->node.data())) {
 